@@ -71,13 +71,14 @@ void DataCacheItem_t::DestroyResource()
 
 CDataCacheSection::CDataCacheSection( CDataCache *pSharedCache, IDataCacheClient *pClient, const char *pszName )
   :	m_pClient( pClient ),
-	m_LRU( pSharedCache->m_LRU ),
 	m_mutex( pSharedCache->m_mutex ),
 	m_pSharedCache( pSharedCache ),
 	m_nFrameUnlockCounter( 0 ),
 	m_options( 0 )
 {
 	memset( &m_status, 0, sizeof(m_status) );
+	m_nGetRequests = 0;
+	m_nGetHits = 0;
 	AssertMsg1( strlen(pszName) <= DC_MAX_CLIENT_NAME, "Cache client name too long \"%s\"", pszName );
 	Q_strncpy( szName, pszName, sizeof(szName) );
 
@@ -204,12 +205,19 @@ bool CDataCacheSection::AddEx( DataCacheClientID_t clientId, const void *pItemDa
 		this
 	};
 
-	memhandle_t hMem = m_LRU.CreateResource( itemData, true );
+	memhandle_t hMem = m_pSharedCache->CreateItem( itemData );
+	if ( hMem == INVALID_MEMHANDLE )
+	{
+		AssertMsg1( false, "Data cache is out of handles adding to \"%s\"", GetName() );
+		if ( pHandle )
+		{
+			*pHandle = DC_INVALID_HANDLE;
+		}
+		return false;
+	}
 
 	Assert( hMem != (memhandle_t)0 && hMem != (memhandle_t)DC_INVALID_HANDLE );
 
-	AccessItem( hMem )->hLRU = hMem;
-
 	if ( pHandle )
 	{
 		*pHandle = (DataCacheHandle_t)hMem;
@@ -230,7 +238,8 @@ bool CDataCacheSection::AddEx( DataCacheClientID_t clientId, const void *pItemDa
 
 	g_iDontForceFlush--;
 
-	m_LRU.UnlockResource( hMem );
+	memhandle_t hLRU;
+	AccessLRU( hMem, &hLRU ).UnlockResource( hLRU );
 
 	return true;
 }
@@ -261,28 +270,31 @@ DataCacheHandle_t CDataCacheSection::DoFind( DataCacheClientID_t clientId )
 	AUTO_LOCK( m_mutex );
 	memhandle_t hCurrent;
 
-	hCurrent = GetFirstUnlockedItem();
-
-	while ( hCurrent != INVALID_MEMHANDLE )
+	for ( int iShard = 0; iShard < DC_LRU_SHARDS; iShard++ )
 	{
-		if ( AccessItem( hCurrent )->clientId == clientId )
+		AUTO_LOCK_( CDataCacheLRU, m_pSharedCache->m_LRU[iShard] );
+
+		hCurrent = GetFirstUnlockedItem( iShard );
+
+		while ( hCurrent != INVALID_MEMHANDLE )
 		{
-			m_status.nFindHits++;
-			return (DataCacheHandle_t)hCurrent;
+			if ( AccessItem( hCurrent )->clientId == clientId )
+			{
+				return (DataCacheHandle_t)hCurrent;
+			}
+			hCurrent = GetNextItem( hCurrent );
 		}
-		hCurrent = GetNextItem( hCurrent );
-	}
 
-	hCurrent = GetFirstLockedItem();
+		hCurrent = GetFirstLockedItem( iShard );
 
-	while ( hCurrent != INVALID_MEMHANDLE )
-	{
-		if ( AccessItem( hCurrent )->clientId == clientId )
+		while ( hCurrent != INVALID_MEMHANDLE )
 		{
-			m_status.nFindHits++;
-			return (DataCacheHandle_t)hCurrent;
+			if ( AccessItem( hCurrent )->clientId == clientId )
+			{
+				return (DataCacheHandle_t)hCurrent;
+			}
+			hCurrent = GetNextItem( hCurrent );
 		}
-		hCurrent = GetNextItem( hCurrent );
 	}
 
 	return DC_INVALID_HANDLE;
@@ -298,15 +310,17 @@ DataCacheRemoveResult_t CDataCacheSection::Remove( DataCacheHandle_t handle, con
 
 	if ( handle != DC_INVALID_HANDLE )
 	{
-		memhandle_t lruHandle = (memhandle_t)handle;
-		if ( m_LRU.LockCount( lruHandle ) > 0 )
+		memhandle_t lruHandle;
+		CDataCacheLRU &lru = AccessLRU( (memhandle_t)handle, &lruHandle );
+		if ( lru.LockCount( lruHandle ) > 0 )
 		{
 			return DC_LOCKED;
 		}
 
 		AUTO_LOCK( m_mutex );
+		AUTO_LOCK_( CDataCacheLRU, lru );
 
-		DataCacheItem_t *pItem = AccessItem( lruHandle );
+		DataCacheItem_t *pItem = lru.GetResource_NoLockNoLRUTouch( lruHandle );
 		if ( pItem )
 		{
 			if ( ppItemData )
@@ -319,7 +333,7 @@ DataCacheRemoveResult_t CDataCacheSection::Remove( DataCacheHandle_t handle, con
 				*pItemSize = pItem->size;
 			}
 
-			DiscardItem( lruHandle, ( bNotify ) ? DC_REMOVED : DC_NONE );
+			DiscardItem( (memhandle_t)handle, ( bNotify ) ? DC_REMOVED : DC_NONE );
 
 			return DC_OK;
 		}
@@ -334,7 +348,7 @@ DataCacheRemoveResult_t CDataCacheSection::Remove( DataCacheHandle_t handle, con
 //-----------------------------------------------------------------------------
 bool CDataCacheSection::IsPresent( DataCacheHandle_t handle )
 {
-	return ( m_LRU.GetResource_NoLockNoLRUTouch( (memhandle_t)handle ) != NULL );
+	return ( AccessItem( (memhandle_t)handle ) != NULL );
 }
 
 
@@ -350,10 +364,12 @@ void *CDataCacheSection::Lock( DataCacheHandle_t handle )
 
 	if ( handle != DC_INVALID_HANDLE )
 	{
-		DataCacheItem_t *pItem = m_LRU.LockResource( (memhandle_t)handle );
+		memhandle_t hLRU;
+		int nLockCount;
+		DataCacheItem_t *pItem = AccessLRU( (memhandle_t)handle, &hLRU ).LockResourceReturnCount( &nLockCount, hLRU );
 		if ( pItem )
 		{
-			if ( m_LRU.LockCount( (memhandle_t)handle ) == 1 )
+			if ( nLockCount == 1 )
 			{
 				NoteLock( pItem->size );
 			}
@@ -377,13 +393,15 @@ int CDataCacheSection::Unlock( DataCacheHandle_t handle )
 	{
 		AssertMsg( AccessItem( (memhandle_t)handle ) != NULL, "Attempted to unlock nonexistent cache entry" );
 		unsigned nBytesUnlocked = 0;
-		m_mutex.Lock();
-		iNewLockCount = m_LRU.UnlockResource( (memhandle_t)handle );
+		memhandle_t hLRU;
+		CDataCacheLRU &lru = AccessLRU( (memhandle_t)handle, &hLRU );
+		lru.Lock();
+		iNewLockCount = lru.UnlockResource( hLRU );
 		if ( iNewLockCount == 0 )
 		{
-			nBytesUnlocked = AccessItem( (memhandle_t)handle )->size;
+			nBytesUnlocked = lru.GetResource_NoLockNoLRUTouch( hLRU )->size;
 		}
-		m_mutex.Unlock();
+		lru.Unlock();
 		if ( nBytesUnlocked )
 		{
 			NoteUnlock( nBytesUnlocked );
@@ -423,17 +441,28 @@ void *CDataCacheSection::Get( DataCacheHandle_t handle, bool bFrameLock )
 	if ( mem_force_flush.GetBool() && !g_iDontForceFlush)
 		Flush();
 
+	m_nGetRequests++;
+
 	if ( handle != DC_INVALID_HANDLE )
 	{
+		void *pData;
 		if ( bFrameLock && IsFrameLocking() )
-			return FrameLock( handle );
+		{
+			pData = FrameLock( handle );
+		}
+		else
+		{
+			// Touching only marks the item in its shard, nothing is relinked
+			memhandle_t hLRU;
+			DataCacheItem_t *pItem = AccessLRU( (memhandle_t)handle, &hLRU ).GetResource_NoLock( hLRU );
+			pData = ( pItem ) ? const_cast<void *>( pItem->pItemData ) : NULL;
+		}
 
-		AUTO_LOCK( m_mutex );
-		DataCacheItem_t *pItem = m_LRU.GetResource_NoLock( (memhandle_t)handle );
-		if ( pItem )
+		if ( pData )
 		{
-			return const_cast<void *>( pItem->pItemData );
+			m_nGetHits++;
 		}
+		return pData;
 	}
 
 	return NULL;
@@ -447,17 +476,26 @@ void *CDataCacheSection::GetNoTouch( DataCacheHandle_t handle, bool bFrameLock )
 {
 	VPROF( "CDataCacheSection::GetNoTouch" );
 
+	m_nGetRequests++;
+
 	if ( handle != DC_INVALID_HANDLE )
 	{
+		void *pData;
 		if ( bFrameLock && IsFrameLocking() )
-			return FrameLock( handle );
+		{
+			pData = FrameLock( handle );
+		}
+		else
+		{
+			DataCacheItem_t *pItem = AccessItem( (memhandle_t)handle );
+			pData = ( pItem ) ? const_cast<void *>( pItem->pItemData ) : NULL;
+		}
 
-		AUTO_LOCK( m_mutex );
-		DataCacheItem_t *pItem = m_LRU.GetResource_NoLockNoLRUTouch( (memhandle_t)handle );
-		if ( pItem )
+		if ( pData )
 		{
-			return const_cast<void *>( pItem->pItemData );
+			m_nGetHits++;
 		}
+		return pData;
 	}
 
 	return NULL;
@@ -514,7 +552,9 @@ void *CDataCacheSection::FrameLock( DataCacheHandle_t handle )
 	FrameLock_t *pFrameLock = m_ThreadFrameLock.Get();
 	if ( pFrameLock )
 	{
-		DataCacheItem_t *pItem = m_LRU.LockResource( (memhandle_t)handle );
+		memhandle_t hLRU;
+		CDataCacheLRU &lru = AccessLRU( (memhandle_t)handle, &hLRU );
+		DataCacheItem_t *pItem = lru.LockResource( hLRU );
 
 		if ( pItem )
 		{
@@ -527,7 +567,7 @@ void *CDataCacheSection::FrameLock( DataCacheHandle_t handle )
 			}
 
 			pResult = const_cast<void *>(pItem->pItemData);
-			m_LRU.UnlockResource( (memhandle_t)handle );
+			lru.UnlockResource( hLRU );
 		}
 	}
 
@@ -583,7 +623,8 @@ int *CDataCacheSection::GetFrameUnlockCounterPtr()
 //-----------------------------------------------------------------------------
 int CDataCacheSection::GetLockCount( DataCacheHandle_t handle )
 {
-	return m_LRU.LockCount( (memhandle_t)handle );
+	memhandle_t hLRU;
+	return AccessLRU( (memhandle_t)handle, &hLRU ).LockCount( hLRU );
 }
 
 
@@ -592,7 +633,8 @@ int CDataCacheSection::GetLockCount( DataCacheHandle_t handle )
 //-----------------------------------------------------------------------------
 int CDataCacheSection::BreakLock( DataCacheHandle_t handle )
 {
-	return m_LRU.BreakLock( (memhandle_t)handle );
+	memhandle_t hLRU;
+	return AccessLRU( (memhandle_t)handle, &hLRU ).BreakLock( hLRU );
 }
 
 
@@ -601,7 +643,8 @@ int CDataCacheSection::BreakLock( DataCacheHandle_t handle )
 //-----------------------------------------------------------------------------
 bool CDataCacheSection::Touch( DataCacheHandle_t handle )
 {
-	m_LRU.TouchResource( (memhandle_t)handle );
+	memhandle_t hLRU;
+	AccessLRU( (memhandle_t)handle, &hLRU ).TouchResource( hLRU );
 	return true;
 }
 
@@ -611,7 +654,8 @@ bool CDataCacheSection::Touch( DataCacheHandle_t handle )
 //-----------------------------------------------------------------------------
 bool CDataCacheSection::Age( DataCacheHandle_t handle )
 {
-	m_LRU.MarkAsStale( (memhandle_t)handle );
+	memhandle_t hLRU;
+	AccessLRU( (memhandle_t)handle, &hLRU ).MarkAsStale( hLRU );
 	return true;
 }
 
@@ -633,23 +677,11 @@ unsigned CDataCacheSection::Flush( bool bUnlockedOnly, bool bNotify )
 	unsigned nBytesFlushed = 0;
 	unsigned nBytesCurrent = 0;
 
-	hCurrent = GetFirstUnlockedItem();
-
-	while ( hCurrent != INVALID_MEMHANDLE )
+	for ( int iShard = 0; iShard < DC_LRU_SHARDS; iShard++ )
 	{
-		hNext = GetNextItem( hCurrent );
-		nBytesCurrent = AccessItem( hCurrent )->size;
-
-		if ( DiscardItem( hCurrent, notificationType ) )
-		{
-			nBytesFlushed += nBytesCurrent;
-		}
-		hCurrent = hNext;
-	}
+		AUTO_LOCK_( CDataCacheLRU, m_pSharedCache->m_LRU[iShard] );
 
-	if ( !bUnlockedOnly )
-	{
-		hCurrent = GetFirstLockedItem();
+		hCurrent = GetFirstUnlockedItem( iShard );
 
 		while ( hCurrent != INVALID_MEMHANDLE )
 		{
@@ -662,6 +694,23 @@ unsigned CDataCacheSection::Flush( bool bUnlockedOnly, bool bNotify )
 			}
 			hCurrent = hNext;
 		}
+
+		if ( !bUnlockedOnly )
+		{
+			hCurrent = GetFirstLockedItem( iShard );
+
+			while ( hCurrent != INVALID_MEMHANDLE )
+			{
+				hNext = GetNextItem( hCurrent );
+				nBytesCurrent = AccessItem( hCurrent )->size;
+
+				if ( DiscardItem( hCurrent, notificationType ) )
+				{
+					nBytesFlushed += nBytesCurrent;
+				}
+				hCurrent = hNext;
+			}
+		}
 	}
 
 	return nBytesFlushed;
@@ -675,27 +724,8 @@ unsigned CDataCacheSection::Purge( unsigned nBytes )
 {
 	VPROF( "CDataCacheSection::Purge" );
 
-	AUTO_LOCK( m_mutex );
-
-	unsigned nBytesPurged = 0;
-	unsigned nBytesCurrent = 0;
-
-	memhandle_t hCurrent = GetFirstUnlockedItem();
-	memhandle_t hNext;
-
-	while ( hCurrent != INVALID_MEMHANDLE && nBytes > 0 )
-	{
-		hNext = GetNextItem( hCurrent );
-		nBytesCurrent = AccessItem( hCurrent )->size;
-
-		if ( DiscardItem( hCurrent, DC_FLUSH_DISCARD  ) )
-		{
-			nBytesPurged += nBytesCurrent;
-			nBytes -= min( nBytesCurrent, nBytes );
-		}
-		hCurrent = hNext;
-	}
-
+	unsigned nBytesPurged;
+	PurgeOldest( nBytes, (unsigned)-1, &nBytesPurged );
 	return nBytesPurged;
 }
 
@@ -703,26 +733,61 @@ unsigned CDataCacheSection::Purge( unsigned nBytes )
 // Purpose: Dump the oldest items to free the specified number of items. Returns number actually freed
 //-----------------------------------------------------------------------------
 unsigned CDataCacheSection::PurgeItems( unsigned nItems )
+{
+	return PurgeOldest( (unsigned)-1, nItems, NULL );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Dumps the oldest unlocked items until either limit is reached,
+//			returns the number of items freed. Takes the oldest of each shard
+//			in turn, which is close enough to the oldest overall.
+//-----------------------------------------------------------------------------
+unsigned CDataCacheSection::PurgeOldest( unsigned nBytes, unsigned nItems, unsigned *pBytesPurged )
 {
 	AUTO_LOCK( m_mutex );
+	m_pSharedCache->LockShards();
 
 	unsigned nPurged = 0;
+	unsigned nBytesPurged = 0;
+	unsigned nBytesCurrent = 0;
 
-	memhandle_t hCurrent = GetFirstUnlockedItem();
+	memhandle_t hCurrent[DC_LRU_SHARDS];
 	memhandle_t hNext;
+	for ( int iShard = 0; iShard < DC_LRU_SHARDS; iShard++ )
+	{
+		hCurrent[iShard] = GetFirstUnlockedItem( iShard );
+	}
 
-	while ( hCurrent != INVALID_MEMHANDLE && nItems )
+	// Stops once a whole round of the shards finds nothing left
+	int nExhausted = 0;
+	for ( int iShard = 0; nBytes > 0 && nItems > 0 && nExhausted < DC_LRU_SHARDS; iShard = ( iShard + 1 ) % DC_LRU_SHARDS )
 	{
-		hNext = GetNextItem( hCurrent );
+		if ( hCurrent[iShard] == INVALID_MEMHANDLE )
+		{
+			nExhausted++;
+			continue;
+		}
+		nExhausted = 0;
+
+		hNext = GetNextItem( hCurrent[iShard] );
+		nBytesCurrent = AccessItem( hCurrent[iShard] )->size;
 
-		if ( DiscardItem( hCurrent, DC_FLUSH_DISCARD ) )
+		if ( DiscardItem( hCurrent[iShard], DC_FLUSH_DISCARD ) )
 		{
+			nBytesPurged += nBytesCurrent;
+			nBytes -= min( nBytesCurrent, nBytes );
 			nItems--;
 			nPurged++;
 		}
-		hCurrent = hNext;
+		hCurrent[iShard] = hNext;
 	}
 
+	m_pSharedCache->UnlockShards();
+
+	if ( pBytesPurged )
+	{
+		*pBytesPurged = nBytesPurged;
+	}
 	return nPurged;
 }
 
@@ -742,7 +807,9 @@ void CDataCacheSection::OutputReport( DataCacheReportType_t reportType )
 //-----------------------------------------------------------------------------
 void CDataCacheSection::UpdateSize( DataCacheHandle_t handle, unsigned int nNewSize )
 {
-	DataCacheItem_t *pItem = m_LRU.LockResource( (memhandle_t)handle );
+	memhandle_t hLRU;
+	CDataCacheLRU &lru = AccessLRU( (memhandle_t)handle, &hLRU );
+	DataCacheItem_t *pItem = lru.LockResource( hLRU );
 	if ( !pItem )
 	{
 		// If it's gone from memory, size is already irrelevant
@@ -763,47 +830,49 @@ void CDataCacheSection::UpdateSize( DataCacheHandle_t handle, unsigned int nNewS
 			m_pSharedCache->EnsureCapacity( bytesAdded );
 		}
 		
-		m_LRU.NotifySizeChanged( (memhandle_t)handle, oldSize, nNewSize );
+		lru.NotifySizeChanged( hLRU, oldSize, nNewSize );
 		NoteSizeChanged( oldSize, nNewSize );
 	}
 
-	m_LRU.UnlockResource( (memhandle_t)handle );
+	lru.UnlockResource( hLRU );
 }
 
 //-----------------------------------------------------------------------------
 // 
 //-----------------------------------------------------------------------------
-memhandle_t CDataCacheSection::GetFirstUnlockedItem()
+memhandle_t CDataCacheSection::GetFirstUnlockedItem( int iShard )
 {
+	CDataCacheLRU &lru = m_pSharedCache->m_LRU[iShard];
 	memhandle_t hCurrent;
 
-	hCurrent = m_LRU.GetFirstUnlocked();
+	hCurrent = lru.GetFirstUnlocked();
 
 	while ( hCurrent != INVALID_MEMHANDLE )
 	{
-		if ( AccessItem( hCurrent )->pSection == this )
+		if ( lru.GetResource_NoLockNoLRUTouch( hCurrent )->pSection == this )
 		{
-			return hCurrent;
+			return DataCacheHandleFromLRU( hCurrent, iShard );
 		}
-		hCurrent = m_LRU.GetNext( hCurrent );
+		hCurrent = lru.GetNext( hCurrent );
 	}
 	return INVALID_MEMHANDLE;
 }
 
 
-memhandle_t CDataCacheSection::GetFirstLockedItem()
+memhandle_t CDataCacheSection::GetFirstLockedItem( int iShard )
 {
+	CDataCacheLRU &lru = m_pSharedCache->m_LRU[iShard];
 	memhandle_t hCurrent;
 
-	hCurrent = m_LRU.GetFirstLocked();
+	hCurrent = lru.GetFirstLocked();
 
 	while ( hCurrent != INVALID_MEMHANDLE )
 	{
-		if ( AccessItem( hCurrent )->pSection == this )
+		if ( lru.GetResource_NoLockNoLRUTouch( hCurrent )->pSection == this )
 		{
-			return hCurrent;
+			return DataCacheHandleFromLRU( hCurrent, iShard );
 		}
-		hCurrent = m_LRU.GetNext( hCurrent );
+		hCurrent = lru.GetNext( hCurrent );
 	}
 	return INVALID_MEMHANDLE;
 }
@@ -811,27 +880,34 @@ memhandle_t CDataCacheSection::GetFirstLockedItem()
 
 memhandle_t CDataCacheSection::GetNextItem( memhandle_t hCurrent )
 {
-	hCurrent = m_LRU.GetNext( hCurrent );
+	int iShard;
+	hCurrent = LRUHandleFromDataCache( hCurrent, &iShard );
+	CDataCacheLRU &lru = m_pSharedCache->m_LRU[iShard];
+
+	hCurrent = lru.GetNext( hCurrent );
 
 	while ( hCurrent != INVALID_MEMHANDLE )
 	{
-		if ( AccessItem( hCurrent )->pSection == this )
+		if ( lru.GetResource_NoLockNoLRUTouch( hCurrent )->pSection == this )
 		{
-			return hCurrent;
+			return DataCacheHandleFromLRU( hCurrent, iShard );
 		}
-		hCurrent = m_LRU.GetNext( hCurrent );
+		hCurrent = lru.GetNext( hCurrent );
 	}
 	return INVALID_MEMHANDLE;
 }
 
+// The item's shard must be locked
 bool CDataCacheSection::DiscardItem( memhandle_t hItem, DataCacheNotificationType_t type )
 {
-	DataCacheItem_t *pItem = AccessItem( hItem );
+	memhandle_t hLRU;
+	CDataCacheLRU &lru = AccessLRU( hItem, &hLRU );
+	DataCacheItem_t *pItem = lru.GetResource_NoLockNoLRUTouch( hLRU );
 	if ( DiscardItemData( pItem, type ) )
 	{
-		if ( m_LRU.LockCount( hItem ) )
+		if ( lru.LockCount( hLRU ) )
 		{
-			m_LRU.BreakLock( hItem );
+			lru.BreakLock( hLRU );
 			NoteUnlock( pItem->size );
 		}
 
@@ -874,7 +950,7 @@ bool CDataCacheSection::DiscardItem( memhandle_t hItem, DataCacheNotificationTyp
 #endif
 
 		pItem->pSection = NULL; // inhibit callbacks from lower level resource system
-		m_LRU.DestroyResource( hItem );
+		lru.DestroyResource( hLRU );
 		return true;
 	}
 	return false;
@@ -1026,10 +1102,16 @@ void *CDataCache::QueryInterface( const char *pInterfaceName )
 // 
 //-----------------------------------------------------------------------------
 CDataCache::CDataCache()
-	: m_mutex( m_LRU.AccessMutex() )
 {
 	memset( &m_status, 0, sizeof(m_status) );
 	m_bInFlush = false;
+	m_nTargetSize = (unsigned)-1;
+
+	// The shards have no budget of their own, the cache evicts from them in turn
+	for ( int i = 0; i < DC_LRU_SHARDS; i++ )
+	{
+		m_LRU[i].SetClockReplacement( true );
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -1037,8 +1119,8 @@ CDataCache::CDataCache()
 //-----------------------------------------------------------------------------
 void CDataCache::SetSize( int nMaxBytes )
 {
-	m_LRU.SetTargetSize( nMaxBytes );
-	m_LRU.FlushToTargetSize();
+	m_nTargetSize = nMaxBytes;
+	EnsureCapacity( 0 );
 
 	nMaxBytes /= 1024 * 1024;
 
@@ -1091,7 +1173,7 @@ void CDataCache::GetStatus( DataCacheStatus_t *pStatus, DataCacheLimits_t *pLimi
 	if ( pLimits )
 	{
 		Construct( pLimits );
-		pLimits->nMaxBytes = m_LRU.TargetSize();
+		pLimits->nMaxBytes = m_nTargetSize;
 	}
 }
 
@@ -1164,7 +1246,11 @@ void CDataCache::EnsureCapacity( unsigned nBytes )
 {
 	VPROF( "CDataCache::EnsureCapacity" );
 
-	m_LRU.EnsureCapacity( nBytes );
+	unsigned nUsed = GetUsedSize();
+	if ( nUsed + nBytes > m_nTargetSize )
+	{
+		PurgeShards( nUsed + nBytes - m_nTargetSize );
+	}
 }
 
 
@@ -1175,7 +1261,84 @@ unsigned CDataCache::Purge( unsigned nBytes )
 {
 	VPROF( "CDataCache::Purge" );
 
-	return m_LRU.Purge( nBytes );
+	return PurgeShards( nBytes );
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Evicts an item at a time from each shard in turn, so the cache as
+//			a whole loses roughly its least recently used items. Only the
+//			shard being evicted from is locked.
+//-----------------------------------------------------------------------------
+unsigned CDataCache::PurgeShards( unsigned nBytes )
+{
+	unsigned nBytesPurged = 0;
+	int nIdle = 0;
+	while ( nBytesPurged < nBytes && nIdle < DC_LRU_SHARDS )
+	{
+		int iShard = (unsigned)( m_iEvictShard++ ) % DC_LRU_SHARDS;
+		unsigned nShardPurged = m_LRU[iShard].Purge( 1 );
+		nIdle = ( nShardPurged ) ? 0 : nIdle + 1;
+		nBytesPurged += nShardPurged;
+	}
+	return nBytesPurged;
+}
+
+
+//-----------------------------------------------------------------------------
+// 
+//-----------------------------------------------------------------------------
+unsigned CDataCache::GetUsedSize()
+{
+	unsigned nUsed = 0;
+	for ( int i = 0; i < DC_LRU_SHARDS; i++ )
+	{
+		nUsed += m_LRU[i].UsedSize();
+	}
+	return nUsed;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Adds a locked item to the next shard with room for it
+//-----------------------------------------------------------------------------
+memhandle_t CDataCache::CreateItem( const DataCacheItemData_t &data )
+{
+	unsigned iFirst = (unsigned)( m_iNextShard++ );
+	for ( int i = 0; i < DC_LRU_SHARDS; i++ )
+	{
+		int iShard = ( iFirst + i ) % DC_LRU_SHARDS;
+		CDataCacheLRU &lru = m_LRU[iShard];
+		AUTO_LOCK_( CDataCacheLRU, lru );
+		if ( lru.ResourceCount() < DC_LRU_SHARD_MAX_ITEMS )
+		{
+			memhandle_t hLRU = lru.CreateResource( data, true );
+			memhandle_t hItem = DataCacheHandleFromLRU( hLRU, iShard );
+			lru.GetResource_NoLockNoLRUTouch( hLRU )->hLRU = hItem;
+			return hItem;
+		}
+	}
+	return INVALID_MEMHANDLE;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Locks every shard, always in the same order
+//-----------------------------------------------------------------------------
+void CDataCache::LockShards()
+{
+	for ( int i = 0; i < DC_LRU_SHARDS; i++ )
+	{
+		m_LRU[i].Lock();
+	}
+}
+
+void CDataCache::UnlockShards()
+{
+	for ( int i = DC_LRU_SHARDS - 1; i >= 0; i-- )
+	{
+		m_LRU[i].Unlock();
+	}
 }
 
 
@@ -1195,13 +1358,17 @@ unsigned CDataCache::Flush( bool bUnlockedOnly, bool bNotify )
 
 	m_bInFlush = true;
 
-	if ( bUnlockedOnly )
-	{
-		result =  m_LRU.FlushAllUnlocked();
-	}
-	else
+	result = 0;
+	for ( int i = 0; i < DC_LRU_SHARDS; i++ )
 	{
-		result = m_LRU.FlushAll();
+		if ( bUnlockedOnly )
+		{
+			result += m_LRU[i].FlushAllUnlocked();
+		}
+		else
+		{
+			result += m_LRU[i].FlushAll();
+		}
 	}
 
 	m_bInFlush = false;
@@ -1216,16 +1383,32 @@ void CDataCache::OutputReport( DataCacheReportType_t reportType, const char *psz
 {
 	int i;
 
+	// Nothing can be evicted while the shards are locked
 	AUTO_LOCK( m_mutex );
-	int bytesUsed = m_LRU.UsedSize();
-	int bytesTotal = m_LRU.TargetSize();
+	LockShards();
+
+	int bytesUsed = GetUsedSize();
+	int bytesTotal = m_nTargetSize;
 
 	float percent = 100.0f * (float)bytesUsed / (float)bytesTotal;
 
 	CUtlVector<memhandle_t> lruList, lockedlist;
 
-	m_LRU.GetLockHandleList( lockedlist );
-	m_LRU.GetLRUHandleList( lruList );
+	for ( int iShard = 0; iShard < DC_LRU_SHARDS; iShard++ )
+	{
+		int iFirstLocked = lockedlist.Count();
+		int iFirstLRU = lruList.Count();
+		m_LRU[iShard].GetLockHandleList( lockedlist );
+		m_LRU[iShard].GetLRUHandleList( lruList );
+		for ( i = iFirstLocked; i < lockedlist.Count(); ++i )
+		{
+			lockedlist[i] = DataCacheHandleFromLRU( lockedlist[i], iShard );
+		}
+		for ( i = iFirstLRU; i < lruList.Count(); ++i )
+		{
+			lruList[i] = DataCacheHandleFromLRU( lruList[i], iShard );
+		}
+	}
 
 	CDataCacheSection *pSection = NULL;
 	if ( pszSection )
@@ -1234,6 +1417,7 @@ void CDataCache::OutputReport( DataCacheReportType_t reportType, const char *psz
 		if ( !pSection )
 		{
 			Msg( "Unknown cache section %s\n", pszSection );
+			UnlockShards();
 			return;
 		}
 	}
@@ -1287,6 +1471,14 @@ void CDataCache::OutputReport( DataCacheReportType_t reportType, const char *psz
 				}
 			}
 			Msg( "Summary: %i resources total %s, %.2f %% of capacity\n", lockedlist.Count() + lruList.Count(), Q_pretifymem( bytesUsed, 2, true ), percent );
+
+			for ( int iShard = 0; iShard < DC_LRU_SHARDS; iShard++ )
+			{
+				CDataCacheShardMutex &mutex = m_LRU[iShard].AccessMutex();
+				unsigned nLocks = mutex.GetLockCount();
+				float contendedPercent = ( nLocks ) ? 100.0f * (float)mutex.GetContendedCount() / (float)nLocks : 0.0f;
+				Msg( "  Shard %d: %i resources %s, %u locks, %.2f %% contended\n", iShard, m_LRU[iShard].ResourceCount(), Q_pretifymem( m_LRU[iShard].UsedSize(), 2, true ), nLocks, contendedPercent );
+			}
 		}
 		else
 		{
@@ -1298,7 +1490,7 @@ void CDataCache::OutputReport( DataCacheReportType_t reportType, const char *psz
 			{
 				if ( AccessItem( lockedlist[ i ] )->pSection == pSection )
 				{
-					pItem = g_DataCache.m_LRU.GetResource_NoLockNoLRUTouch( lockedlist[i] );
+					pItem = AccessItem( lockedlist[i] );
 					sectionBytes += pItem->size;
 					sectionCount++;
 				}
@@ -1307,7 +1499,7 @@ void CDataCache::OutputReport( DataCacheReportType_t reportType, const char *psz
 			{
 				if ( AccessItem( lruList[ i ] )->pSection == pSection )
 				{
-					pItem = g_DataCache.m_LRU.GetResource_NoLockNoLRUTouch( lruList[i] );
+					pItem = AccessItem( lruList[i] );
 					sectionBytes += pItem->size;
 					sectionCount++;
 				}
@@ -1325,8 +1517,17 @@ void CDataCache::OutputReport( DataCacheReportType_t reportType, const char *psz
 			}
 			sectionPercent = 100.0f * (float)sectionBytes/(float)sectionSize;
 			Msg( "Section [%s]: %i resources total %s, %.2f %% of limit (%s)\n", pszSection, sectionCount, Q_pretifymem( sectionBytes, 2, true ), sectionPercent, Q_pretifymem( sectionSize, 2, true ) );
+
+			DataCacheStatus_t status;
+			pSection->GetStatus( &status );
+			unsigned nGets = pSection->GetNumGetRequests();
+			float findPercent = ( status.nFindRequests ) ? 100.0f * (float)status.nFindHits / (float)status.nFindRequests : 0.0f;
+			float getPercent = ( nGets ) ? 100.0f * (float)pSection->GetNumGetHits() / (float)nGets : 0.0f;
+			Msg( "  %u finds, %.2f %% hit; %u gets, %.2f %% hit\n", status.nFindRequests, findPercent, nGets, getPercent );
 		}
 	}
+
+	UnlockShards();
 }
 
 //-------------------------------------
@@ -1334,10 +1535,13 @@ void CDataCache::OutputReport( DataCacheReportType_t reportType, const char *psz
 void CDataCache::OutputItemReport( memhandle_t hItem )
 {
 	AUTO_LOCK( m_mutex );
-	DataCacheItem_t *pItem = m_LRU.GetResource_NoLockNoLRUTouch( hItem );
+	DataCacheItem_t *pItem = AccessItem( hItem );
 	if ( !pItem )
 		return;
 
+	memhandle_t hLRU;
+	CDataCacheLRU &lru = AccessLRU( hItem, &hLRU );
+
 	CDataCacheSection *pSection = pItem->pSection;
 
 	char name[DC_MAX_ITEM_NAME+1];
@@ -1350,7 +1554,7 @@ void CDataCache::OutputItemReport( memhandle_t hItem )
 		pSection->GetName(), 
 		pItem->clientId, pItem->pItemData, hItem,
 		( name[0] ) ? name : "unknown",
-		( m_LRU.LockCount( hItem ) ) ? CFmtStr( "Locked %d", m_LRU.LockCount( hItem ) ).operator const char*() : "" );
+		( lru.LockCount( hLRU ) ) ? CFmtStr( "Locked %d", lru.LockCount( hLRU ) ).operator const char*() : "" );
 }
 
 
@@ -1373,8 +1577,8 @@ int CDataCache::FindSectionIndex( const char *pszSection )
 //-----------------------------------------------------------------------------
 bool CDataCache::SortMemhandlesBySizeLessFunc( const memhandle_t& lhs, const memhandle_t& rhs )
 {
-	DataCacheItem_t *pItem1 = g_DataCache.m_LRU.GetResource_NoLockNoLRUTouch( lhs );
-	DataCacheItem_t *pItem2 = g_DataCache.m_LRU.GetResource_NoLockNoLRUTouch( rhs );
+	DataCacheItem_t *pItem1 = g_DataCache.AccessItem( lhs );
+	DataCacheItem_t *pItem2 = g_DataCache.AccessItem( rhs );
 
 	Assert( pItem1 );
 	Assert( pItem2 );
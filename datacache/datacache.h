@@ -64,8 +64,77 @@ struct DataCacheItem_t : DataCacheItemData_t
 };
 
 //-------------------------------------
+// The LRU is split into shards, each with its own lock, so threads working
+// on different items rarely wait on each other. The mutex counts how often
+// it's taken and how often it had to wait.
+//-------------------------------------
+
+class CDataCacheShardMutex
+{
+public:
+	CDataCacheShardMutex() : m_nLocks( 0 ), m_nContended( 0 ) {}
+
+	void Lock()
+	{
+		if ( !m_mutex.TryLock() )
+		{
+			m_mutex.Lock();
+			m_nContended++;
+		}
+		m_nLocks++;
+	}
+
+	bool TryLock()
+	{
+		if ( !m_mutex.TryLock() )
+			return false;
+		m_nLocks++;
+		return true;
+	}
+
+	void Unlock()							{ m_mutex.Unlock(); }
+	void Lock() const						{ const_cast<CDataCacheShardMutex *>(this)->Lock(); }
+	bool TryLock() const					{ return const_cast<CDataCacheShardMutex *>(this)->TryLock(); }
+	void Unlock() const						{ const_cast<CDataCacheShardMutex *>(this)->Unlock(); }
+
+	unsigned GetLockCount()					{ return m_nLocks; }
+	unsigned GetContendedCount()			{ return m_nContended; }
+
+private:
+	CThreadFastMutex	m_mutex;
+	unsigned			m_nLocks;			// both only change with the mutex held
+	unsigned			m_nContended;
+};
+
+typedef CDataManager<DataCacheItem_t, DataCacheItemData_t, DataCacheItem_t *, CDataCacheShardMutex> CDataCacheLRU;
 
-typedef CDataManager<DataCacheItem_t, DataCacheItemData_t, DataCacheItem_t *, CThreadFastMutex> CDataCacheLRU;
+// Items go to the shards round robin. Cache handles are the shard's handle
+// with the shard folded into the low bits of the index, so each shard can
+// hold 8191 items.
+#define DC_LRU_SHARD_BITS		3
+#define DC_LRU_SHARDS			( 1 << DC_LRU_SHARD_BITS )
+#define DC_LRU_SHARD_MAX_ITEMS	( 0xffff >> DC_LRU_SHARD_BITS )
+
+inline memhandle_t DataCacheHandleFromLRU( memhandle_t hLRU, int iShard )
+{
+	uintp h = (uintp)hLRU;
+	uintp index = ( h & 0xffff ) - 1;
+	return (memhandle_t)( ( h & ~(uintp)0xffff ) | ( ( index << DC_LRU_SHARD_BITS ) + iShard + 1 ) );
+}
+
+inline memhandle_t LRUHandleFromDataCache( memhandle_t hItem, int *pShard )
+{
+	uintp h = (uintp)hItem;
+	uintp index = ( h & 0xffff );
+	if ( index == 0 || hItem == INVALID_MEMHANDLE )
+	{
+		*pShard = 0;
+		return INVALID_MEMHANDLE;
+	}
+	index--;
+	*pShard = (int)( index & ( DC_LRU_SHARDS - 1 ) );
+	return (memhandle_t)( ( h & ~(uintp)0xffff ) | ( ( index >> DC_LRU_SHARD_BITS ) + 1 ) );
+}
 
 //-----------------------------------------------------------------------------
 // CDataCacheSection
@@ -101,6 +170,10 @@ public:
 	inline unsigned GetNumBytesUnlocked()	{ return m_status.nBytes - m_status.nBytesLocked; }
 	inline unsigned GetNumItemsUnlocked()	{ return m_status.nItems - m_status.nItemsLocked; }
 
+	// Diagnostics, not exact when several threads are getting at once
+	inline unsigned GetNumGetRequests()		{ return m_nGetRequests; }
+	inline unsigned GetNumGetHits()			{ return m_nGetHits; }
+
 	virtual void EnsureCapacity( unsigned nBytes, unsigned nItems = 1 );
 
 	//--------------------------------------------------------
@@ -161,10 +234,13 @@ private:
 	virtual DataCacheHandle_t DoFind( DataCacheClientID_t clientId );
 	virtual void OnRemove( DataCacheClientID_t clientId ) {}
 
-	memhandle_t GetFirstUnlockedItem();
-	memhandle_t GetFirstLockedItem();
+	// Iteration within one shard, the shard must be locked
+	memhandle_t GetFirstUnlockedItem( int iShard );
+	memhandle_t GetFirstLockedItem( int iShard );
 	memhandle_t GetNextItem( memhandle_t );
+	unsigned PurgeOldest( unsigned nBytes, unsigned nItems, unsigned *pBytesPurged );
 	DataCacheItem_t *AccessItem( memhandle_t hCurrent );
+	CDataCacheLRU &AccessLRU( memhandle_t hItem, memhandle_t *phLRU );
 	bool DiscardItem( memhandle_t hItem, DataCacheNotificationType_t type );
 	bool DiscardItemData( DataCacheItem_t *pItem, DataCacheNotificationType_t type );
 	void NoteAdd( int size );
@@ -182,9 +258,10 @@ private:
 		int				m_iThread;
 	};
 
-	CDataCacheLRU &		m_LRU;
 	CTHREADLOCAL(FrameLock_t*)	m_ThreadFrameLock;
 	DataCacheStatus_t	m_status;
+	unsigned			m_nGetRequests;
+	unsigned			m_nGetHits;
 	DataCacheLimits_t	m_limits;
 	IDataCacheClient *	m_pClient;
 	unsigned			m_options;
@@ -193,7 +270,7 @@ private:
 	CTSSimpleList<FrameLock_t> m_FreeFrameLocks;
 
 protected:
-	CThreadFastMutex &	m_mutex;
+	CThreadFastMutex &	m_mutex;		// the cache's, shared by every section
 };
 
 
@@ -287,6 +364,12 @@ private:
 	//-----------------------------------------------------
 
 	DataCacheItem_t *AccessItem( memhandle_t hCurrent );
+	CDataCacheLRU &AccessLRU( memhandle_t hItem, memhandle_t *phLRU );
+	memhandle_t CreateItem( const DataCacheItemData_t &data );
+	unsigned GetUsedSize();
+	unsigned PurgeShards( unsigned nBytes );
+	void LockShards();
+	void UnlockShards();
 
 	bool IsInFlush()						{ return m_bInFlush; }
 	int FindSectionIndex( const char *pszSection );
@@ -297,11 +380,14 @@ private:
 
 	//-----------------------------------------------------
 
-	CDataCacheLRU					m_LRU;
+	CDataCacheLRU					m_LRU[DC_LRU_SHARDS];
+	unsigned						m_nTargetSize;			// budget shared by all the shards
+	CInterlockedInt					m_iNextShard;			// shard the next item is added to
+	CInterlockedInt					m_iEvictShard;			// shard eviction takes from next
 	DataCacheStatus_t				m_status;
 	CUtlVector<CDataCacheSection *>	m_Sections;
 	bool							m_bInFlush;
-	CThreadFastMutex &				m_mutex;
+	CThreadFastMutex				m_mutex;				// held while finding, removing or walking items, taken before any shard's
 };
 
 //---------------------------------------------------------
@@ -310,9 +396,17 @@ extern CDataCache g_DataCache;
 
 //-----------------------------------------------------------------------------
 
+inline CDataCacheLRU &CDataCache::AccessLRU( memhandle_t hItem, memhandle_t *phLRU )
+{
+	int iShard;
+	*phLRU = LRUHandleFromDataCache( hItem, &iShard );
+	return m_LRU[iShard];
+}
+
 inline DataCacheItem_t *CDataCache::AccessItem( memhandle_t hCurrent ) 
 { 
-	return m_LRU.GetResource_NoLockNoLRUTouch( hCurrent ); 
+	memhandle_t hLRU;
+	return AccessLRU( hCurrent, &hLRU ).GetResource_NoLockNoLRUTouch( hLRU ); 
 }
 
 //-----------------------------------------------------------------------------
@@ -327,22 +421,27 @@ inline DataCacheItem_t *CDataCacheSection::AccessItem( memhandle_t hCurrent )
 	return m_pSharedCache->AccessItem( hCurrent ); 
 }
 
-// Note: if status updates are moved out of a mutexed section, will need to change these to use interlocked instructions
+inline CDataCacheLRU &CDataCacheSection::AccessLRU( memhandle_t hItem, memhandle_t *phLRU )
+{
+	return m_pSharedCache->AccessLRU( hItem, phLRU );
+}
+
+// Status updates aren't made under a common lock, so they're all interlocked
 
 inline void CDataCacheSection::NoteSizeChanged( int oldSize, int newSize )
 {
 	int nBytes = ( newSize - oldSize );
 
-	m_status.nBytes += nBytes;
-	m_status.nBytesLocked += nBytes;
+	ThreadInterlockedExchangeAdd( &m_status.nBytes, nBytes );
+	ThreadInterlockedExchangeAdd( &m_status.nBytesLocked, nBytes );
 	ThreadInterlockedExchangeAdd( &m_pSharedCache->m_status.nBytes, nBytes );
 	ThreadInterlockedExchangeAdd( &m_pSharedCache->m_status.nBytesLocked, nBytes );
 }
 
 inline void CDataCacheSection::NoteAdd( int size )
 {
-	m_status.nBytes += size;
-	m_status.nItems++;
+	ThreadInterlockedExchangeAdd( &m_status.nBytes, size );
+	ThreadInterlockedIncrement( &m_status.nItems );
 
 	ThreadInterlockedExchangeAdd( &m_pSharedCache->m_status.nBytes, size );
 	ThreadInterlockedIncrement( &m_pSharedCache->m_status.nItems );
@@ -350,8 +449,8 @@ inline void CDataCacheSection::NoteAdd( int size )
 
 inline void CDataCacheSection::NoteRemove( int size )
 {
-	m_status.nBytes -= size;
-	m_status.nItems--;
+	ThreadInterlockedExchangeAdd( &m_status.nBytes, -size );
+	ThreadInterlockedDecrement( &m_status.nItems );
 
 	ThreadInterlockedExchangeAdd( &m_pSharedCache->m_status.nBytes, -size );
 	ThreadInterlockedDecrement( &m_pSharedCache->m_status.nItems );
@@ -359,8 +458,8 @@ inline void CDataCacheSection::NoteRemove( int size )
 
 inline void CDataCacheSection::NoteLock( int size )
 {
-	m_status.nBytesLocked += size;
-	m_status.nItemsLocked++;
+	ThreadInterlockedExchangeAdd( &m_status.nBytesLocked, size );
+	ThreadInterlockedIncrement( &m_status.nItemsLocked );
 
 	ThreadInterlockedExchangeAdd( &m_pSharedCache->m_status.nBytesLocked, size );
 	ThreadInterlockedIncrement( &m_pSharedCache->m_status.nItemsLocked );
@@ -368,14 +467,14 @@ inline void CDataCacheSection::NoteLock( int size )
 
 inline void CDataCacheSection::NoteUnlock( int size )
 {
-	m_status.nBytesLocked -= size;
-	m_status.nItemsLocked--;
+	ThreadInterlockedExchangeAdd( &m_status.nBytesLocked, -size );
+	ThreadInterlockedDecrement( &m_status.nItemsLocked );
 
 	ThreadInterlockedExchangeAdd( &m_pSharedCache->m_status.nBytesLocked, -size );
 	ThreadInterlockedDecrement( &m_pSharedCache->m_status.nItemsLocked );
 
 	// something has been unlocked, assume cached pointers are now invalid
-	m_nFrameUnlockCounter++;
+	ThreadInterlockedIncrement( &m_nFrameUnlockCounter );
 }
 
 //-----------------------------------------------------------------------------
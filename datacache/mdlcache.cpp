@@ -14,6 +14,8 @@
 #include "tier0/icommandline.h"
 #include "tier1/utllinkedlist.h"
 #include "tier1/utlmap.h"
+#include "tier1/utlflathashtable.h"
+#include "tier1/utlpriorityqueue.h"
 #include "datacache/imdlcache.h"
 #include "istudiorender.h"
 #include "filesystem.h"
@@ -194,6 +196,10 @@ static ConVar mod_load_vcollide_async( "mod_load_vcollide_async",  ( AsyncMdlCac
 static ConVar mod_trace_load( "mod_trace_load", "0" );
 static ConVar mod_lock_mdls_on_load( "mod_lock_mdls_on_load", ( IsX360() ) ? "1" : "0" );
 static ConVar mod_load_fakestall( "mod_load_fakestall", "0", 0, "Forces all ANI file loading to stall for specified ms\n");
+static ConVar mod_load_anims_nonblocking( "mod_load_anims_nonblocking", "1", 0, "Outside of map loads, reads animation blocks the client asks for in the background instead of stalling. The zero frame pose is used until they arrive." );
+static ConVar mod_prefetch( "mod_prefetch", "1", 0, "Starts reading animations and meshes when models spawn or change sequence." );
+static ConVar mod_prefetch_inflight( "mod_prefetch_inflight", "16", 0, "Prefetches wait while this many model reads are outstanding." );
+static ConVar mod_load_budget_ms( "mod_load_budget_ms", "2", 0, "Milliseconds per frame spent finishing background model reads, 0 for no limit." );
 
 //-----------------------------------------------------------------------------
 // Utility functions
@@ -376,7 +382,7 @@ public:
 	virtual studiohwdata_t *GetHardwareData( MDLHandle_t handle );
 	virtual vcollide_t *GetVCollide( MDLHandle_t handle ) { return GetVCollideEx( handle, true); }
 	virtual vcollide_t *GetVCollideEx( MDLHandle_t handle, bool synchronousLoad = true );
-	virtual unsigned char *GetAnimBlock( MDLHandle_t handle, int nBlock );
+	virtual unsigned char *GetAnimBlock( MDLHandle_t handle, int nBlock, bool bNonBlocking = false );
 	virtual virtualmodel_t *GetVirtualModel( MDLHandle_t handle );
 	virtual virtualmodel_t *GetVirtualModelFast( const studiohdr_t *pStudioHdr, MDLHandle_t handle );
 	virtual int GetAutoplayList( MDLHandle_t handle, unsigned short **pOut );
@@ -446,6 +452,12 @@ public:
 
 	virtual void MarkFrame();
 
+	virtual void PrefetchModel( MDLHandle_t handle, int nPriority = MDLCACHE_PREFETCH_NORMAL );
+	virtual void PrefetchSequence( MDLHandle_t handle, int nSequence, int nPriority = MDLCACHE_PREFETCH_NORMAL );
+
+	void PrintStats();
+	void ResetStats();
+
 	// Queued loading
 	void ProcessQueuedData( ModelParts_t *pModelParts, bool bHeaderOnly = false );
 	static void	QueuedLoaderCallback_MDL( void *pContext, void  *pContext2, const void *pData, int nSize, LoaderError_t loaderError );
@@ -479,7 +491,8 @@ private:
 	studiohdr_t *UnserializeMDL( MDLHandle_t handle, void *pData, int nDataSize, bool bDataValid );
 
 	// Unserializes an animation block from disk
-	unsigned char *UnserializeAnimBlock( MDLHandle_t handle, int nBlock );
+	unsigned char *UnserializeAnimBlock( MDLHandle_t handle, int nBlock, bool bNonBlocking );
+	intp BeginAnimBlockLoad( MDLHandle_t handle, int nBlock, bool bAsync, int nPriority );
 
 	// Allocates/frees the anim blocks
 	void AllocateAnimBlocks( studiodata_t *pStudioData, int nCount );
@@ -501,14 +514,15 @@ private:
 	void FreeAutoplaySequences( studiodata_t *pStudioData );
 
 	FSAsyncStatus_t LoadData( const char *pszFilename, const char *pszPathID, bool bAsync, FSAsyncControl_t *pControl ) { return LoadData( pszFilename, pszPathID, NULL, 0, 0, bAsync, pControl ); }
-	FSAsyncStatus_t LoadData( const char *pszFilename, const char *pszPathID, void *pDest, int nBytes, int nOffset, bool bAsync, FSAsyncControl_t *pControl );
+	FSAsyncStatus_t LoadData( const char *pszFilename, const char *pszPathID, void *pDest, int nBytes, int nOffset, bool bAsync, FSAsyncControl_t *pControl, int nPriority = 0 );
 	vertexFileHeader_t *LoadVertexData( studiohdr_t *pStudioHdr );
 	vertexFileHeader_t *BuildAndCacheVertexData( studiohdr_t *pStudioHdr, vertexFileHeader_t *pRawVvdHdr  );
 	bool BuildHardwareData( MDLHandle_t handle, studiodata_t *pStudioData, studiohdr_t *pStudioHdr, OptimizedModel::FileHeader_t *pVtxHdr );
 	void ConvertFlexData( studiohdr_t *pStudioHdr );
 
 	int ProcessPendingAsync( intp iAsync );
-	void ProcessPendingAsyncs( MDLCacheDataType_t type = MDLCACHE_NONE );
+	void ProcessPendingAsyncs( MDLCacheDataType_t type = MDLCACHE_NONE, float flBudgetMS = 0.0f );
+	void FinishPendingAsync( intp iAsync );
 	bool ClearAsync( MDLHandle_t handle, MDLCacheDataType_t type, int iAnimBlock, bool bAbort = false );
 
 	const char *GetVTXExtension();
@@ -534,6 +548,25 @@ private:
 	void BreakFrameLock( bool bModels = true, bool bMesh = true );
 	void RestoreFrameLock();
 
+	// Prefetching
+	struct PrefetchRequest_t
+	{
+		MDLHandle_t			hModel;
+		MDLCacheDataType_t	type;			// MDLCACHE_ANIMBLOCK or MDLCACHE_STUDIOHWDATA
+		int					iAnimBlock;
+		int					nPriority;
+		unsigned			nSerial;		// requests of the same priority go in the order they came
+	};
+	static bool PrefetchLessFunc( const PrefetchRequest_t &lhs, const PrefetchRequest_t &rhs );
+
+	bool IsPrefetchable( MDLHandle_t handle );
+	void QueuePrefetch( MDLHandle_t handle, MDLCacheDataType_t type, int iAnimBlock, int nPriority );
+	void QueueSequencePrefetches( MDLHandle_t handle, studiohdr_t *pStudioHdr, int nLocalSequence, int nPriority );
+	void IssuePrefetches();
+	void PrefetchAnimBlock( MDLHandle_t handle, int nBlock );
+	void PrefetchHardwareData( MDLHandle_t handle );
+	void UpdateHardwarePrefetches();
+
 private:
 	IDataCacheSection *m_pModelCacheSection;
 	IDataCacheSection *m_pMeshCacheSection;
@@ -544,6 +577,11 @@ private:
 
 	CUtlDict< studiodata_t*, MDLHandle_t > m_MDLDict;
 
+	// FindMDL is hit for every model precache and prop spawn; this avoids
+	// walking the dictionary's tree with a stricmp per level. Keys point
+	// at the dictionary's own copy of the name.
+	CUtlFlatHashtable< const char *, MDLHandle_t, CaselessStringHashFunctor, CaselessStringEqualFunctor > m_MDLNameIndex;
+
 	IMDLCacheNotify *m_pCacheNotify;
 
 	CUtlFixedLinkedList< AsyncInfo_t > m_PendingAsyncs;
@@ -551,9 +589,28 @@ private:
 	CThreadFastMutex m_QueuedLoadingMutex;
 	CThreadFastMutex m_AsyncMutex;
 
+	// Prefetches not yet issued, and the highest priority each one is queued at
+	CUtlPriorityQueue< PrefetchRequest_t > m_PrefetchQueue;
+	CUtlMap< int, int > m_QueuedPrefetches;
+	unsigned m_nPrefetchSerial;
+
+	// Models whose VTX read waits for their VVD
+	CUtlVector< MDLHandle_t > m_HardwarePrefetches;
+
+	// While set, LoadData reads on the main thread are asynchronous at this priority
+	bool m_bStreaming;
+	int m_nStreamPriority;
+
+	// Statistics
+	int m_nBlockingLoads;
+	int m_nAnimFallbacks;
+	int m_nPrefetchesIssued;
+	int64 m_nBytesRead;
+
 	bool m_bLostVideoMemory : 1;
 	bool m_bConnected : 1;
 	bool m_bInitialized : 1;
+	bool m_bMapLoading : 1;
 };
 
 //-----------------------------------------------------------------------------
@@ -582,11 +639,16 @@ static void RestoreMaterialSystemObjects( int nChangeFlags )
 //-----------------------------------------------------------------------------
 // Constructor
 //-----------------------------------------------------------------------------
-CMDLCache::CMDLCache() : BaseClass( false )
+CMDLCache::CMDLCache() : BaseClass( false ), m_PrefetchQueue( 0, 0, PrefetchLessFunc ), m_QueuedPrefetches( DefLessFunc( int ) )
 {
 	m_bLostVideoMemory = false;
 	m_bConnected = false;
 	m_bInitialized = false;
+	m_bMapLoading = false;
+	m_bStreaming = false;
+	m_nStreamPriority = MDLCACHE_PREFETCH_NORMAL;
+	m_nPrefetchSerial = 0;
+	ResetStats();
 	m_pCacheNotify = NULL;
 	m_pModelCacheSection = NULL;
 	m_pMeshCacheSection = NULL;
@@ -737,6 +799,10 @@ void CMDLCache::Shutdown()
 		}
 
 		m_MDLDict.Purge();
+		m_MDLNameIndex.Purge();
+		m_PrefetchQueue.Purge();
+		m_QueuedPrefetches.Purge();
+		m_HardwarePrefetches.Purge();
 
 		if ( m_pModelCacheSection )
 		{
@@ -941,10 +1007,11 @@ MDLHandle_t CMDLCache::FindMDL( const char *pMDLRelativePath )
 	V_strncpy( szFixedName, pMDLRelativePath, sizeof( szFixedName ) );
 	V_RemoveDotSlashes( szFixedName, '/' );
 
-	MDLHandle_t handle = m_MDLDict.Find( szFixedName );
+	MDLHandle_t handle = m_MDLNameIndex.Get( szFixedName, m_MDLDict.InvalidIndex() );
 	if ( handle == m_MDLDict.InvalidIndex() )
 	{
 		handle = m_MDLDict.Insert( szFixedName, NULL );
+		m_MDLNameIndex.Insert( m_MDLDict.GetElementName( handle ), handle );
 		InitStudioData( handle );
 	}
 
@@ -977,6 +1044,7 @@ int CMDLCache::Release( MDLHandle_t handle )
 	if ( nRefCount <= 0 )
 	{
 		ShutdownStudioData( handle );
+		m_MDLNameIndex.Remove( m_MDLDict.GetElementName( handle ) );
 		m_MDLDict.RemoveAt( handle );
 	}
 
@@ -1204,7 +1272,7 @@ void CMDLCache::FreeAnimBlocks( MDLHandle_t handle )
 //-----------------------------------------------------------------------------
 // Unserializes an animation block from disk
 //-----------------------------------------------------------------------------
-unsigned char *CMDLCache::UnserializeAnimBlock( MDLHandle_t handle, int nBlock )
+unsigned char *CMDLCache::UnserializeAnimBlock( MDLHandle_t handle, int nBlock, bool bNonBlocking )
 {
 	VPROF( "CMDLCache::UnserializeAnimBlock" );
 
@@ -1219,62 +1287,90 @@ unsigned char *CMDLCache::UnserializeAnimBlock( MDLHandle_t handle, int nBlock )
 
 	studiodata_t *pStudioData = m_MDLDict[handle];
 
+	// Outside of map loads a missing block is read in the background rather
+	// than stalling the frame; bone setup uses the zero frame pose meanwhile.
+	// Only callers that can draw that pose ask for it, the server needs the
+	// real one for hitboxes.
+	bNonBlocking = mod_load_anims_async.GetBool() || ( bNonBlocking && mod_load_anims_nonblocking.GetBool() && !m_bMapLoading );
+
 	intp iAsync = GetAsyncInfoIndex( handle, MDLCACHE_ANIMBLOCK, nBlock );
 
 	if ( iAsync == NO_ASYNC )
 	{
-		studiohdr_t *pStudioHdr = GetStudioHdr( handle );
-
-		// FIXME: For consistency, the block name maybe shouldn't have 'model' in it.
-		char const *pModelName = pStudioHdr->pszAnimBlockName();
-		mstudioanimblock_t *pBlock = pStudioHdr->pAnimBlock( nBlock );
-		int nSize = pBlock->dataend - pBlock->datastart;
-		if ( nSize == 0 )
+		// Something wants this now, get it ahead of any prefetches
+		iAsync = BeginAnimBlockLoad( handle, nBlock, bNonBlocking, MDLCACHE_PREFETCH_HIGH );
+		if ( iAsync == NO_ASYNC )
 			return NULL;
+	}
+	else if ( !bNonBlocking )
+	{
+		// Being prefetched, wait for it as it would have been read synchronously
+		FinishPendingAsync( iAsync );
+	}
 
-		// allocate space in the cache
-		pStudioData->m_pAnimBlock[nBlock] = NULL;
+	ProcessPendingAsync( iAsync );
 
-		char pFileName[MAX_PATH];
-		Q_strncpy( pFileName, pModelName, sizeof(pFileName) );
-		Q_FixSlashes( pFileName );
-#ifdef POSIX
-		Q_strlower( pFileName );
-#endif
-		if ( IsX360() )
-		{
-			char pX360Filename[MAX_PATH];
-			UpdateOrCreate( pStudioHdr, pFileName, pX360Filename, sizeof( pX360Filename ), "GAME" );
-			Q_strncpy( pFileName, pX360Filename, sizeof(pX360Filename) );
-		}
+	unsigned char *pData = ( unsigned char * )CheckData( pStudioData->m_pAnimBlock[nBlock], MDLCACHE_ANIMBLOCK );
+	if ( !pData )
+	{
+		++m_nAnimFallbacks;
+	}
+	return pData;
+}
 
-		MdlCacheMsg( "MDLCache: Begin load Anim Block %s (block %i)\n", GetModelName( handle ), nBlock );
+//-----------------------------------------------------------------------------
+// Starts reading an animation block, returns NO_ASYNC if it's empty
+//-----------------------------------------------------------------------------
+intp CMDLCache::BeginAnimBlockLoad( MDLHandle_t handle, int nBlock, bool bAsync, int nPriority )
+{
+	studiodata_t *pStudioData = m_MDLDict[handle];
+	studiohdr_t *pStudioHdr = GetStudioHdr( handle );
 
-		AsyncInfo_t info;
-		if ( IsDebug() )
-		{
-			memset( &info, 0xdd, sizeof( AsyncInfo_t ) );
-		}
-		info.hModel = handle;
-		info.type = MDLCACHE_ANIMBLOCK;
-		info.iAnimBlock = nBlock;
-		info.hControl = NULL;
-		LoadData( pFileName, "GAME", NULL, nSize, pBlock->datastart, mod_load_anims_async.GetBool(), &info.hControl );
-		{
-			AUTO_LOCK( m_AsyncMutex );
-			iAsync = SetAsyncInfoIndex( handle, MDLCACHE_ANIMBLOCK, nBlock, m_PendingAsyncs.AddToTail( info ) );
-		}
+	// FIXME: For consistency, the block name maybe shouldn't have 'model' in it.
+	char const *pModelName = pStudioHdr->pszAnimBlockName();
+	mstudioanimblock_t *pBlock = pStudioHdr->pAnimBlock( nBlock );
+	int nSize = pBlock->dataend - pBlock->datastart;
+	if ( nSize == 0 )
+		return NO_ASYNC;
+
+	// allocate space in the cache
+	pStudioData->m_pAnimBlock[nBlock] = NULL;
+
+	char pFileName[MAX_PATH];
+	Q_strncpy( pFileName, pModelName, sizeof(pFileName) );
+	Q_FixSlashes( pFileName );
+#ifdef POSIX
+	Q_strlower( pFileName );
+#endif
+	if ( IsX360() )
+	{
+		char pX360Filename[MAX_PATH];
+		UpdateOrCreate( pStudioHdr, pFileName, pX360Filename, sizeof( pX360Filename ), "GAME" );
+		Q_strncpy( pFileName, pX360Filename, sizeof(pX360Filename) );
 	}
 
-	ProcessPendingAsync( iAsync );
+	MdlCacheMsg( "MDLCache: Begin load Anim Block %s (block %i)\n", GetModelName( handle ), nBlock );
 
-	return ( unsigned char * )CheckData( pStudioData->m_pAnimBlock[nBlock], MDLCACHE_ANIMBLOCK );
+	AsyncInfo_t info;
+	if ( IsDebug() )
+	{
+		memset( &info, 0xdd, sizeof( AsyncInfo_t ) );
+	}
+	info.hModel = handle;
+	info.type = MDLCACHE_ANIMBLOCK;
+	info.iAnimBlock = nBlock;
+	info.hControl = NULL;
+	LoadData( pFileName, "GAME", NULL, nSize, pBlock->datastart, bAsync, &info.hControl, nPriority );
+	{
+		AUTO_LOCK( m_AsyncMutex );
+		return SetAsyncInfoIndex( handle, MDLCACHE_ANIMBLOCK, nBlock, m_PendingAsyncs.AddToTail( info ) );
+	}
 }
 
 //-----------------------------------------------------------------------------
 // Gets at an animation block associated with an MDL
 //-----------------------------------------------------------------------------
-unsigned char *CMDLCache::GetAnimBlock( MDLHandle_t handle, int nBlock )
+unsigned char *CMDLCache::GetAnimBlock( MDLHandle_t handle, int nBlock, bool bNonBlocking )
 {
 	if ( mod_test_not_available.GetBool() )
 		return NULL;
@@ -1301,7 +1397,7 @@ unsigned char *CMDLCache::GetAnimBlock( MDLHandle_t handle, int nBlock )
 		pStudioData->m_pAnimBlock[nBlock] = NULL;
 
 		// It's not in memory, read it off of disk
-		pData = UnserializeAnimBlock( handle, nBlock );
+		pData = UnserializeAnimBlock( handle, nBlock, bNonBlocking );
 	}
 
 	if (mod_load_fakestall.GetInt())
@@ -1584,6 +1680,11 @@ bool CMDLCache::LoadHardwareData( MDLHandle_t handle )
 			iAsync = SetAsyncInfoIndex( handle, MDLCACHE_STUDIOHWDATA, m_PendingAsyncs.AddToTail( info ) );
 		}
 	}
+	else if ( !m_bStreaming && !mod_load_mesh_async.GetBool() )
+	{
+		// Being prefetched, wait for it as it would have been read synchronously
+		FinishPendingAsync( iAsync );
+	}
 
 	if ( ProcessPendingAsync( iAsync ) > 0 )
 	{
@@ -1937,6 +2038,39 @@ int CMDLCache::UpdateOrCreate( studiohdr_t *pHdr, const char *pSourceName, char
 	return ::UpdateOrCreate( pSourceName, pTargetName, targetLen, pPathID, MdlcacheCreateCallback, bForce, pHdr );
 }
 
+//-----------------------------------------------------------------------------
+// Reads a file by copying it out of a mapped view, which skips the read
+// buffers (and for VPKs, the read cache) it would otherwise pass through
+//-----------------------------------------------------------------------------
+static bool ReadFileMapped( const char *pFileName, const char *pPath, CUtlBuffer &buf, int nMaxBytes )
+{
+	FileHandle_t hFile = g_pFullFileSystem->Open( pFileName, "rb", pPath );
+	if ( !hFile )
+		return false;
+
+	unsigned nBytes = g_pFullFileSystem->Size( hFile );
+	if ( nMaxBytes > 0 )
+	{
+		nBytes = MIN( nBytes, (unsigned)nMaxBytes );
+	}
+
+	bool bOk;
+	void *pView = g_pFullFileSystem->MapFileView( hFile, 0, nBytes );
+	if ( pView )
+	{
+		buf.Put( pView, nBytes );
+		g_pFullFileSystem->UnmapFileView( pView, nBytes );
+		bOk = true;
+	}
+	else
+	{
+		bOk = g_pFullFileSystem->ReadToBuffer( hFile, buf, nMaxBytes );
+	}
+
+	g_pFullFileSystem->Close( hFile );
+	return bOk;
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Attempts to read a file native to the current platform
 //-----------------------------------------------------------------------------
@@ -1954,7 +2088,7 @@ bool CMDLCache::ReadFileNative( char *pFileName, const char *pPath, CUtlBuffer &
 	else
 	{
 		// Read the PC version
-		bOk = g_pFullFileSystem->ReadFile( pFileName, pPath, buf, nMaxBytes );
+		bOk = ReadFileMapped( pFileName, pPath, buf, nMaxBytes );
 
 		if( bOk && type == MDLCACHE_STUDIOHDR )
 		{
@@ -2512,6 +2646,8 @@ void CMDLCache::FinishPendingLoads()
 //-----------------------------------------------------------------------------
 void CMDLCache::BeginMapLoad()
 {
+	m_bMapLoading = true;
+
 	BreakFrameLock();
 
 	studiodata_t *pStudioData;
@@ -2554,6 +2690,8 @@ void CMDLCache::EndMapLoad()
 	}
 
 	RestoreFrameLock();
+
+	m_bMapLoading = false;
 }
 
 
@@ -2726,7 +2864,7 @@ vertexFileHeader_t *CMDLCache::CacheVertexData( studiohdr_t *pStudioHdr )
 //-----------------------------------------------------------------------------
 // Start an async transfer
 //-----------------------------------------------------------------------------
-FSAsyncStatus_t CMDLCache::LoadData( const char *pszFilename, const char *pszPathID, void *pDest, int nBytes, int nOffset, bool bAsync, FSAsyncControl_t *pControl )
+FSAsyncStatus_t CMDLCache::LoadData( const char *pszFilename, const char *pszPathID, void *pDest, int nBytes, int nOffset, bool bAsync, FSAsyncControl_t *pControl, int nPriority )
 {
 	if ( !*pControl )
 	{
@@ -2747,9 +2885,20 @@ FSAsyncStatus_t CMDLCache::LoadData( const char *pszFilename, const char *pszPat
 			asyncRequest.flags = FSASYNC_FLAGS_ALLOCNOFREE;
 		}
 
+		if ( m_bStreaming && ThreadInMainThread() )
+		{
+			bAsync = true;
+			nPriority = m_nStreamPriority;
+		}
+		asyncRequest.priority = nPriority;
+
 		if ( !bAsync )
 		{
 			asyncRequest.flags |= FSASYNC_FLAGS_SYNC;
+			if ( !m_bMapLoading )
+			{
+				++m_nBlockingLoads;
+			}
 		}
 
 		MEM_ALLOC_CREDIT();
@@ -3133,6 +3282,11 @@ int CMDLCache::ProcessPendingAsync( intp iAsync )
 	pInfo = &info;
 	ClearAsync( pInfo->hModel, pInfo->type, pInfo->iAnimBlock );
 
+	if ( status == FSASYNC_OK )
+	{
+		m_nBytesRead += nBytesRead;
+	}
+
 	switch ( pInfo->type )
 	{
 	case MDLCACHE_VERTEXES:
@@ -3164,7 +3318,7 @@ int CMDLCache::ProcessPendingAsync( intp iAsync )
 //-----------------------------------------------------------------------------
 //
 //-----------------------------------------------------------------------------
-void CMDLCache::ProcessPendingAsyncs( MDLCacheDataType_t type )
+void CMDLCache::ProcessPendingAsyncs( MDLCacheDataType_t type, float flBudgetMS )
 {
 	if ( !ThreadInMainThread() )
 	{
@@ -3185,6 +3339,8 @@ void CMDLCache::ProcessPendingAsyncs( MDLCacheDataType_t type )
 
 	AUTO_LOCK( m_AsyncMutex );
 
+	double flEndTime = ( flBudgetMS > 0.0f ) ? Plat_FloatTime() + flBudgetMS * 0.001 : 0.0;
+
 	// Process all of the completed loads that were requested before a new one. This ensures two
 	// things -- the LRU is in correct order, and it catches precached items lurking
 	// in the async queue that have only been requested once (thus aren't being cached
@@ -3202,6 +3358,12 @@ void CMDLCache::ProcessPendingAsyncs( MDLCacheDataType_t type )
 				// indeterminate or pending
 				break;
 			}
+
+			// The rest wait for the next frame
+			if ( flEndTime != 0.0 && Plat_FloatTime() >= flEndTime )
+			{
+				break;
+			}
 		}
 
 		current = next;
@@ -3210,6 +3372,24 @@ void CMDLCache::ProcessPendingAsyncs( MDLCacheDataType_t type )
 	bReentering = false;
 }
 
+//-----------------------------------------------------------------------------
+// Waits for a pending read to finish
+//-----------------------------------------------------------------------------
+void CMDLCache::FinishPendingAsync( intp iAsync )
+{
+	FSAsyncControl_t hControl;
+	{
+		AUTO_LOCK( m_AsyncMutex );
+		hControl = m_PendingAsyncs[iAsync].hControl;
+	}
+
+	if ( hControl && g_pFullFileSystem->AsyncStatus( hControl ) == FSASYNC_STATUS_PENDING )
+	{
+		++m_nBlockingLoads;
+		g_pFullFileSystem->AsyncFinish( hControl, true );
+	}
+}
+
 //-----------------------------------------------------------------------------
 // Cache model's specified dynamic data
 //-----------------------------------------------------------------------------
@@ -3438,6 +3618,10 @@ vertexFileHeader_t *CMDLCache::LoadVertexData( studiohdr_t *pStudioHdr )
 			iAsync = SetAsyncInfoIndex( handle, MDLCACHE_VERTEXES, m_PendingAsyncs.AddToTail( info ) );
 		}
 	}
+	else if ( !m_bStreaming && !mod_load_mesh_async.GetBool() )
+	{
+		FinishPendingAsync( iAsync );
+	}
 
 	ProcessPendingAsync( iAsync );
 
@@ -3949,11 +4133,274 @@ void CMDLCache::ResetErrorModelStatus( MDLHandle_t handle )
 }
 
 //-----------------------------------------------------------------------------
-//
+// Issues queued prefetches and finishes reads that have arrived, within the
+// frame's budget
 //-----------------------------------------------------------------------------
 void CMDLCache::MarkFrame()
 {
-	ProcessPendingAsyncs();
+	IssuePrefetches();
+	ProcessPendingAsyncs( MDLCACHE_NONE, mod_load_budget_ms.GetFloat() );
+	UpdateHardwarePrefetches();
+}
+
+//-----------------------------------------------------------------------------
+// Prefetching
+//-----------------------------------------------------------------------------
+bool CMDLCache::PrefetchLessFunc( const PrefetchRequest_t &lhs, const PrefetchRequest_t &rhs )
+{
+	if ( lhs.nPriority != rhs.nPriority )
+		return lhs.nPriority < rhs.nPriority;
+
+	// Older requests go first
+	return ( int )( lhs.nSerial - rhs.nSerial ) > 0;
+}
+
+bool CMDLCache::IsPrefetchable( MDLHandle_t handle )
+{
+	// Prefetches never read the .mdl itself
+	return ( handle != MDLHANDLE_INVALID && m_MDLDict.IsValidIndex( handle ) && m_MDLDict[handle] &&
+		!( m_MDLDict[handle]->m_nFlags & STUDIODATA_ERROR_MODEL ) && IsDataLoaded( handle, MDLCACHE_STUDIOHDR ) );
+}
+
+void CMDLCache::PrefetchModel( MDLHandle_t handle, int nPriority )
+{
+	if ( !mod_prefetch.GetBool() || !ThreadInMainThread() || !IsPrefetchable( handle ) )
+		return;
+
+	if ( m_MDLDict[handle]->m_nFlags & ( STUDIODATA_FLAGS_STUDIOMESH_LOADED | STUDIODATA_FLAGS_NO_STUDIOMESH ) )
+		return;
+
+	QueuePrefetch( handle, MDLCACHE_STUDIOHWDATA, 0, nPriority );
+}
+
+void CMDLCache::PrefetchSequence( MDLHandle_t handle, int nSequence, int nPriority )
+{
+	if ( !mod_prefetch.GetBool() || !ThreadInMainThread() || nSequence < 0 || !IsPrefetchable( handle ) )
+		return;
+
+	studiohdr_t *pStudioHdr = GetStudioHdr( handle );
+	if ( pStudioHdr->numincludemodels == 0 )
+	{
+		QueueSequencePrefetches( handle, pStudioHdr, nSequence, nPriority );
+		return;
+	}
+
+	// The sequence indexes the virtual model, its animations belong to
+	// whichever model it came from. Don't build the virtual model for this.
+	virtualmodel_t *pVModel = m_MDLDict[handle]->m_pVirtualModel;
+	if ( !pVModel )
+		return;
+
+	MDLHandle_t hGroup;
+	int nLocalSequence;
+	{
+		AUTO_LOCK( pVModel->m_Lock );
+		if ( nSequence >= pVModel->m_seq.Count() )
+			return;
+
+		hGroup = VoidPtrToMDLHandle( pVModel->m_group[ pVModel->m_seq[nSequence].group ].cache );
+		nLocalSequence = pVModel->m_seq[nSequence].index;
+	}
+
+	if ( IsPrefetchable( hGroup ) )
+	{
+		QueueSequencePrefetches( hGroup, GetStudioHdr( hGroup ), nLocalSequence, nPriority );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Queues the blocks holding the start of each of the sequence's animations,
+// plus the block after that for animations split into sections
+//-----------------------------------------------------------------------------
+void CMDLCache::QueueSequencePrefetches( MDLHandle_t handle, studiohdr_t *pStudioHdr, int nLocalSequence, int nPriority )
+{
+	if ( nLocalSequence >= pStudioHdr->numlocalseq || pStudioHdr->numanimblocks <= 1 )
+		return;
+
+	mstudioseqdesc_t *pSeqdesc = pStudioHdr->pLocalSeqdesc( nLocalSequence );
+	for ( int y = 0; y < pSeqdesc->groupsize[1]; y++ )
+	{
+		for ( int x = 0; x < pSeqdesc->groupsize[0]; x++ )
+		{
+			mstudioanimdesc_t *pAnimdesc = pStudioHdr->pLocalAnimdesc( pSeqdesc->anim( x, y ) );
+			if ( pAnimdesc->sectionframes == 0 )
+			{
+				QueuePrefetch( handle, MDLCACHE_ANIMBLOCK, pAnimdesc->animblock, nPriority );
+				continue;
+			}
+
+			int nFirstBlock = pAnimdesc->pSection( 0 )->animblock;
+			QueuePrefetch( handle, MDLCACHE_ANIMBLOCK, nFirstBlock, nPriority );
+
+			int nSections = ( pAnimdesc->numframes / pAnimdesc->sectionframes ) + 2;
+			for ( int i = 1; i < nSections; i++ )
+			{
+				if ( pAnimdesc->pSection( i )->animblock != nFirstBlock )
+				{
+					QueuePrefetch( handle, MDLCACHE_ANIMBLOCK, pAnimdesc->pSection( i )->animblock, nPriority );
+					break;
+				}
+			}
+		}
+	}
+}
+
+void CMDLCache::QueuePrefetch( MDLHandle_t handle, MDLCacheDataType_t type, int iAnimBlock, int nPriority )
+{
+	// Block 0 is in the .mdl, -1 means the model needs recompiling
+	if ( type == MDLCACHE_ANIMBLOCK && iAnimBlock <= 0 )
+		return;
+
+	// Queue it again if it's wanted sooner, the stale request is dropped when it comes up
+	int nKey = MakeAsyncInfoKey( handle, type, iAnimBlock );
+	unsigned short i = m_QueuedPrefetches.Find( nKey );
+	if ( i != m_QueuedPrefetches.InvalidIndex() )
+	{
+		if ( m_QueuedPrefetches[i] >= nPriority )
+			return;
+		m_QueuedPrefetches[i] = nPriority;
+	}
+	else
+	{
+		m_QueuedPrefetches.Insert( nKey, nPriority );
+	}
+
+	PrefetchRequest_t request;
+	request.hModel = handle;
+	request.type = type;
+	request.iAnimBlock = iAnimBlock;
+	request.nPriority = nPriority;
+	request.nSerial = m_nPrefetchSerial++;
+	m_PrefetchQueue.Insert( request );
+}
+
+//-----------------------------------------------------------------------------
+// Issues queued prefetches, highest priority first, while there's room
+//-----------------------------------------------------------------------------
+void CMDLCache::IssuePrefetches()
+{
+	if ( !ThreadInMainThread() || ( IsX360() && g_pQueuedLoader->IsMapLoading() ) )
+		return;
+
+	while ( m_PrefetchQueue.Count() && m_PendingAsyncs.Count() < mod_prefetch_inflight.GetInt() )
+	{
+		PrefetchRequest_t request = m_PrefetchQueue.ElementAtHead();
+		m_PrefetchQueue.RemoveAtHead();
+
+		unsigned short i = m_QueuedPrefetches.Find( MakeAsyncInfoKey( request.hModel, request.type, request.iAnimBlock ) );
+		if ( i == m_QueuedPrefetches.InvalidIndex() || m_QueuedPrefetches[i] != request.nPriority )
+			continue;
+		m_QueuedPrefetches.RemoveAt( i );
+
+		// The model may have gone away since
+		if ( !IsPrefetchable( request.hModel ) )
+			continue;
+
+		m_bStreaming = true;
+		m_nStreamPriority = request.nPriority;
+		if ( request.type == MDLCACHE_ANIMBLOCK )
+		{
+			PrefetchAnimBlock( request.hModel, request.iAnimBlock );
+		}
+		else
+		{
+			PrefetchHardwareData( request.hModel );
+		}
+		m_bStreaming = false;
+		m_nStreamPriority = MDLCACHE_PREFETCH_NORMAL;
+	}
+}
+
+void CMDLCache::PrefetchAnimBlock( MDLHandle_t handle, int nBlock )
+{
+	studiodata_t *pStudioData = m_MDLDict[handle];
+	if ( pStudioData->m_pAnimBlock == NULL )
+	{
+		AllocateAnimBlocks( pStudioData, GetStudioHdr( handle )->numanimblocks );
+	}
+
+	if ( nBlock >= pStudioData->m_nAnimBlockCount )
+		return;
+
+	if ( GetAsyncInfoIndex( handle, MDLCACHE_ANIMBLOCK, nBlock ) != NO_ASYNC )
+		return;
+
+	if ( CheckDataNoTouch( pStudioData->m_pAnimBlock[nBlock], MDLCACHE_ANIMBLOCK ) )
+		return;
+
+	if ( BeginAnimBlockLoad( handle, nBlock, true, m_nStreamPriority ) != NO_ASYNC )
+	{
+		++m_nPrefetchesIssued;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// The VTX can't be read until the VVD is in, so this starts with the VVD
+// and UpdateHardwarePrefetches issues the VTX once it's arrived
+//-----------------------------------------------------------------------------
+void CMDLCache::PrefetchHardwareData( MDLHandle_t handle )
+{
+	studiodata_t *pStudioData = m_MDLDict[handle];
+	if ( pStudioData->m_nFlags & ( STUDIODATA_FLAGS_STUDIOMESH_LOADED | STUDIODATA_FLAGS_NO_STUDIOMESH ) )
+		return;
+
+	if ( GetAsyncInfoIndex( handle, MDLCACHE_STUDIOHWDATA ) != NO_ASYNC )
+		return;
+
+	++m_nPrefetchesIssued;
+	if ( !LoadHardwareData( handle ) && m_HardwarePrefetches.Find( handle ) == m_HardwarePrefetches.InvalidIndex() )
+	{
+		m_HardwarePrefetches.AddToTail( handle );
+	}
+}
+
+void CMDLCache::UpdateHardwarePrefetches()
+{
+	for ( int i = m_HardwarePrefetches.Count(); --i >= 0; )
+	{
+		MDLHandle_t handle = m_HardwarePrefetches[i];
+		if ( !IsPrefetchable( handle ) ||
+			( m_MDLDict[handle]->m_nFlags & ( STUDIODATA_FLAGS_STUDIOMESH_LOADED | STUDIODATA_FLAGS_NO_STUDIOMESH ) ) ||
+			GetAsyncInfoIndex( handle, MDLCACHE_STUDIOHWDATA ) != NO_ASYNC )
+		{
+			m_HardwarePrefetches.FastRemove( i );
+			continue;
+		}
+
+		// Still waiting for the VVD
+		if ( GetAsyncInfoIndex( handle, MDLCACHE_VERTEXES ) != NO_ASYNC )
+			continue;
+
+		m_bStreaming = true;
+		LoadHardwareData( handle );
+		m_bStreaming = false;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Statistics
+//-----------------------------------------------------------------------------
+void CMDLCache::PrintStats()
+{
+	Msg( "MDLCache: %d blocking loads, %d animation fallbacks, %d prefetches issued (%d queued), %.2f MB read\n",
+		m_nBlockingLoads, m_nAnimFallbacks, m_nPrefetchesIssued, m_QueuedPrefetches.Count(), m_nBytesRead / ( 1024.0 * 1024.0 ) );
+}
+
+void CMDLCache::ResetStats()
+{
+	m_nBlockingLoads = 0;
+	m_nAnimFallbacks = 0;
+	m_nPrefetchesIssued = 0;
+	m_nBytesRead = 0;
+}
+
+CON_COMMAND( mdlcache_stats, "Prints how often model data loads stalled or were streamed. 'mdlcache_stats reset' clears the counts." )
+{
+	g_MDLCache.PrintStats();
+	if ( args.ArgC() > 1 && !Q_stricmp( args[1], "reset" ) )
+	{
+		g_MDLCache.ResetStats();
+	}
 }
 
 //-----------------------------------------------------------------------------
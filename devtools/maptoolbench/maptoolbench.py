@@ -0,0 +1,632 @@
+#
+# maptoolbench.py - runs vbsp, vvis and vrad over the map corpus, records how
+# long each tool and each of its stages took, and checks the BSP lumps each
+# tool wrote against the golden hashes for that tool.
+#
+#   maptoolbench.py -bindir <dir with the tools> -game <mod dir> [options]
+#
+#   -bindir <dir>      where vbsp, vvis and vrad live
+#   -game <dir>        mod directory passed on to the tools
+#   -threads <n>       thread count passed on to the tools (default: all cores)
+#   -runs <n>          compile each map this many times (default: 1)
+#   -maps <a,b,...>    only these maps from the corpus (default: all)
+#   -tools <a,b,...>   only run these tools (default: vbsp,vvis,vrad)
+#   -vbsp/-vvis/-vrad "<args>"   extra arguments for a tool
+#   -workdir <dir>     where the maps are compiled (default: ./maptoolbench_work)
+#   -report <file>     JSON report (default: ./maptoolbench_report.json)
+#   -updategolden      write the golden lump hashes of each tool instead of checking them
+#   -threadcheck       compile each map with -threads 1 as well, and check that every
+#                      lump the tools write with -threads <n> matches that. This
+#                      runs whether or not the map has golden hashes.
+#   -generate          rewrite the synthetic maps in the corpus and exit
+#
+# Exits with 1 if any tool failed, a map has no golden hashes, or any lump
+# differs from its golden hash, or with -threadcheck from the lump the one
+# thread compile wrote.
+# The lumps are checked after every tool, so a vvis change that alters the
+# visibility data shows up as a vvis failure, along with the clusters whose
+# PVS or PAS changed.
+#
+# The corpus holds the synthetic grid maps -generate writes and a few small
+# hand made ones (sample_*.vmf) for what the grids don't have: non-axial
+# brushes, a displacement, water, an areaportal, the sun and a spot light.
+#
+# The golden hashes live in golden/<map>.json. They only hold for the -game
+# content, tool options and platform that made them, so make them again with
+# -updategolden when those change, and check them in with the change.
+#
+# No golden hashes are checked in yet. Until someone records them with
+# -updategolden on the reference tools and content, every map fails with
+# "no golden lumps", and the golden check catches nothing. Only the timings
+# and -threadcheck mean anything until then.
+#
+
+import hashlib
+import json
+import os
+import re
+import shutil
+import struct
+import subprocess
+import sys
+import time
+
+
+g_ScriptDir = os.path.dirname( os.path.abspath( __file__ ) )
+g_CorpusDir = os.path.join( g_ScriptDir, "corpus" )
+g_GoldenDir = os.path.join( g_ScriptDir, "golden" )
+
+g_AllTools = [ "vbsp", "vvis", "vrad" ]
+
+# bspfile.h
+BSP_IDENT = b"VBSP"
+HEADER_LUMPS = 64
+LUMP_NAMES = {
+	0 : "ENTITIES", 1 : "PLANES", 2 : "TEXDATA", 3 : "VERTEXES", 4 : "VISIBILITY", 5 : "NODES",
+	6 : "TEXINFO", 7 : "FACES", 8 : "LIGHTING", 9 : "OCCLUSION", 10 : "LEAFS", 11 : "FACEIDS",
+	12 : "EDGES", 13 : "SURFEDGES", 14 : "MODELS", 15 : "WORLDLIGHTS", 16 : "LEAFFACES",
+	17 : "LEAFBRUSHES", 18 : "BRUSHES", 19 : "BRUSHSIDES", 20 : "AREAS", 21 : "AREAPORTALS",
+	26 : "DISPINFO", 27 : "ORIGINALFACES", 28 : "PHYSDISP", 29 : "PHYSCOLLIDE", 30 : "VERTNORMALS",
+	31 : "VERTNORMALINDICES", 32 : "DISP_LIGHTMAP_ALPHAS", 33 : "DISP_VERTS",
+	34 : "DISP_LIGHTMAP_SAMPLE_POSITIONS", 35 : "GAME_LUMP", 36 : "LEAFWATERDATA",
+	37 : "PRIMITIVES", 38 : "PRIMVERTS", 39 : "PRIMINDICES", 40 : "PAKFILE", 41 : "CLIPPORTALVERTS",
+	42 : "CUBEMAPS", 43 : "TEXDATA_STRING_DATA", 44 : "TEXDATA_STRING_TABLE", 45 : "OVERLAYS",
+	46 : "LEAFMINDISTTOWATER", 47 : "FACE_MACRO_TEXTURE_INFO", 48 : "DISP_TRIS",
+	49 : "PHYSCOLLIDESURFACE", 50 : "WATEROVERLAYS", 51 : "LEAF_AMBIENT_INDEX_HDR",
+	52 : "LEAF_AMBIENT_INDEX", 53 : "LIGHTING_HDR", 54 : "WORLDLIGHTS_HDR",
+	55 : "LEAF_AMBIENT_LIGHTING_HDR", 56 : "LEAF_AMBIENT_LIGHTING", 57 : "XZIPPAKFILE",
+	58 : "FACES_HDR", 59 : "MAP_FLAGS", 60 : "OVERLAY_FADES", 61 : "OVERLAY_SYSTEM_LEVELS",
+	62 : "PHYSLEVEL", 63 : "DISP_MULTIBLEND",
+}
+
+# The pak file is a zip with file times in it, so it never matches.
+IGNORED_LUMPS = [ 40 ]
+
+VISIBILITY_LUMP = 4
+
+
+# Tool output that gives a stage time in seconds:
+#   "ProcessBlock_Thread: 0...1...2...3...4...5...6...7...8...9...10 (3)"  (pacifier)
+#   "Building Faces...done (1)"
+#   "12 brush models done (0)"
+#   "FixTjuncs...", "WriteBSP..." then "done (2)", which is named "FixTjuncs/WriteBSP"
+g_PacifierRE = re.compile( r"^(\S.*?)\s*:\s*[\d\.]+\s*\((\d+)\)\s*$" )
+g_DoneRE = re.compile( r"^(.*?)(?:\.\.\.)?\s*done \((\d+)\)\s*$" )
+g_PendingRE = re.compile( r"^(\S.*?)\.\.\.\s*$" )
+
+
+def ParseStages( output ):
+	stages = []
+	pending = []
+	for line in output.splitlines():
+		line = line.strip()
+
+		m = g_PacifierRE.match( line )
+		if m:
+			stages.append( { "name" : m.group( 1 ), "seconds" : int( m.group( 2 ) ) } )
+			continue
+
+		m = g_DoneRE.match( line )
+		if m:
+			name = m.group( 1 ).strip() or "/".join( pending )
+			if name:
+				stages.append( { "name" : name, "seconds" : int( m.group( 2 ) ) } )
+			pending = []
+			continue
+
+		m = g_PendingRE.match( line )
+		if m:
+			pending.append( m.group( 1 ) )
+
+	return stages
+
+
+def CountCores():
+	try:
+		import multiprocessing
+		return multiprocessing.cpu_count()
+	except ( ImportError, NotImplementedError ):
+		return 1
+
+
+def FindTool( bindir, name ):
+	for candidate in [ name, name + ".exe", name + "_linux", name + "_osx" ]:
+		path = os.path.join( bindir, candidate )
+		if os.path.isfile( path ):
+			return path
+	return None
+
+
+#
+# Runs a tool and returns its wall time, CPU time, peak RSS and output.
+# CPU time and peak RSS come from wait4, so they are None where that's missing.
+#
+def RunTool( cmd, cwd, logFile ):
+	start = time.time()
+	log = open( logFile, "wb" )
+	proc = subprocess.Popen( cmd, cwd=cwd, stdout=log, stderr=subprocess.STDOUT )
+
+	cpu = None
+	peakRSS = None
+	if hasattr( os, "wait4" ):
+		pid, status, usage = os.wait4( proc.pid, 0 )
+		proc.returncode = os.WEXITSTATUS( status ) if os.WIFEXITED( status ) else -1
+		cpu = usage.ru_utime + usage.ru_stime
+
+		# ru_maxrss is in kilobytes on Linux and bytes on OS X.
+		peakRSS = usage.ru_maxrss * ( 1 if sys.platform == "darwin" else 1024 )
+	else:
+		proc.wait()
+
+	wall = time.time() - start
+	log.close()
+
+	output = open( logFile, "rb" ).read().decode( "latin-1" )
+	return proc.returncode, wall, cpu, peakRSS, output
+
+
+# bsplib.cpp DecompressVis: a zero byte is followed by a count of zero bytes.
+def DecompressVis( vis, ofs, row ):
+	out = bytearray()
+	while len( out ) < row:
+		if ofs + 1 >= len( vis ):
+			raise ValueError( "visibility row runs off the end of the lump" )
+		if vis[ofs]:
+			out.append( vis[ofs] )
+			ofs += 1
+		else:
+			out.extend( bytearray( vis[ofs + 1] ) )
+			ofs += 2
+	return bytes( out[:row] )
+
+
+#
+# Returns one hash per cluster of its decompressed PVS and PAS rows, so a
+# visibility mismatch can say which clusters see differently.
+#
+def HashVisClusters( vis ):
+	vis = bytearray( vis )
+	if len( vis ) < 4:
+		return []
+	numClusters = struct.unpack_from( "<i", vis, 0 )[0]
+	row = ( numClusters + 7 ) // 8
+	clusters = []
+	for i in range( numClusters ):
+		pvs, pas = struct.unpack_from( "<ii", vis, 4 + i * 8 )
+		sha1 = hashlib.sha1()
+		sha1.update( DecompressVis( vis, pvs, row ) )
+		sha1.update( DecompressVis( vis, pas, row ) )
+		clusters.append( sha1.hexdigest() )
+	return clusters
+
+
+#
+# Returns { "lumps" : { lump index : { "name", "length", "sha1" } },
+# "clusters" : [ PVS/PAS hash per cluster ] } for a .bsp file.
+#
+def HashBSP( bspFile ):
+	data = open( bspFile, "rb" ).read()
+	if len( data ) < 8 + HEADER_LUMPS * 16 or data[0:4] != BSP_IDENT:
+		raise ValueError( "%s isn't a BSP file" % bspFile )
+
+	lumps = {}
+	clusters = []
+	for i in range( HEADER_LUMPS ):
+		fileofs, filelen, version, fourCC = struct.unpack_from( "<iiii", data, 8 + i * 16 )
+		if filelen == 0:
+			continue
+		lumps[str( i )] = {
+			"name" : LUMP_NAMES.get( i, "LUMP_%d" % i ),
+			"length" : filelen,
+			"sha1" : hashlib.sha1( data[fileofs:fileofs + filelen] ).hexdigest(),
+		}
+		if i == VISIBILITY_LUMP:
+			clusters = HashVisClusters( data[fileofs:fileofs + filelen] )
+	return { "lumps" : lumps, "clusters" : clusters }
+
+
+#
+# Returns the lumps of got that differ from want, each with the clusters
+# whose visibility differs when it's the visibility lump.
+#
+def CompareBSP( want, got ):
+	diffs = []
+	wantLumps = want["lumps"]
+	gotLumps = got["lumps"]
+	for index in sorted( set( wantLumps.keys() ) | set( gotLumps.keys() ), key=int ):
+		if int( index ) in IGNORED_LUMPS:
+			continue
+		wantLump = wantLumps.get( index )
+		gotLump = gotLumps.get( index )
+		if wantLump and gotLump and wantLump["sha1"] == gotLump["sha1"]:
+			continue
+		diff = {
+			"lump" : int( index ),
+			"name" : LUMP_NAMES.get( int( index ), "LUMP_%d" % int( index ) ),
+			"golden_length" : wantLump["length"] if wantLump else 0,
+			"length" : gotLump["length"] if gotLump else 0,
+		}
+		if int( index ) == VISIBILITY_LUMP:
+			wantClusters = want.get( "clusters", [] )
+			gotClusters = got.get( "clusters", [] )
+			diff["golden_clusters"] = len( wantClusters )
+			diff["clusters"] = len( gotClusters )
+			diff["cluster_diffs"] = [ i for i in range( min( len( wantClusters ), len( gotClusters ) ) ) if wantClusters[i] != gotClusters[i] ]
+		diffs.append( diff )
+	return diffs
+
+
+def PrintDiffs( diffs, what ):
+	for diff in diffs:
+		print( "  lump %d (%s) differs: %d bytes, %s %d bytes" % ( diff["lump"], diff["name"], diff["length"], what, diff["golden_length"] ) )
+		if "cluster_diffs" in diff:
+			if diff["clusters"] != diff["golden_clusters"]:
+				print( "    %d clusters, %s %d" % ( diff["clusters"], what, diff["golden_clusters"] ) )
+			if diff["cluster_diffs"]:
+				print( "    visibility differs for %d clusters: %s" % ( len( diff["cluster_diffs"] ),
+					" ".join( [ str( c ) for c in diff["cluster_diffs"][:32] ] ) + ( " ..." if len( diff["cluster_diffs"] ) > 32 else "" ) ) )
+
+
+def LoadGolden( mapName ):
+	goldenFile = os.path.join( g_GoldenDir, mapName + ".json" )
+	if not os.path.isfile( goldenFile ):
+		return None
+	return json.load( open( goldenFile, "r" ) )
+
+
+def SaveGolden( mapName, golden ):
+	if not os.path.isdir( g_GoldenDir ):
+		os.makedirs( g_GoldenDir )
+	json.dump( golden, open( os.path.join( g_GoldenDir, mapName + ".json" ), "w" ), indent=1, sort_keys=True )
+
+
+#
+# Compiles a map and checks what each tool wrote against the golden lumps,
+# or against reference (the lumps of another compile, named what) if given.
+# Returns the result for the report and the lumps of the last run.
+#
+def CompileMap( vmfFile, args, toolPaths, threads, reference=None, what="golden" ):
+	mapName = os.path.splitext( os.path.basename( vmfFile ) )[0]
+	mapDir = os.path.join( args["workdir"], mapName if reference is None else "%s_%s" % ( mapName, what.replace( " ", "_" ) ) )
+	if os.path.isdir( mapDir ):
+		shutil.rmtree( mapDir )
+	os.makedirs( mapDir )
+	shutil.copy( vmfFile, mapDir )
+
+	bspFile = os.path.join( mapDir, mapName + ".bsp" )
+	result = { "map" : mapName, "threads" : threads, "runs" : [], "ok" : True }
+	if reference is not None:
+		golden = reference
+	else:
+		golden = {} if args["updategolden"] else LoadGolden( mapName )
+		if golden is None:
+			# A map nobody checked can't pass. -threadcheck still compiles it,
+			# so the threads get checked against one thread.
+			print( "  no golden lumps, record them with -updategolden" )
+			result["ok"] = False
+			result["error"] = "no golden lumps"
+			if not args["threadcheck"]:
+				return result, {}
+
+	lastLumps = {}
+	for iRun in range( args["runs"] ):
+		run = { "tools" : [] }
+
+		for tool in args["tools"]:
+			cmd = [ toolPaths[tool], "-threads", str( threads ), "-game", args["game"] ]
+			cmd += args["toolargs"][tool].split()
+			cmd.append( mapName )
+
+			logFile = os.path.join( mapDir, "%s_%d.log" % ( tool, iRun ) )
+			returnCode, wall, cpu, peakRSS, output = RunTool( cmd, mapDir, logFile )
+
+			toolResult = {
+				"tool" : tool,
+				"exit_code" : returnCode,
+				"wall_seconds" : round( wall, 3 ),
+				"cpu_seconds" : round( cpu, 3 ) if cpu is not None else None,
+				"peak_rss_bytes" : peakRSS,
+				"thread_utilization" : round( cpu / ( wall * threads ), 3 ) if cpu is not None and wall > 0 else None,
+				"stages" : ParseStages( output ),
+				"log" : logFile,
+			}
+			run["tools"].append( toolResult )
+
+			print( "  %-5s %8.2fs%s" % ( tool, wall,
+				"  (%d%% of %d threads)" % ( toolResult["thread_utilization"] * 100, threads ) if cpu is not None else "" ) )
+
+			if returnCode != 0:
+				print( "  %s failed with %d, see %s" % ( tool, returnCode, logFile ) )
+				result["ok"] = False
+				break
+
+			if not os.path.isfile( bspFile ):
+				print( "  %s wrote no %s" % ( tool, bspFile ) )
+				result["ok"] = False
+				break
+
+			# Check what this tool wrote before the next one changes it.
+			bsp = HashBSP( bspFile )
+			lastLumps[tool] = bsp
+			if args["updategolden"] and reference is None:
+				golden[tool] = bsp
+			elif golden is not None:
+				if tool not in golden:
+					print( "  no %s lumps for %s" % ( what, tool ) )
+					result["ok"] = False
+					continue
+				toolResult["lump_diffs"] = CompareBSP( golden[tool], bsp )
+				if toolResult["lump_diffs"]:
+					result["ok"] = False
+					PrintDiffs( toolResult["lump_diffs"], what )
+				else:
+					print( "  lumps match %s" % what )
+
+		result["runs"].append( run )
+		if not result["ok"]:
+			return result, lastLumps
+
+	if args["updategolden"] and reference is None:
+		SaveGolden( mapName, golden )
+		print( "  golden lumps written" )
+
+	return result, lastLumps
+
+
+#
+# Synthetic corpus.
+#
+
+class CVMFWriter:
+	def __init__( self ):
+		self.m_Lines = []
+		self.m_NextID = 1
+
+	def NextID( self ):
+		id = self.m_NextID
+		self.m_NextID += 1
+		return id
+
+	def Block( self, name, keys, children=None, indent=0 ):
+		tab = "\t" * indent
+		self.m_Lines.append( tab + name )
+		self.m_Lines.append( tab + "{" )
+		for key, value in keys:
+			self.m_Lines.append( '%s\t"%s" "%s"' % ( tab, key, value ) )
+		if children:
+			children( indent + 1 )
+		self.m_Lines.append( tab + "}" )
+
+	# Writes an axial box brush. The plane points wind the same way Hammer's do.
+	def Box( self, mins, maxs, material, indent ):
+		x0, y0, z0 = mins
+		x1, y1, z1 = maxs
+		planes = [
+			( ( x0, y1, z1 ), ( x1, y1, z1 ), ( x1, y0, z1 ), "[1 0 0 0] 0.25", "[0 -1 0 0] 0.25" ),
+			( ( x0, y0, z0 ), ( x1, y0, z0 ), ( x1, y1, z0 ), "[1 0 0 0] 0.25", "[0 -1 0 0] 0.25" ),
+			( ( x0, y1, z1 ), ( x0, y0, z1 ), ( x0, y0, z0 ), "[0 1 0 0] 0.25", "[0 0 -1 0] 0.25" ),
+			( ( x1, y1, z0 ), ( x1, y0, z0 ), ( x1, y0, z1 ), "[0 1 0 0] 0.25", "[0 0 -1 0] 0.25" ),
+			( ( x1, y1, z1 ), ( x0, y1, z1 ), ( x0, y1, z0 ), "[1 0 0 0] 0.25", "[0 0 -1 0] 0.25" ),
+			( ( x1, y0, z0 ), ( x0, y0, z0 ), ( x0, y0, z1 ), "[1 0 0 0] 0.25", "[0 0 -1 0] 0.25" ),
+		]
+
+		def Sides( indent ):
+			for p0, p1, p2, uaxis, vaxis in planes:
+				self.Block( "side", [
+					( "id", self.NextID() ),
+					( "plane", "(%d %d %d) (%d %d %d) (%d %d %d)" % ( p0 + p1 + p2 ) ),
+					( "material", material ),
+					( "uaxis", uaxis ),
+					( "vaxis", vaxis ),
+					( "lightmapscale", "16" ),
+				], None, indent )
+
+		self.Block( "solid", [ ( "id", self.NextID() ) ], Sides, indent )
+
+	def Text( self ):
+		return "\n".join( self.m_Lines ) + "\n"
+
+
+ROOM_SIZE = 512
+ROOM_HEIGHT = 256
+WALL = 16
+DOOR_WIDTH = 128
+DOOR_HEIGHT = 128
+WALL_MATERIAL = "DEV/DEV_MEASUREGENERIC01B"
+DETAIL_MATERIAL = "DEV/DEV_MEASUREGENERIC01"
+
+
+#
+# Writes a rooms x rooms grid of rooms with doorways between them. Each room
+# has a light, a func_detail pillar and a func_brush crate, so the world
+# blocks, detail merging, submodels, vis and lighting all have work to do.
+#
+def GenerateGridMap( rooms ):
+	vmf = CVMFWriter()
+	vmf.Block( "versioninfo", [ ( "editorversion", "400" ), ( "editorbuild", "0" ), ( "mapversion", "1" ),
+		( "formatversion", "100" ), ( "prefab", "0" ) ] )
+
+	size = rooms * ROOM_SIZE
+	half = size // 2
+
+	def WorldBrushes( indent ):
+		# floor, ceiling and outer walls
+		vmf.Box( ( -half - WALL, -half - WALL, -WALL ), ( half + WALL, half + WALL, 0 ), WALL_MATERIAL, indent )
+		vmf.Box( ( -half - WALL, -half - WALL, ROOM_HEIGHT ), ( half + WALL, half + WALL, ROOM_HEIGHT + WALL ), WALL_MATERIAL, indent )
+		vmf.Box( ( -half - WALL, -half - WALL, 0 ), ( -half, half + WALL, ROOM_HEIGHT ), WALL_MATERIAL, indent )
+		vmf.Box( ( half, -half - WALL, 0 ), ( half + WALL, half + WALL, ROOM_HEIGHT ), WALL_MATERIAL, indent )
+		vmf.Box( ( -half, -half - WALL, 0 ), ( half, -half, ROOM_HEIGHT ), WALL_MATERIAL, indent )
+		vmf.Box( ( -half, half, 0 ), ( half, half + WALL, ROOM_HEIGHT ), WALL_MATERIAL, indent )
+
+		# inner walls, with a doorway in the middle of each room's side
+		for line in range( 1, rooms ):
+			c = -half + line * ROOM_SIZE
+			for room in range( rooms ):
+				lo = -half + room * ROOM_SIZE
+				mid = lo + ROOM_SIZE // 2
+				for axis in range( 2 ):
+					def Wall( a0, a1, z0, z1 ):
+						if axis == 0:
+							vmf.Box( ( c - WALL // 2, a0, z0 ), ( c + WALL // 2, a1, z1 ), WALL_MATERIAL, indent )
+						else:
+							vmf.Box( ( a0, c - WALL // 2, z0 ), ( a1, c + WALL // 2, z1 ), WALL_MATERIAL, indent )
+					Wall( lo, mid - DOOR_WIDTH // 2, 0, ROOM_HEIGHT )
+					Wall( mid + DOOR_WIDTH // 2, lo + ROOM_SIZE, 0, ROOM_HEIGHT )
+					Wall( mid - DOOR_WIDTH // 2, mid + DOOR_WIDTH // 2, DOOR_HEIGHT, ROOM_HEIGHT )
+
+	vmf.Block( "world", [ ( "id", vmf.NextID() ), ( "mapversion", "1" ), ( "classname", "worldspawn" ),
+		( "skyname", "sky_day01_01" ) ], WorldBrushes )
+
+	for x in range( rooms ):
+		for y in range( rooms ):
+			cx = -half + x * ROOM_SIZE + ROOM_SIZE // 2
+			cy = -half + y * ROOM_SIZE + ROOM_SIZE // 2
+
+			vmf.Block( "entity", [ ( "id", vmf.NextID() ), ( "classname", "light" ),
+				( "_light", "255 %d %d 300" % ( 160 + 10 * x, 160 + 10 * y ) ),
+				( "_lightHDR", "-1 -1 -1 1" ), ( "_quadratic_attn", "1" ),
+				( "origin", "%d %d %d" % ( cx + 96, cy + 96, ROOM_HEIGHT - 32 ) ) ] )
+
+			def Pillar( indent ):
+				vmf.Box( ( cx - 112, cy - 112, 0 ), ( cx - 80, cy - 80, ROOM_HEIGHT ), DETAIL_MATERIAL, indent )
+			vmf.Block( "entity", [ ( "id", vmf.NextID() ), ( "classname", "func_detail" ) ], Pillar )
+
+			def Crate( indent ):
+				vmf.Box( ( cx + 32, cy - 96, 0 ), ( cx + 96, cy - 32, 64 ), DETAIL_MATERIAL, indent )
+			vmf.Block( "entity", [ ( "id", vmf.NextID() ), ( "classname", "func_brush" ), ( "solidity", "0" ) ], Crate )
+
+	vmf.Block( "entity", [ ( "id", vmf.NextID() ), ( "classname", "info_player_start" ),
+		( "origin", "%d %d 16" % ( -half + ROOM_SIZE // 2, -half + ROOM_SIZE // 2 ) ) ] )
+
+	return vmf.Text()
+
+
+g_SyntheticMaps = [
+	( "synth_room", 1 ),
+	( "synth_grid4", 4 ),
+]
+
+
+def GenerateCorpus():
+	if not os.path.isdir( g_CorpusDir ):
+		os.makedirs( g_CorpusDir )
+	for name, rooms in g_SyntheticMaps:
+		path = os.path.join( g_CorpusDir, name + ".vmf" )
+		open( path, "w" ).write( GenerateGridMap( rooms ) )
+		print( "wrote %s" % path )
+
+
+def ParseArgs( argv ):
+	args = {
+		"bindir" : None,
+		"game" : None,
+		"threads" : CountCores(),
+		"runs" : 1,
+		"maps" : None,
+		"tools" : g_AllTools,
+		"toolargs" : dict( [ ( tool, "" ) for tool in g_AllTools ] ),
+		"workdir" : os.path.abspath( "maptoolbench_work" ),
+		"report" : os.path.abspath( "maptoolbench_report.json" ),
+		"updategolden" : False,
+		"threadcheck" : False,
+		"generate" : False,
+	}
+
+	i = 1
+	while i < len( argv ):
+		arg = argv[i].lower()
+		if arg in [ "-updategolden", "-threadcheck", "-generate" ]:
+			args[arg[1:]] = True
+		elif i + 1 >= len( argv ):
+			print( "%s needs a value" % arg )
+			return None
+		elif arg in [ "-bindir", "-game", "-workdir", "-report" ]:
+			i += 1
+			args[arg[1:]] = os.path.abspath( argv[i] )
+		elif arg in [ "-threads", "-runs" ]:
+			i += 1
+			args[arg[1:]] = int( argv[i] )
+		elif arg in [ "-maps", "-tools" ]:
+			i += 1
+			args[arg[1:]] = argv[i].split( "," )
+		elif arg[1:] in g_AllTools:
+			i += 1
+			args["toolargs"][arg[1:]] = argv[i]
+		else:
+			print( "unknown option %s" % arg )
+			return None
+		i += 1
+
+	return args
+
+
+def main():
+	args = ParseArgs( sys.argv )
+	if not args:
+		print( "usage: see the comment at the top of maptoolbench.py" )
+		return 2
+
+	if args["generate"]:
+		GenerateCorpus()
+		return 0
+
+	if not args["bindir"] or not args["game"]:
+		print( "-bindir and -game are required" )
+		return 2
+
+	toolPaths = {}
+	for tool in args["tools"]:
+		if tool not in g_AllTools:
+			print( "unknown tool %s" % tool )
+			return 2
+		toolPaths[tool] = FindTool( args["bindir"], tool )
+		if not toolPaths[tool]:
+			print( "can't find %s in %s" % ( tool, args["bindir"] ) )
+			return 2
+
+	vmfFiles = sorted( [ os.path.join( g_CorpusDir, f ) for f in os.listdir( g_CorpusDir ) if f.lower().endswith( ".vmf" ) ] )
+	if args["maps"]:
+		vmfFiles = [ f for f in vmfFiles if os.path.splitext( os.path.basename( f ) )[0] in args["maps"] ]
+
+	report = {
+		"time" : time.strftime( "%Y-%m-%d %H:%M:%S" ),
+		"platform" : sys.platform,
+		"cores" : CountCores(),
+		"threads" : args["threads"],
+		"tools" : args["tools"],
+		"tool_args" : args["toolargs"],
+		"maps" : [],
+	}
+
+	ok = True
+	for vmfFile in vmfFiles:
+		print( os.path.basename( vmfFile ) )
+		if not args["threadcheck"]:
+			result, lumps = CompileMap( vmfFile, args, toolPaths, args["threads"] )
+			report["maps"].append( result )
+			ok = ok and result["ok"]
+			continue
+
+		# The threads must not change the output: one thread is checked
+		# against the golden lumps, if there are any, then all of them
+		# against one thread.
+		print( " 1 thread" )
+		result, lumps = CompileMap( vmfFile, args, toolPaths, 1 )
+		report["maps"].append( result )
+		ok = ok and result["ok"]
+		if len( lumps ) != len( args["tools"] ):
+			continue
+
+		print( " %d threads" % args["threads"] )
+		result = CompileMap( vmfFile, args, toolPaths, args["threads"], lumps, "1 thread" )[0]
+		report["maps"].append( result )
+		ok = ok and result["ok"]
+
+	json.dump( report, open( args["report"], "w" ), indent=1, sort_keys=True )
+	print( "report written to %s" % args["report"] )
+
+	return 0 if ok else 1
+
+
+if __name__ == "__main__":
+	sys.exit( main() )
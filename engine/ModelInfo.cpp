@@ -1019,6 +1019,8 @@ public:
 	virtual void GetModelMaterialColorAndLighting( const model_t *model, const Vector& origin,
 		const QAngle& angles, trace_t* pTrace, Vector& lighting, Vector& matColor );
 
+	virtual byte *GetAnimBlock( const studiohdr_t *pStudioHdr, int iBlock ) const;
+
 protected:
 	virtual INetworkStringTable *GetDynamicModelStringTable() const;
 	virtual int LookupPrecachedModelIndex( const char *name ) const;
@@ -1077,6 +1079,15 @@ int CModelInfoClient::RegisterDynamicModel( const char *name, bool bClientSide )
 	return CLIENTSIDE_TO_MODEL( localidx );
 }
 
+//-----------------------------------------------------------------------------
+// The client can draw the zero frame pose while an animation block streams in
+//-----------------------------------------------------------------------------
+byte *CModelInfoClient::GetAnimBlock( const studiohdr_t *pStudioHdr, int nBlock ) const
+{
+	MDLHandle_t handle = VoidPtrToMDLHandle( pStudioHdr->VirtualModel() );
+	return g_pMDLCache->GetAnimBlock( handle, nBlock, true );
+}
+
 const model_t *CModelInfoClient::GetModel( int modelindex )
 {
 	if ( IsDynamicModelIndex( modelindex ) )
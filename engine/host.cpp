@@ -60,6 +60,7 @@
 #include "gl_shader.h"
 #include "sys_dll.h"
 #include "cmodel_engine.h"
+#include "modelloader.h"
 #ifndef SWDS
 #include "con_nprint.h"
 #endif
@@ -925,6 +926,12 @@ void Host_Error (const char *error, ...)
 	Q_vsnprintf(string,sizeof(string),error,argptr);
 	va_end (argptr);
 
+	// A map load that failed may still have steps running on the thread pool
+	if ( ThreadInMainThread() )
+	{
+		Mod_FinishMapLoadJobs();
+	}
+
 	if ( sv.IsDedicated() )
 	{
 		// dedicated servers just exit
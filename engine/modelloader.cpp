@@ -56,6 +56,7 @@
 #include "optimize.h"
 #include "networkstringtable.h"
 #include "tier1/callqueue.h"
+#include "vstdlib/jobthread.h"
 
 // memdbgon must be the last include file in a .cpp file!!!
 #include "tier0/memdbgon.h"
@@ -76,6 +77,7 @@ static ConVar mod_offline_hdr_switch( "mod_offline_hdr_switch", CONVAR_DEFAULT_M
                                       "pathways." );
 static ConVar mod_touchalldata( "mod_touchalldata", "1", 0, "Touch model data during level startup" );
 static ConVar mod_forcetouchdata( "mod_forcetouchdata", "1", 0, "Forces all model file data into cache on model load." );
+static ConVar mod_load_timings( "mod_load_timings", "0", 0, "Print how long each step of loading the world model took." );
 ConVar mat_excludetextures( "mat_excludetextures", "0", FCVAR_CHEAT );
 
 ConVar r_unloadlightmaps( "r_unloadlightmaps", "0", FCVAR_CHEAT );
@@ -408,6 +410,12 @@ struct lumpfiles_t
 };
 static lumpfiles_t s_MapLumpFiles[ HEADER_LUMPS ];
 
+// Reads started by PrefetchLumps, each taken by the first helper for its lump
+static FSAsyncControl_t	s_hPrefetchedLumps[ HEADER_LUMPS ];
+
+// Helpers created on map load jobs share the map file handles with the main thread
+static CThreadFastMutex	s_MapFileMutex;
+
 CON_COMMAND( mem_vcollide, "Dumps the memory used by vcollides" )
 {
 	g_ModelLoader.DumpVCollideStats();
@@ -586,6 +594,78 @@ void CMapLoadHelper::InitFromMemory( model_t *pMapModel, const void *pData, int
 	s_pMap = &g_ModelLoader.m_worldBrushData;
 }
 
+//-----------------------------------------------------------------------------
+// Waits for a lump started by PrefetchLumps and hands over its data, or
+// returns NULL if the read failed or came back short. nSize < 0 accepts any
+// size.
+//-----------------------------------------------------------------------------
+static byte *TakePrefetchedLump( int lumpId, int nSize )
+{
+	FSAsyncControl_t hControl = s_hPrefetchedLumps[lumpId];
+	s_hPrefetchedLumps[lumpId] = NULL;
+
+	void *pData = NULL;
+	int nBytesRead = 0;
+	g_pFileSystem->AsyncFinish( hControl, true );
+	FSAsyncStatus_t status = g_pFileSystem->AsyncGetResult( hControl, &pData, &nBytesRead );
+	g_pFileSystem->AsyncRelease( hControl );
+
+	if ( pData && ( status != FSASYNC_OK || ( nSize >= 0 && nBytesRead != nSize ) ) )
+	{
+		g_pFileSystem->FreeOptimalReadBuffer( pData );
+		pData = NULL;
+	}
+	return (byte *)pData;
+}
+
+//-----------------------------------------------------------------------------
+// Starts reading lumps so the disk works while the map loads. The reads go
+// into buffers, not mapped views: a view would only fault its pages in on
+// whichever thread first touches them.
+//-----------------------------------------------------------------------------
+void CMapLoadHelper::PrefetchLumps( const int *pLumps, int nLumps )
+{
+	if ( s_MapBuffer.Base() || s_MapFileHandle == FILESYSTEM_INVALID_HANDLE )
+	{
+		// bsp is in memory, or there's nothing to read from
+		return;
+	}
+
+	for ( int i = 0; i < nLumps; i++ )
+	{
+		int lumpId = pLumps[i];
+		if ( lumpId < 0 || lumpId >= HEADER_LUMPS || s_hPrefetchedLumps[lumpId] )
+		{
+			continue;
+		}
+
+		char szLumpFilename[MAX_PATH];
+		FileAsyncRequest_t request;
+		request.pszFilename = s_szMapName;
+		request.nOffset = s_MapHeader.lumps[lumpId].fileofs;
+		request.nBytes = s_MapHeader.lumps[lumpId].filelen;
+		request.flags = FSASYNC_FLAGS_ALLOCNOFREE;
+
+		if ( IsPC() && s_MapLumpFiles[lumpId].file != FILESYSTEM_INVALID_HANDLE )
+		{
+			GenerateLumpFileName( s_szMapName, szLumpFilename, MAX_PATH, s_MapLumpFiles[lumpId].lumpfileindex );
+			request.pszFilename = szLumpFilename;
+			request.nOffset = s_MapLumpFiles[lumpId].header.lumpOffset;
+			request.nBytes = s_MapLumpFiles[lumpId].header.lumpLength;
+		}
+
+		if ( request.nBytes <= 0 )
+		{
+			continue;
+		}
+
+		if ( g_pFileSystem->AsyncRead( request, &s_hPrefetchedLumps[lumpId] ) != FSASYNC_OK )
+		{
+			s_hPrefetchedLumps[lumpId] = NULL;
+		}
+	}
+}
+
 //-----------------------------------------------------------------------------
 // Shutdown a BSP loading context.
 //-----------------------------------------------------------------------------
@@ -615,6 +695,19 @@ void CMapLoadHelper::Shutdown( void )
 		V_memset( &s_MapLumpFiles, 0, sizeof( s_MapLumpFiles ) );
 	}
 
+	// Drop prefetched lumps nothing asked for
+	for ( int i = 0; i < HEADER_LUMPS; i++ )
+	{
+		if ( s_hPrefetchedLumps[i] )
+		{
+			byte *pData = TakePrefetchedLump( i, -1 );
+			if ( pData )
+			{
+				g_pFileSystem->FreeOptimalReadBuffer( pData );
+			}
+		}
+	}
+
 	s_szLoadName[ 0 ] = 0;
 	V_memset( &s_MapHeader, 0, sizeof( s_MapHeader ) );
 	s_pMap = NULL;
@@ -768,6 +861,7 @@ CMapLoadHelper::CMapLoadHelper( int lumpToLoad )
 	m_pData = NULL;
 	m_pRawData = NULL;
 	m_pUncompressedData = NULL;
+	m_pMappedData = NULL;
 	
 	// Load raw lump from disk
 	lump_t *lump = &s_MapHeader.lumps[ lumpToLoad ];
@@ -809,6 +903,30 @@ CMapLoadHelper::CMapLoadHelper( int lumpToLoad )
 			Sys_Error( "Can't load map from invalid handle!!!" );
 		}
 
+		if ( s_hPrefetchedLumps[lumpToLoad] )
+		{
+			// Already on its way
+			m_pRawData = TakePrefetchedLump( lumpToLoad, m_nLumpSize );
+			m_pData = m_pRawData;
+		}
+
+		// Use the file's pages directly if it can be mapped, unless that would
+		// return badly aligned data. A BSP in a VPK starts wherever its entry
+		// does, so it's the view that has to be aligned, not the lump offset.
+		if ( !m_pData )
+		{
+			m_pMappedData = (byte *)g_pFileSystem->MapFileView( fileToUse, m_nLumpOffset, m_nLumpSize );
+			if ( m_pMappedData && ( (uintp)m_pMappedData & 3 ) != 0 )
+			{
+				g_pFileSystem->UnmapFileView( m_pMappedData, m_nLumpSize );
+				m_pMappedData = NULL;
+			}
+			m_pData = m_pMappedData;
+		}
+	}
+
+	if ( !m_pData )
+	{
 		unsigned nOffsetAlign, nSizeAlign, nBufferAlign;
 		g_pFileSystem->GetOptimalIOConstraints( fileToUse, &nOffsetAlign, &nSizeAlign, &nBufferAlign );
 
@@ -830,6 +948,7 @@ CMapLoadHelper::CMapLoadHelper( int lumpToLoad )
 
 		if ( m_nLumpSize )
 		{
+			AUTO_LOCK_FM( s_MapFileMutex );
 			g_pFileSystem->Seek( fileToUse, alignedOffset, FILESYSTEM_SEEK_HEAD );
 			g_pFileSystem->ReadEx( m_pRawData, alignedBytesToRead, alignedBytesToRead, fileToUse );
 			m_pData = m_pRawData + ( m_nLumpOffset - alignedOffset );
@@ -842,6 +961,7 @@ CMapLoadHelper::CMapLoadHelper( int lumpToLoad )
 		AssertMsg( CLZMA::IsCompressed( m_pData ),
 		           "Lump claims to be compressed but is not recognized as LZMA" );
 
+		int nCompressedSize = m_nLumpSize;
 		m_nLumpSize = CLZMA::GetActualSize( m_pData );
 		AssertMsg( lump->uncompressedSize == m_nLumpSize,
 		           "Lump header disagrees with lzma header for compressed lump" );
@@ -849,6 +969,12 @@ CMapLoadHelper::CMapLoadHelper( int lumpToLoad )
 		m_pUncompressedData = (unsigned char *)malloc( m_nLumpSize );
 		CLZMA::Uncompress( m_pData, m_pUncompressedData );
 
+		if ( m_pMappedData )
+		{
+			g_pFileSystem->UnmapFileView( m_pMappedData, nCompressedSize );
+			m_pMappedData = NULL;
+		}
+
 		m_pData = m_pUncompressedData;
 	}
 }
@@ -867,6 +993,11 @@ CMapLoadHelper::~CMapLoadHelper( void )
 	{
 		g_pFileSystem->FreeOptimalReadBuffer( m_pRawData );
 	}
+
+	if ( m_pMappedData )
+	{
+		g_pFileSystem->UnmapFileView( m_pMappedData, m_nLumpSize );
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -1243,6 +1374,16 @@ void Mod_LoadWorldlights( CMapLoadHelper &lh, bool bIsHDR )
 	}
 }
 
+//-----------------------------------------------------------------------------
+// Names the hunk allocation for a lump. Unlike va() this is safe on the jobs
+// Map_LoadModel runs on the thread pool.
+//-----------------------------------------------------------------------------
+static const char *Mod_LumpHunkName( char *pszOut, int nOutSize, CMapLoadHelper &lh, const char *pszLumpName )
+{
+	V_snprintf( pszOut, nOutSize, "%s [%s]", lh.GetLoadName(), pszLumpName );
+	return pszOut;
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: 
 //-----------------------------------------------------------------------------
@@ -1253,6 +1394,7 @@ void Mod_LoadVertices( void )
 	int			i, count;
 
 	CMapLoadHelper lh( LUMP_VERTEXES );
+	char szHunkName[MAX_PATH];
 
 	in = (dvertex_t *)lh.LumpBase();
 	if ( lh.LumpSize() % sizeof(*in) )
@@ -1260,7 +1402,7 @@ void Mod_LoadVertices( void )
 		Host_Error( "Mod_LoadVertices: funny lump size in %s", lh.GetMapName() );
 	}
 	count = lh.LumpSize() / sizeof(*in);
-	out = (mvertex_t *)Hunk_AllocName( count*sizeof(*out), va( "%s [%s]", lh.GetLoadName(), "vertexes" ) );
+	out = (mvertex_t *)Hunk_AllocName( count*sizeof(*out), Mod_LumpHunkName( szHunkName, sizeof( szHunkName ), lh, "vertexes" ) );
 
 	lh.GetMap()->vertexes = out;
 	lh.GetMap()->numvertexes = count;
@@ -1681,6 +1823,7 @@ static void CalcSurfaceExtents ( CMapLoadHelper& lh, SurfaceHandle_t surfID )
 void Mod_LoadVertNormals( void )
 {
 	CMapLoadHelper lh( LUMP_VERTNORMALS );
+	char szHunkName[MAX_PATH];
 
     // get a pointer to the vertex normal data.
 	Vector *pVertNormals = ( Vector * )lh.LumpBase();
@@ -1692,7 +1835,7 @@ void Mod_LoadVertNormals( void )
         Host_Error( "Mod_LoadVertNormals: funny lump size in %s!\n", lh.GetMapName() );
 
 	int count = lh.LumpSize() / sizeof(*pVertNormals);
-	Vector *out = (Vector *)Hunk_AllocName( lh.LumpSize(), va( "%s [%s]", lh.GetLoadName(), "vertnormals" ) );
+	Vector *out = (Vector *)Hunk_AllocName( lh.LumpSize(), Mod_LumpHunkName( szHunkName, sizeof( szHunkName ), lh, "vertnormals" ) );
 	memcpy( out, pVertNormals, lh.LumpSize() );
 	
 	lh.GetMap()->vertnormals = out;
@@ -1740,12 +1883,13 @@ void Mod_LoadPrimitives( void )
 	int				i, count;
 
 	CMapLoadHelper lh( LUMP_PRIMITIVES );
+	char szHunkName[MAX_PATH];
 
 	in = (dprimitive_t *)lh.LumpBase();
 	if (lh.LumpSize() % sizeof(*in))
 		Host_Error ("Mod_LoadPrimitives: funny lump size in %s",lh.GetMapName());
 	count = lh.LumpSize() / sizeof(*in);
-	out = (mprimitive_t *)Hunk_AllocName( count*sizeof(*out), va( "%s [%s]", lh.GetLoadName(), "primitives" ) );
+	out = (mprimitive_t *)Hunk_AllocName( count*sizeof(*out), Mod_LumpHunkName( szHunkName, sizeof( szHunkName ), lh, "primitives" ) );
 	memset( out, 0, count * sizeof( mprimitive_t ) );
 
 	lh.GetMap()->primitives = out;
@@ -1773,12 +1917,13 @@ void Mod_LoadPrimVerts( void )
 	int				i, count;
 
 	CMapLoadHelper lh( LUMP_PRIMVERTS );
+	char szHunkName[MAX_PATH];
 
 	in = (dprimvert_t *)lh.LumpBase();
 	if (lh.LumpSize() % sizeof(*in))
 		Host_Error ("Mod_LoadPrimVerts: funny lump size in %s",lh.GetMapName());
 	count = lh.LumpSize() / sizeof(*in);
-	out = (mprimvert_t *)Hunk_AllocName( count*sizeof(*out), va( "%s [%s]", lh.GetLoadName(), "primverts" ) );
+	out = (mprimvert_t *)Hunk_AllocName( count*sizeof(*out), Mod_LumpHunkName( szHunkName, sizeof( szHunkName ), lh, "primverts" ) );
 	memset( out, 0, count * sizeof( mprimvert_t ) );
 
 	lh.GetMap()->primverts = out;
@@ -1802,12 +1947,13 @@ void Mod_LoadPrimIndices( void )
 	int				count;
 
 	CMapLoadHelper lh( LUMP_PRIMINDICES );
+	char szHunkName[MAX_PATH];
 
 	in = (unsigned short *)lh.LumpBase();
 	if (lh.LumpSize() % sizeof(*in))
 		Host_Error ("Mod_LoadPrimIndices: funny lump size in %s",lh.GetMapName());
 	count = lh.LumpSize() / sizeof(*in);
-	out = (unsigned short *)Hunk_AllocName( count*sizeof(*out), va("%s [%s]", lh.GetLoadName(), "primindices" ) );
+	out = (unsigned short *)Hunk_AllocName( count*sizeof(*out), Mod_LumpHunkName( szHunkName, sizeof( szHunkName ), lh, "primindices" ) );
 	memset( out, 0, count * sizeof( unsigned short ) );
 
 	lh.GetMap()->primindices = out;
@@ -1819,28 +1965,46 @@ void Mod_LoadPrimIndices( void )
 
 // This allocates memory for a lump and copies the lump data in.
 void Mod_LoadLump( 
-	model_t *loadmodel, 
 	int iLump,
-	char *loadname, 
+	const char *pszLumpName, 
 	int elementSize,
 	void **ppData, 
 	int *nElements )
 {
 	CMapLoadHelper lh( iLump );
+	char szHunkName[MAX_PATH];
 
 	if ( lh.LumpSize() % elementSize )
 	{
-		Host_Error( "Mod_LoadLump: funny lump size in %s", loadmodel->strName.String() );
+		Host_Error( "Mod_LoadLump: funny lump size in %s", lh.GetMapName() );
 	}
 
 	// How many elements?
 	*nElements = lh.LumpSize() / elementSize;
 
 	// Make room for the data and copy the data in.
-	*ppData = Hunk_AllocName( lh.LumpSize(), loadname );
+	*ppData = Hunk_AllocName( lh.LumpSize(), Mod_LumpHunkName( szHunkName, sizeof( szHunkName ), lh, pszLumpName ) );
 	memcpy( *ppData, lh.LumpBase(), lh.LumpSize() );
 }
 
+void Mod_LoadClipPortalVerts( void )
+{
+	worldbrushdata_t *pMap = s_pMap;
+	Mod_LoadLump( LUMP_CLIPPORTALVERTS, "clipportalverts", sizeof( pMap->m_pClipPortalVerts[0] ), (void **)&pMap->m_pClipPortalVerts, &pMap->m_nClipPortalVerts );
+}
+
+void Mod_LoadAreaPortals( void )
+{
+	worldbrushdata_t *pMap = s_pMap;
+	Mod_LoadLump( LUMP_AREAPORTALS, "areaportals", sizeof( pMap->m_pAreaPortals[0] ), (void **)&pMap->m_pAreaPortals, &pMap->m_nAreaPortals );
+}
+
+void Mod_LoadAreas( void )
+{
+	worldbrushdata_t *pMap = s_pMap;
+	Mod_LoadLump( LUMP_AREAS, "areas", sizeof( pMap->m_pAreas[0] ), (void **)&pMap->m_pAreas, &pMap->m_nAreas );
+}
+
 
 //-----------------------------------------------------------------------------
 // Sets up the msurfacelighting_t structure
@@ -2542,12 +2706,13 @@ void Mod_LoadLeafMinDistToWater( void )
 		int		count;
 		unsigned short	*in;
 		unsigned short	*out;
+		char	szHunkName[MAX_PATH];
 
 		in = (unsigned short *)lh.LumpBase();
 		if (lh.LumpSize() % sizeof(*in))
 			Host_Error ("Mod_LoadLeafMinDistToWater: funny lump size in %s",lh.GetMapName());
 		count = lh.LumpSize() / sizeof(*in);
-		out = (unsigned short *)Hunk_AllocName( count*sizeof(*out), va( "%s [%s]", lh.GetLoadName(), "leafmindisttowater" ) );
+		out = (unsigned short *)Hunk_AllocName( count*sizeof(*out), Mod_LumpHunkName( szHunkName, sizeof( szHunkName ), lh, "leafmindisttowater" ) );
 
 		memcpy( out, in, sizeof( out[0] ) * count );
 		lh.GetMap()->m_LeafMinDistToWater = out;
@@ -2651,6 +2816,7 @@ void Mod_LoadSurfedges( medge_t *pedges )
 	unsigned short *out;
 	
 	CMapLoadHelper lh( LUMP_SURFEDGES );
+	char szHunkName[MAX_PATH];
 
 	in = (int *)lh.LumpBase();
 	if (lh.LumpSize() % sizeof(*in))
@@ -2659,7 +2825,7 @@ void Mod_LoadSurfedges( medge_t *pedges )
 	if (count < 1 || count >= MAX_MAP_SURFEDGES)
 		Host_Error ("Mod_LoadSurfedges: bad surfedges count in %s: %i",
 		lh.GetMapName(), count);
-	out = (unsigned short *)Hunk_AllocName( count*sizeof(*out), va( "%s [%s]", lh.GetLoadName(), "surfedges" ) );
+	out = (unsigned short *)Hunk_AllocName( count*sizeof(*out), Mod_LumpHunkName( szHunkName, sizeof( szHunkName ), lh, "surfedges" ) );
 
 	lh.GetMap()->vertindices = out;
 	lh.GetMap()->numvertindices = count;
@@ -4435,6 +4601,239 @@ static void MarkBrushModelWaterSurfaces( model_t* world,
 	host_state.SetWorldModel( pTemp );
 }
 
+//-----------------------------------------------------------------------------
+// Picks the HDR version of a lump if HDR is on and the map has one
+//-----------------------------------------------------------------------------
+static int Mod_HDRLump( int nLump, int nHDRLump )
+{
+	if ( g_pMaterialSystemHardwareConfig->GetHDREnabled() && CMapLoadHelper::LumpSize( nHDRLump ) > 0 )
+	{
+		return nHDRLump;
+	}
+	return nLump;
+}
+
+static void Mod_LoadWorldLighting( void )
+{
+	CMapLoadHelper mlh( Mod_HDRLump( LUMP_LIGHTING, LUMP_LIGHTING_HDR ) );
+	Mod_LoadLighting( mlh );
+}
+
+static void Mod_LoadVertIndices( void )
+{
+	medge_t *pedges = Mod_LoadEdges();
+	Mod_LoadSurfedges( pedges );
+}
+
+//-----------------------------------------------------------------------------
+// Map load steps that only turn their own lumps into world data. They don't
+// touch materials, the collision model or what other steps make, so
+// Map_LoadModel runs them on the thread pool while it does the rest, and waits
+// for them just before the first step that reads their output.
+//-----------------------------------------------------------------------------
+enum MapLoadJobStage_t
+{
+	MAP_LOAD_JOB_BEFORE_FACES,		// faces point into the lighting and primitives, and their extents come from the vertices
+	MAP_LOAD_JOB_BEFORE_OVERLAYS,	// overlays are clipped to the surface geometry
+};
+
+struct MapLoadJobLump_t
+{
+	int					m_nLump;
+	int					m_nElementSize;		// 0 if not checked
+	int					m_nMaxElements;		// 0 for no limit, otherwise there must be at least one
+};
+
+struct MapLoadJob_t
+{
+	const char			*m_pszName;
+	void				(*m_pfnLoad)( void );
+	MapLoadJobStage_t	m_nNeededBy;
+	MapLoadJobLump_t	m_Lumps[2];
+
+	CJob				*m_pJob;
+	float				m_flTime;
+};
+
+static MapLoadJob_t s_MapLoadJobs[] =
+{
+	{ "Mod_LoadLighting",			Mod_LoadWorldLighting,		MAP_LOAD_JOB_BEFORE_FACES,		{ { LUMP_LIGHTING, 0 } } },
+	{ "Mod_LoadPrimitives",			Mod_LoadPrimitives,			MAP_LOAD_JOB_BEFORE_FACES,		{ { LUMP_PRIMITIVES, sizeof( dprimitive_t ) } } },
+	{ "Mod_LoadPrimVerts",			Mod_LoadPrimVerts,			MAP_LOAD_JOB_BEFORE_FACES,		{ { LUMP_PRIMVERTS, sizeof( dprimvert_t ) } } },
+	{ "Mod_LoadPrimIndices",		Mod_LoadPrimIndices,		MAP_LOAD_JOB_BEFORE_FACES,		{ { LUMP_PRIMINDICES, sizeof( unsigned short ) } } },
+	{ "Mod_LoadVertices",			Mod_LoadVertices,			MAP_LOAD_JOB_BEFORE_FACES,		{ { LUMP_VERTEXES, sizeof( dvertex_t ) } } },
+	{ "Mod_LoadEdges/Surfedges",	Mod_LoadVertIndices,		MAP_LOAD_JOB_BEFORE_FACES,		{ { LUMP_EDGES, sizeof( dedge_t ) }, { LUMP_SURFEDGES, sizeof( int ), MAX_MAP_SURFEDGES } } },
+	{ "Mod_LoadVertNormals",		Mod_LoadVertNormals,		MAP_LOAD_JOB_BEFORE_OVERLAYS,	{ { LUMP_VERTNORMALS, sizeof( Vector ) } } },
+	{ "Mod_LoadLeafMinDistToWater",	Mod_LoadLeafMinDistToWater,	MAP_LOAD_JOB_BEFORE_OVERLAYS,	{ { LUMP_LEAFMINDISTTOWATER, sizeof( unsigned short ) } } },
+	{ "LUMP_CLIPPORTALVERTS",		Mod_LoadClipPortalVerts,	MAP_LOAD_JOB_BEFORE_OVERLAYS,	{ { LUMP_CLIPPORTALVERTS, sizeof( Vector ) } } },
+	{ "LUMP_AREAPORTALS",			Mod_LoadAreaPortals,		MAP_LOAD_JOB_BEFORE_OVERLAYS,	{ { LUMP_AREAPORTALS, sizeof( dareaportal_t ) } } },
+	{ "LUMP_AREAS",					Mod_LoadAreas,				MAP_LOAD_JOB_BEFORE_OVERLAYS,	{ { LUMP_AREAS, sizeof( darea_t ) } } },
+};
+
+//-----------------------------------------------------------------------------
+// A job whose lumps are malformed runs on the main thread instead, so that it
+// can Host_Error the usual way
+//-----------------------------------------------------------------------------
+static bool Map_CanQueueLoadJob( const MapLoadJob_t &job )
+{
+	// The 360 frees the lighting lump out from under the other jobs
+	if ( !g_pThreadPool || IsX360() )
+	{
+		return false;
+	}
+
+	for ( int i = 0; i < ARRAYSIZE( job.m_Lumps ); i++ )
+	{
+		const MapLoadJobLump_t &lump = job.m_Lumps[i];
+		if ( !lump.m_nElementSize )
+		{
+			continue;
+		}
+
+		int nSize = CMapLoadHelper::LumpSize( lump.m_nLump );
+		if ( nSize % lump.m_nElementSize )
+		{
+			return false;
+		}
+
+		int nCount = nSize / lump.m_nElementSize;
+		if ( lump.m_nMaxElements && ( nCount < 1 || nCount >= lump.m_nMaxElements ) )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void Map_RunLoadJob( MapLoadJob_t *pJob )
+{
+	double flStart = Plat_FloatTime();
+	pJob->m_pfnLoad();
+	pJob->m_flTime = Plat_FloatTime() - flStart;
+}
+
+static void Map_QueueLoadJobs( void )
+{
+	for ( int i = 0; i < ARRAYSIZE( s_MapLoadJobs ); i++ )
+	{
+		MapLoadJob_t &job = s_MapLoadJobs[i];
+		job.m_pJob = NULL;
+		job.m_flTime = 0.0f;
+		if ( Map_CanQueueLoadJob( job ) )
+		{
+			job.m_pJob = g_pThreadPool->QueueCall( Map_RunLoadJob, &job );
+		}
+		else
+		{
+			Map_RunLoadJob( &job );
+		}
+	}
+}
+
+static void Map_FinishLoadJobs( MapLoadJobStage_t nStage )
+{
+	for ( int i = 0; i < ARRAYSIZE( s_MapLoadJobs ); i++ )
+	{
+		MapLoadJob_t &job = s_MapLoadJobs[i];
+		if ( job.m_nNeededBy == nStage && job.m_pJob )
+		{
+			// Runs it here if no thread has picked it up yet
+			job.m_pJob->ExecuteAndRelease();
+			job.m_pJob = NULL;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Waits for every load job still queued or running. Host_Error calls this
+// before it unloads the map the jobs are writing into.
+//-----------------------------------------------------------------------------
+void Mod_FinishMapLoadJobs( void )
+{
+	Map_FinishLoadJobs( MAP_LOAD_JOB_BEFORE_FACES );
+	Map_FinishLoadJobs( MAP_LOAD_JOB_BEFORE_OVERLAYS );
+}
+
+//-----------------------------------------------------------------------------
+// Starts reading every lump the world model is built from, so the disk is
+// busy while the main thread works on materials
+//-----------------------------------------------------------------------------
+static void Map_PrefetchLumps( void )
+{
+	int nAmbientLump = Mod_HDRLump( LUMP_LEAF_AMBIENT_LIGHTING, LUMP_LEAF_AMBIENT_LIGHTING_HDR );
+	int lumps[] =
+	{
+		LUMP_VERTEXES, LUMP_EDGES, LUMP_SURFEDGES, LUMP_OCCLUSION, LUMP_TEXINFO,
+		Mod_HDRLump( LUMP_LIGHTING, LUMP_LIGHTING_HDR ),
+		LUMP_PRIMITIVES, LUMP_PRIMVERTS, LUMP_PRIMINDICES,
+		Mod_HDRLump( LUMP_FACES, LUMP_FACES_HDR ),
+		LUMP_VERTNORMALS, LUMP_VERTNORMALINDICES,
+		LUMP_LEAFS, nAmbientLump,
+		( nAmbientLump == LUMP_LEAF_AMBIENT_LIGHTING_HDR ) ? LUMP_LEAF_AMBIENT_INDEX_HDR : LUMP_LEAF_AMBIENT_INDEX,
+		LUMP_LEAFFACES, LUMP_NODES, LUMP_LEAFWATERDATA, LUMP_CUBEMAPS,
+#ifndef SWDS
+		LUMP_OVERLAYS, LUMP_OVERLAY_FADES,
+#endif
+		LUMP_LEAFMINDISTTOWATER, LUMP_CLIPPORTALVERTS, LUMP_AREAPORTALS, LUMP_AREAS,
+		Mod_HDRLump( LUMP_WORLDLIGHTS, LUMP_WORLDLIGHTS_HDR ),
+		LUMP_GAME_LUMP, LUMP_MODELS,
+	};
+	CMapLoadHelper::PrefetchLumps( lumps, ARRAYSIZE( lumps ) );
+}
+
+//-----------------------------------------------------------------------------
+// Steps of Map_LoadModel on the main thread, timed from one to the next
+//-----------------------------------------------------------------------------
+struct MapLoadStepTime_t
+{
+	const char	*m_pszName;
+	float		m_flTime;
+};
+
+static CUtlVector<MapLoadStepTime_t> s_MapLoadSteps;
+static double s_flMapLoadStepStart;
+
+static void Map_LoadStep( const char *pszStep )
+{
+	COM_TimestampedLog( "  %s", pszStep );
+
+	double flNow = Plat_FloatTime();
+	if ( s_MapLoadSteps.Count() )
+	{
+		s_MapLoadSteps.Tail().m_flTime = flNow - s_flMapLoadStepStart;
+	}
+	s_flMapLoadStepStart = flNow;
+
+	MapLoadStepTime_t &step = s_MapLoadSteps[ s_MapLoadSteps.AddToTail() ];
+	step.m_pszName = pszStep;
+	step.m_flTime = 0.0f;
+}
+
+static void Map_PrintLoadTimes( double flElapsed )
+{
+	if ( s_MapLoadSteps.Count() )
+	{
+		s_MapLoadSteps.Tail().m_flTime = Plat_FloatTime() - s_flMapLoadStepStart;
+	}
+
+	if ( mod_load_timings.GetBool() )
+	{
+		Msg( "Map_LoadModel: %.1f ms\n", flElapsed * 1000.0 );
+		Msg( "  main thread:\n" );
+		FOR_EACH_VEC( s_MapLoadSteps, i )
+		{
+			Msg( "    %-28s %8.2f ms\n", s_MapLoadSteps[i].m_pszName, s_MapLoadSteps[i].m_flTime * 1000.0f );
+		}
+		Msg( "  load jobs:\n" );
+		for ( int i = 0; i < ARRAYSIZE( s_MapLoadJobs ); i++ )
+		{
+			Msg( "    %-28s %8.2f ms\n", s_MapLoadJobs[i].m_pszName, s_MapLoadJobs[i].m_flTime * 1000.0f );
+		}
+	}
+
+	s_MapLoadSteps.Purge();
+}
+
 int g_nMapLoadCount = 0;
 //-----------------------------------------------------------------------------
 // Purpose: 
@@ -4464,7 +4863,7 @@ void CModelLoader::Map_LoadModel( model_t *mod )
 	mod->brush.renderHandle = 0;
 
 	// HDR and features must be established first
-	COM_TimestampedLog( "  Map_CheckForHDR" );
+	Map_LoadStep( "Map_CheckForHDR" );
 	m_bMapHasHDRLighting = Map_CheckForHDR( mod, m_szLoadName );
 	if ( IsX360() && !m_bMapHasHDRLighting )
 	{
@@ -4472,7 +4871,7 @@ void CModelLoader::Map_LoadModel( model_t *mod )
 	}
 
 	// Load the collision model
-	COM_TimestampedLog( "  CM_LoadMap" );
+	Map_LoadStep( "CM_LoadMap" );
 	unsigned int checksum;
 	CM_LoadMap( mod->strName, false, &checksum );
 
@@ -4481,66 +4880,44 @@ void CModelLoader::Map_LoadModel( model_t *mod )
 	mod->nLoadFlags |= FMODELLOADER_LOADED;
 	CMapLoadHelper::Init( mod, m_szLoadName );
 
-	COM_TimestampedLog( "  Mod_LoadVertices" );
-	Mod_LoadVertices();
-	
-	COM_TimestampedLog( "  Mod_LoadEdges" );
-	medge_t *pedges = Mod_LoadEdges();
+	// Ask for every lump up front, then hand the ones that are plain data to
+	// the thread pool
+	Map_LoadStep( "Map_PrefetchLumps" );
+	Map_PrefetchLumps();
 
-	COM_TimestampedLog( "  Mod_LoadSurfedges" );
-	Mod_LoadSurfedges( pedges );
+	Map_LoadStep( "Map_QueueLoadJobs" );
+	Map_QueueLoadJobs();
 
-	COM_TimestampedLog( "  Mod_LoadPlanes" );
+	Map_LoadStep( "Mod_LoadPlanes" );
 	Mod_LoadPlanes();
 
-	COM_TimestampedLog( "  Mod_LoadOcclusion" );
+	Map_LoadStep( "Mod_LoadOcclusion" );
 	Mod_LoadOcclusion();
 
 	// texdata needs to load before texinfo
-	COM_TimestampedLog( "  Mod_LoadTexdata" );
+	Map_LoadStep( "Mod_LoadTexdata" );
 	Mod_LoadTexdata();
 
-	COM_TimestampedLog( "  Mod_LoadTexinfo" );
+	Map_LoadStep( "Mod_LoadTexinfo" );
 	Mod_LoadTexinfo();
 
 #ifndef SWDS
 	EngineVGui()->UpdateProgressBar(PROGRESS_LOADWORLDMODEL);
 #endif
 
-	// Until BSP version 19, this must occur after loading texinfo
-	COM_TimestampedLog( "  Mod_LoadLighting" );
-	if ( g_pMaterialSystemHardwareConfig->GetHDREnabled() && CMapLoadHelper::LumpSize( LUMP_LIGHTING_HDR ) > 0 )
-	{
-		CMapLoadHelper mlh( LUMP_LIGHTING_HDR );
-		Mod_LoadLighting( mlh );
-	}
-	else
-	{
-		CMapLoadHelper mlh( LUMP_LIGHTING );
-		Mod_LoadLighting( mlh );
-	}
-
-	COM_TimestampedLog( "  Mod_LoadPrimitives" );
-	Mod_LoadPrimitives();
-
-	COM_TimestampedLog( "  Mod_LoadPrimVerts" );
-	Mod_LoadPrimVerts();
-
-	COM_TimestampedLog( "  Mod_LoadPrimIndices" );
-	Mod_LoadPrimIndices();
+	// faces need the lighting and primitives
+	Map_LoadStep( "Map_FinishLoadJobs( faces )" );
+	Map_FinishLoadJobs( MAP_LOAD_JOB_BEFORE_FACES );
 
 #ifndef SWDS
 	EngineVGui()->UpdateProgressBar(PROGRESS_LOADWORLDMODEL);
 #endif
 
 	// faces need to be loaded before vertnormals
-	COM_TimestampedLog( "  Mod_LoadFaces" );
+	Map_LoadStep( "Mod_LoadFaces" );
 	Mod_LoadFaces();
 
-	COM_TimestampedLog( "  Mod_LoadVertNormals" );
-	Mod_LoadVertNormals();
-
-	COM_TimestampedLog( "  Mod_LoadVertNormalIndices" );
+	Map_LoadStep( "Mod_LoadVertNormalIndices" );
 	Mod_LoadVertNormalIndices();
 
 #ifndef SWDS
@@ -4548,59 +4925,36 @@ void CModelLoader::Map_LoadModel( model_t *mod )
 #endif
 
 	// note leafs must load befor marksurfaces
-	COM_TimestampedLog( "  Mod_LoadLeafs" );
+	Map_LoadStep( "Mod_LoadLeafs" );
 	Mod_LoadLeafs();
 
-	COM_TimestampedLog( "  Mod_LoadMarksurfaces" );
+	Map_LoadStep( "Mod_LoadMarksurfaces" );
     Mod_LoadMarksurfaces();
 
-	COM_TimestampedLog( "  Mod_LoadNodes" );
+	Map_LoadStep( "Mod_LoadNodes" );
 	Mod_LoadNodes();
 
-	COM_TimestampedLog( "  Mod_LoadLeafWaterData" );
+	Map_LoadStep( "Mod_LoadLeafWaterData" );
 	Mod_LoadLeafWaterData();
 
-	COM_TimestampedLog( "  Mod_LoadCubemapSamples" );
+	Map_LoadStep( "Mod_LoadCubemapSamples" );
 	Mod_LoadCubemapSamples();
 
+	// everything after this may use the rest of the world geometry
+	Map_LoadStep( "Map_FinishLoadJobs( overlays )" );
+	Map_FinishLoadJobs( MAP_LOAD_JOB_BEFORE_OVERLAYS );
+
 #ifndef SWDS
 	// UNDONE: Does the cmodel need worldlights?
-	COM_TimestampedLog( "  OverlayMgr()->LoadOverlays" );
+	Map_LoadStep( "OverlayMgr()->LoadOverlays" );
 	OverlayMgr()->LoadOverlays();	
 #endif
 
-	COM_TimestampedLog( "  Mod_LoadLeafMinDistToWater" );
-	Mod_LoadLeafMinDistToWater();
-
 #ifndef SWDS
 	EngineVGui()->UpdateProgressBar(PROGRESS_LOADWORLDMODEL);
 #endif
 
-	COM_TimestampedLog( "  LUMP_CLIPPORTALVERTS" );
-	Mod_LoadLump( mod, 
-		LUMP_CLIPPORTALVERTS, 
-		va( "%s [%s]", m_szLoadName, "clipportalverts" ),
-		sizeof(m_worldBrushData.m_pClipPortalVerts[0]), 
-		(void**)&m_worldBrushData.m_pClipPortalVerts,
-		&m_worldBrushData.m_nClipPortalVerts );
-
-	COM_TimestampedLog( "  LUMP_AREAPORTALS" );
-	Mod_LoadLump( mod, 
-		LUMP_AREAPORTALS, 
-		va( "%s [%s]", m_szLoadName, "areaportals" ),
-		sizeof(m_worldBrushData.m_pAreaPortals[0]), 
-		(void**)&m_worldBrushData.m_pAreaPortals,
-		&m_worldBrushData.m_nAreaPortals );
-	
-	COM_TimestampedLog( "  LUMP_AREAS" );
-	Mod_LoadLump( mod, 
-		LUMP_AREAS, 
-		va( "%s [%s]", m_szLoadName, "areas" ),
-		sizeof(m_worldBrushData.m_pAreas[0]), 
-		(void**)&m_worldBrushData.m_pAreas,
-		&m_worldBrushData.m_nAreas );
-
-	COM_TimestampedLog( "  Mod_LoadWorldlights" );
+	Map_LoadStep( "Mod_LoadWorldlights" );
 	if ( g_pMaterialSystemHardwareConfig->GetHDREnabled() && CMapLoadHelper::LumpSize( LUMP_WORLDLIGHTS_HDR ) > 0 )
 	{
 		CMapLoadHelper mlh( LUMP_WORLDLIGHTS_HDR );
@@ -4612,7 +4966,7 @@ void CModelLoader::Map_LoadModel( model_t *mod )
 		Mod_LoadWorldlights( mlh, false );
 	}
 
-	COM_TimestampedLog( "  Mod_LoadGameLumpDict" );
+	Map_LoadStep( "Mod_LoadGameLumpDict" );
 	Mod_LoadGameLumpDict();
 
 	// load the portal information
@@ -4628,7 +4982,7 @@ void CModelLoader::Map_LoadModel( model_t *mod )
 	EngineVGui()->UpdateProgressBar(PROGRESS_LOADWORLDMODEL);
 #endif
 
-	COM_TimestampedLog( "  Mod_LoadSubmodels" );
+	Map_LoadStep( "Mod_LoadSubmodels" );
 	CUtlVector<mmodel_t> submodelList;
 	Mod_LoadSubmodels( submodelList );
 
@@ -4636,26 +4990,27 @@ void CModelLoader::Map_LoadModel( model_t *mod )
 	EngineVGui()->UpdateProgressBar(PROGRESS_LOADWORLDMODEL);
 #endif
 
-	COM_TimestampedLog( "  SetupSubModels" );
+	Map_LoadStep( "SetupSubModels" );
 	SetupSubModels( mod, submodelList );
 
-	COM_TimestampedLog( "  RecomputeSurfaceFlags" );
+	Map_LoadStep( "RecomputeSurfaceFlags" );
 	RecomputeSurfaceFlags( mod );
 
 #ifndef SWDS
 	EngineVGui()->UpdateProgressBar(PROGRESS_LOADWORLDMODEL);
 #endif
 
-	COM_TimestampedLog( "  Map_VisClear" );
+	Map_LoadStep( "Map_VisClear" );
 	Map_VisClear();
 
-	COM_TimestampedLog( "  Map_SetRenderInfoAllocated" );
+	Map_LoadStep( "Map_SetRenderInfoAllocated" );
 	Map_SetRenderInfoAllocated( false );
 
 	// Close map file, etc.
 	CMapLoadHelper::Shutdown();
 
 	double elapsed = Plat_FloatTime() - startTime;
+	Map_PrintLoadTimes( elapsed );
 	COM_TimestampedLog( "Map_LoadModel: Finish - loading took %.4f seconds", elapsed );
 }
 
@@ -187,6 +187,10 @@ public:
 	// Free the lighting lump (increases free memory during loading on 360)
 	static void			FreeLightingLump();
 
+	// Starts reading lumps in the background. The first helper created for
+	// each one takes the data instead of reading it then.
+	static void			PrefetchLumps( const int *pLumps, int nLumps );
+
 	// Returns the size of a particular lump without loading it
 	static int			LumpSize( int lumpId );
 	static int			LumpOffset( int lumpId );
@@ -202,6 +206,7 @@ private:
 	byte				*m_pRawData;
 	byte				*m_pData;
 	byte				*m_pUncompressedData;
+	byte				*m_pMappedData;		// view of the lump mapped straight from the file
 
 	// Handling for lump files
 	int					m_nLumpID;
@@ -214,6 +219,12 @@ private:
 
 void Mod_RecomputeTranslucency( model_t* mod, int nSkin, int nBody, void /*IClientRenderable*/ *pClientRenderable, float fInstanceAlphaModulate );
 
+//-----------------------------------------------------------------------------
+// Waits for the world model load steps running on the thread pool
+//-----------------------------------------------------------------------------
+
+void Mod_FinishMapLoadJobs( void );
+
 //-----------------------------------------------------------------------------
 // game lumps
 //-----------------------------------------------------------------------------
@@ -30,6 +30,7 @@
 #include "replay_internal.h"
 #endif
 #include "tier2/tier2.h"
+#include "sv_ticktelemetry.h"
 
 // memdbgon must be the last include file in a .cpp file!!!
 #include "tier0/memdbgon.h"
@@ -186,16 +187,19 @@ bool CGameClient::ProcessMove(CLC_Move *msg)
 	
 	int startbit = msg->m_DataIn.GetNumBitsRead();
 
-	serverGameClients->ProcessUsercmds
-	( 
-		edict,					// Player edict
-		&msg->m_DataIn,
-		msg->m_nNewCommands,
-		totalcmds,							// Commands in packet
-		netdrop,							// Number of dropped commands
-		ignore,								// Don't actually run anything
-		paused								// Run, but don't actually do any movement
-	);
+	{
+		SV_TICK_PHASE( TICK_PHASE_USERCMDS );
+		serverGameClients->ProcessUsercmds
+		( 
+			edict,					// Player edict
+			&msg->m_DataIn,
+			msg->m_nNewCommands,
+			totalcmds,							// Commands in packet
+			netdrop,							// Number of dropped commands
+			ignore,								// Don't actually run anything
+			paused								// Run, but don't actually do any movement
+		);
+	}
 
 
 	if ( msg->m_DataIn.IsOverflowed() )
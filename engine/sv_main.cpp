@@ -65,6 +65,7 @@
 #include "tier1/functors.h"
 #include "vstdlib/jobthread.h"
 #include "pure_server.h"
+#include "sv_ticktelemetry.h"
 #include "datacache/idatacache.h"
 #include "filesystem/IQueuedLoader.h"
 #include "vstdlib/jobthread.h"
@@ -1896,14 +1897,19 @@ void CGameServer::SendClientMessages ( bool bSendSnapshots )
 
 	if ( receivingClientCount )
 	{
-		// if any client wants an update, take new snapshot now
-		CFrameSnapshot* pSnapshot = framesnapshotmanager->TakeTickSnapshot( m_nTickCount );
+		CFrameSnapshot* pSnapshot;
+		{
+			SV_TICK_PHASE( TICK_PHASE_PACK_ENTITIES );
+
+			// if any client wants an update, take new snapshot now
+			pSnapshot = framesnapshotmanager->TakeTickSnapshot( m_nTickCount );
 
-		// copy temp ents references to pSnapshot
-		CopyTempEntities( pSnapshot );
+			// copy temp ents references to pSnapshot
+			CopyTempEntities( pSnapshot );
 
-		// Compute the client packs
-		SV_ComputeClientPacks( receivingClientCount, pReceivingClients, pSnapshot );
+			// Compute the client packs
+			SV_ComputeClientPacks( receivingClientCount, pReceivingClients, pSnapshot );
+		}
 
 		if ( receivingClientCount > 1 && sv_parallel_sendsnapshot.GetBool() )
 		{
@@ -2812,6 +2818,7 @@ void SV_Think( bool bIsSimulating )
 {
 	VPROF( "SV_Physics" );
 	tmZone( TELEMETRY_LEVEL1, TMZF_NONE, "SV_Think(%s)", bIsSimulating ? "simulating" : "not simulating" );
+	SV_TICK_PHASE( TICK_PHASE_GAMEFRAME );
 	
 // @FD The staging branch already did away with "frames" and wakes on tick
 // optimally.  Currently the hibernating flag essentially means "is empty
@@ -2894,6 +2901,8 @@ void SV_FrameExecuteThreadDeferred()
 
 void SV_SendClientUpdates( bool bIsSimulating, bool bSendDuringPause )
 {
+	SV_TICK_PHASE( TICK_PHASE_SEND_SNAPSHOTS );
+
 	bool bForcedSend = s_bForceSend;
 	s_bForceSend = false;
 
@@ -2923,6 +2932,8 @@ void SV_Frame( bool finalTick )
 		return;
 	}
 
+	g_ServerTickTelemetry.BeginTick();
+
 	g_ServerGlobalVariables.frametime = host_state.interval_per_tick;
 
 	bool bIsSimulating = SV_IsSimulating();
@@ -2933,7 +2944,10 @@ void SV_Frame( bool finalTick )
 	
 
 	// Run any commands from client and play client Think functions if it is time.
-	sv.RunFrame(); // read network input etc
+	{
+		SV_TICK_PHASE( TICK_PHASE_NET_READ );
+		sv.RunFrame(); // read network input etc
+	}
 
 	bool simulated = false;
 	if ( SV_HasPlayers() )
@@ -2976,5 +2990,7 @@ void SV_Frame( bool finalTick )
 	{
 		Steam3Server().RunFrame();
 	}
+
+	g_ServerTickTelemetry.EndTick();
 }
 
@@ -0,0 +1,221 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Per-tick server phase timings
+//
+//=============================================================================//
+
+#include "server_pch.h"
+#include <time.h>
+#include "sv_ticktelemetry.h"
+#include "tier0/fasttimer.h"
+#include "net.h"
+#include "netadr.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+static ConVar sv_tick_telemetry( "sv_tick_telemetry", "1", 0, "Record per-tick server phase timings, see sv_tick_report." );
+static ConVar sv_tick_telemetry_file( "sv_tick_telemetry_file", "", 0, "Append a JSON line of tick timing percentiles to this file every sv_tick_telemetry_interval seconds." );
+static ConVar sv_tick_telemetry_udp( "sv_tick_telemetry_udp", "", 0, "Send a JSON packet of tick timing percentiles to this ip:port every sv_tick_telemetry_interval seconds." );
+static ConVar sv_tick_telemetry_interval( "sv_tick_telemetry_interval", "10", 0, "Seconds covered by each sv_tick_telemetry_file/udp report.", true, 1, false, 0 );
+
+static const char *s_pszPhaseNames[NUM_TICK_PHASES] =
+{
+	"net_read",
+	"usercmds",
+	"gameframe",
+	"pack_entities",
+	"send_snapshots",
+	"tick",
+	"sleep",
+};
+
+CServerTickTelemetry g_ServerTickTelemetry;
+
+CServerTickTelemetry::CServerTickTelemetry()
+{
+	m_bInTick = false;
+	m_nTickThread = 0;
+	m_flIntervalStart = 0;
+	memset( m_nPhaseStart, 0, sizeof( m_nPhaseStart ) );
+	memset( m_nPhaseCycles, 0, sizeof( m_nPhaseCycles ) );
+}
+
+static inline uint32 CyclesToMicroseconds( uint64 nCycles )
+{
+	return (uint32)MIN( (double)nCycles * g_ClockSpeedMicrosecondsMultiplier, 4294967295.0 );
+}
+
+void CServerTickTelemetry::BeginTick()
+{
+	if ( !sv_tick_telemetry.GetBool() )
+		return;
+
+	// SV_Frame runs on a job thread under host_thread_mode, phases only
+	// count on whichever thread is running the tick
+	m_nTickThread = ThreadGetCurrentId();
+	m_bInTick = true;
+	memset( m_nPhaseCycles, 0, sizeof( m_nPhaseCycles ) );
+	m_nPhaseStart[TICK_PHASE_TICK] = CCycleCount::GetTimestamp();
+}
+
+void CServerTickTelemetry::EndTick()
+{
+	if ( !m_bInTick )
+		return;
+
+	m_bInTick = false;
+	m_nPhaseCycles[TICK_PHASE_TICK] = CCycleCount::GetTimestamp() - m_nPhaseStart[TICK_PHASE_TICK];
+
+	// Usercmds run while packets are read, and packing happens while
+	// sending, report them separately
+	m_nPhaseCycles[TICK_PHASE_NET_READ] -= MIN( m_nPhaseCycles[TICK_PHASE_NET_READ], m_nPhaseCycles[TICK_PHASE_USERCMDS] );
+	m_nPhaseCycles[TICK_PHASE_SEND_SNAPSHOTS] -= MIN( m_nPhaseCycles[TICK_PHASE_SEND_SNAPSHOTS], m_nPhaseCycles[TICK_PHASE_PACK_ENTITIES] );
+
+	char szJSON[2048];
+	int nLen = 0;
+	{
+		AUTO_LOCK( m_mutex );
+		for ( int i = 0; i < NUM_TICK_PHASES; i++ )
+		{
+			if ( i == TICK_PHASE_SLEEP )
+				continue;
+
+			uint32 nMicroseconds = CyclesToMicroseconds( m_nPhaseCycles[i] );
+			m_Histograms[i].Record( nMicroseconds );
+			m_IntervalHistograms[i].Record( nMicroseconds );
+		}
+
+		double flNow = Plat_FloatTime();
+		if ( m_flIntervalStart == 0 )
+		{
+			m_flIntervalStart = flNow;
+		}
+		else if ( flNow - m_flIntervalStart >= sv_tick_telemetry_interval.GetFloat() )
+		{
+			if ( sv_tick_telemetry_file.GetString()[0] || sv_tick_telemetry_udp.GetString()[0] )
+			{
+				nLen = FormatJSON( szJSON, sizeof( szJSON ) );
+			}
+			for ( int i = 0; i < NUM_TICK_PHASES; i++ )
+			{
+				m_IntervalHistograms[i].Reset();
+			}
+			m_flIntervalStart = flNow;
+		}
+	}
+
+	// Outside the lock, the main thread shouldn't wait on file or network writes
+	if ( nLen )
+	{
+		WriteEndpoints( szJSON, nLen );
+	}
+}
+
+void CServerTickTelemetry::BeginPhase( ServerTickPhase_t phase )
+{
+	if ( m_bInTick && ThreadGetCurrentId() == m_nTickThread )
+	{
+		m_nPhaseStart[phase] = CCycleCount::GetTimestamp();
+	}
+}
+
+void CServerTickTelemetry::EndPhase( ServerTickPhase_t phase )
+{
+	if ( m_bInTick && ThreadGetCurrentId() == m_nTickThread && m_nPhaseStart[phase] )
+	{
+		m_nPhaseCycles[phase] += CCycleCount::GetTimestamp() - m_nPhaseStart[phase];
+		m_nPhaseStart[phase] = 0;
+	}
+}
+
+void CServerTickTelemetry::RecordSleep( double flSeconds )
+{
+	if ( !sv_tick_telemetry.GetBool() || !sv.IsActive() )
+		return;
+
+	uint32 nMicroseconds = (uint32)clamp( flSeconds * 1000000.0, 0.0, 4294967295.0 );
+	AUTO_LOCK( m_mutex );
+	m_Histograms[TICK_PHASE_SLEEP].Record( nMicroseconds );
+	m_IntervalHistograms[TICK_PHASE_SLEEP].Record( nMicroseconds );
+}
+
+void CServerTickTelemetry::Reset()
+{
+	AUTO_LOCK( m_mutex );
+	for ( int i = 0; i < NUM_TICK_PHASES; i++ )
+	{
+		m_Histograms[i].Reset();
+		m_IntervalHistograms[i].Reset();
+	}
+	m_flIntervalStart = 0;
+}
+
+void CServerTickTelemetry::Report()
+{
+	AUTO_LOCK( m_mutex );
+	ConMsg( "%-16s %9s %9s %9s %9s %9s %9s %9s\n", "phase (ms)", "count", "mean", "p50", "p90", "p99", "p99.9", "max" );
+	for ( int i = 0; i < NUM_TICK_PHASES; i++ )
+	{
+		const CHdrHistogram &h = m_Histograms[i];
+		ConMsg( "%-16s %9llu %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f\n", s_pszPhaseNames[i], (unsigned long long)h.Count(),
+			h.Mean() * 0.001, h.Percentile( 50 ) * 0.001, h.Percentile( 90 ) * 0.001, h.Percentile( 99 ) * 0.001,
+			h.Percentile( 99.9f ) * 0.001, h.Max() * 0.001 );
+	}
+}
+
+int CServerTickTelemetry::FormatJSON( char *pBuf, int nBufSize )
+{
+	int nLen = V_snprintf( pBuf, nBufSize, "{\"time\":%lld,\"tick\":%d,\"interval\":%.3f,\"phases_us\":{",
+		(long long)time( NULL ), sv.m_nTickCount, Plat_FloatTime() - m_flIntervalStart );
+
+	for ( int i = 0; i < NUM_TICK_PHASES && nLen < nBufSize; i++ )
+	{
+		const CHdrHistogram &h = m_IntervalHistograms[i];
+		nLen += V_snprintf( pBuf + nLen, nBufSize - nLen, "%s\"%s\":{\"count\":%llu,\"mean\":%.1f,\"p50\":%u,\"p90\":%u,\"p99\":%u,\"p999\":%u,\"max\":%u}",
+			i ? "," : "", s_pszPhaseNames[i], (unsigned long long)h.Count(), h.Mean(),
+			h.Percentile( 50 ), h.Percentile( 90 ), h.Percentile( 99 ), h.Percentile( 99.9f ), h.Max() );
+	}
+
+	if ( nLen < nBufSize )
+	{
+		nLen += V_snprintf( pBuf + nLen, nBufSize - nLen, "}}\n" );
+	}
+	return MIN( nLen, nBufSize - 1 );
+}
+
+void CServerTickTelemetry::WriteEndpoints( const char *pJSON, int nLen )
+{
+	const char *pszFile = sv_tick_telemetry_file.GetString();
+	const char *pszAddr = sv_tick_telemetry_udp.GetString();
+
+	if ( pszFile[0] )
+	{
+		FileHandle_t hFile = g_pFileSystem->Open( pszFile, "a", "DEFAULT_WRITE_PATH" );
+		if ( hFile != FILESYSTEM_INVALID_HANDLE )
+		{
+			g_pFileSystem->Write( pJSON, nLen, hFile );
+			g_pFileSystem->Close( hFile );
+		}
+	}
+
+	if ( pszAddr[0] )
+	{
+		netadr_t adr;
+		if ( NET_StringToAdr( pszAddr, &adr ) )
+		{
+			NET_SendPacket( NULL, NS_SERVER, adr, (unsigned char *)pJSON, nLen );
+		}
+	}
+}
+
+CON_COMMAND( sv_tick_report, "Print percentiles of per-tick server phase timings. 'sv_tick_report reset' clears them." )
+{
+	if ( args.ArgC() > 1 && !V_stricmp( args[1], "reset" ) )
+	{
+		g_ServerTickTelemetry.Reset();
+		return;
+	}
+
+	g_ServerTickTelemetry.Report();
+}
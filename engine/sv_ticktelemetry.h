@@ -0,0 +1,85 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Per-tick server phase timings, kept as histograms so tail
+//			latency (p99 tick time) can be monitored rather than averages.
+//			See sv_tick_report and the sv_tick_telemetry_* convars.
+//
+//=============================================================================//
+
+#ifndef SV_TICKTELEMETRY_H
+#define SV_TICKTELEMETRY_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "tier0/threadtools.h"
+#include "tier1/hdrhistogram.h"
+
+enum ServerTickPhase_t
+{
+	TICK_PHASE_NET_READ = 0,		// reading packets, not counting usercmds
+	TICK_PHASE_USERCMDS,			// running client usercmds
+	TICK_PHASE_GAMEFRAME,			// server.dll GameFrame
+	TICK_PHASE_PACK_ENTITIES,		// snapshot and client packs
+	TICK_PHASE_SEND_SNAPSHOTS,		// building and sending client messages, not counting packing
+	TICK_PHASE_TICK,				// all of SV_Frame
+	TICK_PHASE_SLEEP,				// waiting for the next frame, recorded once per engine frame
+
+	NUM_TICK_PHASES
+};
+
+class CServerTickTelemetry
+{
+public:
+	CServerTickTelemetry();
+
+	// Bracket SV_Frame. Histograms are updated, and written to the
+	// endpoints if it's time, at the end of each tick.
+	void BeginTick();
+	void EndTick();
+
+	// Phases may be entered several times a tick (usercmds run per client),
+	// their times are summed. Only the thread running the tick is timed,
+	// which is a job thread under host_thread_mode.
+	void BeginPhase( ServerTickPhase_t phase );
+	void EndPhase( ServerTickPhase_t phase );
+
+	// Called by the main thread, which may not be the one running ticks
+	void RecordSleep( double flSeconds );
+
+	void Report();
+	void Reset();
+
+private:
+	void WriteEndpoints( const char *pJSON, int nLen );
+	int FormatJSON( char *pBuf, int nBufSize );
+
+	bool m_bInTick;
+	ThreadId_t m_nTickThread;
+	uint64 m_nPhaseStart[NUM_TICK_PHASES];
+	uint64 m_nPhaseCycles[NUM_TICK_PHASES];
+
+	// Since the last reset, and since the endpoints were last written.
+	// The sleep is recorded from another thread than the tick phases
+	// under host_thread_mode, m_mutex guards these.
+	CThreadFastMutex m_mutex;
+	CHdrHistogram m_Histograms[NUM_TICK_PHASES];
+	CHdrHistogram m_IntervalHistograms[NUM_TICK_PHASES];
+	double m_flIntervalStart;
+};
+
+extern CServerTickTelemetry g_ServerTickTelemetry;
+
+class CServerTickPhaseScope
+{
+public:
+	CServerTickPhaseScope( ServerTickPhase_t phase ) : m_Phase( phase )	{ g_ServerTickTelemetry.BeginPhase( phase ); }
+	~CServerTickPhaseScope()											{ g_ServerTickTelemetry.EndPhase( m_Phase ); }
+
+private:
+	ServerTickPhase_t m_Phase;
+};
+
+#define SV_TICK_PHASE( phase )	CServerTickPhaseScope tickPhaseScope_##phase( phase )
+
+#endif // SV_TICKTELEMETRY_H
@@ -24,6 +24,7 @@
 #include "gl_matsysiface.h"
 #include "vprof_engine.h"
 #include "server.h"
+#include "sv_ticktelemetry.h"
 #include "cl_demo.h"
 #include "toolframework/itoolframework.h"
 #include "toolframework/itoolsystem.h"
@@ -318,6 +319,7 @@ void CEngine::Frame( void )
 
 	// Loop until it is time for our frame. Don't return early because pumping messages
 	// and processing console input is expensive (0.1 ms for each call to ProcessConsoleInput).
+	double flWaitStart = Sys_FloatTime();
 	for (;;)
 	{
 		// Get current time
@@ -372,6 +374,7 @@ void CEngine::Frame( void )
 #endif
 		}
 	}
+	g_ServerTickTelemetry.RecordSleep( m_flCurrentTime - flWaitStart );
 
 	if ( ShouldSerializeAsync() )
 	{
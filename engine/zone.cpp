@@ -35,6 +35,9 @@ CMemoryStack g_HunkOverflow;
 static bool g_bWarnedOverflow;
 #endif
 
+// Map load jobs allocate world data from the thread pool
+static CThreadFastMutex g_HunkMutex;
+
 static int GetTargetCacheSize()
 {
 	int nMemLimit = host_parms.memsize - Hunk_Size();
@@ -53,6 +56,7 @@ Hunk_AllocName
 void *Hunk_AllocName (int size, const char *name, bool bClear)
 {
 	MEM_ALLOC_CREDIT();
+	AUTO_LOCK_FM( g_HunkMutex );
 	void * p = g_HunkMemoryStack.Alloc( size, bClear );
 	if ( p )
 		return p;
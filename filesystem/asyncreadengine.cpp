@@ -0,0 +1,642 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Batched kernel async reads, see asyncreadengine.h
+//
+//=============================================================================
+
+#include <string.h>
+#include "tier0/dbg.h"
+#include "tier0/platform.h"
+#include "asyncreadengine.h"
+
+#ifdef POSIX
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+#ifdef ASYNC_READ_ENGINE_URING
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/poll.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+// NOTE: This has to be the last file included!
+#include "tier0/memdbgon.h"
+
+// How long a staged read can wait for company before it's submitted anyway
+#define ASYNC_READ_FLUSH_MS		1
+
+#ifdef ASYNC_READ_ENGINE_URING
+static int io_uring_setup( unsigned nEntries, struct io_uring_params *pParams )
+{
+	return (int)syscall( __NR_io_uring_setup, nEntries, pParams );
+}
+
+static int io_uring_enter( int hRing, unsigned nToSubmit, unsigned nMinComplete, unsigned nFlags )
+{
+	return (int)syscall( __NR_io_uring_enter, hRing, nToSubmit, nMinComplete, nFlags, NULL, 0 );
+}
+
+static int io_uring_register( int hRing, unsigned nOpcode, void *pArg, unsigned nArgs )
+{
+	return (int)syscall( __NR_io_uring_register, hRing, nOpcode, pArg, nArgs );
+}
+#endif
+
+CAsyncReadEngine::CAsyncReadEngine()
+{
+	m_nInFlight = 0;
+	m_nPending = 0;
+	m_nUnsubmitted = 0;
+	m_nStagedTime = 0;
+	m_hThread = NULL;
+	m_bExit = false;
+	m_hRing = -1;
+	m_hWake = -1;
+	m_pFixedBuffers = NULL;
+	m_pSqRing = NULL;
+	m_pCqRing = NULL;
+	m_pSqes = NULL;
+	m_IdleEvent.Set();
+	ResetStats();
+}
+
+CAsyncReadEngine::~CAsyncReadEngine()
+{
+	Shutdown();
+}
+
+bool CAsyncReadEngine::Init()
+{
+#ifdef ASYNC_READ_ENGINE_URING
+	if ( m_hRing >= 0 )
+		return true;
+
+	struct io_uring_params params;
+	memset( &params, 0, sizeof( params ) );
+	int hRing = io_uring_setup( RING_ENTRIES, &params );
+	if ( hRing < 0 )
+		return false;
+
+	m_nSqRingSize = params.sq_off.array + params.sq_entries * sizeof( uint32 );
+	m_nCqRingSize = params.cq_off.cqes + params.cq_entries * sizeof( struct io_uring_cqe );
+	bool bSingleMmap = ( params.features & IORING_FEAT_SINGLE_MMAP ) != 0;
+	if ( bSingleMmap )
+	{
+		m_nSqRingSize = m_nCqRingSize = MAX( m_nSqRingSize, m_nCqRingSize );
+	}
+
+	m_pSqRing = mmap( NULL, m_nSqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, hRing, IORING_OFF_SQ_RING );
+	m_pCqRing = ( m_pSqRing == MAP_FAILED || bSingleMmap ) ? m_pSqRing :
+		mmap( NULL, m_nCqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, hRing, IORING_OFF_CQ_RING );
+	void *pSqes = mmap( NULL, params.sq_entries * sizeof( struct io_uring_sqe ), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, hRing, IORING_OFF_SQES );
+	m_hWake = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+	if ( m_pSqRing == MAP_FAILED || m_pCqRing == MAP_FAILED || pSqes == MAP_FAILED || m_hWake < 0 )
+	{
+		if ( pSqes != MAP_FAILED )
+			munmap( pSqes, params.sq_entries * sizeof( struct io_uring_sqe ) );
+		if ( m_pCqRing != MAP_FAILED && m_pCqRing != m_pSqRing )
+			munmap( m_pCqRing, m_nCqRingSize );
+		if ( m_pSqRing != MAP_FAILED )
+			munmap( m_pSqRing, m_nSqRingSize );
+		if ( m_hWake >= 0 )
+			close( m_hWake );
+		close( hRing );
+		m_pSqRing = m_pCqRing = NULL;
+		m_hWake = -1;
+		return false;
+	}
+
+	uint8 *pSq = (uint8 *)m_pSqRing;
+	m_pSqHead = (uint32 *)( pSq + params.sq_off.head );
+	m_pSqTail = (uint32 *)( pSq + params.sq_off.tail );
+	m_nSqMask = *(uint32 *)( pSq + params.sq_off.ring_mask );
+	m_pSqArray = (uint32 *)( pSq + params.sq_off.array );
+	m_pSqes = (struct io_uring_sqe *)pSqes;
+
+	uint8 *pCq = (uint8 *)m_pCqRing;
+	m_pCqHead = (uint32 *)( pCq + params.cq_off.head );
+	m_pCqTail = (uint32 *)( pCq + params.cq_off.tail );
+	m_nCqMask = *(uint32 *)( pCq + params.cq_off.ring_mask );
+	m_pCqes = (struct io_uring_cqe *)( pCq + params.cq_off.cqes );
+
+	// Small reads go through registered buffers, the kernel doesn't have to
+	// pin the destination pages for each one. This counts against
+	// RLIMIT_MEMLOCK on older kernels, do without if it's refused.
+	void *pFixed = mmap( NULL, NUM_FIXED_BUFFERS * FIXED_BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+	if ( pFixed != MAP_FAILED )
+	{
+		struct iovec iov[NUM_FIXED_BUFFERS];
+		for ( int i = 0; i < NUM_FIXED_BUFFERS; i++ )
+		{
+			iov[i].iov_base = (uint8 *)pFixed + i * FIXED_BUFFER_SIZE;
+			iov[i].iov_len = FIXED_BUFFER_SIZE;
+		}
+		if ( io_uring_register( hRing, IORING_REGISTER_BUFFERS, iov, NUM_FIXED_BUFFERS ) == 0 )
+		{
+			m_pFixedBuffers = (uint8 *)pFixed;
+			for ( int i = NUM_FIXED_BUFFERS - 1; i >= 0; i-- )
+			{
+				m_FreeFixedBuffers.AddToTail( i );
+			}
+		}
+		else
+		{
+			munmap( pFixed, NUM_FIXED_BUFFERS * FIXED_BUFFER_SIZE );
+		}
+	}
+
+	m_hRing = hRing;
+	m_bExit = false;
+	m_hThread = CreateSimpleThread( ThreadFunc, this );
+	ThreadSetDebugName( m_hThread, "AsyncReadEngine" );
+	return true;
+#else
+	return false;
+#endif
+}
+
+void CAsyncReadEngine::Shutdown()
+{
+#ifdef ASYNC_READ_ENGINE_URING
+	if ( m_hRing < 0 )
+		return;
+
+	WaitForIdle();
+
+	m_bExit = true;
+	Wake();
+	ThreadJoin( m_hThread );
+	ReleaseThreadHandle( m_hThread );
+	m_hThread = NULL;
+
+	munmap( m_pSqes, ( m_nSqMask + 1 ) * sizeof( struct io_uring_sqe ) );
+	if ( m_pCqRing != m_pSqRing )
+	{
+		munmap( m_pCqRing, m_nCqRingSize );
+	}
+	munmap( m_pSqRing, m_nSqRingSize );
+	m_pSqRing = m_pCqRing = NULL;
+	m_pSqes = NULL;
+
+	// Closing the ring drops the buffer registration
+	close( m_hRing );
+	close( m_hWake );
+	m_hRing = m_hWake = -1;
+
+	if ( m_pFixedBuffers )
+	{
+		munmap( m_pFixedBuffers, NUM_FIXED_BUFFERS * FIXED_BUFFER_SIZE );
+		m_pFixedBuffers = NULL;
+	}
+	m_FreeFixedBuffers.Purge();
+
+	for ( int i = 0; i < m_FreeBatches.Count(); i++ )
+	{
+		delete [] m_FreeBatches[i]->m_pIov;
+		delete m_FreeBatches[i];
+	}
+	m_FreeBatches.Purge();
+#endif
+}
+
+void CAsyncReadEngine::Read( AsyncReadOp_t *pOp, bool bMoreComing )
+{
+	Assert( m_hRing >= 0 && pOp->m_nBytes > 0 );
+
+	pOp->m_nResult = 0;
+	pOp->m_iFixedBuffer = -1;
+	pOp->m_Complete.Reset();
+
+	AUTO_LOCK( m_Mutex );
+	m_nReads++;
+	if ( m_nPending++ == 0 )
+	{
+		m_IdleEvent.Reset();
+	}
+	m_Staged.AddToTail( pOp );
+
+	if ( !bMoreComing || m_Staged.Count() >= MAX_MERGED_READS )
+	{
+		FlushLocked();
+	}
+	else if ( m_Staged.Count() == 1 )
+	{
+		// Start the clock on the straggler
+		m_nStagedTime = Plat_MSTime();
+		Wake();
+	}
+}
+
+void CAsyncReadEngine::Flush()
+{
+	AUTO_LOCK( m_Mutex );
+	FlushLocked();
+}
+
+void CAsyncReadEngine::Wait( AsyncReadOp_t *pOp )
+{
+	Flush();
+	pOp->m_Complete.Wait();
+}
+
+bool CAsyncReadEngine::WaitForIdle()
+{
+	{
+		AUTO_LOCK( m_Mutex );
+		if ( !m_nPending )
+			return false;
+		FlushLocked();
+	}
+	m_IdleEvent.Wait();
+	return true;
+}
+
+int CAsyncReadEngine::ReadBlocking( int hFile, void *pDest, int nBytes, int64 nOffset )
+{
+#ifdef POSIX
+	int nRead = 0;
+	while ( nRead < nBytes )
+	{
+		ssize_t n = pread( hFile, (uint8 *)pDest + nRead, nBytes - nRead, nOffset + nRead );
+		if ( n < 0 && errno == EINTR )
+			continue;
+		if ( n < 0 )
+			return nRead ? nRead : -errno;
+		if ( n == 0 )
+			break;
+		nRead += n;
+	}
+	return nRead;
+#else
+	return -1;
+#endif
+}
+
+static int __cdecl CompareStagedReads( AsyncReadOp_t * const *ppLeft, AsyncReadOp_t * const *ppRight )
+{
+	const AsyncReadOp_t *pLeft = *ppLeft;
+	const AsyncReadOp_t *pRight = *ppRight;
+	if ( pLeft->m_hFile != pRight->m_hFile )
+		return ( pLeft->m_hFile < pRight->m_hFile ) ? -1 : 1;
+	if ( pLeft->m_nOffset != pRight->m_nOffset )
+		return ( pLeft->m_nOffset < pRight->m_nOffset ) ? -1 : 1;
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Turn staged reads into SQEs. Reads that pick up where the previous one on
+// the same descriptor left off share a readv. Whatever doesn't fit in the
+// ring stays staged until completions make room.
+//-----------------------------------------------------------------------------
+void CAsyncReadEngine::FlushLocked()
+{
+#ifdef ASYNC_READ_ENGINE_URING
+	if ( m_Staged.Count() )
+	{
+		m_Staged.Sort( CompareStagedReads );
+
+		int nTaken = 0;
+		while ( nTaken < m_Staged.Count() && m_nInFlight < RING_ENTRIES )
+		{
+			Batch_t *pBatch;
+			if ( m_FreeBatches.Count() )
+			{
+				pBatch = m_FreeBatches.Tail();
+				m_FreeBatches.RemoveMultipleFromTail( 1 );
+			}
+			else
+			{
+				pBatch = new Batch_t;
+				pBatch->m_pIov = new struct iovec[MAX_MERGED_READS];
+			}
+
+			AsyncReadOp_t *pFirst = m_Staged[nTaken++];
+			pBatch->m_pOps[0] = pFirst;
+			pBatch->m_nOps = 1;
+			pBatch->m_nBytes = pFirst->m_nBytes;
+			while ( nTaken < m_Staged.Count() && pBatch->m_nOps < MAX_MERGED_READS )
+			{
+				AsyncReadOp_t *pNext = m_Staged[nTaken];
+				if ( pNext->m_hFile != pFirst->m_hFile ||
+					 pNext->m_nOffset != pFirst->m_nOffset + pBatch->m_nBytes ||
+					 pBatch->m_nBytes + pNext->m_nBytes > MAX_MERGED_BYTES )
+					break;
+
+				pBatch->m_pOps[pBatch->m_nOps++] = pNext;
+				pBatch->m_nBytes += pNext->m_nBytes;
+				nTaken++;
+			}
+
+			SubmitLocked( pBatch );
+		}
+
+		m_Staged.RemoveMultipleFromHead( nTaken );
+	}
+
+	EnterLocked();
+#endif
+}
+
+void CAsyncReadEngine::SubmitLocked( Batch_t *pBatch )
+{
+#ifdef ASYNC_READ_ENGINE_URING
+	uint32 nTail = *m_pSqTail;
+	uint32 nIndex = nTail & m_nSqMask;
+	struct io_uring_sqe *pSqe = &m_pSqes[nIndex];
+	memset( pSqe, 0, sizeof( *pSqe ) );
+
+	AsyncReadOp_t *pFirst = pBatch->m_pOps[0];
+	pSqe->fd = pFirst->m_hFile;
+	pSqe->off = pFirst->m_nOffset;
+	pSqe->user_data = (uint64)(uintp)pBatch;
+
+	if ( pBatch->m_nOps == 1 && pFirst->m_nBytes <= FIXED_BUFFER_SIZE && m_FreeFixedBuffers.Count() )
+	{
+		pFirst->m_iFixedBuffer = m_FreeFixedBuffers.Tail();
+		m_FreeFixedBuffers.RemoveMultipleFromTail( 1 );
+		pSqe->opcode = IORING_OP_READ_FIXED;
+		pSqe->addr = (uint64)(uintp)( m_pFixedBuffers + pFirst->m_iFixedBuffer * FIXED_BUFFER_SIZE );
+		pSqe->len = pFirst->m_nBytes;
+		pSqe->buf_index = pFirst->m_iFixedBuffer;
+		m_nFixedReads++;
+	}
+	else
+	{
+		for ( int i = 0; i < pBatch->m_nOps; i++ )
+		{
+			pBatch->m_pIov[i].iov_base = pBatch->m_pOps[i]->m_pDest;
+			pBatch->m_pIov[i].iov_len = pBatch->m_pOps[i]->m_nBytes;
+		}
+		pSqe->opcode = IORING_OP_READV;
+		pSqe->addr = (uint64)(uintp)pBatch->m_pIov;
+		pSqe->len = pBatch->m_nOps;
+		if ( pBatch->m_nOps > 1 )
+		{
+			m_nMergedReads += pBatch->m_nOps;
+		}
+	}
+
+	m_pSqArray[nIndex] = nIndex;
+	__atomic_store_n( m_pSqTail, nTail + 1, __ATOMIC_RELEASE );
+
+	m_nInFlight++;
+	m_nUnsubmitted++;
+	m_nSubmits++;
+#endif
+}
+
+void CAsyncReadEngine::EnterLocked()
+{
+#ifdef ASYNC_READ_ENGINE_URING
+	while ( m_nUnsubmitted > 0 )
+	{
+		m_nSyscalls++;
+		int nSubmitted = io_uring_enter( m_hRing, m_nUnsubmitted, 0, 0 );
+		if ( nSubmitted < 0 )
+		{
+			// EAGAIN/EBUSY: the kernel is out of resources or completions
+			// need reaping first, the completion thread will try again
+			if ( errno == EINTR )
+				continue;
+			m_nStagedTime = Plat_MSTime();
+			Wake();
+			break;
+		}
+		m_nUnsubmitted -= nSubmitted;
+		if ( !nSubmitted )
+			break;
+	}
+#endif
+}
+
+void CAsyncReadEngine::Wake()
+{
+#ifdef ASYNC_READ_ENGINE_URING
+	uint64 nOne = 1;
+	if ( write( m_hWake, &nOne, sizeof( nOne ) ) < 0 )
+	{
+		// Already signalled
+	}
+#endif
+}
+
+uintp CAsyncReadEngine::ThreadFunc( void *pParam )
+{
+	( (CAsyncReadEngine *)pParam )->Run();
+	return 0;
+}
+
+void CAsyncReadEngine::Run()
+{
+#ifdef ASYNC_READ_ENGINE_URING
+	for ( ;; )
+	{
+		int nTimeout = -1;
+		{
+			AUTO_LOCK( m_Mutex );
+			if ( m_bExit && !m_nPending )
+				break;
+			if ( m_Staged.Count() || m_nUnsubmitted )
+			{
+				nTimeout = MAX( 0, ASYNC_READ_FLUSH_MS - (int)( Plat_MSTime() - m_nStagedTime ) );
+			}
+			else if ( m_Deferred.Count() )
+			{
+				nTimeout = ASYNC_READ_FLUSH_MS;
+			}
+		}
+
+		struct pollfd fds[2];
+		fds[0].fd = m_hRing;
+		fds[0].events = POLLIN;
+		fds[0].revents = 0;
+		fds[1].fd = m_hWake;
+		fds[1].events = POLLIN;
+		fds[1].revents = 0;
+		poll( fds, 2, nTimeout );
+
+		if ( fds[1].revents & POLLIN )
+		{
+			uint64 nCount;
+			if ( read( m_hWake, &nCount, sizeof( nCount ) ) < 0 )
+			{
+				// Drained by someone else
+			}
+		}
+
+		ReapCompletions();
+		RetryDeferred();
+
+		// Reads that have waited long enough for company
+		AUTO_LOCK( m_Mutex );
+		if ( ( m_Staged.Count() || m_nUnsubmitted ) && (int)( Plat_MSTime() - m_nStagedTime ) >= ASYNC_READ_FLUSH_MS )
+		{
+			FlushLocked();
+		}
+	}
+#endif
+}
+
+void CAsyncReadEngine::ReapCompletions()
+{
+#ifdef ASYNC_READ_ENGINE_URING
+	bool bMadeRoom = false;
+	for ( ;; )
+	{
+		uint32 nHead = *m_pCqHead;
+		uint32 nTail = __atomic_load_n( m_pCqTail, __ATOMIC_ACQUIRE );
+		if ( nHead == nTail )
+			break;
+
+		while ( nHead != nTail )
+		{
+			struct io_uring_cqe *pCqe = &m_pCqes[nHead & m_nCqMask];
+			Batch_t *pBatch = (Batch_t *)(uintp)pCqe->user_data;
+			int nResult = pCqe->res;
+			nHead++;
+			__atomic_store_n( m_pCqHead, nHead, __ATOMIC_RELEASE );
+
+			CompleteBatch( pBatch, nResult );
+			bMadeRoom = true;
+		}
+	}
+
+	// Reads left staged because the ring was full
+	if ( bMadeRoom )
+	{
+		AUTO_LOCK( m_Mutex );
+		if ( m_Staged.Count() )
+		{
+			FlushLocked();
+		}
+	}
+#endif
+}
+
+void CAsyncReadEngine::CompleteBatch( Batch_t *pBatch, int nResult )
+{
+	int nRemaining = nResult;
+	int nOps = pBatch->m_nOps;
+	int nRetries = 0;
+	int64 nBytes = 0;
+
+	for ( int i = 0; i < nOps; i++ )
+	{
+		AsyncReadOp_t *pOp = pBatch->m_pOps[i];
+		int nRead = ( nResult < 0 ) ? 0 : MIN( nRemaining, pOp->m_nBytes );
+		nRemaining -= nRead;
+
+		if ( pOp->m_iFixedBuffer >= 0 )
+		{
+			memcpy( pOp->m_pDest, m_pFixedBuffers + pOp->m_iFixedBuffer * FIXED_BUFFER_SIZE, nRead );
+			AUTO_LOCK( m_Mutex );
+			m_FreeFixedBuffers.AddToTail( pOp->m_iFixedBuffer );
+			pOp->m_iFixedBuffer = -1;
+		}
+
+		// Errors and short reads are finished synchronously. At end of file
+		// that costs one pread that returns nothing.
+		if ( nRead < pOp->m_nBytes )
+		{
+			int nRest = ReadBlocking( pOp->m_hFile, (uint8 *)pOp->m_pDest + nRead, pOp->m_nBytes - nRead, pOp->m_nOffset + nRead );
+			if ( nRest > 0 )
+			{
+				nRead += nRest;
+			}
+			else if ( nRest < 0 && nRead == 0 )
+			{
+				nRead = nRest;
+			}
+			nRetries++;
+		}
+
+		pOp->m_nResult = nRead;
+		nBytes += MAX( nRead, 0 );
+
+		// Without a completion pOp may be gone as soon as the event is set
+		IAsyncReadCompletion *pCompletion = pOp->m_pCompletion;
+		pOp->m_Complete.Set();
+		if ( pCompletion && !pCompletion->OnAsyncReadComplete( pOp ) )
+		{
+			// Still pending until RetryDeferred() gets it delivered
+			AUTO_LOCK( m_Mutex );
+			m_Deferred.AddToTail( pOp );
+			nOps--;
+		}
+	}
+
+	AUTO_LOCK( m_Mutex );
+	m_nBytes += nBytes;
+	m_nRetries += nRetries;
+	m_nInFlight--;
+	m_FreeBatches.AddToTail( pBatch );
+	FinishedLocked( nOps );
+}
+
+void CAsyncReadEngine::FinishedLocked( int nOps )
+{
+	m_nPending -= nOps;
+	if ( !m_nPending )
+	{
+		m_IdleEvent.Set();
+	}
+}
+
+void CAsyncReadEngine::RetryDeferred()
+{
+	CUtlVector< AsyncReadOp_t * > deferred;
+	{
+		AUTO_LOCK( m_Mutex );
+		if ( !m_Deferred.Count() )
+			return;
+		deferred.Swap( m_Deferred );
+	}
+
+	int nDelivered = 0;
+	for ( int i = 0; i < deferred.Count(); i++ )
+	{
+		if ( !deferred[i]->m_pCompletion->OnAsyncReadComplete( deferred[i] ) )
+		{
+			AUTO_LOCK( m_Mutex );
+			m_Deferred.AddToTail( deferred[i] );
+		}
+		else
+		{
+			nDelivered++;
+		}
+	}
+
+	if ( nDelivered )
+	{
+		AUTO_LOCK( m_Mutex );
+		FinishedLocked( nDelivered );
+	}
+}
+
+void CAsyncReadEngine::PrintStats()
+{
+	AUTO_LOCK( m_Mutex );
+	Msg( "Async read engine: %s, %d staged, %d in flight, %s\n", m_hRing >= 0 ? "io_uring" : "inactive (IO threads read synchronously)",
+		m_Staged.Count(), m_nInFlight, m_pFixedBuffers ? "registered buffers" : "no registered buffers" );
+	Msg( "  reads %llu (%.1f MB), submissions %llu, syscalls %llu (%.1f reads each)\n",
+		(unsigned long long)m_nReads, m_nBytes / ( 1024.0 * 1024.0 ), (unsigned long long)m_nSubmits,
+		(unsigned long long)m_nSyscalls, m_nSyscalls ? (double)m_nReads / m_nSyscalls : 0.0 );
+	Msg( "  merged into readv %llu, registered buffer reads %llu, finished synchronously %llu\n",
+		(unsigned long long)m_nMergedReads, (unsigned long long)m_nFixedReads, (unsigned long long)m_nRetries );
+}
+
+void CAsyncReadEngine::ResetStats()
+{
+	AUTO_LOCK( m_Mutex );
+	m_nReads = 0;
+	m_nSubmits = 0;
+	m_nSyscalls = 0;
+	m_nMergedReads = 0;
+	m_nFixedReads = 0;
+	m_nRetries = 0;
+	m_nBytes = 0;
+}
@@ -0,0 +1,159 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Hands async file reads to the kernel instead of blocking an IO
+//			thread in read() for each one. On Linux reads are queued on an
+//			io_uring: reads staged while more are on their way go in one
+//			submission, adjacent reads of the same descriptor (neighbouring
+//			files in a VPK chunk) are merged into one readv, and small reads
+//			land in buffers registered with the kernel up front.
+//
+//			Elsewhere, or if the kernel doesn't support it, IsActive() is
+//			false and callers read synchronously as before.
+//
+//=============================================================================
+
+#ifndef ASYNCREADENGINE_H
+#define ASYNCREADENGINE_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "tier0/threadtools.h"
+#include "tier1/utlvector.h"
+
+#if defined( LINUX ) && defined( __has_include )
+#if __has_include( <linux/io_uring.h> )
+#define ASYNC_READ_ENGINE_URING
+#endif
+#endif
+
+struct AsyncReadOp_t;
+
+abstract_class IAsyncReadCompletion
+{
+public:
+	// Called on the engine's completion thread after pOp->m_Complete is set.
+	// It mustn't block; return false to be called again a little later.
+	virtual bool OnAsyncReadComplete( AsyncReadOp_t *pOp ) = 0;
+};
+
+struct AsyncReadOp_t
+{
+	int						m_hFile;			// descriptor to read from
+	int64					m_nOffset;
+	void					*m_pDest;
+	int						m_nBytes;
+	int						m_nResult;			// bytes read or -errno, valid once m_Complete is set
+	IAsyncReadCompletion	*m_pCompletion;
+	CThreadManualEvent		m_Complete;
+
+	// Engine internal
+	int						m_iFixedBuffer;
+};
+
+class CAsyncReadEngine
+{
+public:
+	CAsyncReadEngine();
+	~CAsyncReadEngine();
+
+	// Returns false if there's no kernel support
+	bool Init();
+	// Waits for reads in flight
+	void Shutdown();
+	bool IsActive() const { return m_hRing >= 0; }
+
+	// Queues a read, pOp must stay valid until it completes. bMoreComing
+	// holds it back to go out with the reads that follow; staged reads are
+	// submitted within a millisecond regardless.
+	void Read( AsyncReadOp_t *pOp, bool bMoreComing );
+
+	// Submits staged reads now
+	void Flush();
+
+	// Blocks until pOp has completed
+	void Wait( AsyncReadOp_t *pOp );
+
+	// Blocks until nothing is staged or in flight, and every completion
+	// that asked to be called again has taken its read. Returns false if
+	// nothing was pending.
+	bool WaitForIdle();
+
+	void PrintStats();
+	void ResetStats();
+
+	// Plain pread loop, for short or failed reads
+	static int ReadBlocking( int hFile, void *pDest, int nBytes, int64 nOffset );
+
+private:
+	enum
+	{
+		RING_ENTRIES		= 256,
+		MAX_MERGED_READS	= 16,
+		MAX_MERGED_BYTES	= 1024 * 1024,
+		NUM_FIXED_BUFFERS	= 32,
+		FIXED_BUFFER_SIZE	= 64 * 1024,
+	};
+
+	struct Batch_t
+	{
+		AsyncReadOp_t		*m_pOps[MAX_MERGED_READS];
+		int					m_nOps;
+		int					m_nBytes;
+		struct iovec		*m_pIov;
+	};
+
+	static uintp ThreadFunc( void *pParam );
+	void Run();
+	void FlushLocked();
+	void SubmitLocked( Batch_t *pBatch );
+	void EnterLocked();
+	void ReapCompletions();
+	void CompleteBatch( Batch_t *pBatch, int nResult );
+	void FinishedLocked( int nOps );
+	void RetryDeferred();
+	void Wake();
+
+	CThreadMutex				m_Mutex;
+	CUtlVector< AsyncReadOp_t * > m_Staged;
+	CUtlVector< AsyncReadOp_t * > m_Deferred;		// completed, but the completion asked to be called again
+	CUtlVector< Batch_t * >		m_FreeBatches;
+	CUtlVector< int >			m_FreeFixedBuffers;
+	int							m_nInFlight;		// batches in the ring
+	int							m_nPending;			// reads staged, in flight or deferred
+	int							m_nUnsubmitted;		// SQEs written but not yet taken by the kernel
+	uint32						m_nStagedTime;		// Plat_MSTime() the oldest staged read has waited since
+	CThreadManualEvent			m_IdleEvent;
+	ThreadHandle_t				m_hThread;
+	volatile bool				m_bExit;
+
+	int							m_hRing;			// io_uring descriptor, -1 if inactive
+	int							m_hWake;			// eventfd the completion thread polls with the ring
+	uint8						*m_pFixedBuffers;
+
+	// Ring mappings
+	void						*m_pSqRing;
+	void						*m_pCqRing;
+	struct io_uring_sqe			*m_pSqes;
+	size_t						m_nSqRingSize;
+	size_t						m_nCqRingSize;
+	uint32						*m_pSqHead;
+	uint32						*m_pSqTail;
+	uint32						m_nSqMask;
+	uint32						*m_pSqArray;
+	uint32						*m_pCqHead;
+	uint32						*m_pCqTail;
+	uint32						m_nCqMask;
+	struct io_uring_cqe			*m_pCqes;
+
+	// Statistics
+	uint64						m_nReads;
+	uint64						m_nSubmits;
+	uint64						m_nSyscalls;
+	uint64						m_nMergedReads;
+	uint64						m_nFixedReads;
+	uint64						m_nRetries;
+	uint64						m_nBytes;
+};
+
+#endif // ASYNCREADENGINE_H
@@ -44,6 +44,11 @@
 
 #include <time.h>
 
+#ifdef POSIX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 // memdbgon must be the last include file in a .cpp file!!!
 #include "tier0/memdbgon.h"
 
@@ -123,6 +128,31 @@ CBaseFileSystem *BaseFileSystem()
 }
 
 ConVar filesystem_buffer_size( "filesystem_buffer_size", "0", 0, "Size of per file buffers. 0 for none" );
+ConVar fs_map_views( "fs_map_views", "1", 0, "Let large file loads map the file into memory rather than read it" );
+ConVar fs_vpk_hash_cache( "fs_vpk_hash_cache", "1", 0, "Keep VPK chunk file hashes in the write path, and only rehash chunk files whose size or time changed" );
+
+static void FsResolveCacheChanged( IConVar *var, const char *pOldValue, float flOldValue )
+{
+	if ( g_pBaseFileSystem )
+	{
+		g_pBaseFileSystem->ResolveCache().Invalidate();
+	}
+}
+ConVar fs_resolve_cache( "fs_resolve_cache", "1", 0, "Remember which search path each file was opened from, and which files weren't found", FsResolveCacheChanged );
+
+CON_COMMAND( fs_resolve_cache_stats, "Print search path resolve cache hit rates. 'fs_resolve_cache_stats reset' clears them." )
+{
+	if ( !g_pBaseFileSystem )
+		return;
+
+	if ( args.ArgC() > 1 && !V_stricmp( args[1], "reset" ) )
+	{
+		g_pBaseFileSystem->ResolveCache().ResetStats();
+		return;
+	}
+
+	g_pBaseFileSystem->ResolveCache().PrintStats();
+}
 
 #if defined( TRACK_BLOCKING_IO )
 
@@ -828,6 +858,7 @@ void CBaseFileSystem::AddVPKFile( char const *pPath, const char *pPathID, Search
 			return;
 		}
 		pVPK->RegisterFileTracker( (IThreadedFileMD5Processor *)&m_FileTracker2 );
+		pVPK->SetMapDataFiles( CommandLine()->FindParm( "-vpkmmap" ) != 0 );
 
 		pVPK->m_PackFileID = m_FileTracker2.NotePackFileOpened( pVPK->FullPathName(), pPathID, 0 );
 	}
@@ -845,6 +876,8 @@ void CBaseFileSystem::AddVPKFile( char const *pPath, const char *pPathID, Search
 
 	// Check if we're trusted or not
 	SetSearchPathIsTrustedSource( sp );
+
+	m_ResolveCache.Invalidate();
 #endif // SUPPORT_PACKED_STORE
 }
 
@@ -868,7 +901,10 @@ bool CBaseFileSystem::RemoveVPKFile( const char *pPath, const char *pPathID )
 			// remove if we find one
 			if ( m_SearchPaths[i].GetPath() == pathIDSym )
 			{
+				// Async reads of its chunk files go around the VPK
+				m_AsyncReadEngine.WaitForIdle();
 				m_SearchPaths.Remove( i );
+				m_ResolveCache.Invalidate();
 				return true;
 			}
 		}
@@ -939,6 +975,7 @@ bool CBaseFileSystem::AddPackFileFromPath( const char *pPath, const char *pakfil
 	sp->m_pPathIDInfo->SetPathID( pathID );
 	sp->SetPackFile( pf );
 
+	m_ResolveCache.Invalidate();
 	return true;
 }
 
@@ -1106,6 +1143,8 @@ void CBaseFileSystem::RemoveAllMapSearchPaths( void )
 		
 		m_SearchPaths.Remove( i );
 	}
+
+	m_ResolveCache.Invalidate();
 }
 
 //-----------------------------------------------------------------------------
@@ -1181,6 +1220,7 @@ void CBaseFileSystem::AddMapPackFile( const char *pPath, const char *pPathID, Se
 				sp->m_bIsRemotePath = true;
 			}
 			SetSearchPathIsTrustedSource( sp );
+			m_ResolveCache.Invalidate();
 			return;
 		}
 	}
@@ -1259,6 +1299,7 @@ void CBaseFileSystem::AddMapPackFile( const char *pPath, const char *pPathID, Se
 			m_ZipFiles.AddToTail( pf );
 
 			SetSearchPathIsTrustedSource( sp );
+			m_ResolveCache.Invalidate();
 		}
 		else
 		{
@@ -1523,6 +1564,8 @@ void CBaseFileSystem::AddSearchPathInternal( const char *pPath, const char *path
 	{
 		sp->m_bIsRemotePath = true;
 	}
+
+	m_ResolveCache.Invalidate();
 }
 
 //-----------------------------------------------------------------------------
@@ -1680,9 +1723,18 @@ bool CBaseFileSystem::RemoveSearchPath( const char *pPath, const char *pathID )
 		if ( FilterByPathID( &m_SearchPaths[i], id ) )
 			continue;
 
+		if ( m_SearchPaths[i].GetPackedStore() )
+		{
+			m_AsyncReadEngine.WaitForIdle();
+		}
 		m_SearchPaths.Remove( i );
 		bret = true;
 	}
+
+	if ( bret )
+	{
+		m_ResolveCache.Invalidate();
+	}
 	return bret;
 }
 
@@ -1703,6 +1755,8 @@ void CBaseFileSystem::RemoveSearchPaths( const char *pathID )
 			m_SearchPaths.FastRemove(i);
 		}
 	}
+
+	m_ResolveCache.Invalidate();
 }
 
 
@@ -1895,6 +1949,50 @@ bool CBaseFileSystem::ReadToBuffer( FileHandle_t fp, CUtlBuffer &buf, int nMaxBy
 	return (nBytesRead != 0);
 }
 
+//-----------------------------------------------------------------------------
+// Maps a range of a loose file, or of the VPK data file an entry lives in.
+// The mapping is private so callers can fix up what they load in place.
+//-----------------------------------------------------------------------------
+void *CBaseFileSystem::MapFileView( FileHandle_t hFile, unsigned nOffset, unsigned nSize )
+{
+#ifdef POSIX
+	if ( !hFile || !nSize || !fs_map_views.GetBool() )
+		return NULL;
+
+	if ( (uint64)nOffset + nSize > Size( hFile ) )
+		return NULL;
+
+	int64 nFileOffset;
+	int hDescriptor = GetReadDescriptor( hFile, nOffset, nFileOffset );
+	if ( hDescriptor < 0 )
+		return NULL;
+
+	int64 nPageOffset = nFileOffset & ~(int64)( sysconf( _SC_PAGESIZE ) - 1 );
+	size_t nMapSize = (size_t)( nFileOffset - nPageOffset ) + nSize;
+	void *pMapping = mmap( NULL, nMapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, hDescriptor, nPageOffset );
+	if ( pMapping == MAP_FAILED )
+		return NULL;
+
+	// Views are read front to back, start the read ahead now
+	madvise( pMapping, nMapSize, MADV_WILLNEED );
+	return (uint8 *)pMapping + ( nFileOffset - nPageOffset );
+#else
+	return NULL;
+#endif
+}
+
+void CBaseFileSystem::UnmapFileView( void *pView, unsigned nSize )
+{
+#ifdef POSIX
+	if ( !pView )
+		return;
+
+	// Mappings start on a page, the view is offset into the first one
+	uintp nPageOffset = (uintp)pView & ( sysconf( _SC_PAGESIZE ) - 1 );
+	munmap( (uint8 *)pView - nPageOffset, nPageOffset + nSize );
+#endif
+}
+
 //-----------------------------------------------------------------------------
 // Reads/writes files to utlbuffers
 // NOTE NOTE!! 
@@ -2121,8 +2219,10 @@ bool CBaseFileSystem::UnzipFile( const char *pFileName, const char *pPath, const
 void CBaseFileSystem::RemoveAllSearchPaths( void )
 {
 	AUTO_LOCK( m_SearchPathsMutex );
+	m_AsyncReadEngine.WaitForIdle();
 	m_SearchPaths.Purge();
 	//m_PackFileHandles.Purge();
+	m_ResolveCache.Invalidate();
 }
 
 
@@ -2519,39 +2619,127 @@ FileHandle_t CBaseFileSystem::OpenForRead( const char *pFileNameT, const char *p
 		}
 	}
 
+	FileHandle_t filehandle = FindFileInSearchPaths( openInfo, pathID, pathFilter );
+	if ( filehandle )
+		return filehandle;
+
+	LogFileOpen( "[Failed]", pFileName, "" );
+	return ( FileHandle_t )0;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Runs through the search paths for a relative filename. When the
+//			resolve cache knows the answer, only the search path that had the
+//			file last time is tried, or nothing if it wasn't found.
+//-----------------------------------------------------------------------------
+FileHandle_t CBaseFileSystem::FindFileInSearchPaths( CFileOpenInfo &openInfo, const char *pathID, PathTypeFilter_t pathFilter )
+{
+	const char *pFileName = openInfo.m_pFileName;
+
+	char szCacheKey[MAX_PATH + 64];
+	ResolvedFile_t resolved;
+	uint32 nGeneration = 0;
+	bool bUseCache = fs_resolve_cache.GetBool();
+	bool bCached = false;
+	if ( bUseCache )
+	{
+		V_snprintf( szCacheKey, sizeof( szCacheKey ), "%s:%d:%s", pathID ? pathID : "", pathFilter, pFileName );
+		V_strlower( szCacheKey );
+		bCached = m_ResolveCache.Lookup( szCacheKey, resolved, nGeneration );
+		if ( bCached && !resolved.m_bFound )
+			return ( FileHandle_t )0;
+	}
+
+	// Loose files are opened by their lowercase name, see FindFileInSearchPath()
+	char szLowercaseFilename[MAX_PATH];
+	V_strcpy_safe( szLowercaseFilename, openInfo.m_pFileName );
+	V_strlower( szLowercaseFilename );
+
 	CSearchPathsIterator iter( this, &pFileName, pathID, pathFilter );
-	for ( openInfo.m_pSearchPath = iter.GetFirst(); openInfo.m_pSearchPath != NULL; openInfo.m_pSearchPath = iter.GetNext() )
+	for ( ;; )
 	{
-		FileHandle_t filehandle = FindFileInSearchPath( openInfo );
-		if ( filehandle )
+		bool bCacheable = bUseCache && !bCached;
+		int nLooseMisses = 0;
+		int nPackMisses = 0;
+
+		for ( openInfo.m_pSearchPath = iter.GetFirst(); openInfo.m_pSearchPath != NULL; openInfo.m_pSearchPath = iter.GetNext() )
 		{
-			// Check if search path is excluded due to pure server white list,
-			// then we should make a note of this fact, and keep searching
-			if ( !openInfo.m_pSearchPath->m_bIsTrustedForPureServer && openInfo.m_ePureFileClass == ePureServerFileClass_AnyTrusted )
+			if ( bCached && openInfo.m_pSearchPath->m_storeId != resolved.m_storeId )
+				continue;
+
+			bool bLoose = !openInfo.m_pSearchPath->GetPackFile() && !openInfo.m_pSearchPath->GetPackedStore();
+			if ( bCacheable && bLoose && !m_ResolveCache.WatchLooseFile( openInfo.m_pSearchPath->GetPathString(), szLowercaseFilename ) )
 			{
-				#ifdef PURE_SERVER_DEBUG_SPEW
-					Msg( "Ignoring %s from %s for pure server operation\n", openInfo.m_pFileName, openInfo.m_pSearchPath->GetDebugString() );
-				#endif
+				bCacheable = false;
+			}
 
-				m_FileTracker2.NoteFileIgnoredForPureServer( openInfo.m_pFileName, pathID, openInfo.m_pSearchPath->m_storeId );
-				Close( filehandle );
-				openInfo.m_pFileHandle = NULL;
-				if ( ppszResolvedFilename && *ppszResolvedFilename )
+			FileHandle_t filehandle = FindFileInSearchPath( openInfo );
+			if ( filehandle )
+			{
+				// Check if search path is excluded due to pure server white list,
+				// then we should make a note of this fact, and keep searching
+				if ( !openInfo.m_pSearchPath->m_bIsTrustedForPureServer && openInfo.m_ePureFileClass == ePureServerFileClass_AnyTrusted )
 				{
-					free( *ppszResolvedFilename );
-					*ppszResolvedFilename = NULL;
+					#ifdef PURE_SERVER_DEBUG_SPEW
+						Msg( "Ignoring %s from %s for pure server operation\n", openInfo.m_pFileName, openInfo.m_pSearchPath->GetDebugString() );
+					#endif
+
+					m_FileTracker2.NoteFileIgnoredForPureServer( openInfo.m_pFileName, pathID, openInfo.m_pSearchPath->m_storeId );
+					Close( filehandle );
+					openInfo.m_pFileHandle = NULL;
+					if ( openInfo.m_ppszResolvedFilename && *openInfo.m_ppszResolvedFilename )
+					{
+						free( *openInfo.m_ppszResolvedFilename );
+						*openInfo.m_ppszResolvedFilename = NULL;
+					}
+				}
+				else
+				{
+					if ( bCacheable )
+					{
+						resolved.m_storeId = openInfo.m_pSearchPath->m_storeId;
+						resolved.m_bFound = true;
+						resolved.m_nLooseMisses = (uint16)MIN( nLooseMisses, 0xFFFF );
+						resolved.m_nPackMisses = (uint16)MIN( nPackMisses, 0xFFFF );
+						m_ResolveCache.Insert( szCacheKey, resolved, nGeneration );
+					}
+
+					openInfo.HandleFileCRCTracking( openInfo.m_pFileName );
+					return filehandle;
 				}
-				continue;
 			}
 
-			// 
-			openInfo.HandleFileCRCTracking( openInfo.m_pFileName );
-			return filehandle;
+			if ( bCached )
+				break;
+
+			if ( bLoose )
+			{
+				nLooseMisses++;
+			}
+			else
+			{
+				nPackMisses++;
+			}
 		}
-	}
 
-	LogFileOpen( "[Failed]", pFileName, "" );
-	return ( FileHandle_t )0;
+		if ( !bCached )
+		{
+			if ( bCacheable )
+			{
+				resolved.m_storeId = -1;
+				resolved.m_bFound = false;
+				resolved.m_nLooseMisses = (uint16)MIN( nLooseMisses, 0xFFFF );
+				resolved.m_nPackMisses = (uint16)MIN( nPackMisses, 0xFFFF );
+				m_ResolveCache.Insert( szCacheKey, resolved, nGeneration );
+			}
+			return ( FileHandle_t )0;
+		}
+
+		// The file went away from under the cache, search properly
+		m_ResolveCache.NoteStale( szCacheKey );
+		bCached = false;
+	}
 }
 
 
@@ -2589,6 +2777,8 @@ FileHandle_t CBaseFileSystem::OpenForWrite( const char *pFileName, const char *p
 		return ( FileHandle_t )0;
 	}
 
+	m_ResolveCache.NoteLocalWrite();
+
 	CFileHandle *fh = new CFileHandle( this );
 	fh->m_nLength = size;
 	fh->m_type = FT_NORMAL;
@@ -3498,7 +3688,22 @@ void CBaseFileSystem::CacheAllVPKFileHashes( bool bCacheAllVPKHashes, bool bReca
 		{
 			if ( vecChunkHashFractionCopy.Count() == 0 )
 				Msg( "File hash information not found: Hashing all VPK files for pure server operation.\n" );
-			pVPK->HashAllChunkFiles();
+
+			// Named after the VPK, with its full path in case two mods have the same one
+			char szHashCacheFile[MAX_PATH];
+			szHashCacheFile[0] = '\0';
+			if ( fs_vpk_hash_cache.GetBool() )
+			{
+				char szBaseName[MAX_PATH];
+				V_FileBase( pVPK->FullPathName(), szBaseName, sizeof( szBaseName ) );
+				V_sprintf_safe( szHashCacheFile, "cache/vpkhashes/%s_%08x.bin", szBaseName,
+					CRC32_ProcessSingleBuffer( pVPK->FullPathName(), V_strlen( pVPK->FullPathName() ) ) );
+				CreateDirHierarchy( "cache/vpkhashes", "DEFAULT_WRITE_PATH" );
+			}
+
+			double flStart = Plat_FloatTime();
+			int nHashedChunks = pVPK->HashAllChunkFiles( szHashCacheFile[0] ? szHashCacheFile : NULL, "DEFAULT_WRITE_PATH" );
+			Msg( "Hashed %d of %d VPK chunk files in %.1f seconds.\n", nHashedChunks, pVPK->GetHighestChunkFileIndex() + 1, Plat_FloatTime() - flStart );
 			if ( vecChunkHashFractionCopy.Count() != 0 )
 			{
 				if ( vecChunkHash.Count() != vecChunkHashFractionCopy.Count() )
@@ -3608,6 +3813,7 @@ void CBaseFileSystem::RegisterFileWhitelist( IPureServerWhitelist *pWhiteList, I
 	{
 		SetSearchPathIsTrustedSource( &m_SearchPaths[i] );
 	}
+	m_ResolveCache.Invalidate();
 
 	// See if we need to reload any files
 	if ( pFilesToReload )
@@ -3968,6 +4174,8 @@ void CBaseFileSystem::CreateDirHierarchy( const char *pRelativePathT, const char
 #elif defined( POSIX )
 	mkdir( szScratchFileName, S_IRWXU |  S_IRGRP |  S_IROTH );
 #endif
+
+	m_ResolveCache.NoteLocalWrite();
 }
 
 
@@ -4663,6 +4871,7 @@ void CBaseFileSystem::RemoveFile( char const* pRelativePath, const char *pathID
 	{
 		Warning( FILESYSTEM_WARNING, "Unable to remove %s!\n", szScratchFileName );
 	}
+	m_ResolveCache.NoteLocalWrite();
 }
 
 
@@ -4718,6 +4927,7 @@ bool CBaseFileSystem::RenameFile( char const *pOldPath, char const *pNewPath, co
 
 	// Now copy the file over
 	int fail = rename( szScratchFileName, pNewFileName );
+	m_ResolveCache.NoteLocalWrite();
 	if (fail != 0)
 	{
 		Warning( FILESYSTEM_WARNING, "Unable to rename %s to %s!\n", szScratchFileName, pNewFileName );
@@ -4924,7 +5134,11 @@ CBaseFileSystem::CSearchPath::~CSearchPath( void )
 {
 	if ( m_pPackFile )
 	{	
-		m_pPackFile->Release();
+		// Clear it first: the last release destroys the pack, which can still use the
+		// filesystem, and this search path is still in the list being walked
+		CPackFile *pPackFile = m_pPackFile;
+		m_pPackFile = NULL;
+		pPackFile->Release();
 	}
 	if ( m_pPackedStore )
 	{
@@ -5185,6 +5399,7 @@ CBaseFileSystem::CPathIDInfo* CBaseFileSystem::FindOrAddPathIDInfo( const CUtlSy
 void CBaseFileSystem::MarkPathIDByRequestOnly( const char *pPathID, bool bRequestOnly )
 {
 	FindOrAddPathIDInfo( g_PathIDTable.AddString( pPathID ), bRequestOnly );
+	m_ResolveCache.Invalidate();
 }
 
 #if defined( TRACK_BLOCKING_IO )
@@ -61,6 +61,8 @@
 #include "byteswap.h"
 #include "threadsaferefcountedobject.h"
 #include "filetracker.h"
+#include "fileresolvecache.h"
+#include "asyncreadengine.h"
 // #include "filesystem_init.h"
 
 #if defined( SUPPORT_PACKED_STORE )
@@ -281,6 +283,10 @@ public:
 	void						*AllocOptimalReadBuffer( FileHandle_t hFile, unsigned nSize, unsigned nOffset )	{ return malloc( nSize ); }
 	void						FreeOptimalReadBuffer( void *p ) { free( p ); }
 
+	// Memory mapped views
+	virtual void				*MapFileView( FileHandle_t hFile, unsigned nOffset, unsigned nSize );
+	virtual void				UnmapFileView( void *pView, unsigned nSize );
+
 	// Gets the current working directory
 	virtual bool				GetCurrentDirectory( char* pDirectory, int maxlen );
 
@@ -433,6 +439,14 @@ public:
 	FSAsyncStatus_t				SyncGetFileSize( const FileAsyncRequest_t &request );
 	void						DoAsyncCallback( const FileAsyncRequest_t &request, void *pData, int nBytesRead, FSAsyncStatus_t result );
 
+	// Reads queued on m_AsyncReadEngine rather than blocking an IO thread.
+	// BeginEngineRead() returns false if the request has to go through SyncRead().
+	bool						BeginEngineRead( const FileAsyncRequest_t &request, AsyncReadOp_t &op, FileHandle_t &hFile, int &nBytesToRead, bool bMoreComing );
+	FSAsyncStatus_t				FinishEngineRead( const FileAsyncRequest_t &request, AsyncReadOp_t &op, FileHandle_t hFile, int nBytesToRead );
+	CAsyncReadEngine			&AsyncReadEngine() { return m_AsyncReadEngine; }
+	void						*AllocAsyncReadBuffer( const FileAsyncRequest_t &request, FileHandle_t hFile, int nBytesToRead, int &nBytesBuffer );
+	int							GetReadDescriptor( FileHandle_t hFile, int nOffset, int64 &nFileOffset );
+
 	void						SetupPreloadData();
 	void						DiscardPreloadData();
 
@@ -696,6 +710,8 @@ public:
 #endif
 
 	CFileTracker2	m_FileTracker2;
+	CFileResolveCache m_ResolveCache;
+	CAsyncReadEngine m_AsyncReadEngine;
 
 protected:
 	//----------------------------------------------------------------------------
@@ -721,6 +737,7 @@ protected:
 	virtual bool FS_FindNextFile(HANDLE handle, WIN32_FIND_DATA *dat) = 0;
 	virtual bool FS_FindClose(HANDLE handle) = 0;
 	virtual int FS_GetSectorSize( FILE * ) { return 1; }
+	virtual int FS_fileno( FILE * ) { return -1; }
 
 #if defined( TRACK_BLOCKING_IO )
 	void BlockingFileAccess_EnterCriticalSection();
@@ -780,6 +797,8 @@ public:
 	void						LogAccessToFile( char const *accesstype, char const *fullpath, char const *options );
 	void						Warning( FileWarningLevel_t level, PRINTF_FORMAT_STRING const char *fmt, ... );
 
+	CFileResolveCache			&ResolveCache() { return m_ResolveCache; }
+
 protected:
 	// Note: if pFoundStoreID is passed in, then it will set that to the CSearchPath::m_storeId value of the search path it found the file in.
 	const char*					FindFirstHelper( const char *pWildCard, const char *pPathID, FileFindHandle_t *pHandle, int *pFoundStoreID );
@@ -796,6 +815,7 @@ protected:
 	void						HandleOpenRegularFile( CFileOpenInfo &openInfo, bool bIsAbsolutePath );
 
 	FileHandle_t				FindFileInSearchPath( CFileOpenInfo &openInfo );
+	FileHandle_t				FindFileInSearchPaths( CFileOpenInfo &openInfo, const char *pathID, PathTypeFilter_t pathFilter );
 	time_t						FastFileTime( const CSearchPath *path, const char *pFileName );
 
 	const char					*GetWritePath( const char *pFilename, const char *pathID );
@@ -0,0 +1,260 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Search path resolution cache, see fileresolvecache.h
+//
+//=============================================================================
+
+#include "basefilesystem.h"
+#include "fileresolvecache.h"
+
+#ifdef LINUX
+#include <sys/inotify.h>
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+// NOTE: This has to be the last file included!
+#include "tier0/memdbgon.h"
+
+// Past this the cache is simply emptied, a level load touches a few tens of thousands of names
+#define RESOLVE_CACHE_MAX_ENTRIES	( 1 << 17 )
+
+// Changes made by other processes can take this long to be noticed. Reading
+// the watch descriptor on every open costs a syscall each time.
+#define RESOLVE_CACHE_POLL_INTERVAL	0.1
+
+#ifdef LINUX
+#define RESOLVE_CACHE_WATCH_EVENTS	( IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR )
+#endif
+
+CFileResolveCache::CFileResolveCache()
+{
+	m_nGeneration = 0;
+	m_hWatch = -1;
+	m_flNextPoll = 0;
+#ifdef LINUX
+	m_hWatch = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+#endif
+	ResetStats();
+}
+
+CFileResolveCache::~CFileResolveCache()
+{
+	Shutdown();
+}
+
+void CFileResolveCache::Shutdown()
+{
+	AUTO_LOCK( m_Mutex );
+	InvalidateLocked();
+#ifdef LINUX
+	if ( m_hWatch >= 0 )
+	{
+		close( m_hWatch );
+		m_hWatch = -1;
+	}
+#endif
+	m_Entries.Purge();
+	m_WatchedDirs.Purge();
+}
+
+bool CFileResolveCache::CanCacheLooseFiles()
+{
+	return m_hWatch >= 0;
+}
+
+bool CFileResolveCache::Lookup( const char *pszKey, ResolvedFile_t &result, uint32 &nGeneration )
+{
+	AUTO_LOCK( m_Mutex );
+	PollWatchesLocked();
+
+	m_nLookups++;
+	nGeneration = m_nGeneration;
+
+	UtlFlatHashHandle_t h = m_Entries.Find( pszKey );
+	if ( h == m_Entries.InvalidHandle() )
+		return false;
+
+	result = m_Entries[h];
+	m_nHits++;
+	if ( !result.m_bFound )
+	{
+		m_nNegativeHits++;
+	}
+	m_nLooseProbesAvoided += result.m_nLooseMisses;
+	m_nPackProbesAvoided += result.m_nPackMisses;
+	return true;
+}
+
+void CFileResolveCache::Insert( const char *pszKey, const ResolvedFile_t &result, uint32 nGeneration )
+{
+	AUTO_LOCK( m_Mutex );
+	PollWatchesLocked();
+
+	// Something changed while the search paths were being walked
+	if ( nGeneration != m_nGeneration )
+		return;
+
+	if ( m_Entries.Count() >= RESOLVE_CACHE_MAX_ENTRIES )
+	{
+		m_Entries.RemoveAll();
+	}
+
+	m_Entries.Insert( pszKey, result );
+}
+
+void CFileResolveCache::NoteLocalWrite()
+{
+	AUTO_LOCK( m_Mutex );
+	m_flNextPoll = 0;
+}
+
+void CFileResolveCache::NoteStale( const char *pszKey )
+{
+	AUTO_LOCK( m_Mutex );
+	m_nStale++;
+	m_Entries.Remove( pszKey );
+}
+
+void CFileResolveCache::Invalidate()
+{
+	AUTO_LOCK( m_Mutex );
+	InvalidateLocked();
+}
+
+void CFileResolveCache::InvalidateLocked()
+{
+	m_nGeneration++;
+	if ( m_Entries.Count() )
+	{
+		m_nInvalidations++;
+		m_Entries.RemoveAll();
+	}
+}
+
+bool CFileResolveCache::WatchLooseFile( const char *pszSearchPath, const char *pszFileName )
+{
+	if ( m_hWatch < 0 )
+		return false;
+
+	char szDir[MAX_PATH];
+	V_snprintf( szDir, sizeof( szDir ), "%s%s", pszSearchPath, pszFileName );
+	V_FixSlashes( szDir );
+	V_StripFilename( szDir );
+
+	AUTO_LOCK( m_Mutex );
+	return WatchDirectoryLocked( szDir );
+}
+
+bool CFileResolveCache::WatchDirectoryLocked( const char *pszDir )
+{
+#ifdef LINUX
+	if ( m_WatchedDirs.HasElement( pszDir ) )
+		return true;
+
+	if ( inotify_add_watch( m_hWatch, pszDir, RESOLVE_CACHE_WATCH_EVENTS ) < 0 )
+	{
+		if ( errno != ENOENT && errno != ENOTDIR )
+			return false;
+
+		// The directory doesn't exist, watch for it being created instead
+		char szParent[MAX_PATH];
+		V_strncpy( szParent, pszDir, sizeof( szParent ) );
+		if ( !V_StripLastDir( szParent, sizeof( szParent ) ) )
+			return false;
+
+		V_StripTrailingSlash( szParent );
+		if ( !szParent[0] || !V_strcmp( szParent, pszDir ) || !WatchDirectoryLocked( szParent ) )
+			return false;
+	}
+
+	m_WatchedDirs.Insert( pszDir );
+	return true;
+#else
+	return false;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Drain pending inotify events. Any change to a watched directory flushes
+// the whole cache; it only happens when files are written or installed, and
+// figuring out which of the names cached for every search path it affects
+// isn't worth it. Events are queued by the kernel before the write that
+// caused them returns, and NoteLocalWrite() forces the next poll, so a file
+// created by this process is never hidden by an older negative entry.
+//-----------------------------------------------------------------------------
+void CFileResolveCache::PollWatchesLocked()
+{
+#ifdef LINUX
+	if ( m_hWatch < 0 || !m_WatchedDirs.Count() )
+		return;
+
+	double flNow = Plat_FloatTime();
+	if ( flNow < m_flNextPoll )
+		return;
+	m_flNextPoll = flNow + RESOLVE_CACHE_POLL_INTERVAL;
+
+	m_nWatchPolls++;
+
+	char buf[4096] __attribute__(( aligned( __alignof__( struct inotify_event ) ) ));
+	bool bChanged = false;
+	bool bDirsChanged = false;
+	for ( ;; )
+	{
+		ssize_t nRead = read( m_hWatch, buf, sizeof( buf ) );
+		if ( nRead <= 0 )
+			break;
+
+		for ( char *p = buf; p < buf + nRead; )
+		{
+			const struct inotify_event *pEvent = (const struct inotify_event *)p;
+			bChanged = true;
+
+			// New directories may stand in for watches placed on a parent,
+			// and removed ones have lost theirs, re-watch from scratch
+			if ( pEvent->mask & ( IN_ISDIR | IN_IGNORED | IN_Q_OVERFLOW | IN_DELETE_SELF | IN_MOVE_SELF ) )
+			{
+				bDirsChanged = true;
+			}
+			p += sizeof( struct inotify_event ) + pEvent->len;
+		}
+	}
+
+	if ( bChanged )
+	{
+		InvalidateLocked();
+	}
+	if ( bDirsChanged )
+	{
+		m_WatchedDirs.RemoveAll();
+	}
+#endif
+}
+
+void CFileResolveCache::PrintStats()
+{
+	AUTO_LOCK( m_Mutex );
+
+	uint64 nMisses = m_nLookups - m_nHits;
+	Msg( "Search path resolve cache: %d entries, %d watched directories%s\n", m_Entries.Count(), m_WatchedDirs.Count(),
+		m_hWatch >= 0 ? "" : " (loose files not cached)" );
+	Msg( "  lookups %llu, hits %llu (%.1f%%), negative hits %llu, misses %llu, stale %llu\n",
+		(unsigned long long)m_nLookups, (unsigned long long)m_nHits, m_nLookups ? 100.0 * m_nHits / m_nLookups : 0.0,
+		(unsigned long long)m_nNegativeHits, (unsigned long long)nMisses, (unsigned long long)m_nStale );
+	Msg( "  loose file opens avoided %llu, pack lookups avoided %llu, watch polls %llu, invalidations %llu\n",
+		(unsigned long long)m_nLooseProbesAvoided, (unsigned long long)m_nPackProbesAvoided,
+		(unsigned long long)m_nWatchPolls, (unsigned long long)m_nInvalidations );
+}
+
+void CFileResolveCache::ResetStats()
+{
+	AUTO_LOCK( m_Mutex );
+	m_nLookups = 0;
+	m_nHits = 0;
+	m_nNegativeHits = 0;
+	m_nStale = 0;
+	m_nInvalidations = 0;
+	m_nLooseProbesAvoided = 0;
+	m_nPackProbesAvoided = 0;
+	m_nWatchPolls = 0;
+}
@@ -0,0 +1,93 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Remembers which search path a relative filename was opened from
+//			(or that it wasn't found anywhere), so repeated opens skip the
+//			fopen/stat on every loose directory and the lookup in every pack
+//			ahead of it.
+//
+//			Entries for pack files and VPKs can't go stale while the search
+//			paths are unchanged. Loose directories are watched with inotify
+//			on Linux, and any create/delete/rename in a watched directory
+//			flushes the cache; elsewhere results that depended on a loose
+//			directory aren't cached. Watch events are read at most every
+//			RESOLVE_CACHE_POLL_INTERVAL, or on the next lookup after this
+//			process writes a file through the filesystem.
+//
+//=============================================================================
+
+#ifndef FILERESOLVECACHE_H
+#define FILERESOLVECACHE_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "tier0/threadtools.h"
+#include "tier1/utlstring.h"
+#include "tier1/utlflathashtable.h"
+
+struct ResolvedFile_t
+{
+	int		m_storeId;			// CSearchPath::m_storeId the file was opened from, map packs have the top bit set
+	bool	m_bFound;			// false if no search path had it
+	uint16	m_nLooseMisses;		// loose directories tried before the one that had it
+	uint16	m_nPackMisses;		// pack files and VPKs searched before the one that had it
+};
+
+class CFileResolveCache
+{
+public:
+	CFileResolveCache();
+	~CFileResolveCache();
+
+	void Shutdown();
+
+	// Can results that depended on loose directories be cached?
+	bool CanCacheLooseFiles();
+
+	// Returns false on a miss. nGeneration must be passed to Insert() so
+	// results computed across an invalidation are dropped.
+	bool Lookup( const char *pszKey, ResolvedFile_t &result, uint32 &nGeneration );
+	void Insert( const char *pszKey, const ResolvedFile_t &result, uint32 nGeneration );
+
+	// Call before trying pszFileName in the loose directory pszSearchPath.
+	// Returns false if the directory can't be watched, in which case the
+	// result mustn't be cached.
+	bool WatchLooseFile( const char *pszSearchPath, const char *pszFileName );
+
+	// A file or directory was created, removed or renamed through the
+	// filesystem, watch events are read on the next lookup
+	void NoteLocalWrite();
+
+	// A cached store didn't have the file after all
+	void NoteStale( const char *pszKey );
+
+	// Search paths or the pure server whitelist changed
+	void Invalidate();
+
+	void PrintStats();
+	void ResetStats();
+
+private:
+	void InvalidateLocked();
+	void PollWatchesLocked();
+	bool WatchDirectoryLocked( const char *pszDir );
+
+	CThreadMutex m_Mutex;
+	CUtlFlatHashtable< CUtlString, ResolvedFile_t > m_Entries;
+	CUtlFlatHashtable< CUtlString > m_WatchedDirs;
+	uint32 m_nGeneration;
+	int m_hWatch;				// inotify descriptor, -1 if loose directories can't be watched
+	double m_flNextPoll;		// Plat_FloatTime() of the next read of m_hWatch
+
+	// Statistics
+	uint64 m_nLookups;
+	uint64 m_nHits;
+	uint64 m_nNegativeHits;
+	uint64 m_nStale;
+	uint64 m_nInvalidations;
+	uint64 m_nLooseProbesAvoided;
+	uint64 m_nPackProbesAvoided;
+	uint64 m_nWatchPolls;
+};
+
+#endif // FILERESOLVECACHE_H
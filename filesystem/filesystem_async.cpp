@@ -79,6 +79,19 @@ CON_COMMAND( async_resume, "" )
 
 #endif
 
+ConVar fs_async_io_uring( "fs_async_io_uring", "1", 0, "Queue async reads on the kernel (io_uring) instead of blocking an IO thread per read" );
+
+CON_COMMAND( fs_async_io_stats, "Print async read engine statistics. 'fs_async_io_stats reset' clears them." )
+{
+	if ( args.ArgC() > 1 && !V_stricmp( args[1], "reset" ) )
+	{
+		BaseFileSystem()->AsyncReadEngine().ResetStats();
+		return;
+	}
+
+	BaseFileSystem()->AsyncReadEngine().PrintStats();
+}
+
 //-----------------------------------------------------------------------------
 // Need to support old external. New implementation has less granular priority for efficiency
 //-----------------------------------------------------------------------------
@@ -258,7 +271,8 @@ public:
 // A standard filesystem read job
 //---------------------------------------------------------
 class CFileAsyncReadJob : public CFileAsyncJob, 
-						  protected FileAsyncRequest_t
+						  protected FileAsyncRequest_t,
+						  public IAsyncReadCompletion
 {
 public:
 	CFileAsyncReadJob( const FileAsyncRequest_t &fromRequest, CBaseFileSystem *pOwnerFileSystem )
@@ -270,7 +284,10 @@ public:
 		m_pfnRealCallback( fromRequest.pfnCallback ),
 		m_pCustomFetcher(NULL),
 		m_hCustomFetcherHandle(NULL),
-		m_pOwnerFileSystem(pOwnerFileSystem)
+		m_pOwnerFileSystem(pOwnerFileSystem),
+		m_hEngineReadFile(NULL),
+		m_nEngineReadBytes(0),
+		m_bEngineRead(false)
 	{
 #if defined( TRACK_BLOCKING_IO )
 		m_Timer.Start();
@@ -339,6 +356,17 @@ public:
 				retval = -1; // generic failure code...?
 			}
 		}
+		else if ( m_bEngineRead )
+		{
+			// Resumed once the read completed, or waited on by AsyncFinish()
+			m_bEngineRead = false;
+			retval = BaseFileSystem()->FinishEngineRead( *this, m_EngineRead, m_hEngineReadFile, m_nEngineReadBytes );
+		}
+		else if ( GetServiceThread() != -1 && BeginEngineRead() )
+		{
+			// Parked until the read completes and puts it back in the pool
+			retval = JOB_STATUS_PENDING;
+		}
 		else
 		{
 			int iPrevPriority = ThreadGetPriority();
@@ -353,14 +381,60 @@ public:
 #endif
 
 #if defined( TRACK_BLOCKING_IO )
-		m_Timer.End();
-		FileBlockingItem item( FILESYSTEM_BLOCKING_ASYNCHRONOUS, Describe(), m_Timer.GetDuration().GetSeconds(), FileBlockingItem::FB_ACCESS_READ );
-		BaseFileSystem()->RecordBlockingFileAccess( false, item );
+		if ( retval != JOB_STATUS_PENDING )
+		{
+			m_Timer.End();
+			FileBlockingItem item( FILESYSTEM_BLOCKING_ASYNCHRONOUS, Describe(), m_Timer.GetDuration().GetSeconds(), FileBlockingItem::FB_ACCESS_READ );
+			BaseFileSystem()->RecordBlockingFileAccess( false, item );
+		}
 		BaseFileSystem()->SetAllowSynchronousLogging( oldState );
 #endif
 		return retval;
 	}
 
+	// Only on IO threads, anyone else executing the job wants it finished
+	bool BeginEngineRead()
+	{
+		// The engine's reference, dropped in OnAsyncReadComplete()
+		AddRef();
+		m_EngineRead.m_pCompletion = this;
+		m_bEngineRead = BaseFileSystem()->BeginEngineRead( *this, m_EngineRead, m_hEngineReadFile, m_nEngineReadBytes, GetThreadPool()->GetJobCount() > 0 );
+		if ( !m_bEngineRead )
+		{
+			Release();
+		}
+		return m_bEngineRead;
+	}
+
+	virtual bool OnAsyncReadComplete( AsyncReadOp_t *pOp )
+	{
+		// Whoever parked the job may still be on its way out of
+		// CJob::Execute(), or AsyncFinish() or an abort is finishing it. They
+		// can be waiting on other reads, so don't block the engine.
+		if ( !TryLock() )
+			return false;
+
+		if ( !IsFinished() )
+		{
+			ClearServiceThread();
+			GetThreadPool()->AddJob( this );
+		}
+		Unlock();
+		Release();
+		return true;
+	}
+
+	virtual JobStatus_t DoAbort( bool bDiscard )
+	{
+		if ( !m_bEngineRead )
+			return JOB_STATUS_ABORTED;
+
+		// The read is already in flight, treat it like a job that was in
+		// progress and let it complete
+		m_bEngineRead = false;
+		return BaseFileSystem()->FinishEngineRead( *this, m_EngineRead, m_hEngineReadFile, m_nEngineReadBytes );
+	}
+
 	virtual JobStatus_t GetResult( void **ppData, int *pSize ) 
 	{ 
 		if ( m_pResultData )
@@ -424,6 +498,10 @@ private:
 	int						m_nResultSize;
 	void *					m_pRealContext;
 	FSAsyncCallbackFunc_t	m_pfnRealCallback;
+	AsyncReadOp_t			m_EngineRead;
+	FileHandle_t			m_hEngineReadFile;
+	int						m_nEngineReadBytes;
+	bool					m_bEngineRead;
 #if defined( TRACK_BLOCKING_IO )
 	CFastTimer				m_Timer;
 #endif
@@ -688,6 +766,10 @@ void CBaseFileSystem::InitAsync()
 		{
 			SafeRelease( m_pThreadPool );
 		}
+		else if ( !CommandLine()->FindParm( "-noiouring" ) )
+		{
+			m_AsyncReadEngine.Init();
+		}
 	}
 }
 
@@ -699,6 +781,7 @@ void CBaseFileSystem::ShutdownAsync()
 	if ( m_pThreadPool )
 	{
 		AsyncFlush();
+		m_AsyncReadEngine.Shutdown();
 		m_pThreadPool->Stop();
 		SafeRelease( m_pThreadPool );
 	}
@@ -1014,7 +1097,12 @@ void CBaseFileSystem::AsyncFinishAll( int iToPriority )
 	if ( m_pThreadPool)
 	{
 		AUTO_LOCK( g_AsyncFinishMutex );
-		m_pThreadPool->ExecuteToPriority( ConvertPriority( iToPriority ) );
+
+		// Reads in flight go back in the pool when they complete
+		do
+		{
+			m_pThreadPool->ExecuteToPriority( ConvertPriority( iToPriority ) );
+		} while ( m_AsyncReadEngine.WaitForIdle() );
 	}
 }
 
@@ -1220,6 +1308,13 @@ FSAsyncStatus_t CBaseFileSystem::AsyncFlush()
 	if ( m_pThreadPool )
 	{
 		m_pThreadPool->AbortAll();
+
+		// Reads already in flight can't be cancelled, they're completed
+		// as they come back to the pool
+		if ( m_AsyncReadEngine.WaitForIdle() )
+		{
+			m_pThreadPool->AbortAll();
+		}
 	}
 
 	// Abort all custom jobs
@@ -1324,39 +1419,13 @@ FSAsyncStatus_t CBaseFileSystem::SyncRead( const FileAsyncRequest_t &request )
 		// ------------------------------------------------------
 		int nBytesToRead = ( request.nBytes ) ? request.nBytes : Size( hFile ) - request.nOffset;
 		int nBytesBuffer;
-		void *pDest;
 
 		if ( nBytesToRead < 0 )
 		{
 			nBytesToRead = 0; // bad offset?
 		}
 
-		if ( request.pData )
-		{
-			// caller provided buffer
-			Assert( !( request.flags & FSASYNC_FLAGS_NULLTERMINATE ) );
-			pDest = request.pData;
-			nBytesBuffer = nBytesToRead;
-		}
-		else
-		{
-			// allocate an optimal buffer
-			unsigned nOffsetAlign;
-			nBytesBuffer = nBytesToRead + ( ( request.flags & FSASYNC_FLAGS_NULLTERMINATE ) ? 1 : 0 );
-			if ( GetOptimalIOConstraints( hFile, &nOffsetAlign, NULL, NULL) && ( request.nOffset % nOffsetAlign == 0 ) )
-			{
-				nBytesBuffer = GetOptimalReadSize( hFile, nBytesBuffer );
-			}
-
-			if ( !request.pfnAlloc )
-			{
-				pDest = AllocOptimalReadBuffer( hFile, nBytesBuffer, request.nOffset );
-			}
-			else
-			{
-				pDest = (*request.pfnAlloc)( request.pszFilename, nBytesBuffer );
-			}
-		}
+		void *pDest = AllocAsyncReadBuffer( request, hFile, nBytesToRead, nBytesBuffer );
 
 		SetBufferSize( hFile, 0 ); // TODO: what if it's a pack file? restore buffer size?
 
@@ -1400,6 +1469,128 @@ FSAsyncStatus_t CBaseFileSystem::SyncRead( const FileAsyncRequest_t &request )
 	return result;
 }
 
+//-----------------------------------------------------------------------------
+// The request's own buffer, or one allocated for it
+//-----------------------------------------------------------------------------
+void *CBaseFileSystem::AllocAsyncReadBuffer( const FileAsyncRequest_t &request, FileHandle_t hFile, int nBytesToRead, int &nBytesBuffer )
+{
+	if ( request.pData )
+	{
+		// caller provided buffer
+		Assert( !( request.flags & FSASYNC_FLAGS_NULLTERMINATE ) );
+		nBytesBuffer = nBytesToRead;
+		return request.pData;
+	}
+
+	// allocate an optimal buffer
+	unsigned nOffsetAlign;
+	nBytesBuffer = nBytesToRead + ( ( request.flags & FSASYNC_FLAGS_NULLTERMINATE ) ? 1 : 0 );
+	if ( GetOptimalIOConstraints( hFile, &nOffsetAlign, NULL, NULL) && ( request.nOffset % nOffsetAlign == 0 ) )
+	{
+		nBytesBuffer = GetOptimalReadSize( hFile, nBytesBuffer );
+	}
+
+	if ( !request.pfnAlloc )
+	{
+		return AllocOptimalReadBuffer( hFile, nBytesBuffer, request.nOffset );
+	}
+	return (*request.pfnAlloc)( request.pszFilename, nBytesBuffer );
+}
+
+//-----------------------------------------------------------------------------
+// Descriptor and offset to read an open file at nOffset without going
+// through its handle, -1 for pack files and anything else that can't be
+//-----------------------------------------------------------------------------
+int CBaseFileSystem::GetReadDescriptor( FileHandle_t hFile, int nOffset, int64 &nFileOffset )
+{
+#ifdef POSIX
+	CFileHandle *fh = (CFileHandle *)hFile;
+	nFileOffset = nOffset;
+
+#if defined( SUPPORT_PACKED_STORE )
+	if ( fh->m_VPKHandle )
+	{
+		// Read the VPK chunk file directly
+		PackDataFileHandle_t hDataFile;
+		if ( !fh->m_VPKHandle.m_pOwner->GetDataFileRange( fh->m_VPKHandle, nOffset, hDataFile, nFileOffset ) )
+			return -1;
+		fh = (CFileHandle *)hDataFile;
+		if ( fh->m_VPKHandle )
+			return -1;
+	}
+#endif
+
+	if ( !fh->m_pFile || fh->m_pPackFileHandle || fh->m_type != FT_NORMAL )
+		return -1;
+
+	return FS_fileno( fh->m_pFile );
+#else
+	return -1;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Opens the file and queues the read on m_AsyncReadEngine. The file stays
+// open until FinishEngineRead(), which does what the rest of SyncRead() does.
+//-----------------------------------------------------------------------------
+bool CBaseFileSystem::BeginEngineRead( const FileAsyncRequest_t &request, AsyncReadOp_t &op, FileHandle_t &hFile, int &nBytesToRead, bool bMoreComing )
+{
+	if ( !m_AsyncReadEngine.IsActive() || !fs_async_io_uring.GetBool() )
+		return false;
+
+	// Held files keep their handle's position for the next request
+	if ( request.hSpecificAsyncFile != FS_INVALID_ASYNC_FILE || request.nBytes < 0 || request.nOffset < 0 )
+		return false;
+
+	hFile = OpenEx( request.pszFilename, "rb", 0, request.pszPathID );
+	if ( !hFile )
+		return false;
+
+	int nFileSize = Size( hFile );
+	int64 nFileOffset;
+	int hDescriptor = GetReadDescriptor( hFile, request.nOffset, nFileOffset );
+	nBytesToRead = ( request.nBytes ) ? request.nBytes : nFileSize - request.nOffset;
+
+	// Past the end of a VPK entry is the next file in the chunk
+	int nIOBytes = MIN( nBytesToRead, nFileSize - request.nOffset );
+	if ( hDescriptor < 0 || nIOBytes <= 0 )
+	{
+		Close( hFile );
+		hFile = NULL;
+		return false;
+	}
+
+	int nBytesBuffer;
+	op.m_hFile = hDescriptor;
+	op.m_nOffset = nFileOffset;
+	op.m_pDest = AllocAsyncReadBuffer( request, hFile, nBytesToRead, nBytesBuffer );
+	op.m_nBytes = nIOBytes;
+	m_AsyncReadEngine.Read( &op, bMoreComing );
+	return true;
+}
+
+FSAsyncStatus_t CBaseFileSystem::FinishEngineRead( const FileAsyncRequest_t &request, AsyncReadOp_t &op, FileHandle_t hFile, int nBytesToRead )
+{
+	m_AsyncReadEngine.Wait( &op );
+	Close( hFile );
+
+	int nBytesRead = MAX( op.m_nResult, 0 );
+	if ( request.flags & FSASYNC_FLAGS_NULLTERMINATE )
+	{
+		((char *)op.m_pDest)[nBytesRead] = 0;
+	}
+
+	FSAsyncStatus_t result = ( ( nBytesRead == 0 ) && ( nBytesToRead != 0 ) ) ? FSASYNC_ERR_READING : FSASYNC_OK;
+	DoAsyncCallback( request, op.m_pDest, min( nBytesRead, nBytesToRead ), result );
+
+	if ( m_fwLevel >= FILESYSTEM_WARNING_REPORTALLACCESSES_ASYNC )
+	{
+		LogAccessToFile( "async", request.pszFilename, "" );
+	}
+
+	return result;
+}
+
 //-----------------------------------------------------------------------------
 // 
 //-----------------------------------------------------------------------------
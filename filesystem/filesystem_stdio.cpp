@@ -85,6 +85,7 @@ protected:
 	virtual bool FS_FindNextFile(HANDLE handle, WIN32_FIND_DATA *dat);
 	virtual bool FS_FindClose(HANDLE handle);
 	virtual int FS_GetSectorSize( FILE * );
+	virtual int FS_fileno( FILE * );
 
 private:
 	bool CanAsync() const
@@ -117,6 +118,7 @@ public:
 	virtual int FS_fflush() = 0;
 	virtual char *FS_fgets( char *dest, int destSize ) = 0;
 	virtual int FS_GetSectorSize() { return 1; }
+	virtual int FS_fileno() { return -1; }
 };
 
 //---------------------------------------------------------
@@ -138,6 +140,7 @@ public:
 	virtual int FS_ferror();
 	virtual int FS_fflush();
 	virtual char *FS_fgets( char *dest, int destSize );
+	virtual int FS_fileno();
 
 #ifdef POSIX
 	static CUtlMap< ino_t, CThreadMutex * > m_LockedFDMap;
@@ -764,6 +767,15 @@ int CFileSystem_Stdio::FS_GetSectorSize( FILE *fp )
 	return pFile->FS_GetSectorSize();
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: OS descriptor for reads issued outside the FILE, -1 if there isn't one
+//-----------------------------------------------------------------------------
+int CFileSystem_Stdio::FS_fileno( FILE *fp )
+{
+	CStdFilesystemFile *pFile = ((CStdFilesystemFile *)fp);
+	return pFile->FS_fileno();
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: files are always immediately available on disk
 //-----------------------------------------------------------------------------
@@ -1093,6 +1105,18 @@ size_t CStdioFile::FS_vfprintf( const char *fmt, va_list list )
 	return vfprintf(m_pFile, fmt, list);
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: low-level filesystem wrapper
+//-----------------------------------------------------------------------------
+int CStdioFile::FS_fileno()
+{
+#ifdef _WIN32
+	return _fileno( m_pFile );
+#else
+	return fileno( m_pFile );
+#endif
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: low-level filesystem wrapper
 //-----------------------------------------------------------------------------
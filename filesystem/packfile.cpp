@@ -12,8 +12,14 @@
 #include "tier1/lzmaDecoder.h"
 #include "tier1/utlbuffer.h"
 #include "tier1/generichash.h"
+#include "tier1/checksum_crc.h"
 
 ConVar fs_monitor_read_from_pack( "fs_monitor_read_from_pack", "0", 0, "0:Off, 1:Any, 2:Sync only" );
+ConVar fs_pack_content_cache( "fs_pack_content_cache", "1", 0, "Open compressed map pack files from a shared cache of their decompressed contents" );
+ConVar fs_pack_content_cache_mb( "fs_pack_content_cache_mb", "1024", 0, "Megabytes of decompressed map pack files kept in the content cache, the oldest are deleted past this" );
+
+#define PACK_CONTENT_DIGESTS_ID			MAKEID( 'P', 'C', 'D', 'X' )
+#define PACK_CONTENT_DIGESTS_VERSION	1
 
 // How many bytes we should decode at a time when doing pseudo-reads to seek forward in a compressed file handle,
 // (affects maximum stack allocation by a forward seek)
@@ -134,6 +140,25 @@ CFileHandle *CZipPackFile::OpenFile( const char *pFileName, const char *pOptions
 		}
 		m_nOpenFiles++;
 		m_mutex.Unlock();
+
+		// an entry some map already decompressed is opened as a plain file
+		CFileHandle *pCachedFile = OpenFromContentCache( nIndex, pOptions );
+		if ( pCachedFile )
+		{
+			m_mutex.Lock();
+			if ( --m_nOpenFiles == 0 && m_bIsMapPath && m_hPackFileHandleFS )
+			{
+				m_fs->Trace_FClose( m_hPackFileHandleFS );
+				m_hPackFileHandleFS = NULL;
+			}
+			m_mutex.Unlock();
+
+#if !defined( _RETAIL )
+			pCachedFile->SetName( pFileName );
+#endif
+			return pCachedFile;
+		}
+
 		CPackFileHandle* ph = NULL;
 		if ( nCompressionMethod == ZIP_COMPRESSION_LZMA )
 		{
@@ -167,6 +192,354 @@ CFileHandle *CZipPackFile::OpenFile( const char *pFileName, const char *pOptions
 	return NULL;
 }
 
+//-----------------------------------------------------------------------------
+//	Open a compressed entry from the content cache, decompressing it into the
+//	cache first if no map has yet. Returns NULL to read it from the pack.
+//-----------------------------------------------------------------------------
+CFileHandle *CZipPackFile::OpenFromContentCache( int nIndex, const char *pOptions )
+{
+	const CPackFileEntry &entry = m_PackFiles[nIndex];
+	if ( !m_bIsMapPath || !fs_pack_content_cache.GetBool() ||
+		entry.m_nCompressionMethod != ZIP_COMPRESSION_LZMA ||
+		entry.m_nOriginalSize < PACKFILE_CONTENT_CACHE_MIN_SIZE ||
+		entry.m_nPreloadIdx != INVALID_PRELOAD_ENTRY )
+	{
+		return NULL;
+	}
+
+	SHADigest_t digest;
+	CUtlBuffer compressed;
+	if ( !GetContentDigest( nIndex, digest, compressed ) )
+	{
+		return NULL;
+	}
+
+	char szHex[k_cchHash];
+	char szBlobName[MAX_PATH];
+	V_binarytohex( digest, sizeof( digest ), szHex, sizeof( szHex ) );
+	V_snprintf( szBlobName, sizeof( szBlobName ), "%s/%.2s/%s.bin", PACKFILE_CONTENT_CACHE_PATH, szHex, szHex );
+
+	char szFullPath[MAX_PATH];
+	m_fs->RelativePathToFullPath( szBlobName, "DEFAULT_WRITE_PATH", szFullPath, sizeof( szFullPath ) );
+	if ( !V_IsAbsolutePath( szFullPath ) )
+	{
+		if ( !WriteContentBlob( nIndex, szBlobName, compressed ) )
+		{
+			return NULL;
+		}
+		m_fs->RelativePathToFullPath( szBlobName, "DEFAULT_WRITE_PATH", szFullPath, sizeof( szFullPath ) );
+		if ( !V_IsAbsolutePath( szFullPath ) )
+		{
+			return NULL;
+		}
+	}
+
+	int64 nSize;
+	FILE *fp = m_fs->Trace_FOpen( szFullPath, pOptions, 0, &nSize );
+	if ( !fp )
+	{
+		return NULL;
+	}
+	if ( nSize != entry.m_nOriginalSize )
+	{
+		// not the blob this digest was written as
+		m_fs->Trace_FClose( fp );
+		return NULL;
+	}
+
+	CFileHandle *fh = new CFileHandle( m_fs );
+	fh->m_pFile = fp;
+	fh->m_type = FT_NORMAL;
+	fh->m_nLength = nSize;
+	return fh;
+}
+
+//-----------------------------------------------------------------------------
+//	Get the SHA-1 of an entry's compressed bytes, from this pack's saved digests
+//	or by hashing them. Hashing leaves the compressed bytes in the buffer.
+//-----------------------------------------------------------------------------
+bool CZipPackFile::GetContentDigest( int nIndex, SHADigest_t digest, CUtlBuffer &compressed )
+{
+	{
+		AUTO_LOCK( m_mutex );
+		if ( !m_bContentDigestsLoaded )
+		{
+			LoadContentDigests();
+		}
+		if ( m_ContentDigests[nIndex].m_bValid )
+		{
+			V_memcpy( digest, m_ContentDigests[nIndex].m_Digest, sizeof( SHADigest_t ) );
+			return true;
+		}
+	}
+
+	const CPackFileEntry &entry = m_PackFiles[nIndex];
+	compressed.EnsureCapacity( entry.m_nCompressedSize );
+	int nBytesRead = ReadFromPack( nIndex, compressed.Base(), entry.m_nCompressedSize, entry.m_nCompressedSize, entry.m_nPosition );
+	if ( nBytesRead != (int)entry.m_nCompressedSize )
+	{
+		return false;
+	}
+	compressed.SeekPut( CUtlBuffer::SEEK_HEAD, nBytesRead );
+
+	CSHA1 sha1;
+	sha1.Update( (unsigned char *)compressed.Base(), nBytesRead );
+	sha1.Final();
+	sha1.GetHash( digest );
+
+	AUTO_LOCK( m_mutex );
+	V_memcpy( m_ContentDigests[nIndex].m_Digest, digest, sizeof( SHADigest_t ) );
+	m_ContentDigests[nIndex].m_bValid = true;
+	m_bContentDigestsDirty = true;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+//	Decompress an entry into the content cache. Written under a temporary name
+//	and renamed, so a blob under its real name is always complete.
+//-----------------------------------------------------------------------------
+bool CZipPackFile::WriteContentBlob( int nIndex, const char *pBlobName, CUtlBuffer &compressed )
+{
+	const CPackFileEntry &entry = m_PackFiles[nIndex];
+	if ( compressed.TellPut() != (int)entry.m_nCompressedSize )
+	{
+		// digest came from the saved ones, the bytes haven't been read yet
+		compressed.EnsureCapacity( entry.m_nCompressedSize );
+		int nBytesRead = ReadFromPack( nIndex, compressed.Base(), entry.m_nCompressedSize, entry.m_nCompressedSize, entry.m_nPosition );
+		if ( nBytesRead != (int)entry.m_nCompressedSize )
+		{
+			return false;
+		}
+		compressed.SeekPut( CUtlBuffer::SEEK_HEAD, nBytesRead );
+	}
+
+	CUtlBuffer uncompressed;
+	uncompressed.EnsureCapacity( entry.m_nOriginalSize );
+
+	CLZMAStream lzmaStream;
+	lzmaStream.InitZIPHeader( entry.m_nCompressedSize, entry.m_nOriginalSize );
+	unsigned int nCompressedRead = 0;
+	unsigned int nOutputWritten = 0;
+	while ( nOutputWritten < entry.m_nOriginalSize )
+	{
+		unsigned int nInput, nOutput;
+		if ( !lzmaStream.Read( (unsigned char *)compressed.Base() + nCompressedRead, entry.m_nCompressedSize - nCompressedRead,
+		                       (unsigned char *)uncompressed.Base() + nOutputWritten, entry.m_nOriginalSize - nOutputWritten,
+		                       nInput, nOutput ) || ( !nInput && !nOutput ) )
+		{
+			Warning( "Pack file: decompressing into the content cache failed\n" );
+			return false;
+		}
+		nCompressedRead += nInput;
+		nOutputWritten += nOutput;
+	}
+	uncompressed.SeekPut( CUtlBuffer::SEEK_HEAD, nOutputWritten );
+
+	char szDir[MAX_PATH];
+	char szTempName[MAX_PATH];
+	V_ExtractFilePath( pBlobName, szDir, sizeof( szDir ) );
+	V_snprintf( szTempName, sizeof( szTempName ), "%s.%llx.tmp", pBlobName, (unsigned long long)ThreadGetCurrentId() );
+	m_fs->CreateDirHierarchy( szDir, "DEFAULT_WRITE_PATH" );
+	if ( !m_fs->WriteFile( szTempName, "DEFAULT_WRITE_PATH", uncompressed ) )
+	{
+		return false;
+	}
+	if ( !m_fs->RenameFile( szTempName, pBlobName, "DEFAULT_WRITE_PATH" ) )
+	{
+		// another thread or process got there first with the same contents
+		m_fs->RemoveFile( szTempName, "DEFAULT_WRITE_PATH" );
+		return true;
+	}
+
+	TrimContentCache( m_fs, pBlobName, nOutputWritten );
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+//	Content cache size, shared by every pack. Counted from disk the first time
+//	a blob is written, then kept up to date as blobs are added and deleted.
+//-----------------------------------------------------------------------------
+static CThreadFastMutex s_ContentCacheMutex;
+static int64 s_nContentCacheBytes = -1;
+
+struct ContentBlob_t
+{
+	CUtlString	m_Name;
+	time_t		m_nTime;
+	int64		m_nSize;
+};
+
+static int ContentBlobOlder( const ContentBlob_t *pLHS, const ContentBlob_t *pRHS )
+{
+	if ( pLHS->m_nTime != pRHS->m_nTime )
+	{
+		return ( pLHS->m_nTime < pRHS->m_nTime ) ? -1 : 1;
+	}
+	return V_strcmp( pLHS->m_Name.String(), pRHS->m_Name.String() );
+}
+
+static int64 ListContentBlobs( CBaseFileSystem *fs, CUtlVector< ContentBlob_t > &blobs )
+{
+	int64 nTotal = 0;
+	FileFindHandle_t hDirs;
+	for ( const char *pDir = fs->FindFirstEx( PACKFILE_CONTENT_CACHE_PATH "/*", "DEFAULT_WRITE_PATH", &hDirs ); pDir; pDir = fs->FindNext( hDirs ) )
+	{
+		// blobs are in two hex digit directories named after their digest
+		if ( !fs->FindIsDirectory( hDirs ) || V_strlen( pDir ) != 2 )
+			continue;
+
+		char szWildCard[MAX_PATH];
+		V_snprintf( szWildCard, sizeof( szWildCard ), "%s/%s/*.bin", PACKFILE_CONTENT_CACHE_PATH, pDir );
+		FileFindHandle_t hBlobs;
+		for ( const char *pBlob = fs->FindFirstEx( szWildCard, "DEFAULT_WRITE_PATH", &hBlobs ); pBlob; pBlob = fs->FindNext( hBlobs ) )
+		{
+			ContentBlob_t &blob = blobs[ blobs.AddToTail() ];
+			blob.m_Name.Format( "%s/%s/%s", PACKFILE_CONTENT_CACHE_PATH, pDir, pBlob );
+			blob.m_nTime = fs->GetFileTime( blob.m_Name.String(), "DEFAULT_WRITE_PATH" );
+			blob.m_nSize = fs->Size( blob.m_Name.String(), "DEFAULT_WRITE_PATH" );
+			nTotal += blob.m_nSize;
+		}
+		fs->FindClose( hBlobs );
+	}
+	fs->FindClose( hDirs );
+	return nTotal;
+}
+
+//-----------------------------------------------------------------------------
+//	A blob was added to the content cache. Past fs_pack_content_cache_mb the
+//	oldest blobs are deleted until it's back under 90% of that, so the cache
+//	isn't listed again on every write. A blob in use by another process can't
+//	be deleted on Windows, it's left for next time.
+//-----------------------------------------------------------------------------
+void CZipPackFile::TrimContentCache( CBaseFileSystem *fs, const char *pNewBlob, int64 nNewBytes )
+{
+	AUTO_LOCK( s_ContentCacheMutex );
+
+	CUtlVector< ContentBlob_t > blobs;
+	if ( s_nContentCacheBytes < 0 )
+	{
+		s_nContentCacheBytes = ListContentBlobs( fs, blobs );
+	}
+	else
+	{
+		s_nContentCacheBytes += nNewBytes;
+	}
+
+	int64 nMaxBytes = (int64)MAX( fs_pack_content_cache_mb.GetInt(), 0 ) * 1024 * 1024;
+	if ( s_nContentCacheBytes <= nMaxBytes )
+		return;
+
+	if ( !blobs.Count() )
+	{
+		s_nContentCacheBytes = ListContentBlobs( fs, blobs );
+	}
+	blobs.Sort( ContentBlobOlder );
+
+	int64 nTargetBytes = nMaxBytes - nMaxBytes / 10;
+	for ( int i = 0; i < blobs.Count() && s_nContentCacheBytes > nTargetBytes; i++ )
+	{
+		if ( !V_stricmp( blobs[i].m_Name.String(), pNewBlob ) )
+			continue;
+
+		fs->RemoveFile( blobs[i].m_Name.String(), "DEFAULT_WRITE_PATH" );
+		if ( !fs->FileExists( blobs[i].m_Name.String(), "DEFAULT_WRITE_PATH" ) )
+		{
+			s_nContentCacheBytes -= blobs[i].m_nSize;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	Load this pack's digests, any that don't match the pack as it is now are
+//	discarded. The digests are saved per pack file and lump, the full path is
+//	worked out here because the search paths, which Trace_FOpen also uses,
+//	can't be touched once the pack is being destroyed. Called with the mutex held.
+//-----------------------------------------------------------------------------
+void CZipPackFile::LoadContentDigests()
+{
+	m_bContentDigestsLoaded = true;
+	m_bContentDigestsDirty = false;
+	m_ContentDigests.SetCount( m_PackFiles.Count() );
+	V_memset( m_ContentDigests.Base(), 0, m_ContentDigests.Count() * sizeof( ContentDigest_t ) );
+
+	char szWritePath[MAX_PATH];
+	m_fs->GetSearchPath( "DEFAULT_WRITE_PATH", false, szWritePath, sizeof( szWritePath ) );
+	char *pSeparator = V_strstr( szWritePath, ";" );
+	if ( pSeparator )
+	{
+		*pSeparator = 0;
+	}
+	if ( !szWritePath[0] )
+	{
+		return;
+	}
+
+	char szBaseName[MAX_PATH];
+	char szFilename[MAX_PATH];
+	char szFullPath[MAX_PATH];
+	V_FileBase( m_ZipName.String(), szBaseName, sizeof( szBaseName ) );
+	V_snprintf( szFilename, sizeof( szFilename ), "%s/digests/%s_%08x_%llx.bin", PACKFILE_CONTENT_CACHE_PATH, szBaseName,
+		CRC32_ProcessSingleBuffer( m_ZipName.String(), m_ZipName.Length() ), m_nBaseOffset );
+	V_ComposeFileName( szWritePath, szFilename, szFullPath, sizeof( szFullPath ) );
+	m_ContentDigestsPath = szFullPath;
+	m_fs->CreateDirHierarchy( PACKFILE_CONTENT_CACHE_PATH "/digests", "DEFAULT_WRITE_PATH" );
+
+	CUtlBuffer buf;
+	if ( !m_fs->ReadFile( szFullPath, NULL, buf, 0, 0 ) )
+	{
+		return;
+	}
+
+	char szZipName[MAX_PATH];
+	if ( buf.GetInt() != PACK_CONTENT_DIGESTS_ID || buf.GetInt() != PACK_CONTENT_DIGESTS_VERSION ||
+		buf.GetInt64() != m_FileLength || buf.GetInt64() != (int64)m_lPackFileTime ||
+		buf.GetInt() != m_ContentDigests.Count() )
+	{
+		return;
+	}
+	buf.GetString( szZipName );
+	if ( !buf.IsValid() || V_stricmp( szZipName, m_ZipName.String() ) )
+	{
+		return;
+	}
+
+	CUtlVector< ContentDigest_t > digests;
+	digests.SetCount( m_ContentDigests.Count() );
+	buf.Get( digests.Base(), digests.Count() * sizeof( ContentDigest_t ) );
+	if ( buf.IsValid() )
+	{
+		m_ContentDigests.Swap( digests );
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	Save the digests hashed since this pack was mounted
+//-----------------------------------------------------------------------------
+void CZipPackFile::SaveContentDigests()
+{
+	if ( !m_bContentDigestsDirty || m_ContentDigestsPath.IsEmpty() )
+	{
+		return;
+	}
+	m_bContentDigestsDirty = false;
+
+	CUtlBuffer buf;
+	buf.PutInt( PACK_CONTENT_DIGESTS_ID );
+	buf.PutInt( PACK_CONTENT_DIGESTS_VERSION );
+	buf.PutInt64( m_FileLength );
+	buf.PutInt64( (int64)m_lPackFileTime );
+	buf.PutInt( m_ContentDigests.Count() );
+	buf.PutString( m_ZipName.String() );
+	buf.Put( m_ContentDigests.Base(), m_ContentDigests.Count() * sizeof( ContentDigest_t ) );
+
+	FILE *fp = m_fs->FS_fopen( m_ContentDigestsPath.String(), "wb", 0, NULL );
+	if ( fp )
+	{
+		m_fs->FS_fwrite( buf.Base(), buf.TellPut(), fp );
+		m_fs->FS_fclose( fp );
+	}
+}
+
 //-----------------------------------------------------------------------------
 //	Get a directory entry from a pack's preload section
 //-----------------------------------------------------------------------------
@@ -809,6 +1182,8 @@ CZipPackFile::CZipPackFile( CBaseFileSystem* fs, void *pSection )
 	m_pPreloadRemapTable = NULL;
 	m_nPreloadSectionOffset = 0;
 	m_nPreloadSectionSize = 0;
+	m_bContentDigestsLoaded = false;
+	m_bContentDigestsDirty = false;
 
 #if defined( _X360 )
 	m_pSection = pSection;
@@ -817,6 +1192,7 @@ CZipPackFile::CZipPackFile( CBaseFileSystem* fs, void *pSection )
 
 CZipPackFile::~CZipPackFile()
 {
+	SaveContentDigests();
 	DiscardPreloadData();
 }
 
@@ -23,10 +23,18 @@
 // memory characteristics.
 #define PACKFILE_COMPRESSED_FILE_HANDLES_WARNING 20
 
+// Compressed map pack entries at least this big are decompressed once into the content cache and opened from there.
+// Smaller ones decode faster than the cache lookup is worth.
+#define PACKFILE_CONTENT_CACHE_MIN_SIZE ( 16 * 1024 )
+
+// Where the content cache lives, under DEFAULT_WRITE_PATH
+#define PACKFILE_CONTENT_CACHE_PATH "cache/packcontent"
+
 #include "basefilesystem.h"
 #include "tier1/refcount.h"
 #include "tier1/utlbuffer.h"
 #include "tier1/lzmaDecoder.h"
+#include "tier1/checksum_sha1.h"
 
 class CPackFile;
 class CZipPackFile;
@@ -256,6 +264,27 @@ protected:
 
 	bool						GetFileInfo( const char *pFileName, int &nBaseIndex, int64 &nFileOffset, int &nOriginalSize, int &nCompressedSize, unsigned short &nCompressionMethod );
 
+	// Content cache: compressed entries of map packs are stored decompressed under the SHA-1 of their compressed
+	// bytes, shared by every map that packs the same data. The digests of each pack are kept alongside so that
+	// opening an entry on the next mount is a lookup, not a hash.
+	struct ContentDigest_t
+	{
+		SHADigest_t				m_Digest;
+		bool					m_bValid;
+	};
+
+	CFileHandle					*OpenFromContentCache( int nIndex, const char *pOptions );
+	bool						GetContentDigest( int nIndex, SHADigest_t digest, CUtlBuffer &compressed );
+	bool						WriteContentBlob( int nIndex, const char *pBlobName, CUtlBuffer &compressed );
+	void						LoadContentDigests();
+	void						SaveContentDigests();
+	static void					TrimContentCache( CBaseFileSystem *fs, const char *pNewBlob, int64 nNewBytes );
+
+	CUtlVector< ContentDigest_t >	m_ContentDigests;
+	CUtlString					m_ContentDigestsPath;		// full path, the pack is saved when it's destroyed
+	bool						m_bContentDigestsLoaded;
+	bool						m_bContentDigestsDirty;
+
 	// Preload Support
 	void						SetupPreloadData() OVERRIDE;
 	void						DiscardPreloadData() OVERRIDE;
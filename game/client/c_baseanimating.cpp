@@ -1040,6 +1040,9 @@ CStudioHdr *C_BaseAnimating::OnNewModel()
 	if (hdr == NULL)
 		return NULL;
 
+	// Start reading the meshes before the first draw needs them
+	mdlcache->PrefetchModel( m_hStudioHdr );
+
 	InvalidateBoneCache();
 	if ( m_pBoneMergeCache )
 	{
@@ -5039,6 +5042,11 @@ void C_BaseAnimating::SetSequence( int nSequence )
 
 		m_nSequence = nSequence; 
 		InvalidatePhysicsRecursive( ANIMATION_CHANGED );
+		if ( m_hStudioHdr != MDLHANDLE_INVALID )
+		{
+			// Start reading the animations before they're needed
+			mdlcache->PrefetchSequence( m_hStudioHdr, nSequence, MDLCACHE_PREFETCH_HIGH );
+		}
 		if ( m_bClientSideAnimation )
 		{
 			ClientSideAnimationChanged();
@@ -6252,6 +6260,11 @@ unsigned char C_BaseAnimating::GetClientSideFade( void )
 void C_BaseAnimating::SetReceivedSequence( void )
 {
 	m_bReceivedSequence = true;
+
+	if ( m_hStudioHdr != MDLHANDLE_INVALID )
+	{
+		mdlcache->PrefetchSequence( m_hStudioHdr, m_nSequence, MDLCACHE_PREFETCH_HIGH );
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -926,6 +926,11 @@ bool CBaseAnimating::IsValidSequence( int iSequence )
 void CBaseAnimating::SetSequence( int nSequence )
 {
 	Assert( nSequence == 0 || IsDynamicModelLoading() || ( GetModelPtr( ) && ( nSequence < GetModelPtr( )->GetNumSeq() ) && ( GetModelPtr( )->GetNumSeq() < (1 << ANIMATION_SEQUENCE_BITS) ) ) );
+	if ( m_nSequence != nSequence && GetModel() )
+	{
+		// Start reading the animations before they're needed
+		mdlcache->PrefetchSequence( modelinfo->GetCacheHandle( GetModel() ), nSequence );
+	}
 	m_nSequence = nSequence;
 }
 
@@ -103,6 +103,17 @@ enum MDLCacheFlush_t
 	MDLCACHE_FLUSH_ALL              = 0xFFFFFFFF
 };
 
+
+//-----------------------------------------------------------------------------
+// Prefetch priorities, these are also the filesystem's async priorities
+//-----------------------------------------------------------------------------
+enum MDLCachePrefetchPriority_t
+{
+	MDLCACHE_PREFETCH_LOW			= -1,
+	MDLCACHE_PREFETCH_NORMAL		= 0,
+	MDLCACHE_PREFETCH_HIGH			= 1,
+};
+
 /*
 #define MDLCACHE_INTERFACE_VERSION_4 "MDLCache004"
 
@@ -175,7 +186,7 @@ public:
 //-----------------------------------------------------------------------------
 // The main MDL cacher 
 //-----------------------------------------------------------------------------
-#define MDLCACHE_INTERFACE_VERSION "MDLCache004"
+#define MDLCACHE_INTERFACE_VERSION "MDLCache005"
  
 abstract_class IMDLCache : public IAppSystem
 {
@@ -198,7 +209,9 @@ public:
 	virtual studiohdr_t *GetStudioHdr( MDLHandle_t handle ) = 0;
 	virtual studiohwdata_t *GetHardwareData( MDLHandle_t handle ) = 0;
 	virtual vcollide_t *GetVCollide( MDLHandle_t handle ) = 0;
-	virtual unsigned char *GetAnimBlock( MDLHandle_t handle, int nBlock ) = 0;
+	// With bNonBlocking a missing block may be read in the background and
+	// NULL returned meanwhile, see mod_load_anims_nonblocking
+	virtual unsigned char *GetAnimBlock( MDLHandle_t handle, int nBlock, bool bNonBlocking = false ) = 0;
 	virtual virtualmodel_t *GetVirtualModel( MDLHandle_t handle ) = 0;
 	virtual int GetAutoplayList( MDLHandle_t handle, unsigned short **pOut ) = 0;
 	virtual vertexFileHeader_t *GetVertexData( MDLHandle_t handle ) = 0;
@@ -266,6 +279,13 @@ public:
 	virtual void ResetErrorModelStatus( MDLHandle_t handle ) = 0;
 
 	virtual void MarkFrame() = 0;
+
+	// Starts reading data that's about to be needed, e.g. when an entity
+	// spawns or changes sequence. Nothing is read synchronously: requests are
+	// queued by priority and issued and finished a few at a time by MarkFrame.
+	// The model's header must already be loaded, otherwise these do nothing.
+	virtual void PrefetchModel( MDLHandle_t handle, int nPriority = MDLCACHE_PREFETCH_NORMAL ) = 0;
+	virtual void PrefetchSequence( MDLHandle_t handle, int nSequence, int nPriority = MDLCACHE_PREFETCH_NORMAL ) = 0;
 };
 
 
@@ -928,6 +928,16 @@ public:
 	{
 		return GetCaseCorrectFullPath_Ptr( pFullPath, pDest, (int)maxLenInChars );
 	}
+
+	//--------------------------------------------------------
+	// Memory mapped views of open files, for loading large files without
+	// copying them through read buffers. Views are copy on write: the caller
+	// may modify one, the file never sees it. Returns NULL if the range can't
+	// be mapped (pack files, VPK preload bytes, platforms without mmap), in
+	// which case read it instead. The view outlives closing the file.
+	//--------------------------------------------------------
+	virtual void			*MapFileView( FileHandle_t hFile, unsigned nOffset, unsigned nSize ) = 0;
+	virtual void			UnmapFileView( void *pView, unsigned nSize ) = 0;
 };
 
 //-----------------------------------------------------------------------------
@@ -248,6 +248,10 @@ public:
 		{ return m_pFileSystemPassThru->CheckVPKFileHash( PackFileID, nPackFileNumber, nFileFraction, md5Value ); }
 	virtual void			NotifyFileUnloaded( const char *pszFilename, const char *pPathId ) OVERRIDE
 		{ m_pFileSystemPassThru->NotifyFileUnloaded( pszFilename, pPathId ); }
+	virtual void			*MapFileView( FileHandle_t hFile, unsigned nOffset, unsigned nSize ) OVERRIDE
+		{ return m_pFileSystemPassThru->MapFileView( hFile, nOffset, nSize ); }
+	virtual void			UnmapFileView( void *pView, unsigned nSize ) OVERRIDE
+		{ m_pFileSystemPassThru->UnmapFileView( pView, nSize ); }
 
 protected:
 	IFileSystem *m_pFileSystemPassThru;
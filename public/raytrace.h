@@ -193,6 +193,28 @@ protected:
 };
 
 
+// Bounding volume hierarchy node, used instead of the kd-tree with RTE_FLAGS_BVH. The bounds of
+// both children are stored in the parent so that one node visit tests the rays against both
+// children. 64 bytes, one cache line.
+struct CacheOptimizedBVHNode
+{
+	float m_flChildMins[2][3];
+	float m_flChildMaxs[2][3];
+	int32 m_nChild[2];										// node index, or first index into
+															// TriangleIndexList for a leaf. -1 if
+															// the child is empty
+	uint16 m_nChildTriangles[2];							// # of triangles if the child is a leaf,
+															// 0 for a node
+	int32 m_nSplitAxis;										// children are ordered low to high on
+															// this axis
+
+	inline bool IsLeaf( int c ) const
+	{
+		return m_nChildTriangles[c] != 0;
+	}
+};
+
+
 struct RayTracingSingleResult
 {
 	Vector surface_normal;									// surface normal at intersection
@@ -220,6 +242,7 @@ public:
 #define RTE_FLAGS_FAST_TREE_GENERATION 1
 #define RTE_FLAGS_DONT_STORE_TRIANGLE_COLORS 2				// saves memory if not needed
 #define RTE_FLAGS_DONT_STORE_TRIANGLE_MATERIALS 4
+#define RTE_FLAGS_BVH 8										// build a BVH instead of the kd-tree
 
 enum RayTraceLightingMode_t {
 	DIRECT_LIGHTING,										// just dot product lighting
@@ -262,6 +285,7 @@ public:
 
 	FourVectors BackgroundColor;							//< color where no intersection
 	CUtlVector<CacheOptimizedKDNode> OptimizedKDTree;		//< the packed kdtree. root is 0
+	CUtlVector<CacheOptimizedBVHNode> OptimizedBVH;			//< the BVH with RTE_FLAGS_BVH. root is 0
 	CUtlBlockVector<CacheOptimizedTriangle> OptimizedTriangleList; //< the packed triangles
 	CUtlVector<int32> TriangleIndexList;					//< the list of triangle indices.
 	CUtlVector<LightDesc_t> LightList;						//< the list of lights
@@ -310,6 +334,11 @@ public:
 					RayTracingResult *rslt_out,
 					int32 skip_id=-1, ITransparentTriangleCallback *pCallback = NULL);
 
+	// trace a single ray from start to end. Cheaper than a packet for rays which have nothing in
+	// common with the rays around them. ray_length is set to the length of the ray
+	void TraceRay(const Vector &start, const Vector &end, RayTracingSingleResult *rslt_out,
+				  int32 skip_id=-1);
+
 	// compute virtual light sources to model inter-reflection
 	void ComputeVirtualLightSources(void);
 
@@ -356,6 +385,15 @@ public:
 	void CalculateTriangleListBounds(int32 const *tris,int ntris,
 									 Vector &minout, Vector &maxout);
 
+	// BVH versions of the above, in bvh.cpp
+	void BuildBVH(void);
+
+	void Trace4RaysBVH(const FourRays &rays, fltx4 TMin, fltx4 TMax, RayTracingResult *rslt_out,
+					   int32 skip_id, ITransparentTriangleCallback *pCallback);
+
+	void TraceRayBVH(const Vector &start, const Vector &dir, float TMax,
+					 RayTracingSingleResult *rslt_out, int32 skip_id);
+
 	void AddInfinitePointLight(Vector position,				// light center
 							   Vector intensity);			// rgb amount
 
@@ -49,6 +49,14 @@ public:
 
 	void					SetTargetSize( unsigned int targetSize );
 
+	// CLOCK (second chance) replacement: touching a resource only marks it
+	// as referenced instead of moving it to the tail of the LRU. Eviction
+	// passes over referenced resources once, clearing the mark.
+	void					SetClockReplacement( bool value ) { m_clockReplacement = value; }
+
+	// Number of resources in the LRU and locked. Lock first for an exact count
+	int						ResourceCount();
+
 	// NOTE: flush is equivalent to Destroy
 	unsigned int			FlushAllUnlocked();
 	unsigned int			FlushToTargetSize();
@@ -109,11 +117,13 @@ protected:
 		{
 			lockCount = 0;
 			serial = 1;
+			referenced = false;
 			pStore = 0;
 		}
 
 		unsigned short lockCount;
 		unsigned short serial;
+		bool	referenced;		// touched since eviction last passed it, with clock replacement
 		void	*pStore;
 	};
 
@@ -127,7 +137,8 @@ protected:
 	unsigned short m_freeList;
 	unsigned short m_listsAreFreed : 1;
 	unsigned short m_freeOnDestruct : 1;
-	unsigned short m_unused : 14;
+	unsigned short m_clockReplacement : 1;
+	unsigned short m_unused : 13;
 
 };
 
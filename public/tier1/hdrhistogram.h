@@ -0,0 +1,146 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Fixed size log-linear histogram for latency style measurements
+//
+//			Values below SUB_BUCKETS are counted exactly. Above that each
+//			power of two range is split into SUB_BUCKETS linear buckets, so
+//			percentiles are accurate to about 1/SUB_BUCKETS (6%) of the value
+//			over the whole uint32 range, in under 2k of counters. Recording
+//			is a couple of instructions and never allocates.
+//
+//			Not thread safe; keep one per thread and Add() them together.
+//
+//=============================================================================
+
+#ifndef HDRHISTOGRAM_H
+#define HDRHISTOGRAM_H
+
+#if defined( _WIN32 )
+#pragma once
+#include <intrin.h>
+#endif
+
+#include "tier0/platform.h"
+#include "tier0/dbg.h"
+
+class CHdrHistogram
+{
+public:
+	enum
+	{
+		SUB_BUCKET_BITS = 4,
+		SUB_BUCKETS = 1 << SUB_BUCKET_BITS,
+		NUM_BUCKETS = SUB_BUCKETS + ( 32 - SUB_BUCKET_BITS ) * SUB_BUCKETS,
+	};
+
+	CHdrHistogram()							{ Reset(); }
+
+	void Reset()
+	{
+		memset( m_Counts, 0, sizeof( m_Counts ) );
+		m_nCount = 0;
+		m_nSum = 0;
+		m_nMin = 0xFFFFFFFF;
+		m_nMax = 0;
+	}
+
+	void Record( uint32 nValue )
+	{
+		m_Counts[ BucketForValue( nValue ) ]++;
+		m_nCount++;
+		m_nSum += nValue;
+		m_nMin = MIN( m_nMin, nValue );
+		m_nMax = MAX( m_nMax, nValue );
+	}
+
+	void Add( const CHdrHistogram &other )
+	{
+		for ( int i = 0; i < NUM_BUCKETS; i++ )
+		{
+			m_Counts[i] += other.m_Counts[i];
+		}
+		m_nCount += other.m_nCount;
+		m_nSum += other.m_nSum;
+		m_nMin = MIN( m_nMin, other.m_nMin );
+		m_nMax = MAX( m_nMax, other.m_nMax );
+	}
+
+	uint64 Count() const					{ return m_nCount; }
+	uint32 Min() const						{ return m_nCount ? m_nMin : 0; }
+	uint32 Max() const						{ return m_nMax; }
+	double Mean() const						{ return m_nCount ? (double)m_nSum / (double)m_nCount : 0.0; }
+
+	// Smallest value that flPercent (0-100) of the recorded values are at or
+	// below, rounded up to the edge of its bucket
+	uint32 Percentile( float flPercent ) const
+	{
+		if ( !m_nCount )
+			return 0;
+
+		uint64 nTarget = (uint64)( (double)flPercent * 0.01 * (double)m_nCount + 0.5 );
+		nTarget = MAX( nTarget, (uint64)1 );
+
+		uint64 nSeen = 0;
+		for ( int i = 0; i < NUM_BUCKETS; i++ )
+		{
+			nSeen += m_Counts[i];
+			if ( nSeen >= nTarget )
+			{
+				return MAX( m_nMin, MIN( BucketHighValue( i ), m_nMax ) );
+			}
+		}
+		return m_nMax;
+	}
+
+	uint32 BucketCount( int nBucket ) const	{ return m_Counts[nBucket]; }
+
+	static int BucketForValue( uint32 nValue )
+	{
+		if ( nValue < SUB_BUCKETS )
+			return nValue;
+
+		int nMagnitude = HighestBit( nValue );
+		int nSub = ( nValue >> ( nMagnitude - SUB_BUCKET_BITS ) ) & ( SUB_BUCKETS - 1 );
+		return SUB_BUCKETS + ( nMagnitude - SUB_BUCKET_BITS ) * SUB_BUCKETS + nSub;
+	}
+
+	static uint32 BucketLowValue( int nBucket )
+	{
+		if ( nBucket < SUB_BUCKETS )
+			return nBucket;
+
+		int nMagnitude = ( nBucket - SUB_BUCKETS ) / SUB_BUCKETS + SUB_BUCKET_BITS;
+		int nSub = ( nBucket - SUB_BUCKETS ) % SUB_BUCKETS;
+		return (uint32)( SUB_BUCKETS + nSub ) << ( nMagnitude - SUB_BUCKET_BITS );
+	}
+
+	static uint32 BucketHighValue( int nBucket )
+	{
+		if ( nBucket < SUB_BUCKETS )
+			return nBucket;
+
+		int nMagnitude = ( nBucket - SUB_BUCKETS ) / SUB_BUCKETS + SUB_BUCKET_BITS;
+		return BucketLowValue( nBucket ) + ( ( 1u << ( nMagnitude - SUB_BUCKET_BITS ) ) - 1 );
+	}
+
+private:
+	static int HighestBit( uint32 nValue )
+	{
+		Assert( nValue );
+#if defined( _WIN32 )
+		unsigned long nBit;
+		_BitScanReverse( &nBit, nValue );
+		return (int)nBit;
+#else
+		return 31 - __builtin_clz( nValue );
+#endif
+	}
+
+	uint32 m_Counts[NUM_BUCKETS];
+	uint64 m_nCount;
+	uint64 m_nSum;
+	uint32 m_nMin;
+	uint32 m_nMax;
+};
+
+#endif // HDRHISTOGRAM_H
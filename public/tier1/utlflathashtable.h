@@ -0,0 +1,501 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: a flat open-addressing hashtable that probes a whole group of
+// slots at a time using a parallel array of one-byte control values.
+//
+// Usage notes:
+// - same Find/Insert/Remove/iteration API as CUtlHashtable, and the same
+//   functor template parameters, so switching between them is mechanical
+// - handles are stable across removal of OTHER elements, but NOT across
+//   insertion; an insertion that grows the table moves every element.
+// - removing while iterating is fine with RemoveAndAdvance() or
+//   RemoveByHandle() followed by NextHandle()
+// - a value type of "empty_t" can be used to eliminate value storage and
+//   switch Element() to return const Key references instead of values
+// - not thread safe
+//
+// Implementation notes:
+// - every slot has a control byte: EMPTY, DELETED, or the low 7 bits of
+//   the key's hash when the slot is in use
+// - slots are grouped (16 with SSE2, 8 otherwise) and a lookup compares
+//   the 7 hash bits against the whole group's control bytes at once,
+//   so the key comparison only runs on likely matches
+// - groups are probed with a triangular sequence over a power of two
+//   group count, which visits every group
+// - a lookup stops at the first group containing an EMPTY slot; removal
+//   leaves a DELETED tombstone only if its group has no EMPTY slot
+// - the table grows once 7/8 of its slots have been used, or is rebuilt
+//   in place if most of those slots are tombstones
+//
+// CUtlFlatHashtable< uint32 >       setOfIntegers;
+// CUtlFlatHashtable< const char*, int, CaselessStringHashFunctor, CaselessStringEqualFunctor > mapFromNames;
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#ifndef UTLFLATHASHTABLE_H
+#define UTLFLATHASHTABLE_H
+#pragma once
+
+#include "strtools.h"
+#include "utlcommon.h"
+#include "utlmemory.h"
+#include "mathlib/mathlib.h"
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define UTLFLATHASH_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined( _MSC_VER )
+#include <intrin.h>
+#endif
+
+typedef unsigned int UtlFlatHashHandle_t;
+
+#define FOR_EACH_FLATHASHTABLE( table, iter ) \
+	for ( UtlFlatHashHandle_t iter = (table).FirstHandle(); iter != (table).InvalidHandle(); iter = (table).NextHandle( iter ) )
+
+
+//-----------------------------------------------------------------------------
+// A group of control bytes, and the bitmask of slots in it matching a test.
+// With SSE2 there's one mask bit per slot, otherwise the top bit of each
+// byte is used (SWAR), and LowestIndex() shifts that back to a slot index.
+//-----------------------------------------------------------------------------
+class CUtlFlatHashGroup
+{
+public:
+	enum
+	{
+		CTRL_EMPTY = 0x80,
+		CTRL_DELETED = 0xFE,
+		CTRL_HASH_MASK = 0x7F,	// in use slots have the high bit clear
+	};
+
+#ifdef UTLFLATHASH_SSE2
+	enum { WIDTH = 16, MASK_SHIFT = 0 };
+
+	explicit CUtlFlatHashGroup( const uint8 *pCtrl ) { m_ctrl = _mm_loadu_si128( (const __m128i *)pCtrl ); }
+
+	uint64 Match( uint8 h2 ) const			{ return (uint32)_mm_movemask_epi8( _mm_cmpeq_epi8( m_ctrl, _mm_set1_epi8( (char)h2 ) ) ); }
+	uint64 MatchEmpty() const				{ return (uint32)_mm_movemask_epi8( _mm_cmpeq_epi8( m_ctrl, _mm_set1_epi8( (char)CTRL_EMPTY ) ) ); }
+	uint64 MatchEmptyOrDeleted() const		{ return (uint32)_mm_movemask_epi8( m_ctrl ); }
+
+private:
+	__m128i m_ctrl;
+#else
+	enum { WIDTH = 8, MASK_SHIFT = 3 };
+
+	explicit CUtlFlatHashGroup( const uint8 *pCtrl ) { memcpy( &m_ctrl, pCtrl, sizeof( m_ctrl ) ); m_ctrl = LittleQWord( m_ctrl ); }
+
+	// Can report false positives in the byte after a real match, which is
+	// harmless since the caller compares keys anyway
+	uint64 Match( uint8 h2 ) const
+	{
+		uint64 x = m_ctrl ^ ( LSBS * h2 );
+		return ( x - LSBS ) & ~x & MSBS;
+	}
+	// EMPTY is the only control value with the high bit set and bit 1 clear
+	uint64 MatchEmpty() const				{ return m_ctrl & ~( m_ctrl << 6 ) & MSBS; }
+	uint64 MatchEmptyOrDeleted() const		{ return m_ctrl & MSBS; }
+
+private:
+	static const uint64 LSBS = 0x0101010101010101ull;
+	static const uint64 MSBS = 0x8080808080808080ull;
+	uint64 m_ctrl;
+#endif
+
+public:
+	// Index of the lowest slot set in a non-zero mask
+	static FORCEINLINE int LowestIndex( uint64 mask )
+	{
+		Assert( mask != 0 );
+#if defined( _MSC_VER ) && defined( _WIN64 )
+		unsigned long nBit;
+		_BitScanForward64( &nBit, mask );
+		return (int)nBit >> MASK_SHIFT;
+#elif defined( _MSC_VER )
+		unsigned long nBit;
+		if ( !_BitScanForward( &nBit, (uint32)mask ) )
+		{
+			_BitScanForward( &nBit, (uint32)( mask >> 32 ) );
+			nBit += 32;
+		}
+		return (int)nBit >> MASK_SHIFT;
+#else
+		return __builtin_ctzll( mask ) >> MASK_SHIFT;
+#endif
+	}
+};
+
+
+template <typename KeyT, typename ValueT = empty_t, typename KeyHashT = DefaultHashFunctor<KeyT>, typename KeyIsEqualT = DefaultEqualFunctor<KeyT>, typename AlternateKeyT = typename ArgumentTypeInfo<KeyT>::Alt_t >
+class CUtlFlatHashtable
+{
+public:
+	typedef UtlFlatHashHandle_t handle_t;
+
+protected:
+	typedef CUtlKeyValuePair<KeyT, ValueT> KVPair;
+	typedef typename ArgumentTypeInfo<KeyT>::Arg_t KeyArg_t;
+	typedef typename ArgumentTypeInfo<ValueT>::Arg_t ValueArg_t;
+	typedef typename ArgumentTypeInfo<AlternateKeyT>::Arg_t KeyAlt_t;
+
+	enum
+	{
+		GROUP_WIDTH = CUtlFlatHashGroup::WIDTH,
+		CTRL_EMPTY = CUtlFlatHashGroup::CTRL_EMPTY,
+		CTRL_DELETED = CUtlFlatHashGroup::CTRL_DELETED,
+	};
+
+	// Control bytes and slots are allocated separately so a probe only
+	// touches the slots whose control byte matched
+	CUtlMemory< uint8 > m_ctrl;
+	CUtlMemory< KVPair > m_slots;
+	int m_nUsed;
+	int m_nGrowthLeft;		// slots that can still go from EMPTY to in use before growing
+	int m_nMinSize;
+	KeyIsEqualT m_eq;
+	KeyHashT m_hash;
+
+	// The hash functors in utlcommon.h aren't all well mixed in the low
+	// bits, so run a cheap finalizer before splitting the hash in two
+	static FORCEINLINE uint32 MixHash( uint32 h )
+	{
+		h ^= h >> 16;
+		h *= 0x85ebca6b;
+		h ^= h >> 13;
+		return h;
+	}
+	static FORCEINLINE uint8 H2( uint32 h ) { return (uint8)( h & CUtlFlatHashGroup::CTRL_HASH_MASK ); }
+	static FORCEINLINE uint32 H1( uint32 h ) { return h >> 7; }
+
+	int Capacity() const { return m_ctrl.Count(); }
+	int NumGroups() const { return m_ctrl.Count() / GROUP_WIDTH; }
+	bool IsFull( int idx ) const { return ( m_ctrl[idx] & CTRL_EMPTY ) == 0; }
+
+	// Allocate an empty table and then re-insert all existing entries
+	void DoRealloc( int size );
+
+	// Returns the first EMPTY or DELETED slot in the probe sequence for a hash
+	int FindFreeSlot( uint32 h ) const;
+
+	template <typename KeyParamT> handle_t DoLookup( KeyParamT k, uint32 h ) const;
+	template <typename KeyParamT> handle_t DoInsertUnconstructed( KeyParamT k, uint32 h, bool *pDidInsert );
+	void DoRemoveByHandle( handle_t idx );
+
+public:
+	explicit CUtlFlatHashtable( int minimumSize = 32 )
+		: m_nUsed(0), m_nGrowthLeft(0), m_nMinSize(MAX(GROUP_WIDTH, minimumSize)), m_eq(), m_hash() { }
+
+	CUtlFlatHashtable( int minimumSize, const KeyHashT &hash, KeyIsEqualT const &eq = KeyIsEqualT() )
+		: m_nUsed(0), m_nGrowthLeft(0), m_nMinSize(MAX(GROUP_WIDTH, minimumSize)), m_eq(eq), m_hash(hash) { }
+
+	~CUtlFlatHashtable() { Purge(); }
+
+	// Functor/function-pointer access
+	KeyHashT& GetHashRef() { return m_hash; }
+	KeyIsEqualT& GetEqualRef() { return m_eq; }
+	KeyHashT const &GetHashRef() const { return m_hash; }
+	KeyIsEqualT const &GetEqualRef() const { return m_eq; }
+
+	// Handle validation
+	bool IsValidHandle( handle_t idx ) const { return (unsigned)idx < (unsigned)Capacity() && IsFull( idx ); }
+	static handle_t InvalidHandle() { return (handle_t) -1; }
+
+	// Iteration functions
+	handle_t FirstHandle() const { return NextHandle( (handle_t) -1 ); }
+	handle_t NextHandle( handle_t start ) const;
+
+	// Returns the number of unique keys in the table
+	int Count() const { return m_nUsed; }
+
+	// Key lookup, returns InvalidHandle() if not found
+	handle_t Find( KeyArg_t k ) const { return DoLookup<KeyArg_t>( k, m_hash(k) ); }
+	handle_t Find( KeyArg_t k, unsigned int hash ) const { Assert( hash == m_hash(k) ); return DoLookup<KeyArg_t>( k, hash ); }
+	// Alternate-type key lookup, returns InvalidHandle() if not found
+	handle_t Find( KeyAlt_t k ) const { return DoLookup<KeyAlt_t>( k, m_hash(k) ); }
+	handle_t Find( KeyAlt_t k, unsigned int hash ) const { Assert( hash == m_hash(k) ); return DoLookup<KeyAlt_t>( k, hash ); }
+
+	// True if the key is in the table
+	bool HasElement( KeyArg_t k ) const { return InvalidHandle() != Find( k ); }
+	bool HasElement( KeyAlt_t k ) const { return InvalidHandle() != Find( k ); }
+
+	// Key insertion or lookup, always returns a valid handle
+	handle_t Insert( KeyArg_t k ) { return DoInsert<KeyArg_t>( k, m_hash(k) ); }
+	handle_t Insert( KeyArg_t k, ValueArg_t v, bool *pDidInsert = NULL ) { return DoInsert<KeyArg_t>( k, v, m_hash(k), pDidInsert ); }
+	handle_t Insert( KeyArg_t k, ValueArg_t v, unsigned int hash, bool *pDidInsert = NULL ) { Assert( hash == m_hash(k) ); return DoInsert<KeyArg_t>( k, v, hash, pDidInsert ); }
+	// Alternate-type key insertion or lookup, always returns a valid handle
+	handle_t Insert( KeyAlt_t k ) { return DoInsert<KeyAlt_t>( k, m_hash(k) ); }
+	handle_t Insert( KeyAlt_t k, ValueArg_t v, bool *pDidInsert = NULL ) { return DoInsert<KeyAlt_t>( k, v, m_hash(k), pDidInsert ); }
+	handle_t Insert( KeyAlt_t k, ValueArg_t v, unsigned int hash, bool *pDidInsert = NULL ) { Assert( hash == m_hash(k) ); return DoInsert<KeyAlt_t>( k, v, hash, pDidInsert ); }
+
+	// Key removal, returns false if not found
+	bool Remove( KeyArg_t k ) { handle_t idx = Find( k ); if ( idx == InvalidHandle() ) return false; DoRemoveByHandle( idx ); return true; }
+	bool Remove( KeyAlt_t k ) { handle_t idx = Find( k ); if ( idx == InvalidHandle() ) return false; DoRemoveByHandle( idx ); return true; }
+
+	// Remove while iterating, returns the next handle for forward iteration
+	handle_t RemoveAndAdvance( handle_t idx ) { DoRemoveByHandle( idx ); return NextHandle( idx ); }
+
+	// Remove by handle. Other handles stay valid.
+	void RemoveByHandle( handle_t idx ) { DoRemoveByHandle( idx ); }
+
+	// Nuke contents
+	void RemoveAll();
+
+	// Nuke and release memory.
+	void Purge() { RemoveAll(); m_ctrl.Purge(); m_slots.Purge(); m_nGrowthLeft = 0; }
+
+	// Reserve table capacity up front to avoid reallocation during insertions
+	void Reserve( int expected ) { if ( expected > m_nUsed + m_nGrowthLeft ) DoRealloc( expected * 8 / 7 + 1 ); }
+
+	// Access functions. Note: if ValueT is empty_t, all functions return const keys.
+	typedef typename KVPair::ValueReturn_t Element_t;
+	KeyT const &Key( handle_t idx ) const { Assert( IsValidHandle( idx ) ); return m_slots[idx].m_key; }
+	Element_t const &Element( handle_t idx ) const { Assert( IsValidHandle( idx ) ); return m_slots[idx].GetValue(); }
+	Element_t &Element( handle_t idx ) { Assert( IsValidHandle( idx ) ); return m_slots[idx].GetValue(); }
+	Element_t const &operator[]( handle_t idx ) const { return Element( idx ); }
+	Element_t &operator[]( handle_t idx ) { return Element( idx ); }
+
+	Element_t const &Get( KeyArg_t k, Element_t const &defaultValue ) const { handle_t h = Find( k ); if ( h != InvalidHandle() ) return Element( h ); return defaultValue; }
+	Element_t const &Get( KeyAlt_t k, Element_t const &defaultValue ) const { handle_t h = Find( k ); if ( h != InvalidHandle() ) return Element( h ); return defaultValue; }
+
+	Element_t const *GetPtr( KeyArg_t k ) const { handle_t h = Find( k ); if ( h != InvalidHandle() ) return &Element( h ); return NULL; }
+	Element_t const *GetPtr( KeyAlt_t k ) const { handle_t h = Find( k ); if ( h != InvalidHandle() ) return &Element( h ); return NULL; }
+	Element_t *GetPtr( KeyArg_t k ) { handle_t h = Find( k ); if ( h != InvalidHandle() ) return &Element( h ); return NULL; }
+	Element_t *GetPtr( KeyAlt_t k ) { handle_t h = Find( k ); if ( h != InvalidHandle() ) return &Element( h ); return NULL; }
+
+	// Swap memory and contents with another identical hashtable
+	// (NOTE: if using function pointers or functors with state,
+	//  it is up to the caller to ensure that they are compatible!)
+	void Swap( CUtlFlatHashtable &other )
+	{
+		m_ctrl.Swap( other.m_ctrl ); m_slots.Swap( other.m_slots );
+		::V_swap( m_nUsed, other.m_nUsed ); ::V_swap( m_nGrowthLeft, other.m_nGrowthLeft );
+	}
+
+	// GetMemoryUsage returns all memory held by this class
+	// and its held classes.  It does not include sizeof(*this).
+	size_t GetMemoryUsage() const { return m_ctrl.Count() * ( sizeof( uint8 ) + sizeof( KVPair ) ); }
+
+private:
+	template <typename KeyParamT> handle_t DoInsert( KeyParamT k, unsigned int h );
+	template <typename KeyParamT> handle_t DoInsert( KeyParamT k, ValueArg_t v, unsigned int h, bool *pDidInsert );
+
+	CUtlFlatHashtable( const CUtlFlatHashtable& copyConstructorIsNotImplemented );
+	CUtlFlatHashtable &operator=( const CUtlFlatHashtable& assignmentIsNotImplemented );
+};
+
+
+// Allocate an empty table and then re-insert all existing entries.
+template <typename KeyT, typename ValueT, typename KeyHashT, typename KeyIsEqualT, typename AltKeyT>
+void CUtlFlatHashtable<KeyT, ValueT, KeyHashT, KeyIsEqualT, AltKeyT>::DoRealloc( int size )
+{
+	// Keep the table at or below 7/8 full
+	size = MAX( size, m_nUsed + m_nUsed / 7 + 1 );
+	size = SmallestPowerOfTwoGreaterOrEqual( MAX( m_nMinSize, size ) );
+	Assert( size >= GROUP_WIDTH && size > m_nUsed );
+
+	CUtlMemory< uint8 > oldCtrl;
+	CUtlMemory< KVPair > oldSlots;
+	oldCtrl.Swap( m_ctrl );
+	oldSlots.Swap( m_slots );
+
+	m_ctrl.EnsureCapacity( size );
+	m_slots.EnsureCapacity( size );
+	memset( m_ctrl.Base(), CTRL_EMPTY, size );
+	m_nGrowthLeft = size - size / 8 - m_nUsed;
+
+	const uint8 * RESTRICT const pOldCtrl = oldCtrl.Base();
+	KVPair * RESTRICT const pOldSlots = oldSlots.Base();
+	for ( int i = 0; i < oldCtrl.Count(); ++i )
+	{
+		if ( pOldCtrl[i] & CTRL_EMPTY )
+			continue;
+
+		uint32 h = MixHash( m_hash( pOldSlots[i].m_key ) );
+		int newIdx = FindFreeSlot( h );
+		m_ctrl[newIdx] = H2( h );
+		CopyConstruct( &m_slots[newIdx], pOldSlots[i] );
+		Destruct( &pOldSlots[i] );
+	}
+}
+
+
+// Returns the first EMPTY or DELETED slot in the probe sequence for a hash
+template <typename KeyT, typename ValueT, typename KeyHashT, typename KeyIsEqualT, typename AltKeyT>
+int CUtlFlatHashtable<KeyT, ValueT, KeyHashT, KeyIsEqualT, AltKeyT>::FindFreeSlot( uint32 h ) const
+{
+	const uint32 groupmask = NumGroups() - 1;
+	uint32 group = H1( h ) & groupmask;
+	for ( uint32 step = 1; ; ++step )
+	{
+		CUtlFlatHashGroup g( m_ctrl.Base() + group * GROUP_WIDTH );
+		uint64 mask = g.MatchEmptyOrDeleted();
+		if ( mask )
+			return group * GROUP_WIDTH + CUtlFlatHashGroup::LowestIndex( mask );
+
+		Assert( step <= groupmask + 1 );
+		group = ( group + step ) & groupmask;
+	}
+}
+
+
+// Key lookup
+template <typename KeyT, typename ValueT, typename KeyHashT, typename KeyIsEqualT, typename AltKeyT>
+template <typename KeyParamT>
+UtlFlatHashHandle_t CUtlFlatHashtable<KeyT, ValueT, KeyHashT, KeyIsEqualT, AltKeyT>::DoLookup( KeyParamT k, uint32 h ) const
+{
+	if ( m_nUsed == 0 )
+		return InvalidHandle();
+
+	h = MixHash( h );
+	const uint8 h2 = H2( h );
+	const uint8 *pCtrl = m_ctrl.Base();
+	const KVPair *pSlots = m_slots.Base();
+	const uint32 groupmask = NumGroups() - 1;
+	uint32 group = H1( h ) & groupmask;
+	for ( uint32 step = 1; ; ++step )
+	{
+		const uint32 base = group * GROUP_WIDTH;
+		CUtlFlatHashGroup g( pCtrl + base );
+		for ( uint64 mask = g.Match( h2 ); mask; mask &= mask - 1 )
+		{
+			uint32 idx = base + CUtlFlatHashGroup::LowestIndex( mask );
+			if ( m_eq( pSlots[idx].m_key, k ) )
+				return idx;
+		}
+
+		if ( g.MatchEmpty() || step > groupmask )
+			return InvalidHandle();
+
+		group = ( group + step ) & groupmask;
+	}
+}
+
+
+// Finds the key, or claims a slot for it without constructing anything there
+template <typename KeyT, typename ValueT, typename KeyHashT, typename KeyIsEqualT, typename AltKeyT>
+template <typename KeyParamT>
+UtlFlatHashHandle_t CUtlFlatHashtable<KeyT, ValueT, KeyHashT, KeyIsEqualT, AltKeyT>::DoInsertUnconstructed( KeyParamT k, uint32 h, bool *pDidInsert )
+{
+	handle_t existing = DoLookup<KeyParamT>( k, h );
+	if ( existing != InvalidHandle() )
+	{
+		*pDidInsert = false;
+		return existing;
+	}
+
+	h = MixHash( h );
+	int idx = Capacity() ? FindFreeSlot( h ) : -1;
+	if ( idx < 0 || ( m_nGrowthLeft == 0 && m_ctrl[idx] == CTRL_EMPTY ) )
+	{
+		// Out of room. If tombstones are what's using it up, rebuild at
+		// the same size, otherwise double.
+		int nCapacity = Capacity();
+		DoRealloc( m_nUsed * 16 < nCapacity * 7 ? nCapacity : nCapacity * 2 );
+		idx = FindFreeSlot( h );
+	}
+
+	if ( m_ctrl[idx] == CTRL_EMPTY )
+	{
+		--m_nGrowthLeft;
+	}
+	m_ctrl[idx] = H2( h );
+	++m_nUsed;
+	*pDidInsert = true;
+	return idx;
+}
+
+
+// Key insertion, or return index of existing key if found
+template <typename KeyT, typename ValueT, typename KeyHashT, typename KeyIsEqualT, typename AltKeyT>
+template <typename KeyParamT>
+UtlFlatHashHandle_t CUtlFlatHashtable<KeyT, ValueT, KeyHashT, KeyIsEqualT, AltKeyT>::DoInsert( KeyParamT k, unsigned int h )
+{
+	bool bDidInsert;
+	handle_t idx = DoInsertUnconstructed<KeyParamT>( k, h, &bDidInsert );
+	if ( bDidInsert )
+	{
+		ConstructOneArg( &m_slots[idx], k );
+	}
+	return idx;
+}
+
+// Key insertion, or return index of existing key if found
+template <typename KeyT, typename ValueT, typename KeyHashT, typename KeyIsEqualT, typename AltKeyT>
+template <typename KeyParamT>
+UtlFlatHashHandle_t CUtlFlatHashtable<KeyT, ValueT, KeyHashT, KeyIsEqualT, AltKeyT>::DoInsert( KeyParamT k, ValueArg_t v, unsigned int h, bool *pDidInsert )
+{
+	bool bDidInsert;
+	handle_t idx = DoInsertUnconstructed<KeyParamT>( k, h, &bDidInsert );
+	if ( bDidInsert )
+	{
+		ConstructTwoArg( &m_slots[idx], k, v );
+	}
+	if ( pDidInsert ) *pDidInsert = bDidInsert;
+	return idx;
+}
+
+
+// Remove by handle
+template <typename KeyT, typename ValueT, typename KeyHashT, typename KeyIsEqualT, typename AltKeyT>
+void CUtlFlatHashtable<KeyT, ValueT, KeyHashT, KeyIsEqualT, AltKeyT>::DoRemoveByHandle( handle_t idx )
+{
+	Assert( IsValidHandle( idx ) );
+	Destruct( &m_slots[idx] );
+	--m_nUsed;
+
+	// If the group still has an EMPTY slot, no lookup has ever needed to
+	// probe past it and the slot can go straight back to EMPTY
+	CUtlFlatHashGroup g( m_ctrl.Base() + ( idx & ~( GROUP_WIDTH - 1 ) ) );
+	if ( g.MatchEmpty() )
+	{
+		m_ctrl[idx] = CTRL_EMPTY;
+		++m_nGrowthLeft;
+	}
+	else
+	{
+		m_ctrl[idx] = CTRL_DELETED;
+	}
+}
+
+
+// Nuke contents
+template <typename KeyT, typename ValueT, typename KeyHashT, typename KeyIsEqualT, typename AltKeyT>
+void CUtlFlatHashtable<KeyT, ValueT, KeyHashT, KeyIsEqualT, AltKeyT>::RemoveAll()
+{
+	int nCapacity = Capacity();
+	for ( int i = 0; i < nCapacity && m_nUsed > 0; ++i )
+	{
+		if ( IsFull( i ) )
+		{
+			Destruct( &m_slots[i] );
+			--m_nUsed;
+		}
+	}
+	Assert( m_nUsed == 0 );
+	m_nUsed = 0;
+
+	if ( nCapacity )
+	{
+		memset( m_ctrl.Base(), CTRL_EMPTY, nCapacity );
+	}
+	m_nGrowthLeft = nCapacity - nCapacity / 8;
+}
+
+
+// Iteration
+template <typename KeyT, typename ValueT, typename KeyHashT, typename KeyIsEqualT, typename AltKeyT>
+UtlFlatHashHandle_t CUtlFlatHashtable<KeyT, ValueT, KeyHashT, KeyIsEqualT, AltKeyT>::NextHandle( handle_t start ) const
+{
+	const int nCapacity = Capacity();
+	for ( int i = (int)( start + 1 ); i < nCapacity; ++i )
+	{
+		if ( IsFull( i ) )
+			return i;
+	}
+	return InvalidHandle();
+}
+
+#endif // UTLFLATHASHTABLE_H
@@ -0,0 +1,126 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Sharded, open-addressed string intern index with lock-free lookups
+//
+// $NoKeywords: $
+//===========================================================================//
+
+#ifndef UTLSTRINGINDEXMT_H
+#define UTLSTRINGINDEXMT_H
+
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "tier0/platform.h"
+#include "tier0/threadtools.h"
+#include "tier1/utlvector.h"
+
+
+//-----------------------------------------------------------------------------
+// The index doesn't own any string memory; it maps strings to small integer
+// values handed out by the owner (a symbol id, an offset into a string
+// stack, etc.) and calls back into the owner to compare and create them.
+//-----------------------------------------------------------------------------
+abstract_class IUtlStringIndexStorage
+{
+public:
+	virtual ~IUtlStringIndexStorage() {}
+
+	// Returns the string previously stored for a value
+	virtual const char *GetIndexedString( uint32 nValue ) const = 0;
+
+	// Copies the string into permanent storage and returns its value.
+	// Called with the owning shard locked, so concurrent calls for
+	// different shards are possible. Return UTL_STRINGINDEX_INVALID on failure.
+	virtual uint32 AddIndexedString( const char *pString ) = 0;
+};
+
+#define UTL_STRINGINDEX_INVALID		((uint32)~0)
+
+
+//-----------------------------------------------------------------------------
+// CUtlStringIndexMT:
+// description:
+//    Strings are split across a fixed number of shards by hash. Each shard is
+//    an open-addressed table of 32-bit slots holding ( hash tag | value + 1 ),
+//    so a slot is written and read atomically and never changes once filled.
+//
+//    Find() never takes a lock. FindOrAdd() only locks the shard when the
+//    string is missing. When a shard grows, the old table is retired rather
+//    than freed since readers may still be probing it; retired tables are
+//    released by RemoveAll() and the destructor.
+//
+//    Values are never removed, so once a string is added its value is stable
+//    for the lifetime of the index (or until RemoveAll).
+//-----------------------------------------------------------------------------
+class CUtlStringIndexMT
+{
+public:
+	// nValueBits is how many low bits of each slot hold the value, the rest
+	// of the slot caches hash bits to reject mismatches without a strcmp.
+	CUtlStringIndexMT( IUtlStringIndexStorage *pStorage, int nValueBits, bool bCaseInsensitive, int nInitialSize = 32 );
+	~CUtlStringIndexMT();
+
+	// Hashes the string the same way the index does
+	uint32 HashString( const char *pString ) const;
+
+	// Lock-free lookup. Returns UTL_STRINGINDEX_INVALID if not present
+	uint32 Find( const char *pString ) const						{ return Find( pString, HashString( pString ) ); }
+	uint32 Find( const char *pString, uint32 nHash ) const;
+
+	// Finds the string, or adds it through the storage if missing
+	uint32 FindOrAdd( const char *pString )							{ return FindOrAdd( pString, HashString( pString ) ); }
+	uint32 FindOrAdd( const char *pString, uint32 nHash );
+
+	int Count() const;
+
+	// Not thread safe; no other thread may be using the index
+	void RemoveAll();
+
+	// Number of times an insert had to wait on a shard already locked by
+	// another thread. Useful for checking the shard count is sufficient.
+	int GetContendedLockCount() const								{ return m_nContendedLocks; }
+
+private:
+	enum
+	{
+		NUM_SHARDS_BITS = 4,
+		NUM_SHARDS = ( 1 << NUM_SHARDS_BITS ),
+	};
+
+	struct Table_t
+	{
+		uint32 m_nMask;
+		uint32 m_Slots[1];
+	};
+
+	struct Shard_t
+	{
+		Table_t * volatile m_pTable;
+		int m_nCount;
+		CThreadFastMutex m_Mutex;
+		CUtlVector< Table_t * > m_RetiredTables;
+
+		// Keep neighbouring shards' locks off each other's cache lines
+		byte m_Pad[64];
+	};
+
+	static Table_t *AllocTable( int nSize );
+	uint32 ProbeTable( const Table_t *pTable, const char *pString, uint32 nHash ) const;
+	void InsertIntoTable( Table_t *pTable, uint32 nValue, uint32 nHash );
+	void GrowShard( Shard_t &shard );
+	void FreeShardTables( Shard_t &shard );
+
+	uint32 SlotTag( uint32 nHash ) const							{ return nHash & ~m_nValueMask; }
+	bool Matches( const char *pString, uint32 nValue ) const;
+
+	IUtlStringIndexStorage *m_pStorage;
+	uint32 m_nValueMask;
+	int m_nInitialSize;
+	bool m_bCaseInsensitive;
+	CInterlockedInt m_nContendedLocks;
+	Shard_t m_Shards[NUM_SHARDS];
+};
+
+#endif // UTLSTRINGINDEXMT_H
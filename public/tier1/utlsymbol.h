@@ -20,6 +20,7 @@
 #include "tier1/utlbuffer.h"
 #include "tier1/utllinkedlist.h"
 #include "tier1/stringpool.h"
+#include "tier1/utlstringindexmt.h"
 
 
 //-----------------------------------------------------------------------------
@@ -195,59 +196,81 @@ private:
 
 };
 
-class CUtlSymbolTableMT :  public CUtlSymbolTable
+//-----------------------------------------------------------------------------
+// CUtlSymbolTableMT:
+// description:
+//    Thread-safe symbol table with the same interface as CUtlSymbolTable.
+//    Lookups of existing strings never lock; they go through a sharded
+//    open-addressed index (see CUtlStringIndexMT). Symbol ids are handed
+//    out sequentially and never change or get reused until RemoveAll.
+//-----------------------------------------------------------------------------
+class CUtlSymbolTableMT : private IUtlStringIndexStorage
 {
 public:
-	CUtlSymbolTableMT( int growSize = 0, int initSize = 32, bool caseInsensitive = false )
-		: CUtlSymbolTable( growSize, initSize, caseInsensitive )
-	{
-	}
+	CUtlSymbolTableMT( int growSize = 0, int initSize = 32, bool caseInsensitive = false );
+	~CUtlSymbolTableMT();
 
-	CUtlSymbol AddString( const char* pString )
-	{
-		m_lock.LockForWrite();
-		CUtlSymbol result = CUtlSymbolTable::AddString( pString );
-		m_lock.UnlockWrite();
-		return result;
-	}
+	// Finds and/or creates a symbol based on the string
+	CUtlSymbol AddString( const char* pString );
+
+	// Finds the symbol for pString
+	CUtlSymbol Find( const char* pString ) const;
 
-	CUtlSymbol Find( const char* pString ) const
+	// Look up the string associated with a particular symbol
+	const char* String( CUtlSymbol id ) const;
+
+	// String lookups no longer lock, these are kept for existing callers
+	const char * StringNoLock( CUtlSymbol id ) const
 	{
-		m_lock.LockForWrite();
-		CUtlSymbol result = CUtlSymbolTable::Find( pString );
-		m_lock.UnlockWrite();
-		return result;
+		return String( id );
 	}
 
-	const char* String( CUtlSymbol id ) const
+	void LockForRead()
 	{
-		m_lock.LockForRead();
-		const char *pszResult = CUtlSymbolTable::String( id );
-		m_lock.UnlockRead();
-		return pszResult;
 	}
 
-	const char * StringNoLock( CUtlSymbol id ) const
+	void UnlockForRead()
 	{
-		return CUtlSymbolTable::String( id );
 	}
 
-	void LockForRead()
+	inline bool HasElement( const char* pStr ) const
 	{
-		m_lock.LockForRead();
+		return Find( pStr ) != UTL_INVAL_SYMBOL;
 	}
 
-	void UnlockForRead()
+	int GetNumStrings( void ) const
 	{
-		m_lock.UnlockRead();
+		return m_nSymbols;
 	}
 
+	// Remove all symbols in the table. No other thread may be using the table.
+	void RemoveAll();
+
 private:
-#ifdef WIN32
-	mutable CThreadSpinRWLock m_lock;
-#else
-	mutable CThreadRWLock m_lock;
-#endif
+	enum
+	{
+		SYMBOL_PAGE_BITS = 8,
+		SYMBOL_PAGE_SIZE = ( 1 << SYMBOL_PAGE_BITS ),
+		NUM_SYMBOL_PAGES = ( ( UTL_INVAL_SYMBOL + 1 ) >> SYMBOL_PAGE_BITS ),
+	};
+
+	// IUtlStringIndexStorage
+	virtual const char *GetIndexedString( uint32 nValue ) const;
+	virtual uint32 AddIndexedString( const char *pString );
+
+	char *AllocString( int nLen );
+
+	CUtlStringIndexMT m_Index;
+
+	// Symbol id -> string, split into pages so it never needs to move
+	const char ** volatile m_pSymbolPages[NUM_SYMBOL_PAGES];
+	CInterlockedInt m_nSymbols;
+
+	// Stores the string data. Only touched while adding a new symbol
+	CThreadFastMutex m_StringPoolMutex;
+	CUtlVector< char * > m_StringPools;
+	char *m_pPoolCursor;
+	int m_nPoolSpaceLeft;
 };
 
 
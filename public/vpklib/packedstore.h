@@ -111,6 +111,9 @@ public:
 
 	FORCEINLINE void GetPackFileName( char *pchFileNameOut, int cchFileNameOut );
 
+	// Pointer to the bytes at the current position, see CPackedStore::GetDataPointer()
+	FORCEINLINE const void *GetDataPointer( int nNumBytes );
+
 };
 
 #define MAX_ARCHIVE_FILES_TO_KEEP_OPEN_AT_ONCE 512
@@ -131,9 +134,17 @@ struct FileHandleTracker_t
 	int m_nCurOfs;
 	CThreadFastMutex m_Mutex;
 
+	// The whole data file mapped read only, see CPackedStore::SetMapDataFiles()
+	const uint8 * volatile m_pMappedData;
+	int64 m_nMappedSize;
+	bool m_bMapAttempted;
+
 	FileHandleTracker_t( void )
 	{
 		m_nFileNumber = -1;
+		m_pMappedData = NULL;
+		m_nMappedSize = 0;
+		m_bMapAttempted = false;
 	}
 };
 
@@ -293,6 +304,24 @@ public:
 
 	int ReadData( CPackedStoreFileHandle &handle, void *pOutData, int nNumBytes );
 
+	// Where byte nOffset of an open file lives in its data file, for callers
+	// issuing their own reads. Returns false for bytes preloaded into the
+	// directory. Such reads bypass the read cache and its chunk hash checks.
+	bool GetDataFileRange( CPackedStoreFileHandle &handle, int nOffset, PackDataFileHandle_t &hDataFile, int64 &nDataFileOffset );
+
+	// Map data files into memory rather than reading them through the read
+	// cache. Off by default; meant for servers with the content on fast local
+	// disks, where the page cache does the read cache's job. Mapped reads skip
+	// the chunk hash checks, like GetDataFileRange().
+	void SetMapDataFiles( bool bMap ) { m_bMapDataFiles = bMap; }
+	bool IsMappingDataFiles() const { return m_bMapDataFiles; }
+
+	// Returns a pointer to nNumBytes of an open file starting at nOffset,
+	// valid for the lifetime of the store, or NULL if the range isn't in
+	// memory: it spans the preload bytes and the data file, or the data file
+	// isn't mapped.
+	const void *GetDataPointer( CPackedStoreFileHandle &handle, int nOffset, int nNumBytes );
+
 	~CPackedStore( void );
 
 	FORCEINLINE void *DirectoryData( void )
@@ -321,7 +350,11 @@ public:
 	void HashEverything();
 
 	/// Hash all chunk files.  Don't forget to rehash the metadata afterwords!
-	void HashAllChunkFiles();
+	/// Fractions are hashed on several threads. If a cache file is given,
+	/// chunk files with the same size and modification time as when it was
+	/// written reuse its hashes, and it's rewritten afterwards. Returns the
+	/// number of chunk files that were actually read.
+	int HashAllChunkFiles( const char *pszHashCacheFile = NULL, const char *pszHashCachePathID = NULL );
 
 	/// Hash all the metadata.  (Everything that's not in the chunk files)
 	void HashMetadata();
@@ -382,6 +415,12 @@ public:
 
 	void SetUseDirFile() { m_bUseDirFile = true; }
 
+	// Write() appends a perfect hash index of the directory unless this is
+	// turned off. Readers that find one look files up with it instead of
+	// building hash tables over the whole directory.
+	void SetWriteDirectoryIndex( bool bWrite ) { m_bWriteDirectoryIndex = bWrite; }
+	bool HasDirectoryIndex() const { return m_pDirectoryIndex != NULL; }
+
 	int m_PackFileID;
 private:
 	char m_pszFileBaseName[MAX_PATH];
@@ -389,10 +428,12 @@ private:
 	int m_nDirectoryDataSize;
 	int m_nWriteChunkSize;
 	bool m_bUseDirFile;
+	bool m_bWriteDirectoryIndex;
 
 	IBaseFileSystem *m_pFileSystem;
 	IThreadedFileMD5Processor *m_pFileTracker;
 	CThreadFastMutex m_Mutex;
+	bool m_bMapDataFiles;
 	
 	CPackedStoreReadCache m_PackedStoreReadCache;
 
@@ -434,7 +475,24 @@ private:
 
 	void BuildHashTables( void );
 
+	// The perfect hash index read from the directory file, see packedstore_internal.h.
+	// Either mapped straight from the file or read into m_DirectoryIndexData.
+	const uint8 *m_pDirectoryIndex;
+	CUtlVector<uint8> m_DirectoryIndexData;
+	void *m_pDirectoryIndexMapping;
+	size_t m_nDirectoryIndexMappingSize;
+
+	bool LoadDirectoryIndex( char const *pszDirFileName, class CInputFile &dirFile, int nSectionsEnd );
+	void DiscardDirectoryIndex( void );
+	struct CFileHeaderFixedData *FindFileEntryInIndex( char const *pDirname, char const *pBaseName, char const *pExtension, uint8 **pNameBaseOut );
+	void WriteDirectoryIndex( CUtlBuffer &buf );
+
 	FileHandleTracker_t &GetFileHandle( int nFileNumber );
+	const uint8 *GetMappedDataFile( FileHandleTracker_t &fHandle );
+
+	void HashChunkFraction( ChunkHashFraction_t &fraction );
+	void HashChunkFractions( CUtlVector<ChunkHashFraction_t> &fractions );
+	int64 GetDataFileOffset( CPackedStoreFileHandle &handle, int nOffset ) const;
 
 	void CloseWriteHandle( void );
 
@@ -453,6 +511,11 @@ FORCEINLINE int CPackedStoreFileHandle::Read( void *pOutData, int nNumBytes )
 	return m_pOwner->ReadData( *this, pOutData, nNumBytes );
 }
 
+FORCEINLINE const void *CPackedStoreFileHandle::GetDataPointer( int nNumBytes )
+{
+	return m_pOwner->GetDataPointer( *this, m_nCurrentFileOffset, nNumBytes );
+}
+
 FORCEINLINE void CPackedStoreFileHandle::GetPackFileName( char *pchFileNameOut, int cchFileNameOut )
 {
 	m_pOwner->GetPackFileName( *this, pchFileNameOut, cchFileNameOut );
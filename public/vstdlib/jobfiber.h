@@ -0,0 +1,146 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose:	Jobs that run on their own stack and can suspend mid-execution.
+//
+//			A CFiberJob is added to a thread pool like any other CJob, but
+//			its body runs on a separate stack (a fiber). When the body needs
+//			to wait for another job or an event, it calls one of the Yield
+//			functions below instead of blocking: the fiber is switched out,
+//			the worker thread goes back to servicing the queue, and the job
+//			is put back in the pool once the wait is satisfied. It may then
+//			resume on any worker thread. A wait that is already satisfied
+//			once the fiber has switched out (or a yield with no queued jobs
+//			to make way for) resumes straight away on the same worker.
+//
+//			This lets code that would otherwise be written as a callback
+//			state machine (or block a worker in WaitForFinish) be written
+//			straight-line:
+//
+//				JobStatus_t CMyLoadJob::DoFiberExecute()
+//				{
+//					CJob *pRead = StartAsyncRead( ... );
+//					FiberJob_YieldUntilFinished( pRead );	// worker is free meanwhile
+//					...
+//				}
+//
+//			Caveats:
+//			  - the fiber can migrate between threads across a yield, so
+//			    don't hold thread affine state (mutexes, thread locals) across
+//			    one
+//			  - aborting a job that has already started discards its stack
+//			    without unwinding it
+//			  - on platforms without a context switch implementation, fibers
+//			    run directly on the worker's stack and yields block
+//
+//=============================================================================
+
+#ifndef JOBFIBER_H
+#define JOBFIBER_H
+
+#if defined( _WIN32 )
+#pragma once
+#endif
+
+#include "vstdlib/jobthread.h"
+
+#define FIBERJOB_DEFAULT_STACK_SIZE		( 256 * 1024 )
+
+class CFiberJobStack;
+
+//-----------------------------------------------------------------------------
+// Base class for jobs that can yield. Derive and implement DoFiberExecute().
+// The job always goes through the pool's queue (JF_QUEUE) so that it never
+// runs inline on the thread that adds it.
+//-----------------------------------------------------------------------------
+class JOB_CLASS CFiberJob : public CJob
+{
+public:
+	CFiberJob( JobPriority_t priority = JP_NORMAL, unsigned nStackSize = FIBERJOB_DEFAULT_STACK_SIZE );
+	virtual ~CFiberJob();
+
+	// Fiber currently running on this thread, or NULL
+	static CFiberJob *GetCurrent();
+
+	// True if fibers have a real context switch on this platform
+	static bool IsSupported();
+
+	// Number of times this job has been suspended
+	int GetYieldCount() const										{ return m_nYields; }
+
+	//-----------------------------------------------------
+	// Only callable from inside DoFiberExecute()
+	//-----------------------------------------------------
+	void YieldUntilFinished( CJob *pJob );
+	void YieldUntilSet( CThreadEvent *pEvent );
+
+	// Let other queued jobs run, then continue
+	void YieldToPool();
+
+protected:
+	// The body of the job, runs on the fiber's stack
+	virtual JobStatus_t DoFiberExecute() = 0;
+
+private:
+	friend class CFiberJobScheduler;
+
+	virtual JobStatus_t DoExecute();
+
+	void Suspend();
+	bool Park();
+	static void FiberMain( CFiberJobStack *pStack );
+
+	enum FiberState_t
+	{
+		FIBER_NOT_STARTED,
+		FIBER_RUNNING,
+		FIBER_SUSPENDED,
+		FIBER_FINISHED,
+	};
+
+	CFiberJobStack *m_pStack;
+	void *m_pReturnContext;		// context of the worker that last resumed the fiber
+	unsigned m_nStackSize;
+	FiberState_t m_FiberState;
+	JobStatus_t m_FiberResult;
+	int m_nYields;
+
+	// What the fiber is waiting on while suspended
+	CJob *m_pWaitJob;
+	CThreadEvent *m_pWaitEvent;
+};
+
+//-----------------------------------------------------------------------------
+// Fiber job that runs a functor
+//-----------------------------------------------------------------------------
+class CFunctorFiberJob : public CFiberJob
+{
+public:
+	CFunctorFiberJob( CFunctor *pFunctor, const char *pszDescription = NULL, unsigned nStackSize = FIBERJOB_DEFAULT_STACK_SIZE )
+		: CFiberJob( JP_NORMAL, nStackSize ), m_pFunctor( pFunctor )
+	{
+		SetDescription( pszDescription );
+	}
+
+protected:
+	virtual JobStatus_t DoFiberExecute()
+	{
+		(*m_pFunctor)();
+		return JOB_OK;
+	}
+
+private:
+	CRefPtr<CFunctor> m_pFunctor;
+};
+
+//-----------------------------------------------------------------------------
+// Wait helpers usable from any code: if called on a fiber they suspend it,
+// otherwise they fall back to a blocking wait.
+//-----------------------------------------------------------------------------
+JOB_INTERFACE void FiberJob_YieldUntilFinished( CJob *pJob );
+JOB_INTERFACE void FiberJob_YieldUntilSet( CThreadEvent *pEvent );
+
+// Releases cached fiber stacks and stops the thread that resumes fibers
+// waiting on events. No fiber jobs may be suspended.
+JOB_INTERFACE void FiberJob_Shutdown();
+
+#endif // JOBFIBER_H
@@ -103,7 +103,7 @@ struct ThreadPoolStartParams_t
 	{
 		bExecOnThreadPoolThreadsOnly = false;
 
-		bUseAffinityTable = ( pAffinities != NULL ) && ( fDistribute == TRS_TRUE ) && ( nThreads != -1 );
+		bUseAffinityTable = ( pAffinities != NULL ) && ( fDistribute == TRS_TRUE ) && ( nThreads != (unsigned)-1 );
 		if ( bUseAffinityTable )
 		{
 			// user supplied an optional 1:1 affinity mapping to override normal distribute behavior
@@ -426,6 +426,11 @@ JOB_INTERFACE void DestroyThreadPool( IThreadPool *pPool );
 
 JOB_INTERFACE void RunThreadPoolTests();
 
+//-------------------------------------
+
+// Called when a job a suspended CFiberJob waits on finishes (see jobfiber.h)
+JOB_INTERFACE void FiberJob_NotifyJobFinished( CJob *pJob );
+
 //-----------------------------------------------------------------------------
 
 JOB_INTERFACE IThreadPool *g_pThreadPool;
@@ -447,7 +452,8 @@ public:
 		m_flags( 0 ),
 		m_pThreadPool( NULL ),
 		m_CompleteEvent( true ),
-		m_iServicingThread( -1 )
+		m_iServicingThread( -1 ),
+		m_nFinishNotify( FINISH_NOTIFY_NONE )
 	{
 		m_szDescription[ 0 ] = 0;
 	}
@@ -469,6 +475,9 @@ public:
 	int GetServiceThread() const					{ return m_iServicingThread; }
 	void ClearServiceThread()						{ m_iServicingThread = -1; }
 
+	// Pool the job was last added to, if any
+	IThreadPool *GetThreadPool() const				{ return m_pThreadPool; }
+
 	//-----------------------------------------------------
 	// Fast queries
 	//-----------------------------------------------------
@@ -496,6 +505,10 @@ public:
 	inline bool WaitForFinishAndRelease( uint32 dwTimeout = TT_INFINITE ) { if (!this) return true; bool bResult = WaitForFinish( dwTimeout); Release(); return bResult; }
 	CThreadEvent *AccessEvent()						{ return &m_CompleteEvent; }
 
+	// Asks for FiberJob_NotifyJobFinished() when the job finishes. Returns
+	// false if it already has, in which case no notification will come.
+	bool RequestFinishNotify()						{ return ( ThreadInterlockedCompareExchange( &m_nFinishNotify, FINISH_NOTIFY_REQUESTED, FINISH_NOTIFY_NONE ) != FINISH_NOTIFY_DONE ); }
+
 	//-----------------------------------------------------
 	// Perform the job
 	//-----------------------------------------------------
@@ -537,11 +550,30 @@ private:
 	CThreadEvent		m_CompleteEvent;
 	char				m_szDescription[ 32 ];
 
+	enum
+	{
+		FINISH_NOTIFY_NONE,
+		FINISH_NOTIFY_REQUESTED,
+		FINISH_NOTIFY_DONE,
+	};
+	int32 volatile		m_nFinishNotify;
+
 private:
 	//-----------------------------------------------------
 	CJob( const CJob &fromRequest );
 	void operator=(const CJob &fromRequest );
 
+	// Both sides swap the same word, so a request either sees the job
+	// finished or is seen by it
+	void SignalFinished()
+	{
+		m_CompleteEvent.Set();
+		if ( ThreadInterlockedExchange( &m_nFinishNotify, FINISH_NOTIFY_DONE ) == FINISH_NOTIFY_REQUESTED )
+		{
+			FiberJob_NotifyJobFinished( this );
+		}
+	}
+
 	virtual JobStatus_t DoExecute() = 0;
 	virtual JobStatus_t DoAbort( bool bDiscard ) { return JOB_STATUS_ABORTED; }
 	virtual void DoCleanup() {}
@@ -1251,8 +1283,14 @@ inline JobStatus_t CJob::Execute()
 			// Service it
 			m_status = JOB_STATUS_INPROGRESS;
 			result = m_status = DoExecute();
-			DoCleanup();
-			m_CompleteEvent.Set();
+
+			// A job can park itself by returning pending, it will be
+			// added to a pool again and resumed later (see CFiberJob)
+			if ( result != JOB_STATUS_PENDING )
+			{
+				DoCleanup();
+				SignalFinished();
+			}
 			break;
 		}
 
@@ -1319,7 +1357,7 @@ inline JobStatus_t CJob::Abort( bool bDiscard )
 			result = m_status = DoAbort( bDiscard );
 			if ( bDiscard )
 				DoCleanup();
-			m_CompleteEvent.Set();
+			SignalFinished();
 		}
 		break;
 
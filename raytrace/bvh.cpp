@@ -0,0 +1,639 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: bounding volume hierarchy alternative to the kd-tree, built with
+//			the surface area heuristic over binned centroids
+//
+//=============================================================================//
+
+#include "raytrace.h"
+#include "triintersect.h"
+#include "tier0/threadtools.h"
+
+// The children of a node are allowed to overlap. The nodes keep the bounds of both their
+// children, so each visit tests the 4 rays against two boxes (8 ray/box tests) and descends into
+// the nearer hit child first.
+//
+// Huge triangles (the ground, long walls) would make every box above them huge too, so before
+// building they are cut into pieces with the bounds of the part of the triangle in each piece,
+// and can end up in several leaves like in the kd-tree. Only the closest hit is kept, so testing
+// a triangle twice does no harm.
+
+#define BVH_NUM_BINS 16
+#define BVH_MAX_LEAF_TRIS 16								// never make larger leaves
+#define BVH_MAX_DEPTH 60									// median splits below this depth
+#define BVH_MAX_STACK_LEN 128
+#define BVH_MIN_THREADED_TRIS 4096							// build subtrees this big on their own
+															// thread
+#define BVH_SPLIT_FRACTION 32								// cut triangles larger than the world
+															// size over this
+#define BVH_MAX_SPLIT_DEPTH 12
+
+#define COST_OF_TRAVERSAL 75								// approximate #operations, the same
+#define COST_OF_INTERSECTION 167							// as for the kd-tree
+
+struct BVHBuildNode_t
+{
+	Vector m_Mins, m_Maxs;
+	int m_nChild[2];										// -1 for a leaf
+	int m_nFirst, m_nCount;									// range of the triangle list
+	int m_nSplitAxis;
+};
+
+struct BVHBin_t
+{
+	Vector m_Mins, m_Maxs;
+	int m_nCount;
+};
+
+struct BVHBuildState_t
+{
+	Vector *m_pTriMins;										// by reference to a (piece of a)
+	Vector *m_pTriMaxs;										// triangle
+	Vector *m_pCentroids;
+	int32 *m_pRefTris;										// the triangle of each reference
+	int32 *m_pTriList;										// references, partitioned in place
+	BVHBuildNode_t *m_pNodes;								// at most 2n-1 of them
+	int32 volatile m_nNodes;
+	int m_nThreadDepth;										// split onto threads above this depth
+};
+
+struct BVHBuildJob_t
+{
+	BVHBuildState_t *m_pState;
+	int m_nNode;
+	int m_nDepth;
+};
+
+static float BoxSurfaceArea( Vector const &boxmin, Vector const &boxmax )
+{
+	Vector boxdim = boxmax - boxmin;
+	return 2.0 * ( ( boxdim[0] * boxdim[2] ) + ( boxdim[0] * boxdim[1] ) + ( boxdim[1] * boxdim[2] ) );
+}
+
+static inline void ClearBVHBounds( Vector &mins, Vector &maxs )
+{
+	mins.Init( 1.0e23, 1.0e23, 1.0e23 );
+	maxs.Init( -1.0e23, -1.0e23, -1.0e23 );
+}
+
+static inline void AddToBVHBounds( Vector &mins, Vector &maxs, Vector const &addmins, Vector const &addmaxs )
+{
+	VectorMin( mins, addmins, mins );
+	VectorMax( maxs, addmaxs, maxs );
+}
+
+static int AllocBuildNode( BVHBuildState_t *pState, int nFirst, int nCount )
+{
+	int nNode = ThreadInterlockedIncrement( &pState->m_nNodes ) - 1;
+	BVHBuildNode_t &node = pState->m_pNodes[nNode];
+	node.m_nChild[0] = node.m_nChild[1] = -1;
+	node.m_nFirst = nFirst;
+	node.m_nCount = nCount;
+	node.m_nSplitAxis = 0;
+	ClearBVHBounds( node.m_Mins, node.m_Maxs );
+	for ( int i = nFirst; i < nFirst + nCount; i++ )
+	{
+		int t = pState->m_pTriList[i];
+		AddToBVHBounds( node.m_Mins, node.m_Maxs, pState->m_pTriMins[t], pState->m_pTriMaxs[t] );
+	}
+	return nNode;
+}
+
+static inline int CentroidBin( float flCentroid, float flMin, float flBinScale )
+{
+	int nBin = (int)( ( flCentroid - flMin ) * flBinScale );
+	return clamp( nBin, 0, BVH_NUM_BINS - 1 );
+}
+
+static uintp BuildBVHThread( void *pParam );
+
+//-----------------------------------------------------------------------------
+// Splits a node in two where the SAH cost is lowest, or makes it a leaf if
+// no split is worth it
+//-----------------------------------------------------------------------------
+static void RefineBVHNode( BVHBuildState_t *pState, int nNode, int nDepth )
+{
+	BVHBuildNode_t &node = pState->m_pNodes[nNode];
+	int32 *pTris = pState->m_pTriList + node.m_nFirst;
+	int nTris = node.m_nCount;
+	if ( nTris < 3 )
+		return;
+
+	Vector centroidMins, centroidMaxs;
+	ClearBVHBounds( centroidMins, centroidMaxs );
+	for ( int i = 0; i < nTris; i++ )
+	{
+		AddToBVHBounds( centroidMins, centroidMaxs, pState->m_pCentroids[pTris[i]], pState->m_pCentroids[pTris[i]] );
+	}
+
+	float flBestCost = 1.0e30;
+	int nBestAxis = -1;
+	int nBestBin = 0;
+	float flISA = 1.0 / MAX( BoxSurfaceArea( node.m_Mins, node.m_Maxs ), 1.0e-10f );
+	for ( int axis = 0; axis < 3; axis++ )
+	{
+		float flExtent = centroidMaxs[axis] - centroidMins[axis];
+		if ( flExtent <= 1.0e-6 )
+			continue;
+
+		float flBinScale = BVH_NUM_BINS / flExtent;
+		BVHBin_t bins[BVH_NUM_BINS];
+		for ( int b = 0; b < BVH_NUM_BINS; b++ )
+		{
+			ClearBVHBounds( bins[b].m_Mins, bins[b].m_Maxs );
+			bins[b].m_nCount = 0;
+		}
+		for ( int i = 0; i < nTris; i++ )
+		{
+			int t = pTris[i];
+			BVHBin_t &bin = bins[CentroidBin( pState->m_pCentroids[t][axis], centroidMins[axis], flBinScale )];
+			AddToBVHBounds( bin.m_Mins, bin.m_Maxs, pState->m_pTriMins[t], pState->m_pTriMaxs[t] );
+			bin.m_nCount++;
+		}
+
+		// sweep from the right to get the cost of everything right of each split, then from
+		// the left to add the left side
+		float flRightArea[BVH_NUM_BINS];
+		int nRightCount[BVH_NUM_BINS];
+		Vector mins, maxs;
+		ClearBVHBounds( mins, maxs );
+		int nCount = 0;
+		for ( int b = BVH_NUM_BINS - 1; b > 0; b-- )
+		{
+			AddToBVHBounds( mins, maxs, bins[b].m_Mins, bins[b].m_Maxs );
+			nCount += bins[b].m_nCount;
+			nRightCount[b] = nCount;
+			flRightArea[b] = nCount ? BoxSurfaceArea( mins, maxs ) : 0;
+		}
+
+		ClearBVHBounds( mins, maxs );
+		nCount = 0;
+		for ( int b = 0; b < BVH_NUM_BINS - 1; b++ )
+		{
+			AddToBVHBounds( mins, maxs, bins[b].m_Mins, bins[b].m_Maxs );
+			nCount += bins[b].m_nCount;
+			if ( !nCount || !nRightCount[b + 1] )
+				continue;
+
+			float flCost = COST_OF_TRAVERSAL + COST_OF_INTERSECTION * flISA *
+				( BoxSurfaceArea( mins, maxs ) * nCount + flRightArea[b + 1] * nRightCount[b + 1] );
+			if ( flCost < flBestCost )
+			{
+				flBestCost = flCost;
+				nBestAxis = axis;
+				nBestBin = b;
+			}
+		}
+	}
+
+	float flCostOfNoSplit = COST_OF_INTERSECTION * nTris;
+	bool bMedianSplit = ( nBestAxis < 0 ) || ( nDepth > BVH_MAX_DEPTH );
+	if ( nTris <= BVH_MAX_LEAF_TRIS && ( bMedianSplit || flCostOfNoSplit <= flBestCost ) )
+		return;
+
+	int nLeft;
+	if ( bMedianSplit )
+	{
+		// all the centroids are in the same place, or the SAH keeps peeling off a few triangles.
+		// Either way the two halves of the list will do.
+		nBestAxis = 0;
+		nLeft = nTris / 2;
+	}
+	else
+	{
+		float flBinScale = BVH_NUM_BINS / ( centroidMaxs[nBestAxis] - centroidMins[nBestAxis] );
+		int i = 0, j = nTris - 1;
+		while ( i <= j )
+		{
+			if ( CentroidBin( pState->m_pCentroids[pTris[i]][nBestAxis], centroidMins[nBestAxis], flBinScale ) <= nBestBin )
+			{
+				i++;
+			}
+			else
+			{
+				V_swap( pTris[i], pTris[j] );
+				j--;
+			}
+		}
+		nLeft = i;
+	}
+
+	node.m_nSplitAxis = nBestAxis;
+	node.m_nChild[0] = AllocBuildNode( pState, node.m_nFirst, nLeft );
+	node.m_nChild[1] = AllocBuildNode( pState, node.m_nFirst + nLeft, nTris - nLeft );
+
+	if ( nDepth < pState->m_nThreadDepth && nLeft >= BVH_MIN_THREADED_TRIS && nTris - nLeft >= BVH_MIN_THREADED_TRIS )
+	{
+		// the two halves share nothing but the node pool
+		BVHBuildJob_t job;
+		job.m_pState = pState;
+		job.m_nNode = node.m_nChild[0];
+		job.m_nDepth = nDepth + 1;
+		ThreadHandle_t hThread = CreateSimpleThread( BuildBVHThread, &job, 1024 * 1024 );
+		RefineBVHNode( pState, node.m_nChild[1], nDepth + 1 );
+		ThreadJoin( hThread );
+		ReleaseThreadHandle( hThread );
+	}
+	else
+	{
+		RefineBVHNode( pState, node.m_nChild[0], nDepth + 1 );
+		RefineBVHNode( pState, node.m_nChild[1], nDepth + 1 );
+	}
+}
+
+static uintp BuildBVHThread( void *pParam )
+{
+	BVHBuildJob_t *pJob = (BVHBuildJob_t *)pParam;
+	RefineBVHNode( pJob->m_pState, pJob->m_nNode, pJob->m_nDepth );
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Sets child c of an optimized node to a build node. The box is grown a
+// little, the slab test uses an approximate reciprocal.
+//-----------------------------------------------------------------------------
+static void SetBVHChild( CacheOptimizedBVHNode &out, int c, BVHBuildNode_t const &child )
+{
+	for ( int i = 0; i < 3; i++ )
+	{
+		float flPad = 0.01 + 1.0e-5 * MAX( fabs( child.m_Mins[i] ), fabs( child.m_Maxs[i] ) );
+		out.m_flChildMins[c][i] = child.m_Mins[i] - flPad;
+		out.m_flChildMaxs[c][i] = child.m_Maxs[i] + flPad;
+	}
+}
+
+// Writes out the children of build node nNode depth first, returns the index of the node
+static int FlattenBVHNode( RayTracingEnvironment *pEnv, BVHBuildState_t *pState, int nNode )
+{
+	BVHBuildNode_t const &node = pState->m_pNodes[nNode];
+	int nOut = pEnv->OptimizedBVH.AddToTail();
+	pEnv->OptimizedBVH[nOut].m_nSplitAxis = node.m_nSplitAxis;
+	for ( int c = 0; c < 2; c++ )
+	{
+		BVHBuildNode_t const &child = pState->m_pNodes[node.m_nChild[c]];
+		SetBVHChild( pEnv->OptimizedBVH[nOut], c, child );
+		if ( child.m_nChild[0] < 0 )
+		{
+			pEnv->OptimizedBVH[nOut].m_nChild[c] = pEnv->TriangleIndexList.Count();
+			pEnv->OptimizedBVH[nOut].m_nChildTriangles[c] = child.m_nCount;
+			for ( int i = child.m_nFirst; i < child.m_nFirst + child.m_nCount; i++ )
+				pEnv->TriangleIndexList.AddToTail( pState->m_pRefTris[pState->m_pTriList[i]] );
+		}
+		else
+		{
+			pEnv->OptimizedBVH[nOut].m_nChildTriangles[c] = 0;
+			int nChild = FlattenBVHNode( pEnv, pState, node.m_nChild[c] );
+			pEnv->OptimizedBVH[nOut].m_nChild[c] = nChild;
+		}
+	}
+	return nOut;
+}
+
+// Clips a polygon to one side of an axial plane, the side above it if bMaxSide
+static int ClipPolygonToAxialPlane( Vector const *pIn, int nIn, Vector *pOut, int axis, float flDist, bool bMaxSide )
+{
+	int nOut = 0;
+	for ( int i = 0; i < nIn; i++ )
+	{
+		Vector const &p0 = pIn[i];
+		Vector const &p1 = pIn[( i + 1 ) % nIn];
+		float d0 = bMaxSide ? p0[axis] - flDist : flDist - p0[axis];
+		float d1 = bMaxSide ? p1[axis] - flDist : flDist - p1[axis];
+		if ( d0 >= 0 )
+			pOut[nOut++] = p0;
+		if ( ( d0 >= 0 ) != ( d1 >= 0 ) )
+		{
+			Vector isect = p0 + ( d0 / ( d0 - d1 ) ) * ( p1 - p0 );
+			isect[axis] = flDist;
+			pOut[nOut++] = isect;
+		}
+	}
+	return nOut;
+}
+
+//-----------------------------------------------------------------------------
+// Adds references to the triangle for the part of it in the box, cut in half
+// until the pieces are smaller than flMaxExtent
+//-----------------------------------------------------------------------------
+static void AddTriangleRefs( CUtlVector<Vector> &refMins, CUtlVector<Vector> &refMaxs, CUtlVector<int32> &refTris,
+							 int t, Vector const *pVerts, Vector const &boxMins, Vector const &boxMaxs,
+							 float flMaxExtent, int nMaxRefs, int nDepth )
+{
+	// a triangle clipped to 6 planes has at most 9 points
+	Vector poly[2][16];
+	int nPoints = 3;
+	poly[0][0] = pVerts[0];
+	poly[0][1] = pVerts[1];
+	poly[0][2] = pVerts[2];
+	int nCur = 0;
+	for ( int axis = 0; axis < 3 && nPoints; axis++ )
+	{
+		nPoints = ClipPolygonToAxialPlane( poly[nCur], nPoints, poly[nCur ^ 1], axis, boxMins[axis], true );
+		nCur ^= 1;
+		nPoints = ClipPolygonToAxialPlane( poly[nCur], nPoints, poly[nCur ^ 1], axis, boxMaxs[axis], false );
+		nCur ^= 1;
+	}
+	if ( nPoints < 3 )
+		return;
+
+	Vector mins, maxs;
+	ClearBVHBounds( mins, maxs );
+	for ( int i = 0; i < nPoints; i++ )
+		AddToBVHBounds( mins, maxs, poly[nCur][i], poly[nCur][i] );
+
+	Vector extent = maxs - mins;
+	int nSplitAxis = ( extent.x > extent.y ) ? ( ( extent.x > extent.z ) ? 0 : 2 ) : ( ( extent.y > extent.z ) ? 1 : 2 );
+	if ( extent[nSplitAxis] <= flMaxExtent || nDepth >= BVH_MAX_SPLIT_DEPTH || refTris.Count() >= nMaxRefs )
+	{
+		refMins.AddToTail( mins );
+		refMaxs.AddToTail( maxs );
+		refTris.AddToTail( t );
+		return;
+	}
+
+	Vector halfMaxs = maxs, halfMins = mins;
+	halfMaxs[nSplitAxis] = halfMins[nSplitAxis] = 0.5 * ( mins[nSplitAxis] + maxs[nSplitAxis] );
+	AddTriangleRefs( refMins, refMaxs, refTris, t, pVerts, mins, halfMaxs, flMaxExtent, nMaxRefs, nDepth + 1 );
+	AddTriangleRefs( refMins, refMaxs, refTris, t, pVerts, halfMins, maxs, flMaxExtent, nMaxRefs, nDepth + 1 );
+}
+
+void RayTracingEnvironment::BuildBVH(void)
+{
+	int ntris = OptimizedTriangleList.Count();
+
+	Vector worldMins, worldMaxs;
+	ClearBVHBounds( worldMins, worldMaxs );
+	for ( int t = 0; t < ntris; t++ )
+	{
+		for ( int v = 0; v < 3; v++ )
+			AddToBVHBounds( worldMins, worldMaxs, OptimizedTriangleList[t].Vertex( v ), OptimizedTriangleList[t].Vertex( v ) );
+	}
+	Vector worldExtent = worldMaxs - worldMins;
+	float flMaxExtent = MAX( worldExtent.x, MAX( worldExtent.y, worldExtent.z ) ) / BVH_SPLIT_FRACTION;
+
+	// cutting up triangles at most doubles the references
+	CUtlVector<Vector> refMins, refMaxs;
+	CUtlVector<int32> refTris;
+	refMins.EnsureCapacity( ntris );
+	refMaxs.EnsureCapacity( ntris );
+	refTris.EnsureCapacity( ntris );
+	for ( int t = 0; t < ntris; t++ )
+	{
+		CacheOptimizedTriangle const &tri = OptimizedTriangleList[t];
+		Vector verts[3] = { tri.Vertex( 0 ), tri.Vertex( 1 ), tri.Vertex( 2 ) };
+		Vector mins, maxs;
+		ClearBVHBounds( mins, maxs );
+		for ( int v = 0; v < 3; v++ )
+			AddToBVHBounds( mins, maxs, verts[v], verts[v] );
+
+		Vector extent = maxs - mins;
+		if ( MAX( extent.x, MAX( extent.y, extent.z ) ) > flMaxExtent )
+		{
+			int nRefs = refTris.Count();
+			AddTriangleRefs( refMins, refMaxs, refTris, t, verts, mins, maxs, flMaxExtent, ntris * 2, 0 );
+			if ( refTris.Count() > nRefs )
+				continue;
+		}
+
+		// small, or so thin that clipping lost it
+		refMins.AddToTail( mins );
+		refMaxs.AddToTail( maxs );
+		refTris.AddToTail( t );
+	}
+	int nrefs = refTris.Count();
+
+	BVHBuildState_t state;
+	state.m_pTriMins = refMins.Base();
+	state.m_pTriMaxs = refMaxs.Base();
+	state.m_pRefTris = refTris.Base();
+	state.m_pCentroids = new Vector[nrefs];
+	state.m_pTriList = new int32[nrefs];
+	state.m_pNodes = new BVHBuildNode_t[MAX( 2 * nrefs, 1 )];
+	state.m_nNodes = 0;
+
+	// one level of threads per doubling of the cores
+	state.m_nThreadDepth = 0;
+	for ( int n = GetCPUInformation()->m_nLogicalProcessors; n > 1; n >>= 1 )
+		state.m_nThreadDepth++;
+
+	for ( int r = 0; r < nrefs; r++ )
+	{
+		state.m_pCentroids[r] = 0.5 * ( state.m_pTriMins[r] + state.m_pTriMaxs[r] );
+		state.m_pTriList[r] = r;
+	}
+
+	int nRoot = AllocBuildNode( &state, 0, nrefs );
+	RefineBVHNode( &state, nRoot, 0 );
+
+	OptimizedBVH.RemoveAll();
+	OptimizedBVH.EnsureCapacity( state.m_nNodes / 2 + 1 );
+	TriangleIndexList.RemoveAll();
+	TriangleIndexList.EnsureCapacity( nrefs );
+	BVHBuildNode_t const &root = state.m_pNodes[nRoot];
+	m_MinBound = worldMins;
+	m_MaxBound = worldMaxs;
+	if ( root.m_nChild[0] >= 0 )
+	{
+		FlattenBVHNode( this, &state, nRoot );
+	}
+	else
+	{
+		// a single leaf. give the root an empty second child that nothing can hit
+		CacheOptimizedBVHNode &out = OptimizedBVH[OptimizedBVH.AddToTail()];
+		out.m_nSplitAxis = 0;
+		SetBVHChild( out, 0, root );
+		out.m_nChild[0] = 0;
+		out.m_nChildTriangles[0] = nrefs;
+		for ( int r = 0; r < nrefs; r++ )
+			TriangleIndexList.AddToTail( refTris[state.m_pTriList[r]] );
+		for ( int i = 0; i < 3; i++ )
+		{
+			out.m_flChildMins[1][i] = 1.0e23;
+			out.m_flChildMaxs[1][i] = -1.0e23;
+		}
+		out.m_nChild[1] = -1;
+		out.m_nChildTriangles[1] = 0;
+		if ( !nrefs )
+		{
+			out.m_nChild[0] = -1;
+			out.m_flChildMins[0][0] = 1.0e23;
+			out.m_flChildMaxs[0][0] = -1.0e23;
+		}
+	}
+
+	delete[] state.m_pCentroids;
+	delete[] state.m_pTriList;
+	delete[] state.m_pNodes;
+}
+
+void RayTracingEnvironment::Trace4RaysBVH(const FourRays &rays, fltx4 TMin, fltx4 TMax,
+										  RayTracingResult *rslt_out,
+										  int32 skip_id, ITransparentTriangleCallback *pCallback)
+{
+	memset(rslt_out->HitIds,0xff,sizeof(rslt_out->HitIds));
+
+	rslt_out->HitDistance=ReplicateX4(1.0e23);
+
+	rslt_out->surface_normal.DuplicateVector(Vector(0.,0.,0.));
+	FourVectors OneOverRayDir=rays.direction;
+	OneOverRayDir.MakeReciprocalSaturate();
+
+	// the rays don't have to go the same way, the near child is picked by the first ray
+	int near_child[3];
+	for(int c=0;c<3;c++)
+		near_child[c]=( SubFloat( rays.direction[c], 0 ) < 0 ) ? 1 : 0;
+
+	int NodeStack[BVH_MAX_STACK_LEN];
+	int stack_len=0;
+	int node_number=0;
+	while(1)
+	{
+		CacheOptimizedBVHNode const &node=OptimizedBVH[node_number];
+		fltx4 far_t=MinSIMD(TMax,rslt_out->HitDistance);
+
+		// slab test against both children
+		bool bHitChild[2];
+		for(int child=0;child<2;child++)
+		{
+			fltx4 near_isect=TMin;
+			fltx4 far_isect=far_t;
+			for(int c=0;c<3;c++)
+			{
+				fltx4 isect_min_t=
+					MulSIMD(SubSIMD(ReplicateX4(node.m_flChildMins[child][c]),rays.origin[c]),OneOverRayDir[c]);
+				fltx4 isect_max_t=
+					MulSIMD(SubSIMD(ReplicateX4(node.m_flChildMaxs[child][c]),rays.origin[c]),OneOverRayDir[c]);
+				near_isect=MaxSIMD(near_isect,MinSIMD(isect_min_t,isect_max_t));
+				far_isect=MinSIMD(far_isect,MaxSIMD(isect_min_t,isect_max_t));
+			}
+			bHitChild[child]=( node.m_nChild[child] >= 0 ) && IsAnyNegative( CmpLeSIMD( near_isect, far_isect ) );
+		}
+
+		// intersect leaves right away, nearest first, so their hits can cull the rest
+		int first=near_child[node.m_nSplitAxis];
+		for(int i=0;i<2;i++)
+		{
+			int child=first^i;
+			if ( ! bHitChild[child] || ! node.IsLeaf(child) )
+				continue;
+			bHitChild[child]=false;
+			int32 const *tlist=&(TriangleIndexList[node.m_nChild[child]]);
+			for(int ntris=node.m_nChildTriangles[child];ntris;ntris--)
+			{
+				int tnum=*(tlist++);
+				TriIntersectData_t const *tri = &( OptimizedTriangleList[tnum].m_Data.m_IntersectData );
+				if ( tri->m_nTriangleID != skip_id )
+					Intersect4RaysWithTriangle( tri, tnum, rays, rslt_out, pCallback );
+			}
+		}
+
+		if ( bHitChild[first] )
+		{
+			if ( bHitChild[first^1] )
+			{
+				assert(stack_len<BVH_MAX_STACK_LEN);
+				NodeStack[stack_len++]=node.m_nChild[first^1];
+			}
+			node_number=node.m_nChild[first];
+		}
+		else if ( bHitChild[first^1] )
+		{
+			node_number=node.m_nChild[first^1];
+		}
+		else
+		{
+			if ( ! stack_len )
+				return;
+			node_number=NodeStack[--stack_len];
+		}
+	}
+}
+
+void RayTracingEnvironment::TraceRayBVH(const Vector &start, const Vector &dir, float TMax,
+										RayTracingSingleResult *rslt_out, int32 skip_id)
+{
+	rslt_out->HitID=-1;
+	rslt_out->HitDistance=1.0e23;
+	rslt_out->surface_normal.Init();
+
+	Vector OneOverRayDir;
+	for(int c=0;c<3;c++)
+		OneOverRayDir[c]=1.0 / ( ( dir[c] == 0.0f ) ? FLT_EPSILON : dir[c] );
+
+	float max_t=TMax;
+	// popped nodes are skipped if a hit closer than the node was found meanwhile
+	int NodeStack[BVH_MAX_STACK_LEN];
+	float NodeStackNear[BVH_MAX_STACK_LEN];
+	int stack_len=0;
+	int node_number=0;
+	while(1)
+	{
+		CacheOptimizedBVHNode const &node=OptimizedBVH[node_number];
+
+		float near_isect[2];
+		bool bHitChild[2];
+		for(int child=0;child<2;child++)
+		{
+			float tnear=0.0f;
+			float tfar=max_t;
+			for(int c=0;c<3;c++)
+			{
+				float t0=(node.m_flChildMins[child][c]-start[c])*OneOverRayDir[c];
+				float t1=(node.m_flChildMaxs[child][c]-start[c])*OneOverRayDir[c];
+				tnear=MAX(tnear,MIN(t0,t1));
+				tfar=MIN(tfar,MAX(t0,t1));
+			}
+			near_isect[child]=tnear;
+			bHitChild[child]=( node.m_nChild[child] >= 0 ) && ( tnear <= tfar );
+		}
+
+		int first=( near_isect[1] < near_isect[0] ) ? 1 : 0;
+		for(int i=0;i<2;i++)
+		{
+			int child=first^i;
+			if ( ! bHitChild[child] || ! node.IsLeaf(child) )
+				continue;
+			bHitChild[child]=false;
+			int32 const *tlist=&(TriangleIndexList[node.m_nChild[child]]);
+			for(int ntris=node.m_nChildTriangles[child];ntris;ntris--)
+			{
+				int tnum=*(tlist++);
+				TriIntersectData_t const *tri = &( OptimizedTriangleList[tnum].m_Data.m_IntersectData );
+				if ( tri->m_nTriangleID == skip_id )
+					continue;
+				float isect_t=IntersectRayWithTriangle( tri, start, dir, max_t );
+				if ( isect_t < max_t )
+				{
+					max_t=isect_t;
+					rslt_out->HitID=tnum;
+					rslt_out->HitDistance=isect_t;
+					rslt_out->surface_normal.Init( tri->m_flNx, tri->m_flNy, tri->m_flNz );
+				}
+			}
+		}
+
+		if ( bHitChild[first] )
+		{
+			if ( bHitChild[first^1] )
+			{
+				assert(stack_len<BVH_MAX_STACK_LEN);
+				NodeStackNear[stack_len]=near_isect[first^1];
+				NodeStack[stack_len++]=node.m_nChild[first^1];
+			}
+			node_number=node.m_nChild[first];
+		}
+		else if ( bHitChild[first^1] )
+		{
+			node_number=node.m_nChild[first^1];
+		}
+		else
+		{
+			do
+			{
+				if ( ! stack_len )
+					return;
+				node_number=NodeStack[--stack_len];
+			} while ( NodeStackNear[stack_len] > max_t );
+		}
+	}
+}
@@ -357,7 +357,18 @@ void RayTracingEnvironment::FinishRayStream(RayStream &s)
 	for(int msk=0;msk<8;msk++)
 	{
 		int cnt=s.n_in_stream[msk];
-		if (cnt)
+		if (cnt && (Flags & RTE_FLAGS_BVH))
+		{
+			// a single ray is cheaper than a packet of duplicates
+			for(int c=0;c<cnt;c++)
+			{
+				Vector start=s.PendingRays[msk].origin.Vec(c);
+				Vector end=start+s.PendingRays[msk].direction.Vec(c);
+				TraceRay(start,end,s.PendingStreamOutputs[msk][c]);
+			}
+			s.n_in_stream[msk]=0;
+		}
+		else if (cnt)
 		{
 			// fill in unfilled entries with dups of first
 			for(int c=cnt;c<4;c++)
@@ -0,0 +1,149 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: ray/triangle tests shared by the kd-tree and the BVH
+//
+//=============================================================================//
+
+#ifndef TRIINTERSECT_H
+#define TRIINTERSECT_H
+
+#include "raytrace.h"
+
+static fltx4 FourEpsilons={1.0e-10,1.0e-10,1.0e-10,1.0e-10};
+static fltx4 FourZeros={1.0e-10,1.0e-10,1.0e-10,1.0e-10};
+static fltx4 FourNegativeEpsilons={-1.0e-10,-1.0e-10,-1.0e-10,-1.0e-10};
+
+extern int n_intersection_calculations;
+
+// intersect 4 rays with a triangle in intersection format, updating the closest hits in rslt_out
+FORCEINLINE void Intersect4RaysWithTriangle( TriIntersectData_t const *tri, int tnum, const FourRays &rays,
+											 RayTracingResult *rslt_out, ITransparentTriangleCallback *pCallback )
+{
+	n_intersection_calculations++;
+
+	// compute plane intersection
+	FourVectors N;
+	N.x = ReplicateX4( tri->m_flNx );
+	N.y = ReplicateX4( tri->m_flNy );
+	N.z = ReplicateX4( tri->m_flNz );
+
+	fltx4 DDotN = rays.direction * N;
+	// mask off zero or near zero (ray parallel to surface)
+	fltx4 did_hit = OrSIMD( CmpGtSIMD( DDotN,FourEpsilons ),
+							CmpLtSIMD( DDotN, FourNegativeEpsilons ) );
+
+	fltx4 numerator=SubSIMD( ReplicateX4( tri->m_flD ), rays.origin * N );
+
+	fltx4 isect_t=DivSIMD( numerator,DDotN );
+	// now, we have the distance to the plane. lets update our mask
+	did_hit = AndSIMD( did_hit, CmpGtSIMD( isect_t, FourZeros ) );
+	//did_hit=AndSIMD(did_hit,CmpLtSIMD(isect_t,TMax));
+	did_hit = AndSIMD( did_hit, CmpLtSIMD( isect_t, rslt_out->HitDistance ) );
+
+	if ( ! IsAnyNegative( did_hit ) )
+		return;
+
+	// now, check 3 edges
+	fltx4 hitc1 = AddSIMD( rays.origin[tri->m_nCoordSelect0],
+						   MulSIMD( isect_t, rays.direction[ tri->m_nCoordSelect0] ) );
+	fltx4 hitc2 = AddSIMD( rays.origin[tri->m_nCoordSelect1],
+						   MulSIMD( isect_t, rays.direction[tri->m_nCoordSelect1] ) );
+
+	// do barycentric coordinate check
+	fltx4 B0 = MulSIMD( ReplicateX4( tri->m_ProjectedEdgeEquations[0] ), hitc1 );
+
+	B0 = AddSIMD(
+		B0,
+		MulSIMD( ReplicateX4( tri->m_ProjectedEdgeEquations[1] ), hitc2 ) );
+	B0 = AddSIMD(
+		B0, ReplicateX4( tri->m_ProjectedEdgeEquations[2] ) );
+
+	did_hit = AndSIMD( did_hit, CmpGeSIMD( B0, FourZeros ) );
+
+	fltx4 B1 = MulSIMD( ReplicateX4( tri->m_ProjectedEdgeEquations[3] ), hitc1 );
+	B1 = AddSIMD(
+		B1,
+		MulSIMD( ReplicateX4( tri->m_ProjectedEdgeEquations[4]), hitc2 ) );
+
+	B1 = AddSIMD(
+		B1, ReplicateX4( tri->m_ProjectedEdgeEquations[5] ) );
+
+	did_hit = AndSIMD( did_hit, CmpGeSIMD( B1, FourZeros ) );
+
+	fltx4 B2 = AddSIMD( B1, B0 );
+	did_hit = AndSIMD( did_hit, CmpLeSIMD( B2, Four_Ones ) );
+
+	if ( ! IsAnyNegative( did_hit ) )
+		return;
+
+	// if the triangle is transparent
+	if ( tri->m_nFlags & FCACHETRI_TRANSPARENT )
+	{
+		if ( pCallback )
+		{
+			// assuming a triangle indexed as v0, v1, v2
+			// the projected edge equations are set up such that the vert opposite the first
+			// equation is v2, and the vert opposite the second equation is v0
+			// Therefore we pass them back in 1, 2, 0 order
+			// Also B2 is currently B1 + B0 and needs to be 1 - (B1+B0) in order to be a real
+			// barycentric coordinate.  Compute that now and pass it to the callback
+			fltx4 b2 = SubSIMD( Four_Ones, B2 );
+			if ( pCallback->VisitTriangle_ShouldContinue( *tri, rays, &did_hit, &B1, &b2, &B0, tnum ) )
+			{
+				did_hit = Four_Zeros;
+			}
+		}
+	}
+	// now, set the hit_id and closest_hit fields for any enabled rays
+	fltx4 replicated_n = ReplicateIX4(tnum);
+	StoreAlignedSIMD((float *) rslt_out->HitIds,
+					 OrSIMD(AndSIMD(replicated_n,did_hit),
+							AndNotSIMD(did_hit,LoadAlignedSIMD(
+										   (float *) rslt_out->HitIds))));
+	rslt_out->HitDistance=OrSIMD(AndSIMD(isect_t,did_hit),
+								 AndNotSIMD(did_hit,rslt_out->HitDistance));
+
+	rslt_out->surface_normal.x=OrSIMD(
+		AndSIMD(N.x,did_hit),
+		AndNotSIMD(did_hit,rslt_out->surface_normal.x));
+	rslt_out->surface_normal.y=OrSIMD(
+		AndSIMD(N.y,did_hit),
+		AndNotSIMD(did_hit,rslt_out->surface_normal.y));
+	rslt_out->surface_normal.z=OrSIMD(
+		AndSIMD(N.z,did_hit),
+		AndNotSIMD(did_hit,rslt_out->surface_normal.z));
+}
+
+// the same test for one ray. returns the distance to the triangle if it is hit closer than
+// max_t, otherwise max_t
+FORCEINLINE float IntersectRayWithTriangle( TriIntersectData_t const *tri, const Vector &origin,
+											const Vector &direction, float max_t )
+{
+	n_intersection_calculations++;
+
+	float DDotN = direction.x * tri->m_flNx + direction.y * tri->m_flNy + direction.z * tri->m_flNz;
+	if ( ( DDotN <= 1.0e-10 ) && ( DDotN >= -1.0e-10 ) )
+		return max_t;
+
+	float numerator = tri->m_flD - ( origin.x * tri->m_flNx + origin.y * tri->m_flNy + origin.z * tri->m_flNz );
+	float isect_t = numerator / DDotN;
+	if ( ( isect_t <= 1.0e-10 ) || ( isect_t >= max_t ) )
+		return max_t;
+
+	float hitc1 = origin[tri->m_nCoordSelect0] + isect_t * direction[tri->m_nCoordSelect0];
+	float hitc2 = origin[tri->m_nCoordSelect1] + isect_t * direction[tri->m_nCoordSelect1];
+
+	float B0 = tri->m_ProjectedEdgeEquations[0] * hitc1 + tri->m_ProjectedEdgeEquations[1] * hitc2 +
+		tri->m_ProjectedEdgeEquations[2];
+	if ( B0 < 1.0e-10 )
+		return max_t;
+
+	float B1 = tri->m_ProjectedEdgeEquations[3] * hitc1 + tri->m_ProjectedEdgeEquations[4] * hitc2 +
+		tri->m_ProjectedEdgeEquations[5];
+	if ( ( B1 < 1.0e-10 ) || ( B0 + B1 > 1.0f ) )
+		return max_t;
+
+	return isect_t;
+}
+
+#endif // TRIINTERSECT_H
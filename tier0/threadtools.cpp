@@ -865,7 +865,9 @@ bool CThreadSyncObject::Wait( uint32 dwTimeout )
     {
 		volatile int ret = 0;
 
-		while ( !m_bWakeForEvent && ret != ETIMEDOUT )
+		// A zero timeout is a poll (CWorkerThread::PeekCall() between every
+		// job), m_cSet already says it isn't set
+		while ( dwTimeout != 0 && !m_bWakeForEvent && ret != ETIMEDOUT )
 		{
 			struct timeval tv;
 			gettimeofday( &tv, NULL );
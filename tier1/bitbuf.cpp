@@ -536,7 +536,15 @@ bool bf_write::WriteBits(const void *pInData, int nBits)
 
 bool bf_write::WriteBitsFromBuffer( bf_read *pIn, int nBits )
 {
-	// This could be optimized a little by
+	// If the source is byte aligned, its data can be handed straight to WriteBits,
+	// which does a block copy or whole dword shifts depending on our alignment.
+	if ( ( pIn->m_iCurBit & 7 ) == 0 && nBits <= pIn->GetNumBitsLeft() )
+	{
+		WriteBits( pIn->m_pData + ( pIn->m_iCurBit >> 3 ), nBits );
+		pIn->SeekRelative( nBits );
+		return !IsOverflowed() && !pIn->IsOverflowed();
+	}
+
 	while ( nBits > 32 )
 	{
 		WriteUBitLong( pIn->ReadUBitLong( 32 ), 32 );
@@ -625,30 +633,32 @@ void bf_write::WriteBitCoord (const float f)
 	int		intval = (int)abs(f);
 	int		fractval = abs((int)(f*COORD_DENOMINATOR)) & (COORD_DENOMINATOR-1);
 
+	// Flags that indicate whether we have an integer part and/or a fraction part,
+	// then the sign bit and whichever parts are present. Everything is packed
+	// into one value (at most 22 bits) so we only hit the buffer once.
+	unsigned int bits = ( intval ? 1 : 0 ) | ( fractval ? 2 : 0 );
+	int numbits = 2;
 
-	// Send the bit flags that indicate whether we have an integer part and/or a fraction part.
-	WriteOneBit( intval );
-	WriteOneBit( fractval );
-
-	if ( intval || fractval )
+	if ( bits )
 	{
-		// Send the sign bit
-		WriteOneBit( signbit );
+		bits |= signbit << 2;
+		numbits = 3;
 
-		// Send the integer if we have one.
 		if ( intval )
 		{
 			// Adjust the integers from [1..MAX_COORD_VALUE] to [0..MAX_COORD_VALUE-1]
-			intval--;
-			WriteUBitLong( (unsigned int)intval, COORD_INTEGER_BITS );
+			bits |= ( (unsigned int)( intval - 1 ) & ( ( 1 << COORD_INTEGER_BITS ) - 1 ) ) << numbits;
+			numbits += COORD_INTEGER_BITS;
 		}
-		
-		// Send the fraction if we have one
+
 		if ( fractval )
 		{
-			WriteUBitLong( (unsigned int)fractval, COORD_FRACTIONAL_BITS );
+			bits |= (unsigned int)fractval << numbits;
+			numbits += COORD_FRACTIONAL_BITS;
 		}
 	}
+
+	WriteUBitLong( bits, numbits );
 }
 
 void bf_write::WriteBitVec3Coord( const Vector& fa )
@@ -659,9 +669,7 @@ void bf_write::WriteBitVec3Coord( const Vector& fa )
 	yflag = (fa[1] >= COORD_RESOLUTION) || (fa[1] <= -COORD_RESOLUTION);
 	zflag = (fa[2] >= COORD_RESOLUTION) || (fa[2] <= -COORD_RESOLUTION);
 
-	WriteOneBit( xflag );
-	WriteOneBit( yflag );
-	WriteOneBit( zflag );
+	WriteUBitLong( xflag | ( yflag << 1 ) | ( zflag << 2 ), 3 );
 
 	if ( xflag )
 		WriteBitCoord( fa[0] );
@@ -671,7 +679,8 @@ void bf_write::WriteBitVec3Coord( const Vector& fa )
 		WriteBitCoord( fa[2] );
 }
 
-void bf_write::WriteBitNormal( float f )
+// Sign bit followed by the fractional component
+static inline unsigned int EncodeBitNormal( float f )
 {
 	int	signbit = (f <= -NORMAL_RESOLUTION);
 
@@ -682,11 +691,12 @@ void bf_write::WriteBitNormal( float f )
 	if (fractval > NORMAL_DENOMINATOR)
 		fractval = NORMAL_DENOMINATOR;
 
-	// Send the sign bit
-	WriteOneBit( signbit );
+	return signbit | ( fractval << 1 );
+}
 
-	// Send the fractional component
-	WriteUBitLong( fractval, NORMAL_FRACTIONAL_BITS );
+void bf_write::WriteBitNormal( float f )
+{
+	WriteUBitLong( EncodeBitNormal( f ), 1 + NORMAL_FRACTIONAL_BITS );
 }
 
 void bf_write::WriteBitVec3Normal( const Vector& fa )
@@ -696,17 +706,27 @@ void bf_write::WriteBitVec3Normal( const Vector& fa )
 	xflag = (fa[0] >= NORMAL_RESOLUTION) || (fa[0] <= -NORMAL_RESOLUTION);
 	yflag = (fa[1] >= NORMAL_RESOLUTION) || (fa[1] <= -NORMAL_RESOLUTION);
 
-	WriteOneBit( xflag );
-	WriteOneBit( yflag );
+	// Flags, the x and y normals if present and the z sign bit all fit in 27 bits
+	unsigned int bits = xflag | ( yflag << 1 );
+	int numbits = 2;
 
 	if ( xflag )
-		WriteBitNormal( fa[0] );
+	{
+		bits |= EncodeBitNormal( fa[0] ) << numbits;
+		numbits += 1 + NORMAL_FRACTIONAL_BITS;
+	}
 	if ( yflag )
-		WriteBitNormal( fa[1] );
+	{
+		bits |= EncodeBitNormal( fa[1] ) << numbits;
+		numbits += 1 + NORMAL_FRACTIONAL_BITS;
+	}
 	
 	// Write z sign bit
 	int	signbit = (fa[2] <= -NORMAL_RESOLUTION);
-	WriteOneBit( signbit );
+	bits |= signbit << numbits;
+	numbits++;
+
+	WriteUBitLong( bits, numbits );
 }
 
 void bf_write::WriteBitAngles( const QAngle& fa )
@@ -769,11 +789,22 @@ bool bf_write::WriteString(const char *pStr)
 {
 	if(pStr)
 	{
-		do
+		// Write the string and its terminator as one block; WriteBits copies
+		// bytes directly when we're byte aligned and whole dwords otherwise.
+		int nBytes = V_strlen( pStr ) + 1;
+		if ( (m_iCurBit + (nBytes << 3)) > m_nDataBits )
 		{
-			WriteChar( *pStr );
-			++pStr;
-		} while( *(pStr-1) != 0 );
+			// Write as much as will fit, like the per-character version did
+			do
+			{
+				WriteChar( *pStr );
+				++pStr;
+			} while( *(pStr-1) != 0 && !IsOverflowed() );
+		}
+		else
+		{
+			WriteBits( pStr, nBytes << 3 );
+		}
 	}
 	else
 	{
@@ -893,7 +924,36 @@ void bf_read::ReadBits(void *pOutData, int nBits)
 	}
 
 	// X360TBD: Can't read dwords in ReadBits because they'll get swapped
-	if ( IsPC() )
+	if ( IsPC() && nBitsLeft >= 32 && nBitsLeft <= GetNumBitsLeft() )
+	{
+		// Everything we want is in the buffer, so skip the per-read bounds checks
+		if ( (m_iCurBit & 7) == 0 )
+		{
+			// current bit is byte aligned, do block copy
+			int numbytes = nBitsLeft >> 3;
+			Q_memcpy( pOut, m_pData + (m_iCurBit >> 3), numbytes );
+			pOut += numbytes;
+			nBitsLeft -= numbytes << 3;
+			m_iCurBit += numbytes << 3;
+		}
+		else
+		{
+			// Stitch each output dword together from two neighbouring input dwords
+			unsigned int iStartBit = m_iCurBit & 31u;
+			const uint32 *pData = (const uint32 *)m_pData + (m_iCurBit >> 5);
+			while ( nBitsLeft >= 32 )
+			{
+				uint32 dw1 = LoadLittleDWord( (uint32*)pData, 0 ) >> iStartBit;
+				uint32 dw2 = LoadLittleDWord( (uint32*)pData, 1 ) << (32 - iStartBit);
+				*((uint32*)pOut) = dw1 | dw2;
+				++pData;
+				pOut += sizeof(uint32);
+				nBitsLeft -= 32;
+				m_iCurBit += 32;
+			}
+		}
+	}
+	else if ( IsPC() )
 	{
 		// read dwords
 		while ( nBitsLeft >= 32 )
@@ -1090,26 +1150,30 @@ float bf_read::ReadBitCoord (void)
 
 
 	// Read the required integer and fraction flags
-	intval = ReadOneBit();
-	fractval = ReadOneBit();
+	unsigned int flags = ReadUBitLong( 2 );
 
 	// If we got either parse them, otherwise it's a zero.
-	if ( intval || fractval )
+	if ( flags )
 	{
-		// Read the sign bit
-		signbit = ReadOneBit();
+		// The sign bit and whichever parts are present were written as one value
+		int numbits = 1 + ( ( flags & 1 ) ? COORD_INTEGER_BITS : 0 ) + ( ( flags & 2 ) ? COORD_FRACTIONAL_BITS : 0 );
+		unsigned int bits = ReadUBitLong( numbits );
+
+		signbit = bits & 1;
+		bits >>= 1;
 
 		// If there's an integer, read it in
-		if ( intval )
+		if ( flags & 1 )
 		{
 			// Adjust the integers from [0..MAX_COORD_VALUE-1] to [1..MAX_COORD_VALUE]
-			intval = ReadUBitLong( COORD_INTEGER_BITS ) + 1;
+			intval = ( bits & ( ( 1 << COORD_INTEGER_BITS ) - 1 ) ) + 1;
+			bits >>= COORD_INTEGER_BITS;
 		}
 
 		// If there's a fraction, read it in
-		if ( fractval )
+		if ( flags & 2 )
 		{
-			fractval = ReadUBitLong( COORD_FRACTIONAL_BITS );
+			fractval = bits;
 		}
 
 		// Calculate the correct floating point value
@@ -1276,9 +1340,10 @@ void bf_read::ReadBitVec3Coord( Vector& fa )
 	// the corresponding component will not be read and will be stack garbage.
 	fa.Init( 0, 0, 0 );
 
-	xflag = ReadOneBit();
-	yflag = ReadOneBit(); 
-	zflag = ReadOneBit();
+	unsigned int flags = ReadUBitLong( 3 );
+	xflag = flags & 1;
+	yflag = flags & 2; 
+	zflag = flags & 4;
 
 	if ( xflag )
 		fa[0] = ReadBitCoord();
@@ -1290,11 +1355,10 @@ void bf_read::ReadBitVec3Coord( Vector& fa )
 
 float bf_read::ReadBitNormal (void)
 {
-	// Read the sign bit
-	int	signbit = ReadOneBit();
-
-	// Read the fractional part
-	unsigned int fractval = ReadUBitLong( NORMAL_FRACTIONAL_BITS );
+	// Read the sign bit and the fractional part together
+	unsigned int bits = ReadUBitLong( 1 + NORMAL_FRACTIONAL_BITS );
+	int	signbit = bits & 1;
+	unsigned int fractval = bits >> 1;
 
 	// Calculate the correct floating point value
 	float value = (float)fractval * NORMAL_RESOLUTION;
@@ -1308,8 +1372,9 @@ float bf_read::ReadBitNormal (void)
 
 void bf_read::ReadBitVec3Normal( Vector& fa )
 {
-	int xflag = ReadOneBit();
-	int yflag = ReadOneBit(); 
+	unsigned int flags = ReadUBitLong( 2 );
+	int xflag = flags & 1;
+	int yflag = flags & 2; 
 
 	if (xflag)
 		fa[0] = ReadBitNormal();
@@ -1376,6 +1441,35 @@ bool bf_read::ReadString( char *pStr, int maxLen, bool bLine, int *pOutNumChars
 {
 	Assert( maxLen != 0 );
 
+	// When byte aligned, scan the buffer for the terminator and copy in one go.
+	// If it isn't terminated before the end, fall through so overflow is handled as usual.
+	if ( (m_iCurBit & 7) == 0 && maxLen > 0 && GetNumBitsLeft() > 0 )
+	{
+		const char *pStart = (const char *)m_pData + (m_iCurBit >> 3);
+		int nAvailable = GetNumBitsLeft() >> 3;
+		const char *pEnd = (const char *)memchr( pStart, 0, nAvailable );
+		if ( bLine )
+		{
+			const char *pNewLine = (const char *)memchr( pStart, '\n', pEnd ? pEnd - pStart : nAvailable );
+			if ( pNewLine )
+				pEnd = pNewLine;
+		}
+
+		if ( pEnd )
+		{
+			int nChars = pEnd - pStart;
+			int nCopy = MIN( nChars, maxLen - 1 );
+			Q_memcpy( pStr, pStart, nCopy );
+			pStr[nCopy] = 0;
+			m_iCurBit += (nChars + 1) << 3;
+
+			if ( pOutNumChars )
+				*pOutNumChars = nCopy;
+
+			return !IsOverflowed() && nCopy == nChars;
+		}
+	}
+
 	bool bTooSmall = false;
 	int iChar = 0;
 	while(1)
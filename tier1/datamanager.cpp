@@ -26,6 +26,7 @@ CDataManagerBase::CDataManagerBase( unsigned int maxSize )
 	m_freeList = m_memoryLists.CreateList();
 	m_listsAreFreed = 0;
 	m_freeOnDestruct = 1;
+	m_clockReplacement = 0;
 }
 
 CDataManagerBase::~CDataManagerBase() 
@@ -252,6 +253,7 @@ void CDataManagerBase::MarkAsStale( memhandle_t handle )
 	unsigned short memoryIndex = FromHandle(handle);
 	if ( memoryIndex != m_memoryLists.InvalidIndex() )
 	{
+		m_memoryLists[memoryIndex].referenced = false;
 		if ( m_memoryLists[memoryIndex].lockCount == 0 )
 		{
 			m_memoryLists.Unlink( m_lruList, memoryIndex );
@@ -317,6 +319,7 @@ unsigned short CDataManagerBase::CreateHandle( bool bCreateLocked )
 	{
 		m_memoryLists[memoryIndex].lockCount++;
 	}
+	m_memoryLists[memoryIndex].referenced = false;
 
 	return memoryIndex;
 }
@@ -334,7 +337,11 @@ void CDataManagerBase::TouchByIndex( unsigned short memoryIndex )
 {
 	if ( memoryIndex != m_memoryLists.InvalidIndex() )
 	{
-		if ( m_memoryLists[memoryIndex].lockCount == 0 )
+		if ( m_clockReplacement )
+		{
+			m_memoryLists[memoryIndex].referenced = true;
+		}
+		else if ( m_memoryLists[memoryIndex].lockCount == 0 )
 		{
 			m_memoryLists.Unlink( m_lruList, memoryIndex );
 			m_memoryLists.LinkToTail( m_lruList, memoryIndex );
@@ -350,6 +357,11 @@ memhandle_t CDataManagerBase::ToHandle( unsigned short index )
 	return reinterpret_cast< memhandle_t >( (uintp)( hiword|index ) );
 }
 
+int CDataManagerBase::ResourceCount()
+{
+	return m_memoryLists.Count( m_lruList ) + m_memoryLists.Count( m_lockList );
+}
+
 unsigned int CDataManagerBase::TargetSize() 
 { 
 	return MemTotal_Inline(); 
@@ -379,6 +391,15 @@ unsigned int CDataManagerBase::EnsureCapacity( unsigned int size )
 			Unlock();
 			break;
 		}
+		if ( m_memoryLists[lruIndex].referenced )
+		{
+			// Second chance, it goes next time around unless it's touched again
+			m_memoryLists[lruIndex].referenced = false;
+			m_memoryLists.Unlink( m_lruList, lruIndex );
+			m_memoryLists.LinkToTail( m_lruList, lruIndex );
+			Unlock();
+			continue;
+		}
 		m_memoryLists.Unlink( m_lruList, lruIndex );
 		void *p = GetForFreeByIndex( lruIndex );
 		Unlock();
@@ -0,0 +1,283 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Sharded, open-addressed string intern index with lock-free lookups
+//
+// $NoKeywords: $
+//===========================================================================//
+
+#include "tier1/utlstringindexmt.h"
+#include "tier1/strtools.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+
+//-----------------------------------------------------------------------------
+// Constructor, destructor
+//-----------------------------------------------------------------------------
+CUtlStringIndexMT::CUtlStringIndexMT( IUtlStringIndexStorage *pStorage, int nValueBits, bool bCaseInsensitive, int nInitialSize ) :
+	m_pStorage( pStorage ), m_bCaseInsensitive( bCaseInsensitive )
+{
+	Assert( nValueBits > 0 && nValueBits < 32 );
+	m_nValueMask = ( 1u << nValueBits ) - 1;
+	m_nContendedLocks = 0;
+
+	// Spread the initial size over the shards, and keep each table a power of 2
+	int nShardSize = 4;
+	while ( nShardSize * NUM_SHARDS < nInitialSize * 2 )
+	{
+		nShardSize <<= 1;
+	}
+	m_nInitialSize = nShardSize;
+
+	for ( int i = 0; i < NUM_SHARDS; i++ )
+	{
+		m_Shards[i].m_pTable = NULL;
+		m_Shards[i].m_nCount = 0;
+	}
+}
+
+CUtlStringIndexMT::~CUtlStringIndexMT()
+{
+	for ( int i = 0; i < NUM_SHARDS; i++ )
+	{
+		FreeShardTables( m_Shards[i] );
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// FNV-1a with ASCII case folding, followed by a finalizer so that the low
+// bits (shard + probe position) and high bits (slot tag) are both well mixed.
+//-----------------------------------------------------------------------------
+uint32 CUtlStringIndexMT::HashString( const char *pString ) const
+{
+	uint32 nHash = 2166136261u;
+	const unsigned char *p = (const unsigned char *)pString;
+	if ( m_bCaseInsensitive )
+	{
+		for ( ; *p; ++p )
+		{
+			unsigned char c = *p;
+			if ( c >= 'A' && c <= 'Z' )
+			{
+				c += 'a' - 'A';
+			}
+			nHash = ( nHash ^ c ) * 16777619u;
+		}
+	}
+	else
+	{
+		for ( ; *p; ++p )
+		{
+			nHash = ( nHash ^ *p ) * 16777619u;
+		}
+	}
+
+	nHash ^= nHash >> 16;
+	nHash *= 0x85ebca6b;
+	nHash ^= nHash >> 13;
+	nHash *= 0xc2b2ae35;
+	nHash ^= nHash >> 16;
+	return nHash;
+}
+
+
+//-----------------------------------------------------------------------------
+// Table allocation
+//-----------------------------------------------------------------------------
+CUtlStringIndexMT::Table_t *CUtlStringIndexMT::AllocTable( int nSize )
+{
+	Assert( ( nSize & ( nSize - 1 ) ) == 0 );
+	Table_t *pTable = (Table_t *)malloc( sizeof( Table_t ) + ( nSize - 1 ) * sizeof( uint32 ) );
+	pTable->m_nMask = nSize - 1;
+	memset( pTable->m_Slots, 0, nSize * sizeof( uint32 ) );
+	return pTable;
+}
+
+void CUtlStringIndexMT::FreeShardTables( Shard_t &shard )
+{
+	free( shard.m_pTable );
+	shard.m_pTable = NULL;
+	shard.m_nCount = 0;
+
+	for ( int i = 0; i < shard.m_RetiredTables.Count(); i++ )
+	{
+		free( shard.m_RetiredTables[i] );
+	}
+	shard.m_RetiredTables.Purge();
+}
+
+
+//-----------------------------------------------------------------------------
+// Compares a string against the one stored for a value
+//-----------------------------------------------------------------------------
+inline bool CUtlStringIndexMT::Matches( const char *pString, uint32 nValue ) const
+{
+	const char *pStored = m_pStorage->GetIndexedString( nValue );
+	return m_bCaseInsensitive ? !V_stricmp( pString, pStored ) : !V_strcmp( pString, pStored );
+}
+
+
+//-----------------------------------------------------------------------------
+// Linear probe of a single table. Safe to call without the shard lock since
+// a slot goes from empty to filled exactly once.
+//-----------------------------------------------------------------------------
+uint32 CUtlStringIndexMT::ProbeTable( const Table_t *pTable, const char *pString, uint32 nHash ) const
+{
+	const uint32 nMask = pTable->m_nMask;
+	const uint32 nTag = SlotTag( nHash );
+	uint32 i = ( nHash >> NUM_SHARDS_BITS ) & nMask;
+	for ( ;; )
+	{
+		uint32 nSlot = *(volatile const uint32 *)&pTable->m_Slots[i];
+		if ( nSlot == 0 )
+			return UTL_STRINGINDEX_INVALID;
+
+		if ( ( nSlot & ~m_nValueMask ) == nTag )
+		{
+			uint32 nValue = ( nSlot & m_nValueMask ) - 1;
+			if ( Matches( pString, nValue ) )
+				return nValue;
+		}
+
+		i = ( i + 1 ) & nMask;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Lock-free lookup
+//-----------------------------------------------------------------------------
+uint32 CUtlStringIndexMT::Find( const char *pString, uint32 nHash ) const
+{
+	if ( !pString )
+		return UTL_STRINGINDEX_INVALID;
+
+	const Shard_t &shard = m_Shards[ nHash & ( NUM_SHARDS - 1 ) ];
+	const Table_t *pTable = shard.m_pTable;
+	if ( !pTable )
+		return UTL_STRINGINDEX_INVALID;
+
+	return ProbeTable( pTable, pString, nHash );
+}
+
+
+//-----------------------------------------------------------------------------
+// Writes a new slot. The slot is published with an interlocked exchange so
+// anything the storage wrote for the value is visible before the slot is.
+//-----------------------------------------------------------------------------
+void CUtlStringIndexMT::InsertIntoTable( Table_t *pTable, uint32 nValue, uint32 nHash )
+{
+	Assert( nValue < m_nValueMask );
+	const uint32 nMask = pTable->m_nMask;
+	uint32 i = ( nHash >> NUM_SHARDS_BITS ) & nMask;
+	while ( pTable->m_Slots[i] != 0 )
+	{
+		i = ( i + 1 ) & nMask;
+	}
+
+	ThreadInterlockedExchange( (int32 volatile *)&pTable->m_Slots[i], (int32)( SlotTag( nHash ) | ( nValue + 1 ) ) );
+}
+
+
+//-----------------------------------------------------------------------------
+// Doubles a shard's table. Must be called with the shard locked.
+//-----------------------------------------------------------------------------
+void CUtlStringIndexMT::GrowShard( Shard_t &shard )
+{
+	Table_t *pOldTable = shard.m_pTable;
+	int nNewSize = pOldTable ? ( pOldTable->m_nMask + 1 ) * 2 : m_nInitialSize;
+	Table_t *pNewTable = AllocTable( nNewSize );
+
+	if ( pOldTable )
+	{
+		// Slots only store a tag, so rehash from the stored strings
+		for ( uint32 i = 0; i <= pOldTable->m_nMask; i++ )
+		{
+			uint32 nSlot = pOldTable->m_Slots[i];
+			if ( nSlot == 0 )
+				continue;
+
+			uint32 nValue = ( nSlot & m_nValueMask ) - 1;
+			InsertIntoTable( pNewTable, nValue, HashString( m_pStorage->GetIndexedString( nValue ) ) );
+		}
+
+		// Readers may still be probing the old table
+		shard.m_RetiredTables.AddToTail( pOldTable );
+	}
+
+	ThreadInterlockedExchangePointer( (void * volatile *)&shard.m_pTable, pNewTable );
+}
+
+
+//-----------------------------------------------------------------------------
+// Finds the string, or adds it through the storage if missing
+//-----------------------------------------------------------------------------
+uint32 CUtlStringIndexMT::FindOrAdd( const char *pString, uint32 nHash )
+{
+	if ( !pString )
+		return UTL_STRINGINDEX_INVALID;
+
+	uint32 nValue = Find( pString, nHash );
+	if ( nValue != UTL_STRINGINDEX_INVALID )
+		return nValue;
+
+	Shard_t &shard = m_Shards[ nHash & ( NUM_SHARDS - 1 ) ];
+	if ( !shard.m_Mutex.TryLock() )
+	{
+		++m_nContendedLocks;
+		shard.m_Mutex.Lock();
+	}
+
+	// Someone may have added it while we weren't holding the lock
+	if ( shard.m_pTable )
+	{
+		nValue = ProbeTable( shard.m_pTable, pString, nHash );
+	}
+
+	if ( nValue == UTL_STRINGINDEX_INVALID )
+	{
+		nValue = m_pStorage->AddIndexedString( pString );
+		if ( nValue != UTL_STRINGINDEX_INVALID )
+		{
+			// Keep the load factor at or below 1/2 so probes stay short
+			if ( !shard.m_pTable || ( shard.m_nCount + 1 ) * 2 > (int)( shard.m_pTable->m_nMask + 1 ) )
+			{
+				GrowShard( shard );
+			}
+
+			InsertIntoTable( shard.m_pTable, nValue, nHash );
+			++shard.m_nCount;
+		}
+	}
+
+	shard.m_Mutex.Unlock();
+	return nValue;
+}
+
+
+//-----------------------------------------------------------------------------
+// Number of strings in the index
+//-----------------------------------------------------------------------------
+int CUtlStringIndexMT::Count() const
+{
+	int nCount = 0;
+	for ( int i = 0; i < NUM_SHARDS; i++ )
+	{
+		nCount += m_Shards[i].m_nCount;
+	}
+	return nCount;
+}
+
+
+//-----------------------------------------------------------------------------
+// Remove all strings. No other thread may be using the index.
+//-----------------------------------------------------------------------------
+void CUtlStringIndexMT::RemoveAll()
+{
+	for ( int i = 0; i < NUM_SHARDS; i++ )
+	{
+		FreeShardTables( m_Shards[i] );
+	}
+}
@@ -369,6 +369,131 @@ void CUtlSymbolTable::RemoveAll()
 }
 
 
+//-----------------------------------------------------------------------------
+// Thread-safe symbol table
+//-----------------------------------------------------------------------------
+CUtlSymbolTableMT::CUtlSymbolTableMT( int growSize, int initSize, bool caseInsensitive ) :
+	m_Index( this, sizeof( UtlSymId_t ) * 8, caseInsensitive, initSize ), m_StringPools( 8 ), m_pPoolCursor( NULL ), m_nPoolSpaceLeft( 0 )
+{
+	memset( (void *)m_pSymbolPages, 0, sizeof( m_pSymbolPages ) );
+	m_nSymbols = 0;
+}
+
+CUtlSymbolTableMT::~CUtlSymbolTableMT()
+{
+	RemoveAll();
+}
+
+CUtlSymbol CUtlSymbolTableMT::AddString( const char* pString )
+{
+	VPROF( "CUtlSymbol::AddString" );
+	if ( !pString )
+		return CUtlSymbol( UTL_INVAL_SYMBOL );
+
+	uint32 nValue = m_Index.FindOrAdd( pString );
+	return CUtlSymbol( ( nValue == UTL_STRINGINDEX_INVALID ) ? UTL_INVAL_SYMBOL : (UtlSymId_t)nValue );
+}
+
+CUtlSymbol CUtlSymbolTableMT::Find( const char* pString ) const
+{
+	VPROF( "CUtlSymbol::Find" );
+	if ( !pString )
+		return CUtlSymbol();
+
+	uint32 nValue = m_Index.Find( pString );
+	return CUtlSymbol( ( nValue == UTL_STRINGINDEX_INVALID ) ? UTL_INVAL_SYMBOL : (UtlSymId_t)nValue );
+}
+
+const char* CUtlSymbolTableMT::String( CUtlSymbol id ) const
+{
+	if ( !id.IsValid() )
+		return "";
+
+	Assert( (int)(UtlSymId_t)id < m_nSymbols );
+	return GetIndexedString( (UtlSymId_t)id );
+}
+
+const char *CUtlSymbolTableMT::GetIndexedString( uint32 nValue ) const
+{
+	const char **pPage = m_pSymbolPages[ nValue >> SYMBOL_PAGE_BITS ];
+	Assert( pPage );
+	return pPage[ nValue & ( SYMBOL_PAGE_SIZE - 1 ) ];
+}
+
+//-----------------------------------------------------------------------------
+// Copies a new string into the pools and gives it the next symbol id.
+// Called by the index with the string's shard locked.
+//-----------------------------------------------------------------------------
+char *CUtlSymbolTableMT::AllocString( int nLen )
+{
+	if ( nLen > m_nPoolSpaceLeft )
+	{
+		int nPoolSize = MAX( nLen, MIN_STRING_POOL_SIZE );
+		m_pPoolCursor = (char *)malloc( nPoolSize );
+		m_StringPools.AddToTail( m_pPoolCursor );
+		m_nPoolSpaceLeft = nPoolSize;
+	}
+
+	char *pString = m_pPoolCursor;
+	m_pPoolCursor += nLen;
+	m_nPoolSpaceLeft -= nLen;
+	return pString;
+}
+
+uint32 CUtlSymbolTableMT::AddIndexedString( const char *pString )
+{
+	AUTO_LOCK( m_StringPoolMutex );
+
+	int nId = m_nSymbols;
+	if ( nId >= UTL_INVAL_SYMBOL )
+	{
+		AssertMsg( false, "CUtlSymbolTableMT: out of symbols" );
+		return UTL_STRINGINDEX_INVALID;
+	}
+
+	int nPage = nId >> SYMBOL_PAGE_BITS;
+	if ( !m_pSymbolPages[nPage] )
+	{
+		MEM_ALLOC_CREDIT();
+		const char **pPage = (const char **)malloc( SYMBOL_PAGE_SIZE * sizeof( const char * ) );
+		memset( pPage, 0, SYMBOL_PAGE_SIZE * sizeof( const char * ) );
+		ThreadInterlockedExchangePointer( (void * volatile *)&m_pSymbolPages[nPage], pPage );
+	}
+
+	int nLen = V_strlen( pString ) + 1;
+	char *pCopy = AllocString( nLen );
+	memcpy( pCopy, pString, nLen );
+	m_pSymbolPages[nPage][ nId & ( SYMBOL_PAGE_SIZE - 1 ) ] = pCopy;
+
+	// The index publishes the slot with a barrier after we return
+	++m_nSymbols;
+	return nId;
+}
+
+//-----------------------------------------------------------------------------
+// Remove all symbols in the table. No other thread may be using the table.
+//-----------------------------------------------------------------------------
+void CUtlSymbolTableMT::RemoveAll()
+{
+	m_Index.RemoveAll();
+
+	for ( int i = 0; i < NUM_SYMBOL_PAGES; i++ )
+	{
+		free( (void *)m_pSymbolPages[i] );
+		m_pSymbolPages[i] = NULL;
+	}
+	m_nSymbols = 0;
+
+	for ( int i = 0; i < m_StringPools.Count(); i++ )
+	{
+		free( m_StringPools[i] );
+	}
+	m_StringPools.RemoveAll();
+	m_pPoolCursor = NULL;
+	m_nPoolSpaceLeft = 0;
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose: 
 // Input  : *pFileName - 
@@ -0,0 +1,222 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Runs distwork between this process and local worker processes:
+//			every work unit comes back once with the right result, the
+//			workers see each other's results, and a connection sending a
+//			message too long to buffer gets dropped
+//
+//===========================================================================//
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <windows.h>
+#elif POSIX
+#define INVALID_SOCKET -1
+typedef int SOCKET;
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#define closesocket close
+#endif
+
+#include "cmdlib.h"
+#include "threads.h"
+#include "distwork.h"
+#include "tier0/platform.h"
+#include "tier0/threadtools.h"
+#include "tier1/strtools.h"
+#include "tier1/utlvector.h"
+
+#define DEFAULT_WORKERS		4
+#define DEFAULT_PORT		27899			// not the tools' port, so it can run next to them
+#define TEST_WORK_UNITS		2000
+
+static CUtlVector<int64>	g_Results;		// coordinator: by work unit, -1 until received
+static int					g_nDuplicates;
+static int					g_nWrong;
+static int					g_nMostShares;	// coordinator: most shared results a worker had seen
+static int					g_nBadShares;	// worker: shared results that weren't right
+static int					g_nShares;
+
+static inline int64 WorkUnitValue( uint64 iWorkUnit )
+{
+	return (int64)( iWorkUnit * iWorkUnit + 7 );
+}
+
+static void ProcessWorkUnit( int iThread, uint64 iWorkUnit, CUtlBuffer &buf )
+{
+	// long enough that the workers overlap
+	ThreadSleep( 1 );
+	buf.PutInt64( WorkUnitValue( iWorkUnit ) );
+	buf.PutInt( g_nBadShares );
+	buf.PutInt( g_nShares );
+}
+
+static void ReceiveWorkUnit( uint64 iWorkUnit, CUtlBuffer &buf )
+{
+	int64 nValue = buf.GetInt64();
+	int nBadShares = buf.GetInt();
+	int nShares = buf.GetInt();
+	g_nMostShares = MAX( g_nMostShares, nShares );
+	if ( iWorkUnit >= (uint64)g_Results.Count() || !buf.IsValid() || nValue != WorkUnitValue( iWorkUnit ) || nBadShares )
+	{
+		g_nWrong++;
+		return;
+	}
+	if ( g_Results[(int)iWorkUnit] != -1 )
+		g_nDuplicates++;
+	g_Results[(int)iWorkUnit] = nValue;
+}
+
+static void ShareWorkUnit( uint64 iWorkUnit, CUtlBuffer &buf )
+{
+	if ( buf.GetInt64() != WorkUnitValue( iWorkUnit ) )
+		ThreadInterlockedIncrement( (int32 volatile *)&g_nBadShares );
+	ThreadInterlockedIncrement( (int32 volatile *)&g_nShares );
+}
+
+static bool CheckStage( const char *pName, int nWorkUnits, const uint64 *pWorkUnits, double flSeconds )
+{
+	int nMissing = 0;
+	for ( int i = 0; i < nWorkUnits; i++ )
+	{
+		int iWorkUnit = pWorkUnits ? (int)pWorkUnits[i] : i;
+		if ( g_Results[iWorkUnit] != WorkUnitValue( iWorkUnit ) )
+			nMissing++;
+	}
+
+	bool bOk = !nMissing && !g_nDuplicates && !g_nWrong;
+	printf( "%-8s %5d work units in %.2f seconds: %d missing, %d twice, %d wrong  %s\n",
+		pName, nWorkUnits, flSeconds, nMissing, g_nDuplicates, g_nWrong, bOk ? "ok" : "FAILED" );
+	return bOk;
+}
+
+static void ResetResults()
+{
+	g_Results.SetCount( TEST_WORK_UNITS );
+	for ( int i = 0; i < TEST_WORK_UNITS; i++ )
+	{
+		g_Results[i] = -1;
+	}
+	g_nDuplicates = 0;
+	g_nWrong = 0;
+}
+
+// Connects the way a worker would and says it's sending 2 GB. Returns the
+// socket, which the coordinator should close once it reads the header.
+static SOCKET SendHugeMessage( int nPort )
+{
+	SOCKET s = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+	if ( s == INVALID_SOCKET )
+		return s;
+
+	struct sockaddr_in address;
+	memset( &address, 0, sizeof( address ) );
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+	address.sin_port = htons( nPort );
+	uint32 header[2] = { 0x7ffffff0, 0 };	// distmsgheader_t, a hello
+	if ( connect( s, (struct sockaddr *)&address, sizeof( address ) ) != 0 ||
+		 send( s, (const char *)header, sizeof( header ), 0 ) != sizeof( header ) )
+	{
+		closesocket( s );
+		return INVALID_SOCKET;
+	}
+	return s;
+}
+
+static bool WasClosed( SOCKET s )
+{
+	fd_set readSet;
+	FD_ZERO( &readSet );
+	FD_SET( s, &readSet );
+	struct timeval timeout = { 0, 0 };
+	char c;
+	return select( (int)s + 1, &readSet, NULL, NULL, &timeout ) == 1 && recv( s, &c, 1, 0 ) <= 0;
+}
+
+static void PrintUsage()
+{
+	printf( "format is 'distwork_test [-workers NUM] [-port NUM]'\n" );
+	printf( "-workers NUM\tNumber of worker processes (default = %d).\n", DEFAULT_WORKERS );
+	printf( "-port NUM\tPort the coordinator listens on (default = %d).\n", DEFAULT_PORT );
+}
+
+int main( int argc, char **argv )
+{
+	// The workers get the coordinator's command line, with -distworker
+	char szWorkers[16], szPort[16];
+	V_snprintf( szWorkers, sizeof( szWorkers ), "%d", DEFAULT_WORKERS );
+	V_snprintf( szPort, sizeof( szPort ), "%d", DEFAULT_PORT );
+	bool bWorker = false;
+	for ( int i = 1; i < argc; i++ )
+	{
+		if ( !Q_stricmp( argv[i], "-distworker" ) && i + 1 < argc )
+		{
+			bWorker = true;
+			i++;
+		}
+		else if ( !Q_stricmp( argv[i], "-workers" ) && i + 1 < argc )
+			V_strncpy( szWorkers, argv[++i], sizeof( szWorkers ) );
+		else if ( !Q_stricmp( argv[i], "-port" ) && i + 1 < argc )
+			V_strncpy( szPort, argv[++i], sizeof( szPort ) );
+		else if ( Q_stricmp( argv[i], "-threads" ) || i + 1 >= argc )
+		{
+			PrintUsage();
+			return 1;
+		}
+		else
+			numthreads = atoi( argv[++i] );
+	}
+
+	// Listen on a known port, so the huge message can find it
+	CUtlVector<char *> args;
+	args.AddMultipleToTail( argc, argv );
+	if ( !bWorker )
+	{
+		args.AddToTail( (char *)"-distribute" );
+		args.AddToTail( szWorkers );
+		args.AddToTail( (char *)"-distlisten" );
+		args.AddToTail( (char *)"-distport" );
+		args.AddToTail( szPort );
+	}
+	int nArgs = args.Count();
+	args.AddToTail( NULL );
+	char **ppArgs = args.Base();
+	DistWork_Init( nArgs, ppArgs );
+
+	SOCKET hugeSocket = g_bDistWorker ? INVALID_SOCKET : SendHugeMessage( atoi( szPort ) );
+
+	// Every work unit, with the results shared between the workers
+	ResetResults();
+	double flSeconds = DistributeWorkUnits( TEST_WORK_UNITS, NULL, ProcessWorkUnit, ReceiveWorkUnit, ShareWorkUnit );
+	bool bOk = g_bDistWorker || CheckStage( "all", TEST_WORK_UNITS, NULL, flSeconds );
+	if ( !g_bDistWorker && atoi( szWorkers ) > 1 )
+	{
+		printf( "workers saw up to %d shared results  %s\n", g_nMostShares, g_nMostShares ? "ok" : "FAILED" );
+		bOk = bOk && g_nMostShares > 0;
+	}
+
+	// A list of them, nothing shared
+	CUtlVector<uint64> workUnits;
+	for ( int i = 1; i < TEST_WORK_UNITS; i += 3 )
+	{
+		workUnits.AddToTail( i );
+	}
+	ResetResults();
+	flSeconds = DistributeWorkUnits( workUnits.Count(), workUnits.Base(), ProcessWorkUnit, ReceiveWorkUnit );
+	if ( g_bDistWorker )
+		CmdLib_Exit( 0 );
+	bOk = CheckStage( "list", workUnits.Count(), workUnits.Base(), flSeconds ) && bOk;
+
+	bool bDropped = hugeSocket != INVALID_SOCKET && WasClosed( hugeSocket );
+	printf( "huge message dropped  %s\n", bDropped ? "ok" : "FAILED" );
+	bOk = bOk && bDropped;
+	if ( hugeSocket != INVALID_SOCKET )
+		closesocket( hugeSocket );
+
+	CmdLib_Exit( bOk ? 0 : 1 );
+	return 0;
+}
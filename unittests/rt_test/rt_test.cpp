@@ -0,0 +1,247 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Compares the kd-tree and the BVH of the ray tracer on a triangle
+//			set written by vrad -dumptrace: build time, rays per second and
+//			whether both find the same hits
+//
+//===========================================================================//
+
+#include "tier0/platform.h"
+#include "mathlib/mathlib.h"
+#include "vstdlib/random.h"
+#include "tier2/tier2.h"
+#include "raytrace.h"
+
+#define COHERENT_IMAGE_SIZE 512								// camera rays, in 2x2 packets
+#define DEFAULT_INCOHERENT_RAYS 1000000
+
+struct TestRay_t
+{
+	Vector m_Start;
+	Vector m_End;
+};
+
+static int LoadTriangles( const char *pFilename, RayTracingEnvironment *pEnvs, int nEnvs )
+{
+	FILE *fp = fopen( pFilename, "r" );
+	if ( !fp )
+		return -1;
+
+	// windings, as written by WriteWinding: a point count then x y z r g b per point
+	int nTris = 0;
+	int nPoints;
+	while ( fscanf( fp, "%d", &nPoints ) == 1 )
+	{
+		Vector points[64];
+		Vector color;
+		if ( nPoints < 3 || nPoints > ARRAYSIZE( points ) )
+			break;
+		for ( int i = 0; i < nPoints; i++ )
+		{
+			if ( fscanf( fp, "%f %f %f %f %f %f", &points[i].x, &points[i].y, &points[i].z, &color.x, &color.y, &color.z ) != 6 )
+				break;
+		}
+		for ( int i = 2; i < nPoints; i++ )
+		{
+			for ( int e = 0; e < nEnvs; e++ )
+				pEnvs[e].AddTriangle( nTris, points[0], points[i - 1], points[i], color );
+			nTris++;
+		}
+	}
+	fclose( fp );
+	return nTris;
+}
+
+// Looks out of the middle of the map, 2x2 pixel packets
+static void MakeCoherentRays( RayTracingEnvironment const &env, CUtlVector<TestRay_t> &rays )
+{
+	Vector center = 0.5 * ( env.m_MinBound + env.m_MaxBound );
+	float flLength = ( env.m_MaxBound - env.m_MinBound ).Length();
+	for ( int y = 0; y < COHERENT_IMAGE_SIZE; y += 2 )
+	{
+		for ( int x = 0; x < COHERENT_IMAGE_SIZE; x += 2 )
+		{
+			for ( int i = 0; i < 4; i++ )
+			{
+				Vector dir( 1.0, ( x + ( i & 1 ) ) * ( 2.0 / COHERENT_IMAGE_SIZE ) - 1.0, ( y + ( i >> 1 ) ) * ( 2.0 / COHERENT_IMAGE_SIZE ) - 1.0 );
+				VectorNormalize( dir );
+				TestRay_t &ray = rays[rays.AddToTail()];
+				ray.m_Start = center;
+				ray.m_End = center + flLength * dir;
+			}
+		}
+	}
+}
+
+// Random rays between points inside the bounds, like bounce light and sky samples
+static void MakeIncoherentRays( RayTracingEnvironment const &env, int nRays, CUtlVector<TestRay_t> &rays )
+{
+	RandomSeed( 1 );
+	for ( int i = 0; i < nRays; i++ )
+	{
+		TestRay_t &ray = rays[rays.AddToTail()];
+		for ( int c = 0; c < 3; c++ )
+		{
+			ray.m_Start[c] = RandomFloat( env.m_MinBound[c], env.m_MaxBound[c] );
+			ray.m_End[c] = RandomFloat( env.m_MinBound[c], env.m_MaxBound[c] );
+		}
+	}
+}
+
+enum TraceMode_t
+{
+	TRACE_PACKETS,
+	TRACE_STREAM,
+	TRACE_SINGLE,
+};
+
+static double TraceRays( RayTracingEnvironment &env, CUtlVector<TestRay_t> const &rays, TraceMode_t mode,
+						 RayTracingSingleResult *pResults )
+{
+	double flStart = Plat_FloatTime();
+	if ( mode == TRACE_PACKETS )
+	{
+		for ( int i = 0; i + 3 < rays.Count(); i += 4 )
+		{
+			FourRays myrays;
+			myrays.origin.LoadAndSwizzle( rays[i].m_Start, rays[i + 1].m_Start, rays[i + 2].m_Start, rays[i + 3].m_Start );
+			myrays.direction.LoadAndSwizzle( rays[i].m_End, rays[i + 1].m_End, rays[i + 2].m_End, rays[i + 3].m_End );
+			myrays.direction -= myrays.origin;
+			fltx4 len = myrays.direction.length();
+			myrays.direction *= ReciprocalSIMD( len );
+			RayTracingResult rslt;
+			env.Trace4Rays( myrays, Four_Zeros, len, &rslt );
+			for ( int r = 0; r < 4; r++ )
+			{
+				pResults[i + r].HitID = rslt.HitIds[r];
+				pResults[i + r].HitDistance = SubFloat( rslt.HitDistance, r );
+				pResults[i + r].ray_length = SubFloat( len, r );
+			}
+		}
+	}
+	else if ( mode == TRACE_STREAM )
+	{
+		RayStream stream;
+		for ( int i = 0; i < rays.Count(); i++ )
+			env.AddToRayStream( stream, rays[i].m_Start, rays[i].m_End, &pResults[i] );
+		env.FinishRayStream( stream );
+	}
+	else
+	{
+		for ( int i = 0; i < rays.Count(); i++ )
+			env.TraceRay( rays[i].m_Start, rays[i].m_End, &pResults[i] );
+	}
+	return Plat_FloatTime() - flStart;
+}
+
+static inline bool IsHit( RayTracingSingleResult const &rslt )
+{
+	// the kd-tree can report hits past the end of the ray
+	return rslt.HitID != -1 && rslt.HitDistance < rslt.ray_length;
+}
+
+// Both have to agree whether the ray is blocked, and how far away
+static int CountMismatches( RayTracingSingleResult const *pA, RayTracingSingleResult const *pB, int nRays )
+{
+	int nMismatches = 0;
+	for ( int i = 0; i < nRays; i++ )
+	{
+		bool bHitA = IsHit( pA[i] );
+		if ( bHitA != IsHit( pB[i] ) ||
+			 ( bHitA && fabs( pA[i].HitDistance - pB[i].HitDistance ) > 0.01 + 1.0e-4 * pA[i].HitDistance ) )
+		{
+			nMismatches++;
+		}
+	}
+	return nMismatches;
+}
+
+static void PrintArgSummaryAndExit( void )
+{
+	printf( "format is 'rt_test trace.txt [-rays NUM]'\n" );
+	printf( "trace.txt is written by vrad -dumptrace.\n" );
+	printf( "-rays NUM\tSet the number of incoherent rays (default = %d).\n", DEFAULT_INCOHERENT_RAYS );
+	exit( 1 );
+}
+
+int main( int argc, char **argv )
+{
+	InitCommandLineProgram( argc, argv );
+
+	const char *pFilename = NULL;
+	int nIncoherentRays = DEFAULT_INCOHERENT_RAYS;
+	for ( int i = 1; i < argc; i++ )
+	{
+		if ( !Q_stricmp( argv[i], "-rays" ) && i + 1 < argc )
+		{
+			nIncoherentRays = atoi( argv[++i] );
+			nIncoherentRays = MAX( 4, nIncoherentRays );
+		}
+		else if ( argv[i][0] != '-' )
+			pFilename = argv[i];
+		else
+			PrintArgSummaryAndExit();
+	}
+	if ( !pFilename )
+		PrintArgSummaryAndExit();
+
+	// 0 is the kd-tree, 1 the BVH
+	static RayTracingEnvironment envs[2];
+	envs[1].Flags |= RTE_FLAGS_BVH;
+	const char *pNames[2] = { "kd-tree", "BVH" };
+
+	int nTris = LoadTriangles( pFilename, envs, 2 );
+	if ( nTris <= 0 )
+	{
+		printf( "couldn't read any triangles from %s\n", pFilename );
+		return 1;
+	}
+	printf( "%d triangles\n", nTris );
+
+	for ( int e = 0; e < 2; e++ )
+	{
+		double flStart = Plat_FloatTime();
+		envs[e].SetupAccelerationStructure();
+		printf( "%-8s build: %.3f seconds\n", pNames[e], Plat_FloatTime() - flStart );
+	}
+
+	CUtlVector<TestRay_t> coherent, incoherent;
+	MakeCoherentRays( envs[0], coherent );
+	MakeIncoherentRays( envs[0], nIncoherentRays & ~3, incoherent );
+
+	struct
+	{
+		const char *m_pName;
+		CUtlVector<TestRay_t> *m_pRays;
+		TraceMode_t m_Mode;
+	} tests[] =
+	{
+		{ "coherent packets", &coherent, TRACE_PACKETS },
+		{ "incoherent packets", &incoherent, TRACE_PACKETS },
+		{ "incoherent stream", &incoherent, TRACE_STREAM },
+		{ "incoherent single", &incoherent, TRACE_SINGLE },
+	};
+
+	int nMaxRays = MAX( coherent.Count(), incoherent.Count() );
+	RayTracingSingleResult *pResults[2];
+	pResults[0] = new RayTracingSingleResult[nMaxRays];
+	pResults[1] = new RayTracingSingleResult[nMaxRays];
+
+	int nTotalMismatches = 0;
+	printf( "%-20s %14s %14s %8s %10s\n", "", "kd-tree ray/s", "BVH ray/s", "speedup", "mismatches" );
+	for ( int t = 0; t < ARRAYSIZE( tests ); t++ )
+	{
+		int nRays = tests[t].m_pRays->Count();
+		double flRate[2];
+		for ( int e = 0; e < 2; e++ )
+			flRate[e] = nRays / MAX( TraceRays( envs[e], *tests[t].m_pRays, tests[t].m_Mode, pResults[e] ), 1.0e-6 );
+
+		int nMismatches = CountMismatches( pResults[0], pResults[1], nRays );
+		nTotalMismatches += nMismatches;
+		printf( "%-20s %14.0f %14.0f %7.2fx %10d\n", tests[t].m_pName, flRate[0], flRate[1], flRate[1] / flRate[0], nMismatches );
+	}
+
+	delete[] pResults[0];
+	delete[] pResults[1];
+	return nTotalMismatches ? 1 : 0;
+}
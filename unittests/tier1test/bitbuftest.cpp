@@ -0,0 +1,396 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Unit tests and microbenchmarks for bf_write / bf_read
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#include "unitlib/unitlib.h"
+#include "tier0/platform.h"
+#include "tier0/fasttimer.h"
+#include "tier1/bitbuf.h"
+#include "tier1/strtools.h"
+#include "coordsize.h"
+
+DEFINE_TESTSUITE( BitBufTestSuite )
+
+//-----------------------------------------------------------------------------
+// Bit-at-a-time reference encoders matching the wire format the fast paths
+// in bitbuf.cpp must keep producing.
+//-----------------------------------------------------------------------------
+static void RefWriteBitCoord( bf_write &buf, float f )
+{
+	int signbit = ( f <= -COORD_RESOLUTION );
+	int intval = (int)abs( f );
+	int fractval = abs( (int)( f * COORD_DENOMINATOR ) ) & ( COORD_DENOMINATOR - 1 );
+
+	buf.WriteOneBit( intval );
+	buf.WriteOneBit( fractval );
+	if ( intval || fractval )
+	{
+		buf.WriteOneBit( signbit );
+		if ( intval )
+		{
+			buf.WriteUBitLong( (unsigned int)( intval - 1 ), COORD_INTEGER_BITS );
+		}
+		if ( fractval )
+		{
+			buf.WriteUBitLong( (unsigned int)fractval, COORD_FRACTIONAL_BITS );
+		}
+	}
+}
+
+static void RefWriteBitVec3Coord( bf_write &buf, const Vector &v )
+{
+	int xflag = ( v[0] >= COORD_RESOLUTION ) || ( v[0] <= -COORD_RESOLUTION );
+	int yflag = ( v[1] >= COORD_RESOLUTION ) || ( v[1] <= -COORD_RESOLUTION );
+	int zflag = ( v[2] >= COORD_RESOLUTION ) || ( v[2] <= -COORD_RESOLUTION );
+
+	buf.WriteOneBit( xflag );
+	buf.WriteOneBit( yflag );
+	buf.WriteOneBit( zflag );
+	if ( xflag )
+		RefWriteBitCoord( buf, v[0] );
+	if ( yflag )
+		RefWriteBitCoord( buf, v[1] );
+	if ( zflag )
+		RefWriteBitCoord( buf, v[2] );
+}
+
+static void RefWriteBitNormal( bf_write &buf, float f )
+{
+	int signbit = ( f <= -NORMAL_RESOLUTION );
+	unsigned int fractval = abs( (int)( f * NORMAL_DENOMINATOR ) );
+	if ( fractval > NORMAL_DENOMINATOR )
+		fractval = NORMAL_DENOMINATOR;
+
+	buf.WriteOneBit( signbit );
+	buf.WriteUBitLong( fractval, NORMAL_FRACTIONAL_BITS );
+}
+
+static void RefWriteBitVec3Normal( bf_write &buf, const Vector &v )
+{
+	int xflag = ( v[0] >= NORMAL_RESOLUTION ) || ( v[0] <= -NORMAL_RESOLUTION );
+	int yflag = ( v[1] >= NORMAL_RESOLUTION ) || ( v[1] <= -NORMAL_RESOLUTION );
+
+	buf.WriteOneBit( xflag );
+	buf.WriteOneBit( yflag );
+	if ( xflag )
+		RefWriteBitNormal( buf, v[0] );
+	if ( yflag )
+		RefWriteBitNormal( buf, v[1] );
+	buf.WriteOneBit( v[2] <= -NORMAL_RESOLUTION );
+}
+
+static void RefWriteBytes( bf_write &buf, const void *pData, int nBytes )
+{
+	const unsigned char *p = (const unsigned char *)pData;
+	for ( int i = 0; i < nBytes; i++ )
+	{
+		for ( int nBit = 0; nBit < 8; nBit++ )
+		{
+			buf.WriteOneBit( ( p[i] >> nBit ) & 1 );
+		}
+	}
+}
+
+static const float s_TestCoords[] = { 0.0f, 0.01f, 0.03125f, -0.03125f, 1.0f, -1.0f, 15.5f, -200.25f, 4095.96875f, -16383.0f, 16384.0f, 0.5f };
+static const char *s_TestStrings[] = { "", "a", "player", "weapon_smg1\n", "models/props_c17/oildrum001.mdl" };
+
+#define BITBUF_TEST_BYTES	2048
+
+// Compares bit ranges a dword at a time through ReadUBitLong, so the check
+// doesn't lean on any of the code under test's block paths
+static bool CompareBits( const void *pA, int nStartA, const void *pB, int nStartB, int nBits )
+{
+	bf_read ra( pA, BITBUF_TEST_BYTES );
+	bf_read rb( pB, BITBUF_TEST_BYTES );
+	ra.Seek( nStartA );
+	rb.Seek( nStartB );
+	while ( nBits > 0 )
+	{
+		int nChunk = MIN( nBits, 32 );
+		if ( ra.ReadUBitLong( nChunk ) != rb.ReadUBitLong( nChunk ) )
+			return false;
+		nBits -= nChunk;
+	}
+	return true;
+}
+
+static bool CompareBuffers( const bf_write &a, const bf_write &b )
+{
+	if ( a.GetNumBitsWritten() != b.GetNumBitsWritten() || a.IsOverflowed() != b.IsOverflowed() )
+		return false;
+
+	return CompareBits( a.GetData(), 0, b.GetData(), 0, a.GetNumBitsWritten() );
+}
+
+static void EncodeTests()
+{
+	ALIGN16 unsigned char fastData[BITBUF_TEST_BYTES] ALIGN16_POST;
+	ALIGN16 unsigned char refData[BITBUF_TEST_BYTES] ALIGN16_POST;
+	ALIGN16 unsigned char blob[256] ALIGN16_POST;
+	for ( int i = 0; i < (int)sizeof( blob ); i++ )
+	{
+		blob[i] = (unsigned char)( i * 37 + 11 );
+	}
+
+	// Every encoder at every starting bit offset within a dword
+	for ( int nStartBit = 0; nStartBit < 32; nStartBit++ )
+	{
+		memset( fastData, 0xCD, sizeof( fastData ) );
+		memset( refData, 0xCD, sizeof( refData ) );
+		bf_write fast( "fast", fastData, sizeof( fastData ) );
+		bf_write ref( "ref", refData, sizeof( refData ) );
+		fast.WriteUBitLong( 0x5A5A5A5A, nStartBit );
+		ref.WriteUBitLong( 0x5A5A5A5A, nStartBit );
+
+		for ( int i = 0; i < (int)ARRAYSIZE( s_TestCoords ); i++ )
+		{
+			fast.WriteBitCoord( s_TestCoords[i] );
+			RefWriteBitCoord( ref, s_TestCoords[i] );
+
+			Vector v( s_TestCoords[i], s_TestCoords[ ( i + 3 ) % ARRAYSIZE( s_TestCoords ) ], 0.0f );
+			fast.WriteBitVec3Coord( v );
+			RefWriteBitVec3Coord( ref, v );
+
+			Vector n( s_TestCoords[i] / 16384.0f, -0.5f, ( i & 1 ) ? -0.25f : 0.25f );
+			fast.WriteBitVec3Normal( n );
+			RefWriteBitVec3Normal( ref, n );
+			fast.WriteBitNormal( n.x );
+			RefWriteBitNormal( ref, n.x );
+		}
+
+		for ( int i = 0; i < (int)ARRAYSIZE( s_TestStrings ); i++ )
+		{
+			fast.WriteString( s_TestStrings[i] );
+			RefWriteBytes( ref, s_TestStrings[i], V_strlen( s_TestStrings[i] ) + 1 );
+		}
+
+		// Blobs starting at every alignment of the source pointer
+		for ( int i = 0; i < 4; i++ )
+		{
+			fast.WriteBytes( blob + i, 61 );
+			RefWriteBytes( ref, blob + i, 61 );
+		}
+
+		Shipping_Assert( !fast.IsOverflowed() );
+		Shipping_Assert( CompareBuffers( fast, ref ) );
+
+		// Decode it all back
+		bf_read in( "in", fastData, sizeof( fastData ), fast.GetNumBitsWritten() );
+		in.Seek( nStartBit );
+		for ( int i = 0; i < (int)ARRAYSIZE( s_TestCoords ); i++ )
+		{
+			float fExpected = (int)( s_TestCoords[i] * COORD_DENOMINATOR ) / (float)COORD_DENOMINATOR;
+			if ( fabs( s_TestCoords[i] ) >= ( 1 << COORD_INTEGER_BITS ) )
+			{
+				// Out of range integers wrap, just make sure the stream stays in sync
+				in.ReadBitCoord();
+			}
+			else
+			{
+				Shipping_Assert( in.ReadBitCoord() == fExpected );
+			}
+
+			Vector v;
+			in.ReadBitVec3Coord( v );
+			Shipping_Assert( v.z == 0.0f );
+
+			Vector n;
+			in.ReadBitVec3Normal( n );
+			Shipping_Assert( fabs( n.y + 0.5f ) < 0.001f );
+			if ( n.z != 0.0f )
+			{
+				// z is only implied when x and y don't already make a unit vector
+				Shipping_Assert( ( n.z < 0.0f ) == ( ( i & 1 ) != 0 ) );
+			}
+			Shipping_Assert( fabs( in.ReadBitNormal() - n.x ) < 0.001f );
+		}
+
+		for ( int i = 0; i < (int)ARRAYSIZE( s_TestStrings ); i++ )
+		{
+			char str[64];
+			Shipping_Assert( in.ReadString( str, sizeof( str ) ) );
+			Shipping_Assert( !V_strcmp( str, s_TestStrings[i] ) );
+		}
+
+		for ( int i = 0; i < 4; i++ )
+		{
+			unsigned char out[64];
+			Shipping_Assert( in.ReadBytes( out, 61 ) );
+			Shipping_Assert( !memcmp( out, blob + i, 61 ) );
+		}
+
+		Shipping_Assert( !in.IsOverflowed() );
+		Shipping_Assert( in.GetNumBitsLeft() == 0 );
+
+		// Copying between buffers must match regardless of either side's alignment
+		ALIGN16 unsigned char copyData[BITBUF_TEST_BYTES] ALIGN16_POST;
+		for ( int nDestBit = 0; nDestBit < 9; nDestBit++ )
+		{
+			in.Seek( nStartBit );
+			bf_write copy( "copy", copyData, sizeof( copyData ) );
+			copy.WriteUBitLong( 0, nDestBit );
+			copy.WriteBitsFromBuffer( &in, fast.GetNumBitsWritten() - nStartBit );
+
+			Shipping_Assert( !copy.IsOverflowed() );
+			Shipping_Assert( CompareBits( fastData, nStartBit, copyData, nDestBit, fast.GetNumBitsWritten() - nStartBit ) );
+		}
+	}
+
+	// Strings that don't fit, or aren't terminated, keep their old behaviour
+	{
+		uint32 data[2];
+		bf_write out( data, sizeof( data ) );
+		out.SetAssertOnOverflow( false );
+		Shipping_Assert( !out.WriteString( "this is too long" ) );
+		Shipping_Assert( out.IsOverflowed() );
+
+		bf_read in( data, sizeof( data ) );
+		in.SetAssertOnOverflow( false );
+		char str[32];
+		Shipping_Assert( !in.ReadString( str, sizeof( str ) ) );
+		Shipping_Assert( !V_strncmp( str, "this is ", 8 ) );
+
+		bf_write shortOut( data, sizeof( data ) );
+		shortOut.WriteString( "abcdef" );
+		bf_read shortIn( data, sizeof( data ) );
+		Shipping_Assert( !shortIn.ReadString( str, 4 ) );
+		Shipping_Assert( !V_strcmp( str, "abc" ) );
+		Shipping_Assert( shortIn.GetNumBitsRead() == 7 * 8 );
+	}
+}
+
+DEFINE_TESTCASE( BitBufEncodeTest, BitBufTestSuite )
+{
+	Msg( "Running bf_write/bf_read encoder tests\n" );
+
+	EncodeTests();
+}
+
+
+//-----------------------------------------------------------------------------
+// Microbenchmarks, shaped like the messages that dominate server traffic
+//-----------------------------------------------------------------------------
+#define BITBUF_BENCH_ITERATIONS		20000
+#define BITBUF_BENCH_BYTES			4096
+
+// An entity delta as written by dt_encode: field index deltas, then mostly
+// coords, normals and small ints
+static void WriteEntityDelta( bf_write &buf, int nSeed )
+{
+	for ( int i = 0; i < 24; i++ )
+	{
+		buf.WriteUBitVar( ( i * 7 + nSeed ) & 63 );
+		switch ( i & 3 )
+		{
+		case 0: buf.WriteBitVec3Coord( Vector( nSeed * 0.25f, -i * 3.5f, 128.0f ) ); break;
+		case 1: buf.WriteBitVec3Normal( Vector( 0.6f, -0.48f, 0.64f ) ); break;
+		case 2: buf.WriteBitCoord( i * 1.03125f - nSeed ); break;
+		case 3: buf.WriteUBitLong( nSeed + i, 11 ); break;
+		}
+	}
+}
+
+static void ReadEntityDelta( bf_read &buf )
+{
+	Vector v;
+	for ( int i = 0; i < 24; i++ )
+	{
+		buf.ReadUBitVar();
+		switch ( i & 3 )
+		{
+		case 0: buf.ReadBitVec3Coord( v ); break;
+		case 1: buf.ReadBitVec3Normal( v ); break;
+		case 2: buf.ReadBitCoord(); break;
+		case 3: buf.ReadUBitLong( 11 ); break;
+		}
+	}
+}
+
+// Net messages: a type, some strings (convars, string table entries) and a
+// payload at an arbitrary bit offset
+static void WriteNetMessages( bf_write &buf, const unsigned char *pPayload )
+{
+	for ( int i = 0; i < 8; i++ )
+	{
+		buf.WriteUBitLong( i + 3, 6 );
+		buf.WriteString( "sv_cheats" );
+		buf.WriteString( "models/props_junk/watermelon01.mdl" );
+		buf.WriteOneBit( i & 1 );
+		buf.WriteUBitLong( 300, 20 );
+		buf.WriteBits( pPayload, 300 );
+	}
+}
+
+static void ReadNetMessages( bf_read &buf, unsigned char *pPayload )
+{
+	char str[256];
+	for ( int i = 0; i < 8; i++ )
+	{
+		buf.ReadUBitLong( 6 );
+		buf.ReadString( str, sizeof( str ) );
+		buf.ReadString( str, sizeof( str ) );
+		buf.ReadOneBit();
+		int nBits = buf.ReadUBitLong( 20 );
+		buf.ReadBits( pPayload, nBits );
+	}
+}
+
+DEFINE_TESTCASE( BitBufBenchmark, BitBufTestSuite )
+{
+	Msg( "Running bf_write/bf_read benchmarks\n" );
+
+	ALIGN16 unsigned char data[BITBUF_BENCH_BYTES] ALIGN16_POST;
+	ALIGN16 unsigned char payload[64] ALIGN16_POST;
+	for ( int i = 0; i < (int)sizeof( payload ); i++ )
+	{
+		payload[i] = (unsigned char)i;
+	}
+
+	CFastTimer timer;
+	int nBits = 0;
+
+	timer.Start();
+	for ( int i = 0; i < BITBUF_BENCH_ITERATIONS; i++ )
+	{
+		bf_write buf( data, sizeof( data ) );
+		WriteEntityDelta( buf, i );
+		nBits = buf.GetNumBitsWritten();
+	}
+	timer.End();
+	Msg( "entity delta write: %.1f ns/msg (%d bits)\n", timer.GetDuration().GetMicrosecondsF() * 1000.0 / BITBUF_BENCH_ITERATIONS, nBits );
+
+	timer.Start();
+	for ( int i = 0; i < BITBUF_BENCH_ITERATIONS; i++ )
+	{
+		bf_read buf( data, sizeof( data ), nBits );
+		ReadEntityDelta( buf );
+		Shipping_Assert( !buf.IsOverflowed() );
+	}
+	timer.End();
+	Msg( "entity delta read:  %.1f ns/msg\n", timer.GetDuration().GetMicrosecondsF() * 1000.0 / BITBUF_BENCH_ITERATIONS );
+
+	timer.Start();
+	for ( int i = 0; i < BITBUF_BENCH_ITERATIONS; i++ )
+	{
+		bf_write buf( data, sizeof( data ) );
+		WriteNetMessages( buf, payload );
+		nBits = buf.GetNumBitsWritten();
+	}
+	timer.End();
+	Msg( "net messages write: %.1f ns/msg (%d bits)\n", timer.GetDuration().GetMicrosecondsF() * 1000.0 / BITBUF_BENCH_ITERATIONS, nBits );
+
+	unsigned char readPayload[64];
+	timer.Start();
+	for ( int i = 0; i < BITBUF_BENCH_ITERATIONS; i++ )
+	{
+		bf_read buf( data, sizeof( data ), nBits );
+		ReadNetMessages( buf, readPayload );
+		Shipping_Assert( !buf.IsOverflowed() );
+	}
+	timer.End();
+	Msg( "net messages read:  %.1f ns/msg\n", timer.GetDuration().GetMicrosecondsF() * 1000.0 / BITBUF_BENCH_ITERATIONS );
+	Shipping_Assert( !memcmp( readPayload, payload, 300 / 8 ) );
+}
@@ -0,0 +1,116 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Unit tests for CDataManager eviction, LRU and CLOCK
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#include "unitlib/unitlib.h"
+#include "tier0/platform.h"
+#include "tier1/datamanager.h"
+
+DEFINE_TESTSUITE( DataManagerTestSuite )
+
+static int s_nDestroyed;
+
+struct TestResource_t
+{
+	static TestResource_t *CreateResource( int nSize )	{ TestResource_t *p = new TestResource_t; p->m_nSize = nSize; return p; }
+	static unsigned int EstimatedSize( int nSize )		{ return nSize; }
+	void DestroyResource()								{ s_nDestroyed++; delete this; }
+	TestResource_t *GetData()							{ return this; }
+	unsigned int Size()									{ return m_nSize; }
+
+	int m_nSize;
+};
+
+typedef CDataManager<TestResource_t, int, TestResource_t *, CThreadFastMutex> CTestDataManager;
+
+static bool IsPresent( CTestDataManager &manager, memhandle_t h )
+{
+	return manager.GetResource_NoLockNoLRUTouch( h ) != NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Room for three resources. A is touched before D goes in: plain LRU moves
+// it to the back, CLOCK marks it and passes it over once, either way the
+// untouched B goes first.
+//-----------------------------------------------------------------------------
+static void EvictionTest( bool bClock )
+{
+	CTestDataManager manager( 3 );
+	manager.SetClockReplacement( bClock );
+	s_nDestroyed = 0;
+
+	memhandle_t hA = manager.CreateResource( 1 );
+	memhandle_t hB = manager.CreateResource( 1 );
+	memhandle_t hC = manager.CreateResource( 1 );
+	Shipping_Assert( manager.ResourceCount() == 3 && manager.UsedSize() == 3 );
+
+	manager.TouchResource( hA );
+	memhandle_t hD = manager.CreateResource( 1 );
+	Shipping_Assert( IsPresent( manager, hA ) && !IsPresent( manager, hB ) && IsPresent( manager, hC ) && IsPresent( manager, hD ) );
+	Shipping_Assert( s_nDestroyed == 1 );
+
+	// Nothing touched since, C is the oldest
+	memhandle_t hE = manager.CreateResource( 1 );
+	Shipping_Assert( IsPresent( manager, hA ) && !IsPresent( manager, hC ) );
+
+	// Locked resources are never evicted, aged ones go first
+	manager.LockResource( hD );
+	manager.TouchResource( hE );
+	manager.MarkAsStale( hE );
+	manager.CreateResource( 1 );
+	Shipping_Assert( IsPresent( manager, hA ) && IsPresent( manager, hD ) && !IsPresent( manager, hE ) );
+
+	// With everything touched eviction still makes room
+	manager.TouchResource( hA );
+	manager.CreateResource( 1 );
+	Shipping_Assert( manager.UsedSize() == 3 && manager.ResourceCount() == 3 && IsPresent( manager, hD ) );
+	Shipping_Assert( s_nDestroyed == 4 );
+
+	manager.UnlockResource( hD );
+	manager.FlushAll();
+	Shipping_Assert( manager.ResourceCount() == 0 && s_nDestroyed == 7 );
+}
+
+//-----------------------------------------------------------------------------
+// Touching under CLOCK doesn't reorder anything, so a purge walks the
+// resources in the order they were added, skipping the touched ones once
+//-----------------------------------------------------------------------------
+static void ClockOrderTest()
+{
+	CTestDataManager manager;
+	manager.SetClockReplacement( true );
+	s_nDestroyed = 0;
+
+	memhandle_t h[8];
+	for ( int i = 0; i < 8; i++ )
+	{
+		h[i] = manager.CreateResource( 1 );
+	}
+	for ( int i = 0; i < 8; i += 2 )
+	{
+		manager.TouchResource( h[i] );
+	}
+
+	Shipping_Assert( manager.Purge( 4 ) == 4 );
+	for ( int i = 0; i < 8; i++ )
+	{
+		Shipping_Assert( IsPresent( manager, h[i] ) == ( ( i & 1 ) == 0 ) );
+	}
+
+	// The second chance is used up
+	Shipping_Assert( manager.Purge( 2 ) == 2 );
+	Shipping_Assert( !IsPresent( manager, h[0] ) && !IsPresent( manager, h[2] ) && IsPresent( manager, h[4] ) );
+	manager.FlushAll();
+}
+
+DEFINE_TESTCASE( DataManagerTest, DataManagerTestSuite )
+{
+	Msg( "Running CDataManager tests\n" );
+
+	EvictionTest( false );
+	EvictionTest( true );
+	ClockOrderTest();
+}
@@ -0,0 +1,264 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Unit tests and yield benchmark for CFiberJob
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#include "unitlib/unitlib.h"
+#include "tier0/platform.h"
+#include "tier0/fasttimer.h"
+#include "tier0/threadtools.h"
+#include "vstdlib/jobfiber.h"
+
+DEFINE_TESTSUITE( FiberJobTestSuite )
+
+#define FIBERJOB_TEST_FIBERS		64
+#define FIBERJOB_TEST_YIELDS		8
+
+static CInterlockedInt g_nFibersStarted;
+static CInterlockedInt g_nFibersFinished;
+
+class CTestFiberJob : public CFiberJob
+{
+public:
+	CTestFiberJob( CThreadEvent *pGate, CJob *pGateJob, int nYields )
+	  : m_pGate( pGate ),
+		m_pGateJob( pGateJob ),
+		m_nPoolYields( nYields ),
+		m_nStartThread( 0 ),
+		m_nEndThread( 0 ),
+		m_bRanToEnd( false )
+	{
+	}
+
+	virtual JobStatus_t DoFiberExecute()
+	{
+		Shipping_Assert( GetCurrent() == this );
+		m_nStartThread = ThreadGetCurrentId();
+		++g_nFibersStarted;
+
+		if ( m_pGate )
+		{
+			YieldUntilSet( m_pGate );
+		}
+		if ( m_pGateJob )
+		{
+			FiberJob_YieldUntilFinished( m_pGateJob );
+			Shipping_Assert( m_pGateJob->IsFinished() );
+		}
+		for ( int i = 0; i < m_nPoolYields; i++ )
+		{
+			YieldToPool();
+			Shipping_Assert( GetCurrent() == this );
+		}
+
+		m_nEndThread = ThreadGetCurrentId();
+		m_bRanToEnd = true;
+		++g_nFibersFinished;
+		return JOB_OK;
+	}
+
+	CThreadEvent *m_pGate;
+	CJob *m_pGateJob;
+	int m_nPoolYields;
+	ThreadId_t m_nStartThread;
+	ThreadId_t m_nEndThread;
+	bool m_bRanToEnd;
+};
+
+static void NoOp()
+{
+}
+
+static IThreadPool *StartTestPool( int nThreads )
+{
+	IThreadPool *pPool = CreateThreadPool();
+	ThreadPoolStartParams_t params;
+	params.nThreads = nThreads;
+	pPool->Start( params );
+	return pPool;
+}
+
+static void StopTestPool( IThreadPool *pPool )
+{
+	pPool->Stop();
+	DestroyThreadPool( pPool );
+}
+
+//-----------------------------------------------------------------------------
+// More fibers wait than the pool has threads; if waiting blocked a worker
+// the pool would deadlock
+//-----------------------------------------------------------------------------
+static void WaitTests( IThreadPool *pPool )
+{
+	CThreadEvent gate( true );
+	CJob *pGateJob = new CFunctorJob( CreateFunctor( NoOp ) );
+
+	g_nFibersStarted = 0;
+	g_nFibersFinished = 0;
+
+	CTestFiberJob *pFibers[FIBERJOB_TEST_FIBERS];
+	for ( int i = 0; i < FIBERJOB_TEST_FIBERS; i++ )
+	{
+		// Half wait on the event, half on the job
+		pFibers[i] = new CTestFiberJob( ( i & 1 ) ? &gate : NULL, ( i & 1 ) ? NULL : pGateJob, FIBERJOB_TEST_YIELDS );
+		pPool->AddJob( pFibers[i] );
+	}
+
+	// Every fiber gets to its wait even though neither gate is open
+	while ( g_nFibersStarted != FIBERJOB_TEST_FIBERS )
+	{
+		ThreadSleep( 1 );
+	}
+	Shipping_Assert( g_nFibersFinished == 0 );
+
+	gate.Set();
+	pGateJob->Execute();
+
+	int nMigrated = 0;
+	for ( int i = 0; i < FIBERJOB_TEST_FIBERS; i++ )
+	{
+		pPool->YieldWait( pFibers[i] );
+		Shipping_Assert( pFibers[i]->Executed() && pFibers[i]->m_bRanToEnd );
+		// The gate may have opened before a fiber got to suspend on it
+		Shipping_Assert( pFibers[i]->GetYieldCount() >= FIBERJOB_TEST_YIELDS );
+		nMigrated += ( pFibers[i]->m_nStartThread != pFibers[i]->m_nEndThread );
+		pFibers[i]->Release();
+	}
+	Shipping_Assert( g_nFibersFinished == FIBERJOB_TEST_FIBERS );
+	Msg( "%d of %d fibers finished on a different thread than they started on\n", nMigrated, FIBERJOB_TEST_FIBERS );
+
+	pGateJob->Release();
+}
+
+//-----------------------------------------------------------------------------
+// Waits that are already satisfied don't suspend, and yields off a fiber
+// don't break anything
+//-----------------------------------------------------------------------------
+static void ImmediateTests( IThreadPool *pPool )
+{
+	CThreadEvent gate( true );
+	gate.Set();
+	CJob *pGateJob = new CFunctorJob( CreateFunctor( NoOp ) );
+	pGateJob->Execute();
+
+	CTestFiberJob *pFiber = new CTestFiberJob( &gate, pGateJob, 0 );
+	pPool->AddJob( pFiber );
+	pPool->YieldWait( pFiber );
+	Shipping_Assert( pFiber->Executed() && pFiber->GetYieldCount() == 0 );
+	pFiber->Release();
+
+	Shipping_Assert( CFiberJob::GetCurrent() == NULL );
+	FiberJob_YieldUntilFinished( pGateJob );
+	FiberJob_YieldUntilSet( &gate );
+
+	// Fiber stacks are reused once a fiber has finished
+	for ( int i = 0; i < FIBERJOB_TEST_FIBERS * 4; i++ )
+	{
+		CFiberJob *pFunctorFiber = new CFunctorFiberJob( CreateFunctor( NoOp ) );
+		pPool->AddJob( pFunctorFiber );
+		pPool->YieldWait( pFunctorFiber );
+		Shipping_Assert( pFunctorFiber->Executed() );
+		pFunctorFiber->Release();
+	}
+
+	pGateJob->Release();
+}
+
+DEFINE_TESTCASE( FiberJobTest, FiberJobTestSuite )
+{
+	Msg( "Running CFiberJob tests\n" );
+
+	IThreadPool *pPool = StartTestPool( 2 );
+
+	ImmediateTests( pPool );
+	if ( CFiberJob::IsSupported() )
+	{
+		WaitTests( pPool );
+	}
+
+	StopTestPool( pPool );
+	FiberJob_Shutdown();
+}
+
+
+//-----------------------------------------------------------------------------
+// Cost of yielding. With nothing else queued a yield switches straight back
+// into the fiber, and a fiber waiting on a job is queued again by the worker
+// that runs the job, so neither should cost a thread wakeup.
+//-----------------------------------------------------------------------------
+#define FIBERJOB_BENCH_YIELDS	20000
+#define FIBERJOB_BENCH_WAITS	2000
+
+// Queues a job and waits on it, over and over
+class CJobWaitFiberJob : public CFiberJob
+{
+public:
+	virtual JobStatus_t DoFiberExecute()
+	{
+		for ( int i = 0; i < FIBERJOB_BENCH_WAITS; i++ )
+		{
+			CJob *pJob = new CFunctorJob( CreateFunctor( NoOp ) );
+			pJob->SetFlags( JF_QUEUE );
+			GetThreadPool()->AddJob( pJob );
+			YieldUntilFinished( pJob );
+			Shipping_Assert( pJob->IsFinished() );
+			pJob->Release();
+		}
+		return JOB_OK;
+	}
+};
+
+DEFINE_TESTCASE( FiberJobBenchmark, FiberJobTestSuite )
+{
+	Msg( "Running CFiberJob yield benchmark\n" );
+
+	if ( !CFiberJob::IsSupported() )
+	{
+		Msg( "Fibers not supported on this platform\n" );
+		return;
+	}
+
+	IThreadPool *pPool = StartTestPool( 1 );
+
+	// Baseline, a plain job going through the same queue
+	CFastTimer timer;
+	timer.Start();
+	for ( int i = 0; i < FIBERJOB_BENCH_YIELDS / 10; i++ )
+	{
+		CJob *pJob = new CFunctorJob( CreateFunctor( NoOp ) );
+		pJob->SetFlags( JF_QUEUE );
+		pPool->AddJob( pJob );
+		pJob->AccessEvent()->Wait();
+		pJob->Release();
+	}
+	timer.End();
+	Msg( "%.2f us/job round trip\n", timer.GetDuration().GetMicrosecondsF() / ( FIBERJOB_BENCH_YIELDS / 10 ) );
+
+	CTestFiberJob *pFiber = new CTestFiberJob( NULL, NULL, FIBERJOB_BENCH_YIELDS );
+	timer.Start();
+	pPool->AddJob( pFiber );
+	// Block rather than YieldWait(), which spins on POSIX and would compete
+	// with the worker
+	pFiber->AccessEvent()->Wait();
+	timer.End();
+
+	Shipping_Assert( pFiber->Executed() && pFiber->GetYieldCount() == FIBERJOB_BENCH_YIELDS );
+	Msg( "%.2f us/yield\n", timer.GetDuration().GetMicrosecondsF() / FIBERJOB_BENCH_YIELDS );
+	pFiber->Release();
+
+	// The single worker runs the job, then picks the fiber up again
+	CJobWaitFiberJob *pWaitFiber = new CJobWaitFiberJob;
+	timer.Start();
+	pPool->AddJob( pWaitFiber );
+	pWaitFiber->AccessEvent()->Wait();
+	timer.End();
+
+	Shipping_Assert( pWaitFiber->Executed() );
+	Msg( "%.2f us/job wait\n", timer.GetDuration().GetMicrosecondsF() / FIBERJOB_BENCH_WAITS );
+	pWaitFiber->Release();
+
+	StopTestPool( pPool );
+	FiberJob_Shutdown();
+}
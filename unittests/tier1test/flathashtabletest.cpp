@@ -0,0 +1,274 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Unit tests and lookup benchmark for CUtlFlatHashtable
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#include "unitlib/unitlib.h"
+#include "tier0/platform.h"
+#include "tier0/fasttimer.h"
+#include "tier1/utlflathashtable.h"
+#include "tier1/utlhashtable.h"
+#include "tier1/utldict.h"
+#include "tier1/utlmap.h"
+#include "tier1/strtools.h"
+
+DEFINE_TESTSUITE( FlatHashtableTestSuite )
+
+#define FLATHASH_TEST_KEYS		8192
+#define FLATHASH_TEST_OPS		200000
+
+typedef CUtlFlatHashtable< const char *, int, CaselessStringHashFunctor, CaselessStringEqualFunctor > CaselessFlatDict_t;
+typedef CUtlHashtable< const char *, int, CaselessStringHashFunctor, CaselessStringEqualFunctor > CaselessHashDict_t;
+
+static char s_TestNames[FLATHASH_TEST_KEYS][48];
+
+static void BuildTestNames()
+{
+	for ( int i = 0; i < FLATHASH_TEST_KEYS; i++ )
+	{
+		V_snprintf( s_TestNames[i], sizeof( s_TestNames[i] ), "materials/models/props/test_%d.vmt", i );
+	}
+}
+
+static uint32 s_nRandSeed;
+static uint32 NextRand()
+{
+	s_nRandSeed = s_nRandSeed * 1664525 + 1013904223;
+	return s_nRandSeed >> 8;
+}
+
+//-----------------------------------------------------------------------------
+// Random inserts and removes checked against a CUtlMap
+//-----------------------------------------------------------------------------
+static void RandomOpTests()
+{
+	CUtlFlatHashtable< int, int > table;
+	CUtlMap< int, int > reference( DefLessFunc( int ) );
+
+	s_nRandSeed = 1;
+	for ( int nOp = 0; nOp < FLATHASH_TEST_OPS; nOp++ )
+	{
+		// Small key range, so there's lots of hits, removes and tombstones
+		int nKey = (int)( NextRand() % 2048 ) - 1024;
+		switch ( NextRand() % 4 )
+		{
+		case 0:
+		case 1:
+			{
+				bool bDidInsert;
+				UtlFlatHashHandle_t h = table.Insert( nKey, nOp, &bDidInsert );
+				Shipping_Assert( table.Key( h ) == nKey );
+				Shipping_Assert( bDidInsert == ( reference.Find( nKey ) == reference.InvalidIndex() ) );
+				if ( bDidInsert )
+				{
+					reference.Insert( nKey, nOp );
+				}
+				Shipping_Assert( table[h] == reference[ reference.Find( nKey ) ] );
+			}
+			break;
+
+		case 2:
+			{
+				bool bRemoved = table.Remove( nKey );
+				Shipping_Assert( bRemoved == reference.Remove( nKey ) );
+			}
+			break;
+
+		case 3:
+			{
+				UtlFlatHashHandle_t h = table.Find( nKey );
+				unsigned short r = reference.Find( nKey );
+				Shipping_Assert( ( h == table.InvalidHandle() ) == ( r == reference.InvalidIndex() ) );
+				if ( h != table.InvalidHandle() )
+				{
+					Shipping_Assert( table[h] == reference[r] );
+				}
+			}
+			break;
+		}
+
+		Shipping_Assert( table.Count() == (int)reference.Count() );
+	}
+
+	// Iteration must visit everything exactly once
+	int nVisited = 0;
+	FOR_EACH_FLATHASHTABLE( table, h )
+	{
+		unsigned short r = reference.Find( table.Key( h ) );
+		Shipping_Assert( r != reference.InvalidIndex() && reference[r] == table[h] );
+		++nVisited;
+	}
+	Shipping_Assert( nVisited == table.Count() );
+
+	// Removing while iterating
+	for ( UtlFlatHashHandle_t h = table.FirstHandle(); h != table.InvalidHandle(); )
+	{
+		h = ( table.Key( h ) & 1 ) ? table.RemoveAndAdvance( h ) : table.NextHandle( h );
+	}
+	FOR_EACH_FLATHASHTABLE( table, h )
+	{
+		Shipping_Assert( ( table.Key( h ) & 1 ) == 0 );
+	}
+
+	table.RemoveAll();
+	Shipping_Assert( table.Count() == 0 && table.FirstHandle() == table.InvalidHandle() );
+	Shipping_Assert( !table.HasElement( 0 ) );
+}
+
+//-----------------------------------------------------------------------------
+// Handles, string keys, sets
+//-----------------------------------------------------------------------------
+static void HandleAndKeyTypeTests()
+{
+	// Handles survive the removal of other elements
+	CUtlFlatHashtable< uint32, uint32 > table;
+	table.Reserve( FLATHASH_TEST_KEYS );
+	size_t nMemory = table.GetMemoryUsage();
+	UtlFlatHashHandle_t handles[FLATHASH_TEST_KEYS];
+	for ( uint32 i = 0; i < FLATHASH_TEST_KEYS; i++ )
+	{
+		handles[i] = table.Insert( i * 7919, i );
+	}
+	Shipping_Assert( table.GetMemoryUsage() == nMemory );
+	for ( uint32 i = 0; i < FLATHASH_TEST_KEYS; i += 2 )
+	{
+		table.RemoveByHandle( handles[i] );
+	}
+	for ( uint32 i = 1; i < FLATHASH_TEST_KEYS; i += 2 )
+	{
+		Shipping_Assert( table.IsValidHandle( handles[i] ) && table.Key( handles[i] ) == i * 7919 && table[ handles[i] ] == i );
+		Shipping_Assert( table.Find( i * 7919 ) == handles[i] );
+	}
+
+	// Churn through many more keys than the table holds at once, so tombstones
+	// have to be cleaned up without the table growing unbounded
+	CUtlFlatHashtable< uint32 > set;
+	for ( uint32 i = 0; i < FLATHASH_TEST_OPS; i++ )
+	{
+		set.Insert( i );
+		if ( i >= 64 )
+		{
+			Shipping_Assert( set.Remove( i - 64 ) );
+		}
+	}
+	Shipping_Assert( set.Count() == 64 );
+	Shipping_Assert( set.GetMemoryUsage() <= 1024 * sizeof( uint32 ) );
+	Shipping_Assert( set.HasElement( FLATHASH_TEST_OPS - 1 ) && !set.HasElement( 0 ) );
+
+	// Caseless string keys
+	CaselessFlatDict_t dict;
+	for ( int i = 0; i < FLATHASH_TEST_KEYS; i++ )
+	{
+		dict.Insert( s_TestNames[i], i );
+	}
+	Shipping_Assert( dict.Count() == FLATHASH_TEST_KEYS );
+	Shipping_Assert( dict.Get( "MATERIALS/models/props/TEST_17.vmt", -1 ) == 17 );
+	Shipping_Assert( dict.Get( "materials/models/props/test_.vmt", -1 ) == -1 );
+	Shipping_Assert( dict.Insert( "Materials/Models/Props/Test_5.vmt", 99 ) == dict.Find( s_TestNames[5] ) );
+	Shipping_Assert( *dict.GetPtr( s_TestNames[5] ) == 5 );
+}
+
+DEFINE_TESTCASE( FlatHashtableTest, FlatHashtableTestSuite )
+{
+	Msg( "Running CUtlFlatHashtable tests\n" );
+
+	BuildTestNames();
+	RandomOpTests();
+	HandleAndKeyTypeTests();
+}
+
+
+//-----------------------------------------------------------------------------
+// Lookup benchmark against the containers the hot dictionaries used to be
+//-----------------------------------------------------------------------------
+#define FLATHASH_BENCH_LOOKUPS	( 1 << 21 )
+
+template < class T >
+static void BenchmarkStringLookups( const char *pName, T &dict, int nKeys )
+{
+	CFastTimer timer;
+	int nFound = 0;
+	timer.Start();
+	for ( int i = 0; i < FLATHASH_BENCH_LOOKUPS; i++ )
+	{
+		// Half hits, half misses (the second half of the names was never added)
+		nFound += dict.Find( s_TestNames[ ( i * 37 ) % ( nKeys * 2 ) ] ) != dict.InvalidIndex();
+	}
+	timer.End();
+	Shipping_Assert( nFound == FLATHASH_BENCH_LOOKUPS / 2 );
+	Msg( "%5d names, %-18s %6.1f ns/lookup\n", nKeys, pName, timer.GetDuration().GetMicrosecondsF() * 1000.0 / FLATHASH_BENCH_LOOKUPS );
+}
+
+// Adapts the handle based hashtables to the Find()/InvalidIndex() shape of CUtlDict
+template < class T >
+class CHashtableDictAdapter
+{
+public:
+	typedef typename T::handle_t handle_t;
+	T m_table;
+	handle_t Find( const char *pName ) const { return m_table.Find( pName ); }
+	handle_t InvalidIndex() const { return m_table.InvalidHandle(); }
+};
+
+template < class T >
+static void BenchmarkIntLookups( const char *pName, T &map, int nKeys )
+{
+	CFastTimer timer;
+	int nFound = 0;
+	timer.Start();
+	for ( int i = 0; i < FLATHASH_BENCH_LOOKUPS; i++ )
+	{
+		nFound += map.Find( ( ( i * 37 ) % ( nKeys * 2 ) ) * 4099 ) != map.InvalidIndex();
+	}
+	timer.End();
+	Shipping_Assert( nFound == FLATHASH_BENCH_LOOKUPS / 2 );
+	Msg( "%5d ints,  %-18s %6.1f ns/lookup\n", nKeys, pName, timer.GetDuration().GetMicrosecondsF() * 1000.0 / FLATHASH_BENCH_LOOKUPS );
+}
+
+template < class T >
+class CHashtableMapAdapter
+{
+public:
+	typedef typename T::handle_t handle_t;
+	T m_table;
+	handle_t Find( int nKey ) const { return m_table.Find( nKey ); }
+	handle_t InvalidIndex() const { return m_table.InvalidHandle(); }
+};
+
+DEFINE_TESTCASE( FlatHashtableBenchmark, FlatHashtableTestSuite )
+{
+	Msg( "Running CUtlFlatHashtable lookup benchmark\n" );
+
+	BuildTestNames();
+
+	for ( int nKeys = 64; nKeys <= FLATHASH_TEST_KEYS / 2; nKeys *= 8 )
+	{
+		CUtlDict< int, int > dict;
+		CHashtableDictAdapter< CaselessHashDict_t > hashtable;
+		CHashtableDictAdapter< CaselessFlatDict_t > flat;
+
+		CUtlMap< int, int > map( DefLessFunc( int ) );
+		CHashtableMapAdapter< CUtlHashtable< int, int > > intHashtable;
+		CHashtableMapAdapter< CUtlFlatHashtable< int, int > > intFlat;
+
+		for ( int i = 0; i < nKeys; i++ )
+		{
+			dict.Insert( s_TestNames[i], i );
+			hashtable.m_table.Insert( s_TestNames[i], i );
+			flat.m_table.Insert( s_TestNames[i], i );
+
+			map.Insert( i * 4099, i );
+			intHashtable.m_table.Insert( i * 4099, i );
+			intFlat.m_table.Insert( i * 4099, i );
+		}
+
+		BenchmarkStringLookups( "CUtlDict", dict, nKeys );
+		BenchmarkStringLookups( "CUtlHashtable", hashtable, nKeys );
+		BenchmarkStringLookups( "CUtlFlatHashtable", flat, nKeys );
+		BenchmarkIntLookups( "CUtlMap", map, nKeys );
+		BenchmarkIntLookups( "CUtlHashtable", intHashtable, nKeys );
+		BenchmarkIntLookups( "CUtlFlatHashtable", intFlat, nKeys );
+	}
+}
@@ -0,0 +1,125 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Unit tests for CHdrHistogram
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#include "unitlib/unitlib.h"
+#include "tier0/platform.h"
+#include "tier1/hdrhistogram.h"
+
+DEFINE_TESTSUITE( HdrHistogramTestSuite )
+
+static uint32 s_nRandSeed;
+static uint32 NextRand()
+{
+	s_nRandSeed = s_nRandSeed * 1664525 + 1013904223;
+	return s_nRandSeed;
+}
+
+//-----------------------------------------------------------------------------
+// Every value lands in a bucket that contains it, and buckets are narrow
+// relative to their values
+//-----------------------------------------------------------------------------
+static void BucketTests()
+{
+	for ( uint32 v = 0; v < 70000; v++ )
+	{
+		int b = CHdrHistogram::BucketForValue( v );
+		Shipping_Assert( CHdrHistogram::BucketLowValue( b ) <= v && v <= CHdrHistogram::BucketHighValue( b ) );
+		if ( v )
+		{
+			Shipping_Assert( b >= CHdrHistogram::BucketForValue( v - 1 ) );
+		}
+	}
+
+	s_nRandSeed = 1;
+	for ( int i = 0; i < 100000; i++ )
+	{
+		uint32 v = NextRand() >> ( NextRand() % 32 );
+		int b = CHdrHistogram::BucketForValue( v );
+		Shipping_Assert( b >= 0 && b < CHdrHistogram::NUM_BUCKETS );
+		uint32 nLow = CHdrHistogram::BucketLowValue( b );
+		uint32 nHigh = CHdrHistogram::BucketHighValue( b );
+		Shipping_Assert( nLow <= v && v <= nHigh );
+		Shipping_Assert( (double)( nHigh - nLow ) <= (double)nLow / CHdrHistogram::SUB_BUCKETS );
+	}
+
+	Shipping_Assert( CHdrHistogram::BucketForValue( 0xFFFFFFFF ) == CHdrHistogram::NUM_BUCKETS - 1 );
+	Shipping_Assert( CHdrHistogram::BucketHighValue( CHdrHistogram::NUM_BUCKETS - 1 ) == 0xFFFFFFFF );
+}
+
+//-----------------------------------------------------------------------------
+// Percentiles of known distributions
+//-----------------------------------------------------------------------------
+static void PercentileTests()
+{
+	CHdrHistogram empty;
+	Shipping_Assert( empty.Count() == 0 && empty.Percentile( 99 ) == 0 && empty.Min() == 0 && empty.Max() == 0 );
+
+	// 1..100000 once each
+	CHdrHistogram uniform;
+	for ( uint32 v = 1; v <= 100000; v++ )
+	{
+		uniform.Record( v );
+	}
+	Shipping_Assert( uniform.Count() == 100000 && uniform.Min() == 1 && uniform.Max() == 100000 );
+	Shipping_Assert( fabs( uniform.Mean() - 50000.5 ) < 0.01 );
+
+	const float flPercents[] = { 1, 50, 90, 99, 99.9f, 100 };
+	for ( int i = 0; i < (int)ARRAYSIZE( flPercents ); i++ )
+	{
+		double flExpected = flPercents[i] * 1000.0;
+		double flActual = uniform.Percentile( flPercents[i] );
+		Shipping_Assert( flActual >= flExpected && flActual <= flExpected * ( 1.0 + 1.0 / CHdrHistogram::SUB_BUCKETS ) );
+	}
+
+	// A 1% tail of slow ticks shows up at p99.5 but not at p98
+	CHdrHistogram ticks;
+	for ( int i = 0; i < 9900; i++ )
+	{
+		ticks.Record( 2000 + ( i % 100 ) );
+	}
+	for ( int i = 0; i < 100; i++ )
+	{
+		ticks.Record( 40000 );
+	}
+	Shipping_Assert( ticks.Percentile( 98 ) < 2300 );
+	Shipping_Assert( ticks.Percentile( 99.5f ) == 40000 );
+	Shipping_Assert( ticks.Percentile( 100 ) == 40000 );
+
+	// Merging is the same as recording into one
+	CHdrHistogram merged;
+	merged.Add( ticks );
+	merged.Add( uniform );
+	CHdrHistogram both;
+	for ( uint32 v = 1; v <= 100000; v++ )
+	{
+		both.Record( v );
+	}
+	for ( int i = 0; i < 9900; i++ )
+	{
+		both.Record( 2000 + ( i % 100 ) );
+	}
+	for ( int i = 0; i < 100; i++ )
+	{
+		both.Record( 40000 );
+	}
+	Shipping_Assert( merged.Count() == both.Count() && merged.Min() == both.Min() && merged.Max() == both.Max() );
+	for ( int b = 0; b < CHdrHistogram::NUM_BUCKETS; b++ )
+	{
+		Shipping_Assert( merged.BucketCount( b ) == both.BucketCount( b ) );
+	}
+
+	merged.Reset();
+	Shipping_Assert( merged.Count() == 0 && merged.Percentile( 50 ) == 0 );
+}
+
+DEFINE_TESTCASE( HdrHistogramTest, HdrHistogramTestSuite )
+{
+	Msg( "Running CHdrHistogram tests\n" );
+
+	BucketTests();
+	PercentileTests();
+}
@@ -0,0 +1,73 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Known answer tests for CSHA1
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#include "tier0/dbg.h"
+#include "unitlib/unitlib.h"
+#include "tier0/platform.h"
+#include "tier1/checksum_sha1.h"
+#include "tier1/strtools.h"
+
+DEFINE_TESTSUITE( SHA1TestSuite )
+
+static void CheckHash( const unsigned char *pData, unsigned int nBytes, unsigned int nChunk, const char *pszExpected )
+{
+	CSHA1 sha1;
+	for ( unsigned int i = 0; i < nBytes; i += nChunk )
+	{
+		sha1.Update( (unsigned char *)pData + i, MIN( nChunk, nBytes - i ) );
+	}
+	sha1.Final();
+
+	SHADigest_t digest;
+	sha1.GetHash( digest );
+
+	char szHex[k_cubHash * 2 + 1];
+	V_binarytohex( digest, sizeof( digest ), szHex, sizeof( szHex ) );
+	Shipping_Assert( !V_stricmp( szHex, pszExpected ) );
+}
+
+//-----------------------------------------------------------------------------
+// FIPS 180 test vectors, fed whole and in chunks that straddle the 64 byte
+// blocks. The words of a block didn't fit the workspace on LP64 when they
+// were unsigned long.
+//-----------------------------------------------------------------------------
+DEFINE_TESTCASE( SHA1KnownAnswerTest, SHA1TestSuite )
+{
+	Msg( "Running CSHA1 known answer tests\n" );
+
+	static const struct
+	{
+		const char *m_pszMessage;
+		const char *m_pszDigest;
+	} s_Vectors[] =
+	{
+		{ "", "da39a3ee5e6b4b0d3255bfef95601890afd80709" },
+		{ "abc", "a9993e364706816aba3e25717850c26c9cd0d89d" },
+		{ "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", "84983e441c3bd26ebaae4aa1f95129e5e54670f1" },
+		{ "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+			"a49b2446a02c645bf419f995b67091253a04a259" },
+	};
+
+	const unsigned int nChunks[] = { 1, 3, 63, 64, 65, 1000 };
+	for ( int i = 0; i < (int)ARRAYSIZE( s_Vectors ); i++ )
+	{
+		const unsigned char *pData = (const unsigned char *)s_Vectors[i].m_pszMessage;
+		unsigned int nBytes = V_strlen( s_Vectors[i].m_pszMessage );
+		for ( int j = 0; j < (int)ARRAYSIZE( nChunks ); j++ )
+		{
+			CheckHash( pData, nBytes, nChunks[j], s_Vectors[i].m_pszDigest );
+		}
+	}
+
+	// One million 'a'
+	const unsigned int nMillion = 1000000;
+	unsigned char *pMillion = new unsigned char[nMillion];
+	V_memset( pMillion, 'a', nMillion );
+	CheckHash( pMillion, nMillion, nMillion, "34aa973cd4c4daa4f61eeb2bdbad27316534016f" );
+	CheckHash( pMillion, nMillion, 4099, "34aa973cd4c4daa4f61eeb2bdbad27316534016f" );
+	delete[] pMillion;
+}
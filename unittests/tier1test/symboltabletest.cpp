@@ -0,0 +1,194 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Unit test and multi-threaded intern benchmark for CUtlSymbolTableMT
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#include "unitlib/unitlib.h"
+#include "tier0/platform.h"
+#include "tier0/threadtools.h"
+#include "tier1/utlsymbol.h"
+#include "tier1/strtools.h"
+
+DEFINE_TESTSUITE( SymbolTableTestSuite )
+
+#define SYMBOL_TEST_STRING_COUNT	4096
+#define SYMBOL_TEST_ITERATIONS		64
+#define SYMBOL_TEST_MAX_THREADS		16
+
+static char s_TestStrings[SYMBOL_TEST_STRING_COUNT][32];
+
+static void BuildTestStrings()
+{
+	for ( int i = 0; i < SYMBOL_TEST_STRING_COUNT; i++ )
+	{
+		V_snprintf( s_TestStrings[i], sizeof( s_TestStrings[i] ), "materials/test/sym_%d.vmt", i );
+	}
+}
+
+static void SingleThreadedTests()
+{
+	CUtlSymbolTableMT table( 0, 32, true );
+
+	CUtlSymbol a = table.AddString( "Models/Player.mdl" );
+	CUtlSymbol b = table.AddString( "models/player.mdl" );
+	CUtlSymbol c = table.AddString( "models/player2.mdl" );
+	Shipping_Assert( a.IsValid() && c.IsValid() );
+	Shipping_Assert( a == b );
+	Shipping_Assert( a != c );
+	Shipping_Assert( !V_strcmp( table.String( a ), "Models/Player.mdl" ) );
+	Shipping_Assert( table.Find( "MODELS/PLAYER2.MDL" ) == c );
+	Shipping_Assert( !table.Find( "models/player3.mdl" ).IsValid() );
+	Shipping_Assert( !table.AddString( NULL ).IsValid() );
+	Shipping_Assert( table.GetNumStrings() == 2 );
+
+	CUtlSymbolTableMT caseSensitive;
+	Shipping_Assert( caseSensitive.AddString( "Key" ) != caseSensitive.AddString( "key" ) );
+
+	// Symbols must stay valid and unchanged as the table grows
+	CUtlSymbol ids[SYMBOL_TEST_STRING_COUNT];
+	for ( int i = 0; i < SYMBOL_TEST_STRING_COUNT; i++ )
+	{
+		ids[i] = table.AddString( s_TestStrings[i] );
+	}
+	for ( int i = 0; i < SYMBOL_TEST_STRING_COUNT; i++ )
+	{
+		Shipping_Assert( table.Find( s_TestStrings[i] ) == ids[i] );
+		Shipping_Assert( !V_strcmp( table.String( ids[i] ), s_TestStrings[i] ) );
+	}
+	Shipping_Assert( table.String( a ) && !V_strcmp( table.String( a ), "Models/Player.mdl" ) );
+
+	table.RemoveAll();
+	Shipping_Assert( table.GetNumStrings() == 0 );
+	Shipping_Assert( !table.Find( s_TestStrings[0] ).IsValid() );
+}
+
+DEFINE_TESTCASE( SymbolTableSingleThreadTest, SymbolTableTestSuite )
+{
+	Msg( "Running CUtlSymbolTableMT tests\n" );
+
+	BuildTestStrings();
+	SingleThreadedTests();
+}
+
+
+//-----------------------------------------------------------------------------
+// The old behaviour of CUtlSymbolTableMT, kept here as a baseline: every
+// lookup takes the write lock since CUtlSymbolTable::Find isn't reentrant.
+//-----------------------------------------------------------------------------
+class CLockedSymbolTable : public CUtlSymbolTable
+{
+public:
+	CLockedSymbolTable() : CUtlSymbolTable( 0, 32, true ) {}
+
+	CUtlSymbol AddString( const char *pString )
+	{
+		m_lock.LockForWrite();
+		CUtlSymbol result = CUtlSymbolTable::AddString( pString );
+		m_lock.UnlockWrite();
+		return result;
+	}
+
+private:
+	CThreadRWLock m_lock;
+};
+
+struct SymbolThreadParams_t
+{
+	CUtlSymbolTableMT *m_pTable;
+	CLockedSymbolTable *m_pLockedTable;
+	int m_nThread;
+	UtlSymId_t m_Ids[SYMBOL_TEST_STRING_COUNT];
+};
+
+static CThreadEvent *s_pStartEvent;
+
+static uintp SymbolInternThreadFunc( void *pParam )
+{
+	SymbolThreadParams_t *pParams = (SymbolThreadParams_t *)pParam;
+	s_pStartEvent->Wait();
+
+	for ( int nIter = 0; nIter < SYMBOL_TEST_ITERATIONS; nIter++ )
+	{
+		// Each thread walks the strings from a different starting point, so
+		// the first pass has threads racing to insert the same strings
+		for ( int i = 0; i < SYMBOL_TEST_STRING_COUNT; i++ )
+		{
+			int nString = ( i + pParams->m_nThread * 97 ) % SYMBOL_TEST_STRING_COUNT;
+			if ( pParams->m_pTable )
+			{
+				pParams->m_Ids[nString] = pParams->m_pTable->AddString( s_TestStrings[nString] );
+			}
+			else
+			{
+				pParams->m_Ids[nString] = pParams->m_pLockedTable->AddString( s_TestStrings[nString] );
+			}
+		}
+	}
+	return 0;
+}
+
+static double RunInternBenchmark( int nThreads, CUtlSymbolTableMT *pTable, CLockedSymbolTable *pLockedTable )
+{
+	static SymbolThreadParams_t s_Params[SYMBOL_TEST_MAX_THREADS];
+	ThreadHandle_t hThreads[SYMBOL_TEST_MAX_THREADS];
+
+	CThreadEvent startEvent( true );
+	s_pStartEvent = &startEvent;
+
+	for ( int i = 0; i < nThreads; i++ )
+	{
+		s_Params[i].m_pTable = pTable;
+		s_Params[i].m_pLockedTable = pLockedTable;
+		s_Params[i].m_nThread = i;
+		hThreads[i] = CreateSimpleThread( &SymbolInternThreadFunc, &s_Params[i] );
+	}
+
+	double flStart = Plat_FloatTime();
+	startEvent.Set();
+	for ( int i = 0; i < nThreads; i++ )
+	{
+		ThreadJoin( hThreads[i] );
+		ReleaseThreadHandle( hThreads[i] );
+	}
+	double flElapsed = Plat_FloatTime() - flStart;
+
+	// Every thread must have seen the same id for each string
+	for ( int i = 1; i < nThreads; i++ )
+	{
+		Shipping_Assert( !memcmp( s_Params[0].m_Ids, s_Params[i].m_Ids, sizeof( s_Params[0].m_Ids ) ) );
+	}
+	if ( pTable )
+	{
+		Shipping_Assert( pTable->GetNumStrings() == SYMBOL_TEST_STRING_COUNT );
+		for ( int i = 0; i < SYMBOL_TEST_STRING_COUNT; i++ )
+		{
+			Shipping_Assert( !V_strcmp( pTable->String( s_Params[0].m_Ids[i] ), s_TestStrings[i] ) );
+		}
+	}
+
+	s_pStartEvent = NULL;
+	return flElapsed;
+}
+
+DEFINE_TESTCASE( SymbolTableMultiThreadBenchmark, SymbolTableTestSuite )
+{
+	Msg( "Running CUtlSymbolTableMT multi-threaded intern benchmark\n" );
+
+	BuildTestStrings();
+
+	int nMaxThreads = Clamp( (int)GetCPUInformation()->m_nLogicalProcessors, 2, (int)SYMBOL_TEST_MAX_THREADS );
+	for ( int nThreads = 1; nThreads <= nMaxThreads; nThreads *= 2 )
+	{
+		CLockedSymbolTable lockedTable;
+		double flLocked = RunInternBenchmark( nThreads, NULL, &lockedTable );
+
+		CUtlSymbolTableMT table( 0, 32, true );
+		double flSharded = RunInternBenchmark( nThreads, &table, NULL );
+
+		int nLookups = nThreads * SYMBOL_TEST_ITERATIONS * SYMBOL_TEST_STRING_COUNT;
+		Msg( "%2d threads: locked %.2f Mlookups/s, sharded %.2f Mlookups/s\n", nThreads,
+			nLookups / ( flLocked * 1e6 ), nLookups / ( flSharded * 1e6 ) );
+	}
+}
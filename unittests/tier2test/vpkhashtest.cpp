@@ -0,0 +1,129 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Unit tests for hashing VPK chunk files, and the hash cache
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#include "unitlib/unitlib.h"
+#include "tier0/platform.h"
+#include "tier1/utlbuffer.h"
+#include "tier2/tier2.h"
+#include "filesystem.h"
+#include "vpklib/packedstore.h"
+
+DEFINE_TESTSUITE( VPKHashTestSuite )
+
+#define VPK_TEST_BASENAME		"vpkhashtest"
+#define VPK_TEST_FILES			40
+
+static uint32 s_nRandSeed;
+static uint32 NextRand()
+{
+	s_nRandSeed = s_nRandSeed * 1664525 + 1013904223;
+	return s_nRandSeed;
+}
+
+//-----------------------------------------------------------------------------
+// Hashes every fraction the old way, one after another through the store's
+// own file handles
+//-----------------------------------------------------------------------------
+static bool MatchesSerialHashes( CPackedStore &store )
+{
+	CUtlSortVector<ChunkHashFraction_t, ChunkHashFractionLess_t> &hashes = store.AccessPackFileHashes();
+	FOR_EACH_VEC( hashes, i )
+	{
+		CPackedStoreFileHandle handle = store.GetHandleForHashingFiles();
+		handle.m_nFileNumber = hashes[i].m_nPackFileNumber;
+
+		FileHash_t fileHash;
+		int64 nFileSize;
+		store.HashEntirePackFile( handle, nFileSize, hashes[i].m_nFileFraction, 0x00100000, fileHash );
+		if ( fileHash.m_cbFileLen != hashes[i].m_cbChunkLen || V_memcmp( fileHash.m_md5contents.bits, hashes[i].m_md5contents.bits, sizeof( fileHash.m_md5contents.bits ) ) )
+			return false;
+	}
+	return true;
+}
+
+DEFINE_TESTCASE( VPKHashTest, VPKHashTestSuite )
+{
+	Msg( "Running VPK chunk hashing tests\n" );
+
+	// The unit tests have no search paths, so use full paths
+	char szBaseName[MAX_PATH];
+	char szCacheFileName[MAX_PATH];
+	char szFileName[MAX_PATH];
+	V_MakeAbsolutePath( szBaseName, sizeof( szBaseName ), VPK_TEST_BASENAME );
+	V_sprintf_safe( szCacheFileName, "%s_hashes.bin", szBaseName );
+
+	// A few chunk files of a few MB
+	CPackedStore *pWriter = new CPackedStore( szBaseName, szFileName, g_pFullFileSystem, true );
+	pWriter->SetWriteChunkSize( 3 * 1024 * 1024 );
+	CUtlVector<uint8> data;
+	s_nRandSeed = 1;
+	for ( int i = 0; i < VPK_TEST_FILES; i++ )
+	{
+		data.SetCount( 1 + NextRand() % ( 512 * 1024 ) );
+		for ( int j = 0; j < data.Count(); j++ )
+		{
+			data[j] = (uint8)NextRand();
+		}
+		char szName[MAX_PATH];
+		V_sprintf_safe( szName, "data/file%d.bin", i );
+		pWriter->AddFile( szName, 0, data.Base(), data.Count(), true );
+	}
+	pWriter->Write();
+	int nChunks = pWriter->GetHighestChunkFileIndex() + 1;
+	delete pWriter;
+	Shipping_Assert( nChunks > 1 );
+
+	CPackedStore *pStore = new CPackedStore( szBaseName, szFileName, g_pFullFileSystem );
+	if ( g_pFullFileSystem->FileExists( szCacheFileName ) )
+	{
+		g_pFullFileSystem->RemoveFile( szCacheFileName, NULL );
+	}
+
+	// Parallel hashes are the serial ones
+	Shipping_Assert( pStore->HashAllChunkFiles() == nChunks );
+	Shipping_Assert( pStore->AccessPackFileHashes().Count() > nChunks );
+	Shipping_Assert( MatchesSerialHashes( *pStore ) );
+
+	CUtlVector<ChunkHashFraction_t> hashes;
+	hashes.CopyArray( pStore->AccessPackFileHashes().Base(), pStore->AccessPackFileHashes().Count() );
+
+	// The first time with a cache hashes everything, the second nothing
+	Shipping_Assert( pStore->HashAllChunkFiles( szCacheFileName ) == nChunks );
+	Shipping_Assert( pStore->HashAllChunkFiles( szCacheFileName ) == 0 );
+	Shipping_Assert( pStore->AccessPackFileHashes().Count() == hashes.Count() );
+	Shipping_Assert( !V_memcmp( pStore->AccessPackFileHashes().Base(), hashes.Base(), hashes.Count() * sizeof( ChunkHashFraction_t ) ) );
+
+	// A chunk file that changed size is hashed again
+	char szChunkFileName[MAX_PATH];
+	V_sprintf_safe( szChunkFileName, "%s_%03d.vpk", szBaseName, nChunks - 1 );
+	CUtlBuffer chunk;
+	Shipping_Assert( g_pFullFileSystem->ReadFile( szChunkFileName, NULL, chunk ) );
+	chunk.PutUnsignedChar( 0 );
+	Shipping_Assert( g_pFullFileSystem->WriteFile( szChunkFileName, NULL, chunk ) );
+	Shipping_Assert( pStore->HashAllChunkFiles( szCacheFileName ) == 1 );
+	delete pStore;
+
+	// The cache outlives the store; a new one also has fresh handles for the serial hashes
+	pStore = new CPackedStore( szBaseName, szFileName, g_pFullFileSystem );
+	Shipping_Assert( pStore->HashAllChunkFiles( szCacheFileName ) == 0 );
+	Shipping_Assert( MatchesSerialHashes( *pStore ) );
+
+	// Everything is hashed again if the cache is garbage
+	CUtlBuffer garbage;
+	garbage.PutInt( 12345 );
+	Shipping_Assert( g_pFullFileSystem->WriteFile( szCacheFileName, NULL, garbage ) );
+	Shipping_Assert( pStore->HashAllChunkFiles( szCacheFileName ) == nChunks );
+	delete pStore;
+
+	g_pFullFileSystem->RemoveFile( szCacheFileName, NULL );
+	g_pFullFileSystem->RemoveFile( szFileName, NULL );
+	for ( int i = 0; i < nChunks; i++ )
+	{
+		V_sprintf_safe( szChunkFileName, "%s_%03d.vpk", szBaseName, i );
+		g_pFullFileSystem->RemoveFile( szChunkFileName, NULL );
+	}
+}
@@ -0,0 +1,177 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Unit tests for the VPK directory index, and how long opening and
+//			looking up files in a large VPK takes with and without it
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#include "unitlib/unitlib.h"
+#include "tier0/platform.h"
+#include "tier1/utlbuffer.h"
+#include "tier2/tier2.h"
+#include "filesystem.h"
+#include "vpklib/packedstore.h"
+
+DEFINE_TESTSUITE( VPKIndexTestSuite )
+
+#define VPK_TEST_BASENAME		"vpkindextest"
+#define VPK_TEST_EXTENSIONS		4
+#define VPK_TEST_DIRS			1000
+#define VPK_TEST_FILES_PER_DIR	125			// per extension, 500000 files in all
+
+static const char *s_pExtensions[VPK_TEST_EXTENSIONS] = { "vmt", "vtf", "mdl", "wav" };
+
+static uint32 FakeCRC( int nExt, int nDir, int nFile )
+{
+	return ( nExt * VPK_TEST_DIRS + nDir ) * VPK_TEST_FILES_PER_DIR + nFile;
+}
+
+//-----------------------------------------------------------------------------
+// Writes a version 2 directory file with no index. Every file is a single
+// part in chunk 0 at a made up offset; nothing here reads the data.
+//-----------------------------------------------------------------------------
+static void WriteLegacyDirFile( const char *pszDirFileName )
+{
+	CUtlBuffer dir;
+	char szName[MAX_PATH];
+	for ( int e = 0; e < VPK_TEST_EXTENSIONS; e++ )
+	{
+		dir.PutString( s_pExtensions[e] );
+		for ( int d = 0; d < VPK_TEST_DIRS; d++ )
+		{
+			V_sprintf_safe( szName, "materials/set%d", d );
+			dir.PutString( szName );
+			for ( int f = 0; f < VPK_TEST_FILES_PER_DIR; f++ )
+			{
+				V_sprintf_safe( szName, "file%d", f );
+				dir.PutString( szName );
+				dir.PutUnsignedInt( FakeCRC( e, d, f ) );
+				dir.PutShort( 0 );								// metadata size
+				dir.PutShort( 0 );								// chunk
+				dir.PutUnsignedInt( FakeCRC( e, d, f ) * 16 );	// offset
+				dir.PutUnsignedInt( 16 );						// size
+				dir.PutUnsignedShort( 0xffff );					// end of parts
+			}
+			dir.PutChar( 0 );
+		}
+		dir.PutChar( 0 );
+	}
+	dir.PutChar( 0 );
+
+	CUtlBuffer file;
+	file.PutInt( 0x55aa1234 );		// VPK_HEADER_MARKER
+	file.PutInt( 2 );				// VPK_CURRENT_VERSION
+	file.PutInt( dir.TellPut() );
+	file.PutInt( 0 );				// embedded chunk
+	file.PutInt( 0 );				// chunk hashes
+	file.PutInt( 0 );				// self hashes
+	file.PutInt( 0 );				// signature
+	file.Put( dir.Base(), dir.TellPut() );
+
+	Shipping_Assert( g_pFullFileSystem->WriteFile( pszDirFileName, NULL, file ) );
+}
+
+static const char *TestFileName( char *pszOut, int nOutSize, int nExt, int nDir, int nFile )
+{
+	V_snprintf( pszOut, nOutSize, "materials/set%d/file%d.%s", nDir, nFile, s_pExtensions[nExt] );
+	return pszOut;
+}
+
+//-----------------------------------------------------------------------------
+// Looks up every file plus as many that aren't there, returns the time taken
+//-----------------------------------------------------------------------------
+static double LookupAll( CPackedStore &store )
+{
+	char szName[MAX_PATH];
+	double flStart = Plat_FloatTime();
+	for ( int e = 0; e < VPK_TEST_EXTENSIONS; e++ )
+	{
+		for ( int d = 0; d < VPK_TEST_DIRS; d++ )
+		{
+			for ( int f = 0; f < VPK_TEST_FILES_PER_DIR; f++ )
+			{
+				CPackedStoreFileHandle hFile = store.OpenFile( TestFileName( szName, sizeof( szName ), e, d, f ) );
+				Shipping_Assert( hFile && hFile.m_nFileNumber == 0 && hFile.m_nFileSize == 16 &&
+					hFile.m_nFileOffset == (int)( FakeCRC( e, d, f ) * 16 ) );
+
+				// Right directory and extension, wrong name
+				Shipping_Assert( !store.OpenFile( TestFileName( szName, sizeof( szName ), e, d, f + VPK_TEST_FILES_PER_DIR ) ) );
+			}
+		}
+	}
+	double flElapsed = Plat_FloatTime() - flStart;
+
+	Shipping_Assert( !store.OpenFile( "materials/set0/file0.txt" ) );
+	Shipping_Assert( !store.OpenFile( "materials/file0.vmt" ) );
+	Shipping_Assert( !store.OpenFile( "file0.vmt" ) );
+	Shipping_Assert( !store.OpenFile( "materials/set0/file0" ) );
+	return flElapsed;
+}
+
+DEFINE_TESTCASE( VPKIndexTest, VPKIndexTestSuite )
+{
+	Msg( "Running VPK directory index tests\n" );
+
+	// The unit tests have no search paths, so use full paths
+	char szBaseName[MAX_PATH];
+	char szDirFileName[MAX_PATH];
+	char szFileName[MAX_PATH];
+	V_MakeAbsolutePath( szBaseName, sizeof( szBaseName ), VPK_TEST_BASENAME );
+	V_sprintf_safe( szDirFileName, "%s_dir.vpk", szBaseName );
+	WriteLegacyDirFile( szDirFileName );
+	int nFiles = VPK_TEST_EXTENSIONS * VPK_TEST_DIRS * VPK_TEST_FILES_PER_DIR;
+
+	// No index, hash tables are built over the directory
+	double flStart = Plat_FloatTime();
+	CPackedStore *pLegacy = new CPackedStore( szBaseName, szFileName, g_pFullFileSystem );
+	double flLegacyOpen = Plat_FloatTime() - flStart;
+	Shipping_Assert( !pLegacy->HasDirectoryIndex() );
+	double flLegacyLookup = LookupAll( *pLegacy );
+	delete pLegacy;
+
+	// Rewriting it adds the index
+	CPackedStore *pWriter = new CPackedStore( szBaseName, szFileName, g_pFullFileSystem, true );
+	flStart = Plat_FloatTime();
+	pWriter->Write();
+	double flBuild = Plat_FloatTime() - flStart;
+	delete pWriter;
+
+	flStart = Plat_FloatTime();
+	CPackedStore *pIndexed = new CPackedStore( szBaseName, szFileName, g_pFullFileSystem );
+	double flIndexedOpen = Plat_FloatTime() - flStart;
+	Shipping_Assert( pIndexed->HasDirectoryIndex() );
+	double flIndexedLookup = LookupAll( *pIndexed );
+
+	// Changing the directory drops the index and still finds everything
+	VPKContentFileInfo_t info;
+	info.m_sName = "materials/new/added.vmt";
+	info.m_iTotalSize = 16;
+	info.m_idxChunk = 0;
+	info.m_iOffsetInChunk = 0;
+	info.m_iPreloadSize = 0;
+	info.m_pPreloadData = NULL;
+	info.m_crc = 0;
+	pIndexed->AddFileToDirectory( info );
+	Shipping_Assert( !pIndexed->HasDirectoryIndex() );
+	Shipping_Assert( pIndexed->OpenFile( "materials/new/added.vmt" ) );
+	Shipping_Assert( pIndexed->OpenFile( "materials/set999/file124.wav" ) );
+	delete pIndexed;
+
+	// An index for some other directory is ignored: change the CRC of the
+	// first file, after the 28 byte header and "vmt", "materials/set0", "file0"
+	CUtlBuffer buf;
+	Shipping_Assert( g_pFullFileSystem->ReadFile( szDirFileName, NULL, buf ) );
+	( (char *)buf.Base() )[28 + 4 + 15 + 6] ^= 1;
+	Shipping_Assert( g_pFullFileSystem->WriteFile( szDirFileName, NULL, buf ) );
+	CPackedStore *pStale = new CPackedStore( szBaseName, szFileName, g_pFullFileSystem );
+	Shipping_Assert( !pStale->HasDirectoryIndex() );
+	delete pStale;
+
+	g_pFullFileSystem->RemoveFile( szDirFileName, NULL );
+
+	Msg( "  %d files: open %.1fms without index, %.1fms with (built in %.1fms)\n", nFiles,
+		flLegacyOpen * 1000.0, flIndexedOpen * 1000.0, flBuild * 1000.0 );
+	Msg( "  lookups (hit + miss): %.0fns without index, %.0fns with\n",
+		flLegacyLookup * 1e9 / ( 2 * nFiles ), flIndexedLookup * 1e9 / ( 2 * nFiles ) );
+}
@@ -0,0 +1,889 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Hands work units out to worker processes over TCP, on this
+//			machine or others, for the tools that can't use VMPI
+//
+//=============================================================================//
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <process.h>
+typedef int socklen_t;
+#elif POSIX
+#define INVALID_SOCKET -1
+#define SOCKET_ERROR -1
+typedef int SOCKET;
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#define closesocket close
+#endif
+
+#include "cmdlib.h"
+#include "threads.h"
+#include "pacifier.h"
+#include "distwork.h"
+#include "tier0/platform.h"
+#include "tier0/threadtools.h"
+#include "tier1/strtools.h"
+#include "tier1/checksum_crc.h"
+#include "tier1/utlvector.h"
+
+// The coordinator runs one select() loop on the main thread. Each worker
+// thread has its own connection and does one work unit at a time: it says
+// hello, and then every result it sends back gets it the next work unit.
+//
+// Every message is a distmsgheader_t then m_nBytes of data. All the machines
+// are expected to be the same kind, like the map files they load, so nothing
+// is byte swapped. Anything can connect to a -distlisten port, so a message
+// longer than DISTWORK_MAX_MESSAGE drops the connection before any of it is
+// buffered.
+
+#define DISTWORK_MAGIC			0x57545344		// "DSTW"
+#define DISTWORK_VERSION		1
+
+#define DISTWORK_MAX_COPIES		2		// workers doing the same work unit at the end
+#define DISTWORK_MAX_SHARED		64		// shared results sent with one work unit
+#define DISTWORK_CONNECT_TIME	60.0	// seconds a worker keeps trying to connect
+#define DISTWORK_MAX_MESSAGE	( 64 << 20 )	// bytes after the header
+#define DISTWORK_MAX_RESULTS	( DISTWORK_MAX_MESSAGE - 64 )	// so one can always be shared
+
+enum
+{
+	DISTMSG_HELLO,		// worker: disthello_t
+	DISTMSG_RESULT,		// worker: work unit, results
+	DISTMSG_WORK,		// coordinator: work unit, shared count, then work unit, byte count and results per shared result
+	DISTMSG_DONE,		// coordinator: all the work units of the stage are done
+	DISTMSG_QUIT,		// coordinator: there are no more stages
+};
+
+struct distmsgheader_t
+{
+	uint32	m_nBytes;
+	uint32	m_nType;
+};
+
+struct disthello_t
+{
+	uint32	m_nMagic;
+	uint32	m_nVersion;
+	int32	m_nStage;
+	uint32	m_nPad;
+	uint64	m_nWorkerID;	// the same for all the threads of a worker process
+};
+
+enum
+{
+	DISTCONN_HELLO,		// hasn't said which stage it's on yet
+	DISTCONN_IDLE,		// nothing to give it right now, or it's ahead of us
+	DISTCONN_BUSY,		// doing m_iSlot
+	DISTCONN_DRAINING,	// told the stage is done, may still send a late result
+};
+
+struct distconn_t
+{
+	SOCKET				m_Socket;
+	int					m_nState;
+	int					m_nStage;
+	uint64				m_nWorkerID;
+	int					m_iSlot;		// index into the work unit list
+	double				m_flStartTime;
+	CUtlVector<byte>	m_Received;		// not a whole message yet
+};
+
+// The results a worker process hasn't been sent yet start at m_iNextShared
+struct distworkerproc_t
+{
+	uint64	m_nWorkerID;
+	int		m_iNextShared;
+};
+
+struct distshared_t
+{
+	uint64	m_iWorkUnit;
+	uint64	m_nWorkerID;	// who did it, they don't need it back
+	int		m_nOffset;		// into g_SharedData
+	int		m_nBytes;
+};
+
+bool g_bDistWork = false;
+bool g_bDistWorker = false;
+
+static SOCKET				g_ListenSocket = INVALID_SOCKET;
+static bool					g_bDistListen = false;
+static int					g_nDistPort = DISTWORK_DEFAULT_PORT;
+static char					g_szCoordinator[256];
+static int					g_nDistStage = 0;
+static uint64				g_nWorkerID;
+
+#ifdef _WIN32
+static CUtlVector<intptr_t>	g_LocalWorkers;
+#else
+static CUtlVector<pid_t>	g_LocalWorkers;
+#endif
+
+static CUtlVector<distconn_t *>		g_DistConns;
+static CUtlVector<distworkerproc_t>	g_DistWorkerProcs;
+
+// The stage DistributeWorkUnits is running
+static int						g_nStageWorkUnits;
+static const uint64				*g_pStageWorkUnits;
+static DistProcessWorkUnitFn	g_pProcessFn;
+static DistReceiveWorkUnitFn	g_pReceiveFn;
+static DistShareWorkUnitFn		g_pShareFn;
+static CUtlVector<byte>			g_SlotDone;
+static CUtlVector<int>			g_SlotCopies;	// workers doing it now
+static CUtlVector<int>			g_RequeuedSlots;
+static int						g_iNextSlot;
+static int						g_nSlotsDone;
+static CUtlVector<distshared_t>	g_Shared;
+static CUtlVector<byte>			g_SharedData;
+
+
+//-----------------------------------------------------------------------------
+// Sockets
+//-----------------------------------------------------------------------------
+static bool SendAll( SOCKET s, const void *pData, int nBytes )
+{
+	const char *p = (const char *)pData;
+	while ( nBytes > 0 )
+	{
+		int nSent = send( s, p, nBytes, 0 );
+		if ( nSent <= 0 )
+			return false;
+		p += nSent;
+		nBytes -= nSent;
+	}
+	return true;
+}
+
+static bool RecvAll( SOCKET s, void *pData, int nBytes )
+{
+	char *p = (char *)pData;
+	while ( nBytes > 0 )
+	{
+		int nReceived = recv( s, p, nBytes, 0 );
+		if ( nReceived <= 0 )
+			return false;
+		p += nReceived;
+		nBytes -= nReceived;
+	}
+	return true;
+}
+
+static bool SendMessage( SOCKET s, int nType, const void *pData, int nBytes, const void *pData2 = NULL, int nBytes2 = 0 )
+{
+	distmsgheader_t header;
+	header.m_nBytes = nBytes + nBytes2;
+	header.m_nType = nType;
+	return SendAll( s, &header, sizeof( header ) ) && SendAll( s, pData, nBytes ) && SendAll( s, pData2, nBytes2 );
+}
+
+static bool RecvMessage( SOCKET s, distmsgheader_t &header, CUtlVector<byte> &data )
+{
+	if ( !RecvAll( s, &header, sizeof( header ) ) || header.m_nBytes > DISTWORK_MAX_MESSAGE )
+		return false;
+	data.SetCount( header.m_nBytes );
+	return RecvAll( s, data.Base(), header.m_nBytes );
+}
+
+static void SetNoDelay( SOCKET s )
+{
+	// the messages are small and every one is waited for
+	int nOn = 1;
+	setsockopt( s, IPPROTO_TCP, TCP_NODELAY, (const char *)&nOn, sizeof( nOn ) );
+}
+
+static SOCKET ConnectToCoordinator()
+{
+	char szHost[256];
+	V_strncpy( szHost, g_szCoordinator, sizeof( szHost ) );
+	char *pPort = strrchr( szHost, ':' );
+	if ( !pPort )
+		Error( "-distworker: expected host:port, got '%s'.\n", g_szCoordinator );
+	*pPort++ = 0;
+
+	struct addrinfo hints, *pAddrs;
+	memset( &hints, 0, sizeof( hints ) );
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	if ( getaddrinfo( szHost, pPort, &hints, &pAddrs ) != 0 )
+		Error( "-distworker: can't find '%s'.\n", szHost );
+
+	// The coordinator might still be starting up
+	double flGiveUp = Plat_FloatTime() + DISTWORK_CONNECT_TIME;
+	while ( 1 )
+	{
+		SOCKET s = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+		if ( s == INVALID_SOCKET )
+			Error( "-distworker: can't create a socket.\n" );
+		if ( connect( s, pAddrs->ai_addr, (socklen_t)pAddrs->ai_addrlen ) != SOCKET_ERROR )
+		{
+			freeaddrinfo( pAddrs );
+			SetNoDelay( s );
+			return s;
+		}
+		closesocket( s );
+
+		if ( Plat_FloatTime() > flGiveUp )
+			Error( "-distworker: can't connect to %s.\n", g_szCoordinator );
+		ThreadSleep( 1000 );
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Local worker processes
+//-----------------------------------------------------------------------------
+static bool IsDistArg( const char *pArg )
+{
+	return !Q_stricmp( pArg, "-distribute" ) || !Q_stricmp( pArg, "-distport" ) || !Q_stricmp( pArg, "-distworker" );
+}
+
+static void StartLocalWorkers( int nWorkers, int argc, char **argv )
+{
+	// The same command line, working for us on one thread each
+	char szCoordinator[64];
+	V_snprintf( szCoordinator, sizeof( szCoordinator ), "127.0.0.1:%d", g_nDistPort );
+
+	CUtlVector<char *> args;
+	args.AddToTail( argv[0] );
+	args.AddToTail( (char *)"-threads" );
+	args.AddToTail( (char *)"1" );
+	args.AddToTail( (char *)"-distworker" );
+	args.AddToTail( szCoordinator );
+	for ( int i = 1; i < argc; i++ )
+	{
+		if ( IsDistArg( argv[i] ) )
+			i++;
+		else if ( Q_stricmp( argv[i], "-distlisten" ) )
+			args.AddToTail( argv[i] );
+	}
+	args.AddToTail( NULL );
+
+	for ( int i = 0; i < nWorkers; i++ )
+	{
+#ifdef _WIN32
+		char szExe[MAX_PATH];
+		GetModuleFileName( NULL, szExe, sizeof( szExe ) );
+		intptr_t hProcess = _spawnv( _P_NOWAIT, szExe, args.Base() );
+		if ( hProcess == -1 )
+			Error( "-distribute: can't start a worker process.\n" );
+		g_LocalWorkers.AddToTail( hProcess );
+#else
+		pid_t pid = fork();
+		if ( pid < 0 )
+			Error( "-distribute: can't start a worker process.\n" );
+		if ( pid == 0 )
+		{
+			// The coordinator says everything worth saying, only let the errors through
+			int fd = open( "/dev/null", O_WRONLY );
+			if ( fd >= 0 )
+				dup2( fd, STDOUT_FILENO );
+			execv( "/proc/self/exe", args.Base() );
+			execvp( argv[0], args.Base() );
+			_exit( 1 );
+		}
+		g_LocalWorkers.AddToTail( pid );
+#endif
+	}
+}
+
+// Forgets about the local workers that have exited
+static void ReapLocalWorkers( bool bWait )
+{
+	for ( int i = g_LocalWorkers.Count() - 1; i >= 0; i-- )
+	{
+#ifdef _WIN32
+		HANDLE hProcess = (HANDLE)g_LocalWorkers[i];
+		if ( WaitForSingleObject( hProcess, bWait ? INFINITE : 0 ) != WAIT_OBJECT_0 )
+			continue;
+		CloseHandle( hProcess );
+#else
+		int nStatus;
+		if ( waitpid( g_LocalWorkers[i], &nStatus, bWait ? 0 : WNOHANG ) == 0 )
+			continue;
+#endif
+		g_LocalWorkers.Remove( i );
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Coordinator
+//-----------------------------------------------------------------------------
+static void AcceptWorker();
+
+static void DistWork_Shutdown()
+{
+	// Let everyone still around know, including the ones waiting for a
+	// stage that won't come
+	while ( g_ListenSocket != INVALID_SOCKET )
+	{
+		fd_set readSet;
+		FD_ZERO( &readSet );
+		FD_SET( g_ListenSocket, &readSet );
+		struct timeval timeout = { 0, 0 };
+		if ( select( (int)g_ListenSocket + 1, &readSet, NULL, NULL, &timeout ) <= 0 )
+			break;
+		AcceptWorker();
+	}
+	for ( int i = 0; i < g_DistConns.Count(); i++ )
+	{
+		SendMessage( g_DistConns[i]->m_Socket, DISTMSG_QUIT, NULL, 0 );
+		closesocket( g_DistConns[i]->m_Socket );
+		delete g_DistConns[i];
+	}
+	g_DistConns.Purge();
+
+	if ( g_ListenSocket != INVALID_SOCKET )
+	{
+		closesocket( g_ListenSocket );
+		g_ListenSocket = INVALID_SOCKET;
+	}
+
+	// The local ones might not even have connected yet
+	for ( int i = 0; i < g_LocalWorkers.Count(); i++ )
+	{
+#ifdef _WIN32
+		TerminateProcess( (HANDLE)g_LocalWorkers[i], 0 );
+#else
+		kill( g_LocalWorkers[i], SIGTERM );
+#endif
+	}
+	ReapLocalWorkers( true );
+}
+
+static void OpenListenSocket()
+{
+	g_ListenSocket = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+	if ( g_ListenSocket == INVALID_SOCKET )
+		Error( "-distribute: can't create a socket.\n" );
+
+	int nOn = 1;
+	setsockopt( g_ListenSocket, SOL_SOCKET, SO_REUSEADDR, (const char *)&nOn, sizeof( nOn ) );
+
+	// Only the local workers need this machine unless it's listening
+	struct sockaddr_in address;
+	memset( &address, 0, sizeof( address ) );
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl( g_bDistListen ? INADDR_ANY : INADDR_LOOPBACK );
+	address.sin_port = htons( g_bDistListen ? g_nDistPort : 0 );
+	if ( bind( g_ListenSocket, (struct sockaddr *)&address, sizeof( address ) ) == SOCKET_ERROR ||
+		 listen( g_ListenSocket, 64 ) == SOCKET_ERROR )
+	{
+		Error( "-distribute: can't listen on port %d.\n", g_bDistListen ? g_nDistPort : 0 );
+	}
+
+	socklen_t nLength = sizeof( address );
+	getsockname( g_ListenSocket, (struct sockaddr *)&address, &nLength );
+	g_nDistPort = ntohs( address.sin_port );
+}
+
+static void AcceptWorker()
+{
+	SOCKET s = accept( g_ListenSocket, NULL, NULL );
+	if ( s == INVALID_SOCKET )
+		return;
+	SetNoDelay( s );
+
+	distconn_t *pConn = new distconn_t;
+	pConn->m_Socket = s;
+	pConn->m_nState = DISTCONN_HELLO;
+	pConn->m_nStage = 0;
+	pConn->m_nWorkerID = 0;
+	pConn->m_iSlot = -1;
+	pConn->m_flStartTime = 0;
+	g_DistConns.AddToTail( pConn );
+}
+
+static distworkerproc_t *FindWorkerProc( uint64 nWorkerID )
+{
+	for ( int i = 0; i < g_DistWorkerProcs.Count(); i++ )
+	{
+		if ( g_DistWorkerProcs[i].m_nWorkerID == nWorkerID )
+			return &g_DistWorkerProcs[i];
+	}
+	distworkerproc_t &proc = g_DistWorkerProcs[g_DistWorkerProcs.AddToTail()];
+	proc.m_nWorkerID = nWorkerID;
+	proc.m_iNextShared = 0;
+	return &proc;
+}
+
+static inline uint64 SlotWorkUnit( int iSlot )
+{
+	return g_pStageWorkUnits ? g_pStageWorkUnits[iSlot] : (uint64)iSlot;
+}
+
+// The work unit to give pConn next, or -1
+static int NextSlot( distconn_t *pConn )
+{
+	while ( g_RequeuedSlots.Count() )
+	{
+		int iSlot = g_RequeuedSlots.Tail();
+		g_RequeuedSlots.RemoveMultipleFromTail( 1 );
+		if ( !g_SlotDone[iSlot] )
+			return iSlot;
+	}
+
+	if ( g_iNextSlot < g_nStageWorkUnits )
+		return g_iNextSlot++;
+
+	// Nothing new left, help with the one that has been going the longest
+	distconn_t *pOldest = NULL;
+	for ( int i = 0; i < g_DistConns.Count(); i++ )
+	{
+		distconn_t *pOther = g_DistConns[i];
+		if ( pOther->m_nState != DISTCONN_BUSY || g_SlotDone[pOther->m_iSlot] ||
+			 g_SlotCopies[pOther->m_iSlot] >= DISTWORK_MAX_COPIES || pOther->m_nWorkerID == pConn->m_nWorkerID )
+		{
+			continue;
+		}
+		if ( !pOldest || pOther->m_flStartTime < pOldest->m_flStartTime )
+			pOldest = pOther;
+	}
+	return pOldest ? pOldest->m_iSlot : -1;
+}
+
+static void DropConnection( distconn_t *pConn )
+{
+	if ( pConn->m_nState == DISTCONN_BUSY )
+	{
+		int iSlot = pConn->m_iSlot;
+		if ( --g_SlotCopies[iSlot] == 0 && !g_SlotDone[iSlot] )
+		{
+			Warning( "Lost a worker, handing out work unit %llu again.\n", (unsigned long long)SlotWorkUnit( iSlot ) );
+			g_RequeuedSlots.AddToTail( iSlot );
+		}
+	}
+
+	closesocket( pConn->m_Socket );
+	g_DistConns.FindAndRemove( pConn );
+	delete pConn;
+}
+
+static bool AssignWork( distconn_t *pConn )
+{
+	int iSlot = NextSlot( pConn );
+	if ( iSlot < 0 )
+	{
+		pConn->m_nState = DISTCONN_IDLE;
+		return true;
+	}
+
+	// The results this worker process hasn't seen go along with it
+	CUtlBuffer buf;
+	uint64 iWorkUnit = SlotWorkUnit( iSlot );
+	buf.Put( &iWorkUnit, sizeof( iWorkUnit ) );
+	int nSharedPos = buf.TellPut();
+	buf.PutInt( 0 );
+
+	int nShared = 0;
+	if ( g_pShareFn )
+	{
+		distworkerproc_t *pProc = FindWorkerProc( pConn->m_nWorkerID );
+		for ( ; pProc->m_iNextShared < g_Shared.Count() && nShared < DISTWORK_MAX_SHARED; pProc->m_iNextShared++ )
+		{
+			distshared_t &shared = g_Shared[pProc->m_iNextShared];
+			if ( shared.m_nWorkerID == pConn->m_nWorkerID )
+				continue;
+			if ( buf.TellPut() + (int)( sizeof( shared.m_iWorkUnit ) + sizeof( int ) ) + shared.m_nBytes > DISTWORK_MAX_MESSAGE )
+				break;	// the rest go with the next one
+			buf.Put( &shared.m_iWorkUnit, sizeof( shared.m_iWorkUnit ) );
+			buf.PutInt( shared.m_nBytes );
+			buf.Put( &g_SharedData[shared.m_nOffset], shared.m_nBytes );
+			nShared++;
+		}
+	}
+	*(int *)( (byte *)buf.Base() + nSharedPos ) = nShared;
+
+	pConn->m_nState = DISTCONN_BUSY;
+	pConn->m_iSlot = iSlot;
+	pConn->m_flStartTime = Plat_FloatTime();
+	g_SlotCopies[iSlot]++;
+	return SendMessage( pConn->m_Socket, DISTMSG_WORK, buf.Base(), buf.TellPut() );
+}
+
+static void ReceiveResult( distconn_t *pConn, const byte *pData, int nBytes )
+{
+	int iSlot = pConn->m_iSlot;
+	g_SlotCopies[iSlot]--;
+	if ( g_SlotDone[iSlot] )
+		return;
+
+	g_SlotDone[iSlot] = true;
+	g_nSlotsDone++;
+
+	uint64 iWorkUnit = *(const uint64 *)pData;
+	pData += sizeof( iWorkUnit );
+	nBytes -= sizeof( iWorkUnit );
+
+	CUtlBuffer buf( pData, nBytes, CUtlBuffer::READ_ONLY );
+	g_pReceiveFn( iWorkUnit, buf );
+
+	if ( g_pShareFn )
+	{
+		distshared_t &shared = g_Shared[g_Shared.AddToTail()];
+		shared.m_iWorkUnit = iWorkUnit;
+		shared.m_nWorkerID = pConn->m_nWorkerID;
+		shared.m_nOffset = g_SharedData.Count();
+		shared.m_nBytes = nBytes;
+		g_SharedData.AddMultipleToTail( nBytes, pData );
+	}
+}
+
+// Returns false if the connection should be dropped
+static bool HandleMessage( distconn_t *pConn, int nType, const byte *pData, int nBytes )
+{
+	if ( nType == DISTMSG_HELLO )
+	{
+		const disthello_t *pHello = (const disthello_t *)pData;
+		if ( pConn->m_nState != DISTCONN_HELLO || nBytes != sizeof( disthello_t ) ||
+			 pHello->m_nMagic != DISTWORK_MAGIC || pHello->m_nVersion != DISTWORK_VERSION )
+		{
+			Warning( "A worker that doesn't speak our protocol connected, dropping it.\n" );
+			return false;
+		}
+
+		pConn->m_nStage = pHello->m_nStage;
+		pConn->m_nWorkerID = pHello->m_nWorkerID;
+		if ( pConn->m_nStage < g_nDistStage )
+		{
+			// Too late for that one
+			pConn->m_nState = DISTCONN_DRAINING;
+			return SendMessage( pConn->m_Socket, DISTMSG_DONE, NULL, 0 );
+		}
+		if ( pConn->m_nStage > g_nDistStage )
+		{
+			// It waits for us to get there
+			pConn->m_nState = DISTCONN_IDLE;
+			return true;
+		}
+		return AssignWork( pConn );
+	}
+
+	if ( nType == DISTMSG_RESULT )
+	{
+		if ( pConn->m_nState == DISTCONN_DRAINING )
+			return true;
+		if ( pConn->m_nState != DISTCONN_BUSY || nBytes < (int)sizeof( uint64 ) ||
+			 *(const uint64 *)pData != SlotWorkUnit( pConn->m_iSlot ) )
+		{
+			Warning( "A worker sent a result it wasn't asked for, dropping it.\n" );
+			return false;
+		}
+		ReceiveResult( pConn, pData, nBytes );
+		return AssignWork( pConn );
+	}
+
+	return false;
+}
+
+// Reads what's there and handles the whole messages. Returns false if the
+// connection should be dropped.
+static bool ReadConnection( distconn_t *pConn )
+{
+	byte buf[65536];
+	int nReceived = recv( pConn->m_Socket, (char *)buf, sizeof( buf ), 0 );
+	if ( nReceived <= 0 )
+		return false;
+	pConn->m_Received.AddMultipleToTail( nReceived, buf );
+
+	int nUsed = 0;
+	while ( pConn->m_Received.Count() - nUsed >= (int)sizeof( distmsgheader_t ) )
+	{
+		const distmsgheader_t *pHeader = (const distmsgheader_t *)&pConn->m_Received[nUsed];
+		if ( pHeader->m_nBytes > DISTWORK_MAX_MESSAGE )
+		{
+			Warning( "A worker sent a %u byte message, dropping it.\n", pHeader->m_nBytes );
+			return false;
+		}
+		int nMessage = sizeof( distmsgheader_t ) + pHeader->m_nBytes;
+		if ( pConn->m_Received.Count() - nUsed < nMessage )
+			break;
+
+		if ( !HandleMessage( pConn, pHeader->m_nType, (const byte *)( pHeader + 1 ), pHeader->m_nBytes ) )
+			return false;
+		nUsed += nMessage;
+	}
+	pConn->m_Received.RemoveMultiple( 0, nUsed );
+	return true;
+}
+
+// Whether anyone might still come back with results
+static bool HaveWorkers()
+{
+	if ( g_bDistListen || g_LocalWorkers.Count() )
+		return true;
+	for ( int i = 0; i < g_DistConns.Count(); i++ )
+	{
+		if ( g_DistConns[i]->m_nState != DISTCONN_DRAINING )
+			return true;
+	}
+	return false;
+}
+
+static void DoWorkLocally()
+{
+	CUtlBuffer results;
+	for ( int iSlot = 0; iSlot < g_nStageWorkUnits; iSlot++ )
+	{
+		if ( g_SlotDone[iSlot] )
+			continue;
+
+		uint64 iWorkUnit = SlotWorkUnit( iSlot );
+		results.Clear();
+		g_pProcessFn( 0, iWorkUnit, results );
+
+		CUtlBuffer buf( results.Base(), results.TellPut(), CUtlBuffer::READ_ONLY );
+		g_pReceiveFn( iWorkUnit, buf );
+		g_SlotDone[iSlot] = true;
+		g_nSlotsDone++;
+		UpdatePacifier( (float)g_nSlotsDone / g_nStageWorkUnits );
+	}
+}
+
+static void CoordinateStage()
+{
+	g_SlotDone.SetCount( g_nStageWorkUnits );
+	g_SlotCopies.SetCount( g_nStageWorkUnits );
+	memset( g_SlotDone.Base(), 0, g_nStageWorkUnits * sizeof( byte ) );
+	memset( g_SlotCopies.Base(), 0, g_nStageWorkUnits * sizeof( int ) );
+	g_RequeuedSlots.RemoveAll();
+	g_iNextSlot = 0;
+	g_nSlotsDone = 0;
+	g_Shared.RemoveAll();
+	g_SharedData.RemoveAll();
+	g_DistWorkerProcs.RemoveAll();
+
+	while ( g_nSlotsDone < g_nStageWorkUnits )
+	{
+		// Give anyone waiting something to do, including the ones that
+		// got here before we did
+		for ( int i = g_DistConns.Count() - 1; i >= 0; i-- )
+		{
+			distconn_t *pConn = g_DistConns[i];
+			if ( pConn->m_nState == DISTCONN_IDLE && pConn->m_nStage == g_nDistStage && !AssignWork( pConn ) )
+				DropConnection( pConn );
+		}
+
+		fd_set readSet;
+		FD_ZERO( &readSet );
+		FD_SET( g_ListenSocket, &readSet );
+		SOCKET maxSocket = g_ListenSocket;
+		for ( int i = 0; i < g_DistConns.Count(); i++ )
+		{
+			FD_SET( g_DistConns[i]->m_Socket, &readSet );
+			maxSocket = MAX( maxSocket, g_DistConns[i]->m_Socket );
+		}
+
+		struct timeval timeout;
+		timeout.tv_sec = 0;
+		timeout.tv_usec = 200000;
+		if ( select( (int)maxSocket + 1, &readSet, NULL, NULL, &timeout ) > 0 )
+		{
+			for ( int i = g_DistConns.Count() - 1; i >= 0; i-- )
+			{
+				distconn_t *pConn = g_DistConns[i];
+				if ( FD_ISSET( pConn->m_Socket, &readSet ) && !ReadConnection( pConn ) )
+					DropConnection( pConn );
+			}
+			if ( FD_ISSET( g_ListenSocket, &readSet ) )
+				AcceptWorker();
+		}
+
+		ReapLocalWorkers( false );
+		if ( !HaveWorkers() )
+		{
+			Warning( "\nNo workers left, doing the rest here.\n" );
+			DoWorkLocally();
+		}
+
+		UpdatePacifier( (float)g_nSlotsDone / g_nStageWorkUnits );
+	}
+
+	// Anyone still busy is doing a copy of something that's done. They find
+	// the news when they send it in; nothing is closed until we exit so the
+	// late results don't bounce.
+	for ( int i = g_DistConns.Count() - 1; i >= 0; i-- )
+	{
+		distconn_t *pConn = g_DistConns[i];
+		if ( pConn->m_nState == DISTCONN_DRAINING || pConn->m_nStage > g_nDistStage )
+			continue;
+		pConn->m_nState = DISTCONN_DRAINING;
+		if ( !SendMessage( pConn->m_Socket, DISTMSG_DONE, NULL, 0 ) )
+			DropConnection( pConn );
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Worker
+//-----------------------------------------------------------------------------
+static void ApplySharedResults( const byte *&pData, int nShared )
+{
+	for ( int i = 0; i < nShared; i++ )
+	{
+		uint64 iWorkUnit = *(const uint64 *)pData;
+		pData += sizeof( iWorkUnit );
+		int nBytes = *(const int *)pData;
+		pData += sizeof( nBytes );
+
+		CUtlBuffer buf( pData, nBytes, CUtlBuffer::READ_ONLY );
+		g_pShareFn( iWorkUnit, buf );
+		pData += nBytes;
+	}
+}
+
+static void DistWorkerThread( int iThread, void *pUserData )
+{
+	SOCKET s = ConnectToCoordinator();
+
+	disthello_t hello;
+	hello.m_nMagic = DISTWORK_MAGIC;
+	hello.m_nVersion = DISTWORK_VERSION;
+	hello.m_nStage = g_nDistStage;
+	hello.m_nPad = 0;
+	hello.m_nWorkerID = g_nWorkerID;
+	if ( !SendMessage( s, DISTMSG_HELLO, &hello, sizeof( hello ) ) )
+		Error( "Lost the connection to the coordinator.\n" );
+
+	CUtlVector<byte> data;
+	CUtlBuffer results;
+	while ( 1 )
+	{
+		distmsgheader_t header;
+		if ( !RecvMessage( s, header, data ) )
+			Error( "Lost the connection to the coordinator.\n" );
+		if ( header.m_nType == DISTMSG_DONE )
+			break;
+		if ( header.m_nType == DISTMSG_QUIT )
+		{
+			Msg( "The coordinator is finished.\n" );
+			CmdLib_Exit( 0 );
+		}
+		if ( header.m_nType != DISTMSG_WORK )
+			Error( "Got a message from the coordinator that doesn't make sense.\n" );
+
+		const byte *pData = data.Base();
+		uint64 iWorkUnit = *(const uint64 *)pData;
+		pData += sizeof( iWorkUnit );
+		int nShared = *(const int *)pData;
+		pData += sizeof( nShared );
+		ApplySharedResults( pData, nShared );
+
+		results.Clear();
+		g_pProcessFn( iThread, iWorkUnit, results );
+		if ( results.TellPut() > DISTWORK_MAX_RESULTS )
+			Error( "Work unit %llu has %d bytes of results, more than a message can hold.\n", (unsigned long long)iWorkUnit, results.TellPut() );
+		if ( !SendMessage( s, DISTMSG_RESULT, &iWorkUnit, sizeof( iWorkUnit ), results.Base(), results.TellPut() ) )
+			Error( "Lost the connection to the coordinator.\n" );
+	}
+
+	closesocket( s );
+}
+
+
+//-----------------------------------------------------------------------------
+// Interface
+//-----------------------------------------------------------------------------
+void DistWork_Init( int &argc, char **&argv )
+{
+	int nLocalWorkers = -1;
+	for ( int i = 1; i < argc; i++ )
+	{
+		if ( !Q_stricmp( argv[i], "-distribute" ) && i + 1 < argc )
+		{
+			nLocalWorkers = atoi( argv[i + 1] );
+		}
+		else if ( !Q_stricmp( argv[i], "-distlisten" ) )
+		{
+			g_bDistListen = true;
+		}
+		else if ( !Q_stricmp( argv[i], "-distport" ) && i + 1 < argc )
+		{
+			g_nDistPort = atoi( argv[i + 1] );
+		}
+		else if ( !Q_stricmp( argv[i], "-distworker" ) && i + 1 < argc )
+		{
+			V_strncpy( g_szCoordinator, argv[i + 1], sizeof( g_szCoordinator ) );
+			g_bDistWorker = true;
+		}
+	}
+	if ( nLocalWorkers < 0 && !g_bDistListen && !g_bDistWorker )
+		return;
+
+	g_bDistWork = true;
+
+#ifdef _WIN32
+	WSADATA wsaData;
+	WSAStartup( MAKEWORD( 2, 0 ), &wsaData );
+#else
+	// a worker hanging up shows up in recv() instead
+	signal( SIGPIPE, SIG_IGN );
+#endif
+
+	if ( g_bDistWorker )
+	{
+		char szHost[256] = "";
+		gethostname( szHost, sizeof( szHost ) );
+		g_nWorkerID = ( (uint64)CRC32_ProcessSingleBuffer( szHost, V_strlen( szHost ) ) << 32 ) ^
+			( (uint64)getpid() << 16 ) ^ (uint64)( Plat_FloatTime() * 1000000.0 );
+	}
+	else
+	{
+		OpenListenSocket();
+		Msg( "Distributing work on port %d\n", g_nDistPort );
+		StartLocalWorkers( MAX( nLocalWorkers, 0 ), argc, argv );
+		CmdLib_AtCleanup( DistWork_Shutdown );
+	}
+
+	// Take our arguments out of the command line
+	int nArgs = 1;
+	for ( int i = 1; i < argc; i++ )
+	{
+		if ( IsDistArg( argv[i] ) )
+			i++;
+		else if ( Q_stricmp( argv[i], "-distlisten" ) )
+			argv[nArgs++] = argv[i];
+	}
+	argc = nArgs;
+}
+
+double DistributeWorkUnits( int nWorkUnits, const uint64 *pWorkUnits, DistProcessWorkUnitFn processFn,
+							DistReceiveWorkUnitFn receiveFn, DistShareWorkUnitFn shareFn )
+{
+	Assert( g_bDistWork );
+	double flStart = Plat_FloatTime();
+
+	g_nDistStage++;
+	g_nStageWorkUnits = nWorkUnits;
+	g_pStageWorkUnits = pWorkUnits;
+	g_pProcessFn = processFn;
+	g_pReceiveFn = receiveFn;
+	g_pShareFn = shareFn;
+
+	if ( g_bDistWorker )
+	{
+		if ( numthreads == -1 )
+			ThreadSetDefault();
+		if ( numthreads > MAX_TOOL_THREADS )
+			numthreads = MAX_TOOL_THREADS;
+		RunThreadsOn( numthreads, false, DistWorkerThread );
+	}
+	else
+	{
+		CoordinateStage();
+	}
+
+	return Plat_FloatTime() - flStart;
+}
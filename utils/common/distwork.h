@@ -0,0 +1,63 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Hands work units out to worker processes over TCP, on this
+//			machine or others, for the tools that can't use VMPI
+//
+//=============================================================================//
+
+#ifndef DISTWORK_H
+#define DISTWORK_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "tier1/utlbuffer.h"
+
+
+#define DISTWORK_DEFAULT_PORT	27800
+
+
+// Workers implement this to do a work unit. Append the results to buf.
+typedef void (*DistProcessWorkUnitFn)( int iThread, uint64 iWorkUnit, CUtlBuffer &buf );
+
+// The coordinator implements this to take the results written by
+// DistProcessWorkUnitFn. Called on the main thread, once per work unit.
+typedef void (*DistReceiveWorkUnitFn)( uint64 iWorkUnit, CUtlBuffer &buf );
+
+// Workers implement this to see the results of work units the other workers
+// finished. Called on a worker thread between work units.
+typedef void (*DistShareWorkUnitFn)( uint64 iWorkUnit, CUtlBuffer &buf );
+
+
+extern bool g_bDistWork;		// Coordinating or working.
+extern bool g_bDistWorker;		// Working for a coordinator somewhere else.
+
+
+// Call this first thing in the exe. It takes these out of argv:
+//   -distribute <n>          : coordinate, and start n worker processes on this machine
+//   -distlisten              : also take workers from other machines
+//   -distport <port>         : port to take them on (default: DISTWORK_DEFAULT_PORT)
+//   -distworker <host:port>  : work for the coordinator at host:port
+void DistWork_Init( int &argc, char **&argv );
+
+// The coordinator and all the workers call this at the same point, with the
+// same functions. Workers run numthreads work units at a time until the
+// coordinator has the results of all of them. A work unit is handed out
+// again if the worker doing it goes away, and the idle workers take copies
+// of the slow ones at the end; the first result back is the one used.
+//
+// pWorkUnits lists the work units on the coordinator, or NULL for
+// 0 .. nWorkUnits-1. If shareFn is set, every worker gets the results of the
+// work units the others did.
+//
+// Returns how long it took.
+double DistributeWorkUnits(
+	int nWorkUnits,
+	const uint64 *pWorkUnits,
+	DistProcessWorkUnitFn processFn,
+	DistReceiveWorkUnitFn receiveFn,
+	DistShareWorkUnitFn shareFn = NULL
+	);
+
+
+#endif // DISTWORK_H
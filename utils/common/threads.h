@@ -24,6 +24,10 @@
 
 extern	int		numthreads;
 
+// True while RunThreadsOn is running. Code that may be called from a worker
+// thread checks this before starting threads of its own.
+extern	qboolean	threaded;
+
 // If set to true, then all the threads that are created are low priority.
 extern bool	g_bLowPriorityThreads;
 
@@ -7,6 +7,8 @@
 //=============================================================================//
 
 #include "vbsp.h"
+#include "utlvector.h"
+#include "pacifier.h"
 
 
 int		c_nodes;
@@ -310,17 +312,16 @@ AllocNode
 */
 node_t *AllocNode (void)
 {
-	static int s_NodeCount = 0;
+	static int32 volatile s_NodeCount = 0;
 
 	node_t	*node;
 
 	node = (node_t*)malloc(sizeof(*node));
 	memset (node, 0, sizeof(*node));
-	node->id = s_NodeCount;
+	// the subtrees are built on threads
+	node->id = ThreadInterlockedIncrement( &s_NodeCount ) - 1;
 	node->diskId = -1;
 
-	s_NodeCount++;
-
 	return node;
 }
 
@@ -332,7 +333,7 @@ AllocBrush
 */
 bspbrush_t *AllocBrush (int numsides)
 {
-	static int s_BrushId = 0;
+	static int32 volatile s_BrushId = 0;
 
 	bspbrush_t	*bb;
 	int			c;
@@ -340,7 +341,7 @@ bspbrush_t *AllocBrush (int numsides)
 	c = (int)&(((bspbrush_t *)0)->sides[numsides]);
 	bb = (bspbrush_t*)malloc(c);
 	memset (bb, 0, c);
-	bb->id = s_BrushId++;
+	bb->id = ThreadInterlockedIncrement( &s_BrushId ) - 1;
 	if (numthreads == 1)
 		c_active_brushes++;
 	return bb;
@@ -1331,7 +1332,20 @@ BuildTree_r
 */
 
 
-node_t *BuildTree_r (node_t *node, bspbrush_t *brushes)
+// The split tree is built serially this many levels down, and the subtrees
+// under that are built on threads. Each subtree only depends on its own
+// brushes and volume, so the result doesn't depend on the scheduling.
+#define BUILDTREE_SERIAL_DEPTH	6
+
+struct buildtreework_t
+{
+	node_t		*node;
+	bspbrush_t	*brushes;
+};
+
+static CUtlVector<buildtreework_t> g_BuildTreeWork;
+
+node_t *BuildTree_r (node_t *node, bspbrush_t *brushes, int depth = -1)
 {
 	node_t		*newnode;
 	side_t		*bestside;
@@ -1371,14 +1385,51 @@ node_t *BuildTree_r (node_t *node, bspbrush_t *brushes)
 	SplitBrush (node->volume, node->planenum, &node->children[0]->volume,
 		&node->children[1]->volume);
 
-	// recursively process children
+	// recursively process children, or queue them up for the threads
 	for (i=0 ; i<2 ; i++)
 	{
-		node->children[i] = BuildTree_r (node->children[i], children[i]);
+		if (depth == 0)
+		{
+			int j = g_BuildTreeWork.AddToTail();
+			g_BuildTreeWork[j].node = node->children[i];
+			g_BuildTreeWork[j].brushes = children[i];
+			continue;
+		}
+
+		node->children[i] = BuildTree_r (node->children[i], children[i], depth - 1);
 	}
 
 	return node;
 }
+
+static void BuildSubtree_Thread (int threadnum, int worknum)
+{
+	BuildTree_r (g_BuildTreeWork[worknum].node, g_BuildTreeWork[worknum].brushes);
+}
+
+/*
+================
+BuildTree
+
+Builds the top of the tree, then the subtrees under it on threads, unless
+we're already running on a worker thread
+================
+*/
+static node_t *BuildTree (node_t *node, bspbrush_t *brushes)
+{
+	if (threaded || numthreads <= 1)
+		return BuildTree_r (node, brushes);
+
+	Assert( g_BuildTreeWork.Count() == 0 );
+	BuildTree_r (node, brushes, BUILDTREE_SERIAL_DEPTH);
+
+	SuppressPacifier (true);
+	RunThreadsOnIndividual (g_BuildTreeWork.Count(), false, BuildSubtree_Thread);
+	SuppressPacifier (false);
+	g_BuildTreeWork.Purge();
+
+	return node;
+}
 	  
 
 //===========================================================
@@ -1447,7 +1498,7 @@ tree_t *BrushBSP (bspbrush_t *brushlist, Vector& mins, Vector& maxs)
 
 	tree->headnode = node;
 
-	node = BuildTree_r (node, brushlist);
+	node = BuildTree (node, brushlist);
 	qprintf ("%5i visible nodes\n", c_nodes/2 - c_nonvis);
 	qprintf ("%5i nonvis nodes\n", c_nonvis);
 	qprintf ("%5i leafs\n", (c_nodes+1)/2);
@@ -14,6 +14,8 @@
 #include "mstristrip.h"
 #include "tier1/strtools.h"
 #include "materialpatch.h"
+#include "pacifier.h"
+
 /*
 
   some faces will be removed before saving, but still form nodes:
@@ -791,16 +793,17 @@ int		c_faces;
 
 face_t	*AllocFace (void)
 {
-	static int s_FaceId = 0;
+	static int32 volatile s_FaceId = 0;
 
 	face_t	*f;
 
 	f = (face_t*)malloc(sizeof(*f));
 	memset (f, 0, sizeof(*f));
-	f->id = s_FaceId;
-	++s_FaceId;
+	// faces are made on the MakeFaces threads too
+	f->id = ThreadInterlockedIncrement( &s_FaceId ) - 1;
 
-	c_faces++;
+	if (numthreads == 1)
+		c_faces++;
 
 	return f;
 }
@@ -822,7 +825,8 @@ void FreeFace (face_t *f)
 	if (f->w)
 		FreeWinding (f->w);
 	free (f);
-	c_faces--;
+	if (numthreads == 1)
+		c_faces--;
 }
 
 
@@ -1107,7 +1111,8 @@ face_t *TryMerge (face_t *f1, face_t *f2, Vector& planenormal)
 	if (!nw)
 		return NULL;
 
-	c_merge++;
+	if (numthreads == 1)
+		c_merge++;
 	newf = NewFaceFromFace (f1);
 	newf->w = nw;
 
@@ -1211,7 +1216,8 @@ void SubdivideFace (face_t **pFaceList, face_t *f)
 				break;
 			
 		// split it
-			c_subdivide++;
+			if (numthreads == 1)
+				c_subdivide++;
 			
 			luxelsPerWorldUnit = VectorNormalize (temp);	
 
@@ -1410,8 +1416,14 @@ mark the side that originally created it
   solid / water : solid
   water / empty : water
   water / water : none
+
+The faces on each node are merged and subdivided afterwards by
+MakeNodeFaces_Thread. Only the faces on a node are touched, so the nodes
+can be done in any order.
 ===============
 */
+static CUtlVector<node_t *> g_FaceNodes;
+
 void MakeFaces_r (node_t *node)
 {
 	portal_t	*p;
@@ -1423,11 +1435,8 @@ void MakeFaces_r (node_t *node)
 		MakeFaces_r (node->children[0]);
 		MakeFaces_r (node->children[1]);
 
-		// merge together all visible faces on the node
-		if (!nomerge)
-			MergeFaceList(&node->faces);
-		if (!nosubdiv)
-			SubdivideFaceList(&node->faces);
+		if (node->faces)
+			g_FaceNodes.AddToTail (node);
 
 		return;
 	}
@@ -1451,6 +1460,17 @@ void MakeFaces_r (node_t *node)
 	}
 }
 
+static void MakeNodeFaces_Thread (int threadnum, int nodenum)
+{
+	node_t *node = g_FaceNodes[nodenum];
+
+	// merge together all visible faces on the node
+	if (!nomerge)
+		MergeFaceList(&node->faces);
+	if (!nosubdiv)
+		SubdivideFaceList(&node->faces);
+}
+
 typedef winding_t *pwinding_t;
 
 static void PrintWinding( winding_t *w )
@@ -1804,6 +1824,19 @@ void MakeFaces (node_t *node)
 
 	MakeFaces_r (node);
 
+	if (!threaded)
+	{
+		SuppressPacifier (true);
+		RunThreadsOnIndividual (g_FaceNodes.Count(), false, MakeNodeFaces_Thread);
+		SuppressPacifier (false);
+	}
+	else
+	{
+		for (int i = 0; i < g_FaceNodes.Count(); i++)
+			MakeNodeFaces_Thread (0, i);
+	}
+	g_FaceNodes.Purge();
+
 	qprintf ("%5i makefaces\n", c_nodefaces);
 	qprintf ("%5i merged\n", c_merge);
 	qprintf ("%5i subdivided\n", c_subdivide);
@@ -284,9 +284,17 @@ void ProcessWorldModel (void)
 		//
 
 		// make the portals/faces by traversing down to each empty leaf
+		start = Plat_FloatTime();
+		Msg("Building Portals...");
 		MakeTreePortals (tree);
+		Msg("done (%d)\n", (int)(Plat_FloatTime() - start) );
 
-		if (FloodEntities (tree))
+		start = Plat_FloatTime();
+		Msg("Flooding Entities...");
+		qboolean bFilled = FloodEntities (tree);
+		Msg("done (%d)\n", (int)(Plat_FloatTime() - start) );
+
+		if (bFilled)
 		{
 			// turns everthing outside into solid
 			FillOutside (tree->headnode);
@@ -316,7 +324,10 @@ void ProcessWorldModel (void)
 		}
 	}
 
+	start = Plat_FloatTime();
+	Msg("Flooding Areas...");
 	FloodAreas (tree);
+	Msg("done (%d)\n", (int)(Plat_FloatTime() - start) );
 
 	RemoveAreaPortalBrushes_R( tree->headnode );
 
@@ -337,7 +348,10 @@ void ProcessWorldModel (void)
 	face_t *pLeafFaceList = NULL;
 	if ( !nodetail )
 	{
+		start = Plat_FloatTime();
+		Msg("Merging Detail...");
 		pLeafFaceList = MergeDetailTree( tree, brush_start, brush_end );
+		Msg("done (%d)\n", (int)(Plat_FloatTime() - start) );
 	}
 
 	start = Plat_FloatTime();
@@ -831,6 +845,8 @@ void ProcessModels (void)
 	// Remove them from the list of models to process below
 	EmitOccluderBrushes( );
 
+	int nSubModels = 0;
+	float flSubModelTime = 0.0f;
 	for ( entity_num=0; entity_num < num_entities; ++entity_num )
 	{
 		entity_t *pEntity = &entities[entity_num];
@@ -847,7 +863,10 @@ void ProcessModels (void)
 		}
 		else
 		{
+			float flStart = Plat_FloatTime();
 			ProcessSubModel( );
+			flSubModelTime += Plat_FloatTime() - flStart;
+			++nSubModels;
 		}
 
 		EndModel ();
@@ -858,6 +877,8 @@ void ProcessModels (void)
 		}
 	}
 
+	Msg( "%d brush models done (%d)\n", nSubModels, (int)flSubModelTime );
+
 	// Turn the skybox into a cubemap in case we don't build env_cubemap textures.
 	Cubemap_CreateDefaultCubemaps();
 	EndBSPFile ();
@@ -70,6 +70,10 @@ public:
 	virtual bool			ReadFile( const char *pFileName, const char *pPath, CUtlBuffer &buf, int nMaxBytes = 0, int nStartingByte = 0, FSAllocFunc_t pfnAlloc = 0 );
 	virtual bool			WriteFile( const char *pFileName, const char *pPath, CUtlBuffer &buf );
 
+	// Handles are IVMPIFiles, there's nothing to map
+	virtual void			*MapFileView( FileHandle_t hFile, unsigned nOffset, unsigned nSize ) { return NULL; }
+	virtual void			UnmapFileView( void *pView, unsigned nSize ) {}
+
 // All the IFileSystem-specific ones pass the calls through.
 // The worker opens its own filesystem_stdio fthrough.
 
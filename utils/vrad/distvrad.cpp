@@ -0,0 +1,58 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: BuildFacelights on worker processes, for -distribute and
+//			-distworker
+//
+//=============================================================================//
+
+#include "vrad.h"
+#include "lightmap.h"
+#include "pacifier.h"
+#include "distwork.h"
+
+
+extern void BuildPatchLights( int facenum );
+
+
+//-----------------------------------------------------------------------------
+// Sends back what BuildFacelights made for the face
+//-----------------------------------------------------------------------------
+static void ProcessDistFace( int iThread, uint64 iFace, CUtlBuffer &buf )
+{
+	BuildFacelights( iThread, (int)iFace );
+	PutFacelight( (int)iFace, buf );
+}
+
+static void ReceiveDistFace( uint64 iFace, CUtlBuffer &buf )
+{
+	if ( !GetFacelight( (int)iFace, buf ) )
+		Error( "Got a short face from a -distribute worker.\n" );
+}
+
+//-----------------------------------------------------------------------------
+// Runs BuildFacelights on the workers and BuildPatchLights here. The workers
+// exit when it's done.
+//-----------------------------------------------------------------------------
+void RunDistBuildFacelights()
+{
+	Msg( "%-20s ", "BuildFacelights:" );
+	if ( !g_bDistWorker )
+		StartPacifier( "" );
+
+	double elapsed = DistributeWorkUnits( numfaces, NULL, ProcessDistFace, ReceiveDistFace );
+
+	if ( g_bDistWorker )
+	{
+		Msg( "VRAD worker finished.\n" );
+		CmdLib_Exit( 0 );
+	}
+
+	EndPacifier( false );
+	Msg( " (%d)\n", (int)elapsed );
+
+	// BuildFacelights leaves this to the coordinator, it needs all the faces
+	for ( int i = 0; i < numfaces; ++i )
+	{
+		BuildPatchLights( i );
+	}
+}
@@ -0,0 +1,497 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Keeps the direct light of each face and the bounce transfers
+//			between runs on the same map, so only the faces that a changed
+//			light can reach are lit again
+//
+//			The transfers go in a file of their own next to the light cache.
+//			They can run to gigabytes, so they're streamed in and out a block
+//			at a time instead of going through one CUtlBuffer.
+//
+//=============================================================================//
+
+#include "vrad.h"
+#include "lightmap.h"
+#include "tier1/generichash.h"
+#include "tier1/utlbuffer.h"
+#include "tier1/utlhashtable.h"
+#include "filesystem.h"
+
+#define LIGHTCACHE_ID		MAKEID('V','R','C','3')
+#define TRANSFERCACHE_ID	MAKEID('V','R','T','2')
+
+extern void BuildPatchLights( int facenum );
+
+// A light only ever reaches the samples in the clusters of its PVS. Each face
+// keeps the clusters its samples were in, so a face whose clusters aren't in
+// the PVS of any light that was added, removed or changed gets the same
+// direct light as before.
+//
+// Anything that can move a shadow or a sample, or change the patches, goes
+// into the world key, and the whole map is lit again when it changes. The
+// face key covers what only lights that face: its texinfo and lightmap.
+static uint64					g_WorldKey;
+static CUtlVector<uint64>		g_FaceKeys;
+static CUtlVector< CUtlVector<int> >	g_FaceClusters;
+
+// the lights of this run: key, then the PVS
+static CUtlVector<uint64>		g_LightKeys;
+static CUtlBuffer				g_LightPVS;
+static int						g_nPVSBytes;
+
+// the last run
+static CUtlBuffer				g_CacheFile;
+static CUtlVector<int>			g_CachedFaceOffsets;	// -1 to light the face again
+static bool						g_bTransfersCached;		// the transfers file already has these
+
+static inline uint64 MixBits( uint64 n )
+{
+	n ^= n >> 33;
+	n *= 0xff51afd7ed558ccdull;
+	n ^= n >> 33;
+	n *= 0xc4ceb9fe1a85ec53ull;
+	n ^= n >> 33;
+	return n;
+}
+
+static inline uint64 HashCombine( uint64 nHash, const void *pData, int nBytes )
+{
+	return MixBits( nHash ^ MurmurHash64( pData, nBytes, (uint32)nHash ) );
+}
+
+template<class T> static inline uint64 HashCombine( uint64 nHash, T const &value )
+{
+	return HashCombine( nHash, &value, sizeof( value ) );
+}
+
+static uint64 ComputeWorldKey( void )
+{
+	// The options that change where the samples are or what the rays hit
+	float options[] =
+	{
+		(float)g_bHDR, (float)do_extra, (float)debug_extra, (float)do_fast, (float)do_centersamples,
+		(float)dlight_map, (float)g_bLargeDispSampleRadius, (float)g_bStaticPropPolys,
+		(float)g_bTextureShadows, (float)g_bDisablePropSelfShadowing, (float)g_bNoSkyRecurse,
+		(float)g_bHalfTransfers, g_flSkySampleScale, smoothing_threshold, g_SunAngularExtent,
+		g_flMaxDispSampleSize,
+	};
+
+	uint64 nKey = HashCombine( 0, options, sizeof( options ) );
+	nKey = HashCombine( nKey, numfaces );
+	nKey = HashCombine( nKey, dvertexes, numvertexes * sizeof( dvertexes[0] ) );
+	nKey = HashCombine( nKey, dplanes, numplanes * sizeof( dplanes[0] ) );
+	nKey = HashCombine( nKey, dedges, numedges * sizeof( dedges[0] ) );
+	nKey = HashCombine( nKey, dsurfedges, numsurfedges * sizeof( dsurfedges[0] ) );
+	nKey = HashCombine( nKey, dmodels, nummodels * sizeof( dmodels[0] ) );
+	nKey = HashCombine( nKey, dnodes, numnodes * sizeof( dnodes[0] ) );
+	nKey = HashCombine( nKey, dvisdata, visdatasize );
+	nKey = HashCombine( nKey, g_dispinfo.Base(), g_dispinfo.Count() * sizeof( ddispinfo_t ) );
+	nKey = HashCombine( nKey, g_DispVerts.Base(), g_DispVerts.Count() * sizeof( CDispVert ) );
+	nKey = HashCombine( nKey, g_DispTris.Base(), g_DispTris.Count() * sizeof( CDispTri ) );
+
+	for ( int i = 0; i < numleafs; i++ )
+	{
+		nKey = HashCombine( nKey, dleafs[i].cluster );
+	}
+
+	// the normals are smoothed across faces
+	for ( int i = 0; i < numfaces; i++ )
+	{
+		nKey = HashCombine( nKey, g_pFaces[i].smoothingGroups );
+	}
+
+	// everything that casts a shadow: brushes, displacements and props
+	for ( int i = 0; i < g_RtEnv.OptimizedTriangleList.Count(); i++ )
+	{
+		nKey = HashCombine( nKey, g_RtEnv.OptimizedTriangleList[i] );
+	}
+	nKey = HashCombine( nKey, g_RtEnv.TriangleColors.Base(), g_RtEnv.TriangleColors.Count() * sizeof( Vector ) );
+	nKey = HashCombine( nKey, g_RtEnv.TriangleMaterials.Base(), g_RtEnv.TriangleMaterials.Count() * sizeof( int32 ) );
+
+	return nKey;
+}
+
+static uint64 ComputeFaceKey( int facenum )
+{
+	// leave out what BuildFacelights writes
+	dface_t face = g_pFaces[facenum];
+	memset( face.styles, 0, sizeof( face.styles ) );
+	face.lightofs = 0;
+
+	texinfo_t *pTexinfo = &texinfo[face.texinfo];
+	uint64 nKey = HashCombine( g_WorldKey, face );
+	nKey = HashCombine( nKey, *pTexinfo );
+	if ( pTexinfo->texdata >= 0 )
+	{
+		nKey = HashCombine( nKey, dtexdata[pTexinfo->texdata] );
+	}
+	return nKey;
+}
+
+static uint64 ComputeLightKey( directlight_t *dl )
+{
+	uint64 nKey = HashCombine( 0, dl->light );
+	nKey = HashCombine( nKey, dl->facenum );
+	nKey = HashCombine( nKey, dl->texdata );
+	nKey = HashCombine( nKey, dl->snormal );
+	nKey = HashCombine( nKey, dl->tnormal );
+	nKey = HashCombine( nKey, dl->sscale );
+	nKey = HashCombine( nKey, dl->tscale );
+	nKey = HashCombine( nKey, dl->soffset );
+	nKey = HashCombine( nKey, dl->toffset );
+	nKey = HashCombine( nKey, dl->m_flStartFadeDistance );
+	nKey = HashCombine( nKey, dl->m_flEndFadeDistance );
+	nKey = HashCombine( nKey, dl->m_flCapDist );
+	return nKey;
+}
+
+// The patches, as far as the transfers between them go
+static uint64 ComputePatchKey( void )
+{
+	uint64 nKey = HashCombine( g_WorldKey, g_Patches.Count() );
+	for ( int i = 0; i < g_Patches.Count(); i++ )
+	{
+		CPatch *patch = &g_Patches[i];
+		int nFlags = patch->sky | ( patch->needsBumpmap << 1 );
+		int indices[] =
+		{
+			patch->faceNumber, patch->clusterNumber, patch->parent, patch->child1, patch->child2,
+			patch->ndxNext, patch->ndxNextParent, patch->ndxNextClusterChild, nFlags,
+		};
+
+		nKey = HashCombine( nKey, indices, sizeof( indices ) );
+		nKey = HashCombine( nKey, patch->origin );
+		nKey = HashCombine( nKey, patch->normal );
+		nKey = HashCombine( nKey, patch->mins );
+		nKey = HashCombine( nKey, patch->maxs );
+		nKey = HashCombine( nKey, patch->face_mins );
+		nKey = HashCombine( nKey, patch->face_maxs );
+		nKey = HashCombine( nKey, patch->planeDist );
+		nKey = HashCombine( nKey, patch->area );
+		nKey = HashCombine( nKey, patch->plane->normal );
+		if ( patch->winding )
+		{
+			nKey = HashCombine( nKey, patch->winding->p, patch->winding->numpoints * sizeof( Vector ) );
+		}
+	}
+	return nKey;
+}
+
+//-----------------------------------------------------------------------------
+// Called by the lighting code with the clusters of every 4 samples it lights
+//-----------------------------------------------------------------------------
+void AddLightCacheClusters( int facenum, const int *pClusters )
+{
+	CUtlVector<int> &clusters = g_FaceClusters[facenum];
+	for ( int i = 0; i < 4; i++ )
+	{
+		if ( clusters.Find( pClusters[i] ) == -1 )
+		{
+			clusters.AddToTail( pClusters[i] );
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Finds the faces the last run lit the same way. Returns how many there are.
+//-----------------------------------------------------------------------------
+static int LoadLightCache( const char *pFilename )
+{
+	g_CachedFaceOffsets.SetSize( numfaces );
+	for ( int i = 0; i < numfaces; i++ )
+	{
+		g_CachedFaceOffsets[i] = -1;
+	}
+
+	g_CacheFile.Purge();
+	if ( !g_pFileSystem->ReadFile( pFilename, NULL, g_CacheFile ) )
+		return 0;
+
+	int nId = g_CacheFile.GetInt();
+	uint64 nWorldKey = (uint64)g_CacheFile.GetInt64();
+	int nFaces = g_CacheFile.GetInt();
+	int nPVSBytes = g_CacheFile.GetInt();
+	int nLights = g_CacheFile.GetInt();
+	if ( !g_CacheFile.IsValid() || nId != LIGHTCACHE_ID || nLights < 0 ||
+		g_CacheFile.GetBytesRemaining() < nLights * ( (int)sizeof( uint64 ) + nPVSBytes ) )
+	{
+		Warning( "%s isn't a light cache, ignoring it\n", pFilename );
+		g_CacheFile.Purge();
+		return 0;
+	}
+
+	if ( nWorldKey != g_WorldKey || nFaces != numfaces || nPVSBytes != g_nPVSBytes )
+	{
+		Msg( "the map or the options changed since %s, lighting every face\n", pFilename );
+		g_CacheFile.Purge();
+		return 0;
+	}
+
+	// The lights both runs have cancel out, the PVS of the rest says which
+	// faces to light again. Lights can be in there more than once.
+	CUtlVector<uint64> oldKeys;
+	CUtlVector<int> oldPVS;
+	oldKeys.SetSize( nLights );
+	oldPVS.SetSize( nLights );
+	for ( int i = 0; i < nLights; i++ )
+	{
+		oldKeys[i] = (uint64)g_CacheFile.GetInt64();
+		oldPVS[i] = g_CacheFile.TellGet();
+		g_CacheFile.SeekGet( CUtlBuffer::SEEK_CURRENT, nPVSBytes );
+	}
+
+	CUtlVector<byte> changed;
+	changed.SetSize( nPVSBytes );
+	memset( changed.Base(), 0, nPVSBytes );
+
+	CUtlHashtable<uint64, int> oldCounts, newCounts;
+	for ( int j = 0; j < nLights; j++ )
+	{
+		oldCounts[oldCounts.Insert( oldKeys[j], 0 )]++;
+	}
+	for ( int i = 0; i < g_LightKeys.Count(); i++ )
+	{
+		newCounts[newCounts.Insert( g_LightKeys[i], 0 )]++;
+	}
+
+	bool bLightsChanged = false;
+	for ( int i = 0; i < g_LightKeys.Count(); i++ )
+	{
+		UtlHashHandle_t h = oldCounts.Find( g_LightKeys[i] );
+		if ( h != oldCounts.InvalidHandle() && oldCounts[h] > 0 )
+		{
+			oldCounts[h]--;
+			continue;
+		}
+
+		const byte *pPVS = (const byte *)g_LightPVS.Base() + i * nPVSBytes;
+		for ( int k = 0; k < nPVSBytes; k++ )
+		{
+			changed[k] |= pPVS[k];
+		}
+		bLightsChanged = true;
+	}
+	for ( int j = 0; j < nLights; j++ )
+	{
+		UtlHashHandle_t h = newCounts.Find( oldKeys[j] );
+		if ( h != newCounts.InvalidHandle() && newCounts[h] > 0 )
+		{
+			newCounts[h]--;
+			continue;
+		}
+
+		const byte *pPVS = (const byte *)g_CacheFile.Base() + oldPVS[j];
+		for ( int k = 0; k < nPVSBytes; k++ )
+		{
+			changed[k] |= pPVS[k];
+		}
+		bLightsChanged = true;
+	}
+
+	int nReused = 0;
+	int i;
+	for ( i = 0; i < numfaces; i++ )
+	{
+		uint64 nFaceKey = (uint64)g_CacheFile.GetInt64();
+		int nClusters = g_CacheFile.GetInt();
+		if ( !g_CacheFile.IsValid() || nClusters < 0 || g_CacheFile.GetBytesRemaining() < nClusters * (int)sizeof( int ) )
+			break;
+
+		CUtlVector<int> &clusters = g_FaceClusters[i];
+		clusters.SetSize( nClusters );
+		g_CacheFile.Get( clusters.Base(), nClusters * sizeof( int ) );
+
+		int nBytes = g_CacheFile.GetInt();
+		if ( !g_CacheFile.IsValid() || nBytes < 0 || g_CacheFile.GetBytesRemaining() < nBytes )
+			break;
+
+		bool bReuse = ( nFaceKey == g_FaceKeys[i] );
+		for ( int c = 0; c < nClusters && bReuse; c++ )
+		{
+			// samples outside the map see every light
+			bReuse = ( clusters[c] < 0 ) ? !bLightsChanged : !PVSCheck( changed.Base(), clusters[c] );
+		}
+
+		if ( bReuse )
+		{
+			g_CachedFaceOffsets[i] = g_CacheFile.TellGet();
+			nReused++;
+		}
+		g_CacheFile.SeekGet( CUtlBuffer::SEEK_CURRENT, nBytes );
+	}
+
+	Msg( "reusing the direct light of %d of %d faces from %s\n", nReused, numfaces, pFilename );
+	return nReused;
+}
+
+static void BuildCachedFacelights( int iThread, int facenum )
+{
+	int nOffset = g_CachedFaceOffsets[facenum];
+	if ( nOffset >= 0 )
+	{
+		// every thread reads its own faces out of the file
+		CUtlBuffer buf( (const byte *)g_CacheFile.Base() + nOffset, g_CacheFile.TellPut() - nOffset, CUtlBuffer::READ_ONLY );
+		if ( GetFacelight( facenum, buf ) )
+		{
+			BuildPatchLights( facenum );
+			return;
+		}
+	}
+
+	g_FaceClusters[facenum].RemoveAll();
+	BuildFacelights( iThread, facenum );
+}
+
+//-----------------------------------------------------------------------------
+// BuildFacelights for -incremental: faces no changed light can reach come out
+// of the cache, the rest are lit
+//-----------------------------------------------------------------------------
+void RunIncrementalBuildFacelights( void )
+{
+	g_WorldKey = ComputeWorldKey();
+	g_FaceKeys.SetSize( numfaces );
+	for ( int i = 0; i < numfaces; i++ )
+	{
+		g_FaceKeys[i] = ComputeFaceKey( i );
+	}
+
+	// ExportDirectLightsToWorldLights gets rid of the lights before the save
+	g_nPVSBytes = ( dvis->numclusters / 8 ) + 1;
+	g_LightKeys.RemoveAll();
+	g_LightPVS.Clear();
+	for ( directlight_t *dl = activelights; dl != NULL; dl = dl->next )
+	{
+		g_LightKeys.AddToTail( ComputeLightKey( dl ) );
+		g_LightPVS.Put( dl->pvs, g_nPVSBytes );
+	}
+
+	g_FaceClusters.Purge();
+	g_FaceClusters.SetSize( numfaces );
+
+	LoadLightCache( g_szLightCacheFile );
+
+	RunThreadsOnIndividual( numfaces, true, BuildCachedFacelights );
+}
+
+static void GetTransferCacheFile( char *pFilename, int nSize )
+{
+	V_strncpy( pFilename, g_szLightCacheFile, nSize );
+	V_SetExtension( pFilename, ".vrt", nSize );
+}
+
+//-----------------------------------------------------------------------------
+// Uses the transfers from the last run if the patches are the same. Returns
+// false if they have to be made again.
+//-----------------------------------------------------------------------------
+bool LoadIncrementalTransfers( void )
+{
+	char szFilename[_MAX_PATH];
+	GetTransferCacheFile( szFilename, sizeof( szFilename ) );
+	FileHandle_t hFile = g_pFileSystem->Open( szFilename, "rb" );
+	if ( !hFile )
+		return false;
+
+	int nId = 0;
+	uint64 nPatchKey = 0;
+	g_bTransfersCached = g_pFileSystem->Read( &nId, sizeof( nId ), hFile ) == sizeof( nId ) && nId == TRANSFERCACHE_ID &&
+		g_pFileSystem->Read( &nPatchKey, sizeof( nPatchKey ), hFile ) == sizeof( nPatchKey ) &&
+		nPatchKey == ComputePatchKey() && LoadTransferMatrix( hFile );
+	g_pFileSystem->Close( hFile );
+	if ( !g_bTransfersCached )
+		return false;
+
+	Msg( "reusing the transfers from %s\n", szFilename );
+	return true;
+}
+
+static void SaveTransferCache( void )
+{
+	char szFilename[_MAX_PATH];
+	GetTransferCacheFile( szFilename, sizeof( szFilename ) );
+	FileHandle_t hFile = g_pFileSystem->Open( szFilename, "wb" );
+	if ( !hFile )
+	{
+		Warning( "Couldn't write %s\n", szFilename );
+		return;
+	}
+
+	int nId = TRANSFERCACHE_ID;
+	uint64 nPatchKey = ComputePatchKey();
+	bool bOk = g_pFileSystem->Write( &nId, sizeof( nId ), hFile ) == sizeof( nId ) &&
+		g_pFileSystem->Write( &nPatchKey, sizeof( nPatchKey ), hFile ) == sizeof( nPatchKey ) &&
+		SaveTransferMatrix( hFile );
+	g_pFileSystem->Close( hFile );
+	if ( !bOk )
+	{
+		// the next run finds it short and makes the transfers again
+		Warning( "Couldn't write %s\n", szFilename );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Writes the direct light of every face for the next run, and the transfers
+// if there are any and they didn't come from the transfers file. Call it
+// between making the transfers and BounceLight.
+//-----------------------------------------------------------------------------
+void SaveLightCache( void )
+{
+	FileHandle_t hFile = g_pFileSystem->Open( g_szLightCacheFile, "wb" );
+	if ( !hFile )
+	{
+		Warning( "Couldn't write %s\n", g_szLightCacheFile );
+	}
+
+	// a face at a time, instead of the whole file in memory
+	CUtlBuffer buf;
+	buf.PutInt( LIGHTCACHE_ID );
+	buf.PutInt64( g_WorldKey );
+	buf.PutInt( numfaces );
+	buf.PutInt( g_nPVSBytes );
+	buf.PutInt( g_LightKeys.Count() );
+	for ( int i = 0; i < g_LightKeys.Count(); i++ )
+	{
+		buf.PutInt64( g_LightKeys[i] );
+		buf.Put( (const byte *)g_LightPVS.Base() + i * g_nPVSBytes, g_nPVSBytes );
+	}
+
+	// the last run is done with
+	g_CacheFile.Purge();
+	g_CachedFaceOffsets.Purge();
+
+	bool bOk = hFile && g_pFileSystem->Write( buf.Base(), buf.TellPut(), hFile ) == buf.TellPut();
+	buf.Clear();
+
+	CUtlBuffer face;
+	for ( int i = 0; i < numfaces && bOk; i++ )
+	{
+		face.Clear();
+		PutFacelight( i, face );
+
+		buf.PutInt64( g_FaceKeys[i] );
+		buf.PutInt( g_FaceClusters[i].Count() );
+		buf.Put( g_FaceClusters[i].Base(), g_FaceClusters[i].Count() * sizeof( int ) );
+		buf.PutInt( face.TellPut() );
+		buf.Put( face.Base(), face.TellPut() );
+
+		bOk = g_pFileSystem->Write( buf.Base(), buf.TellPut(), hFile ) == buf.TellPut();
+		buf.Clear();
+	}
+	if ( hFile )
+	{
+		g_pFileSystem->Close( hFile );
+		if ( !bOk )
+		{
+			Warning( "Couldn't write %s\n", g_szLightCacheFile );
+		}
+	}
+
+	if ( numbounce > 0 && !g_bTransfersCached )
+	{
+		SaveTransferCache();
+	}
+
+	g_FaceKeys.Purge();
+	g_FaceClusters.Purge();
+	g_LightKeys.Purge();
+	g_LightPVS.Purge();
+}
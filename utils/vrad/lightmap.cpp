@@ -12,6 +12,7 @@
 #include "mathlib/bumpvects.h"
 #include "tier1/utlvector.h"
 #include "vmpi.h"
+#include "distwork.h"
 #include "mathlib/anorms.h"
 #include "map_utils.h"
 #include "mathlib/halton.h"
@@ -823,6 +824,95 @@ void FreeSampleWindings( facelight_t *fl )
 }
 
 
+template<class T> static void PutValues( CUtlBuffer &buf, T const *pSrc, int nNumValues )
+{
+	buf.Put( pSrc, sizeof( pSrc[0] ) * nNumValues );
+}
+
+template<class T> static T *GetValues( CUtlBuffer &buf, int nNumValues )
+{
+	T *pDest = (T *)calloc( nNumValues, sizeof( T ) );
+	buf.Get( pDest, sizeof( T ) * nNumValues );
+	return pDest;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Write out what BuildFacelights made for a face: the face and its
+//			facelight_t, the pointers in the facelight_t only say which arrays
+//			follow. The sample windings are left behind.
+//-----------------------------------------------------------------------------
+void PutFacelight( int facenum, CUtlBuffer &buf )
+{
+	facelight_t *fl = &facelight[facenum];
+	buf.Put( &g_pFaces[facenum], sizeof( dface_t ) );
+	buf.Put( fl, sizeof( facelight_t ) );
+
+	PutValues( buf, fl->sample, fl->numsamples );
+	for ( int i = 0; i < MAXLIGHTMAPS; ++i )
+	{
+		for ( int n = 0; n < NUM_BUMP_VECTS+1; ++n )
+		{
+			if ( fl->light[i][n] )
+			{
+				PutValues( buf, fl->light[i][n], fl->numsamples );
+			}
+		}
+	}
+
+	if ( fl->luxel )
+		PutValues( buf, fl->luxel, fl->numluxels );
+
+	if ( fl->luxelNormals )
+		PutValues( buf, fl->luxelNormals, fl->numluxels );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Read back a face written by PutFacelight. Returns false, and leaves
+//			the facelight_t empty, if the buffer is short.
+//-----------------------------------------------------------------------------
+bool GetFacelight( int facenum, CUtlBuffer &buf )
+{
+	facelight_t *fl = &facelight[facenum];
+	buf.Get( &g_pFaces[facenum], sizeof( dface_t ) );
+	buf.Get( fl, sizeof( facelight_t ) );
+	if ( !buf.IsValid() )
+	{
+		memset( fl, 0, sizeof( facelight_t ) );
+		return false;
+	}
+
+	fl->sample = GetValues<sample_t>( buf, fl->numsamples );
+	for ( int i = 0; i < fl->numsamples; ++i )
+	{
+		fl->sample[i].w = NULL;
+	}
+
+	for ( int i = 0; i < MAXLIGHTMAPS; ++i )
+	{
+		for ( int n = 0; n < NUM_BUMP_VECTS+1; ++n )
+		{
+			if ( fl->light[i][n] )
+			{
+				fl->light[i][n] = GetValues<LightingValue_t>( buf, fl->numsamples );
+			}
+		}
+	}
+
+	if ( fl->luxel )
+		fl->luxel = GetValues<Vector>( buf, fl->numluxels );
+
+	if ( fl->luxelNormals )
+		fl->luxelNormals = GetValues<Vector>( buf, fl->numluxels );
+
+	if ( !buf.IsValid() )
+	{
+		memset( fl, 0, sizeof( facelight_t ) );
+		return false;
+	}
+	return true;
+}
+
+
 
 //-----------------------------------------------------------------------------
 // Purpose: build the sample data for each lightmapped primitive type
@@ -2483,6 +2573,9 @@ static void ComputeIlluminationPointAndNormalsSSE( lightinfo_t const& l, FourVec
 	// TODO: this may slow things down a bit ( using Vec )
 	for ( int i = 0; i < 4; ++i )
 		pInfo->m_Clusters[i] = ClusterFromPoint( pos.Vec( i ) );
+
+	if ( g_bIncremental )
+		AddLightCacheClusters( pInfo->m_FaceNum, pInfo->m_Clusters );
 }
 
 //-----------------------------------------------------------------------------
@@ -3174,10 +3267,10 @@ void BuildFacelights (int iThread, int facenum)
 		}
 	}
 
-	if (!g_bUseMPI) 
+	if (!g_bUseMPI && !g_bDistWork) 
 	{
 		//
-		// This is done on the master node when MPI is used
+		// This is done on the master node when MPI or -distribute is used
 		//
 		BuildPatchLights( facenum );
 	}
@@ -18,6 +18,8 @@
 #include "mathlib/bumpvects.h"
 #include "bsplib.h"
 
+class CUtlBuffer;
+
 typedef struct
 {
 	dface_t		*faces[2];
@@ -135,6 +137,9 @@ extern void InitLightinfo( lightinfo_t *l, int facenum );
 
 void FreeDLights();
 
+void PutFacelight( int facenum, CUtlBuffer &buf );
+bool GetFacelight( int facenum, CUtlBuffer &buf );
+
 void ExportDirectLightsToWorldLights();
 
 
@@ -0,0 +1,571 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: The patch to patch transfers as one sparse matrix, and the
+//			bounces as products of it with the light the patches send out
+//
+//=============================================================================//
+
+#include "vrad.h"
+#include "mathlib/ssemath.h"
+#include "mathlib/compressed_vector.h"
+
+// Row j holds the transfers into patch j, in patch order, from
+// g_TransferRowStart[j] up to g_TransferRowStart[j+1]. Everything that
+// stays the same from bounce to bounce is folded into the weights, so a
+// bounce only reads the rows front to back and the light sent out by the
+// patches they name. The rows are handed to the threads in blocks of about
+// the same number of transfers. A big map can have more than 2^31 transfers
+// in all, so the row starts are 64 bit; offsets within a block fit an int.
+//
+// Each block has its own allocation, so while the matrix is built from the
+// transfer lists of the patches it never holds much more than one block
+// on top of the lists it hasn't freed yet.
+//
+// With -halftransfers the weights are 16 bit floats relative to the largest
+// weight in their row.
+
+#define TRANSFER_BLOCK_SIZE		16384		// transfers per block of rows
+
+struct transferblock_t
+{
+	int			*pPatches;
+	float		*pWeights;
+	float16		*pWeights16;	// -halftransfers only
+};
+
+static CUtlVector<int64>			g_TransferRowStart;
+static CUtlVector<float>			g_TransferRowScale;		// -halftransfers only
+static CUtlVector<int>				g_TransferBlockStart;	// first row of each block
+static CUtlVector<transferblock_t>	g_TransferBlocks;
+
+static CUtlVector<Vector>	g_PatchOrigins;
+static CUtlVector<Vector>	g_ShootLight;			// emitlight * reflectivity, by patch
+
+// the normals of each bumped patch, flat normal first
+struct bumpnormals_t
+{
+	Vector normal[NUM_BUMP_VECTS+1];
+};
+static CUtlVector<int>				g_BumpRow;		// index into g_BumpNormals, or -1
+static CUtlVector<bumpnormals_t>	g_BumpNormals;
+
+// one row of weights, unpacked from -halftransfers
+static float				*g_pRowWeights[MAX_TOOL_THREADS];
+
+extern CUtlVector<Vector>		emitlight;
+extern CUtlVector<bumplights_t>	addlight;
+
+extern void GetBumpNormals( const float* sVect, const float* tVect, const Vector& flatNormal,
+					 const Vector& phongNormal, Vector bumpNormals[NUM_BUMP_VECTS] );
+extern void PreGetBumpNormalsForDisp( texinfo_t *pTexinfo, Vector &vecU, Vector &vecV, Vector &vecNormal );
+
+
+static void ComputeBumpNormals( CPatch *patch, Vector *normals )
+{
+	// Disps
+	bool bDisp = ( g_pFaces[patch->faceNumber].dispinfo != -1 );
+	if ( bDisp )
+	{
+		normals[0] = patch->normal;
+		texinfo_t *pTexinfo = &texinfo[g_pFaces[patch->faceNumber].texinfo];
+		Vector vecTexU, vecTexV;
+		PreGetBumpNormalsForDisp( pTexinfo, vecTexU, vecTexV, normals[0] );
+
+		// use facenormal along with the smooth normal to build the three bump map vectors
+		GetBumpNormals( vecTexU, vecTexV, normals[0], normals[0], &normals[1] );
+	}
+	else
+	{
+		GetPhongNormal( patch->faceNumber, patch->origin, normals[0] );
+
+		texinfo_t *pTexinfo = &texinfo[g_pFaces[patch->faceNumber].texinfo];
+		// use facenormal along with the smooth normal to build the three bump map vectors
+		GetBumpNormals( pTexinfo->textureVecsTexelsPerWorldUnits[0],
+			pTexinfo->textureVecsTexelsPerWorldUnits[1], patch->normal,
+			normals[0], &normals[1] );
+	}
+
+	// force the base lightmap to use the flat normal instead of the phong normal
+	// FIXME: why does the patch not use the phong normal?
+	normals[0] = patch->normal;
+}
+
+static int TransferPatchCompare( const void *a, const void *b )
+{
+	return ( (const transfer_t *)a )->patch - ( (const transfer_t *)b )->patch;
+}
+
+//-----------------------------------------------------------------------------
+// Splits the rows into blocks once g_TransferRowStart is known. The blocks
+// have no storage yet.
+//-----------------------------------------------------------------------------
+static void SetupTransferBlocks( void )
+{
+	int nPatches = g_Patches.Count();
+
+	// rows are never split, a block ends once it has enough
+	g_TransferBlockStart.RemoveAll();
+	for ( int j = 0; j < nPatches; )
+	{
+		g_TransferBlockStart.AddToTail( j );
+		int64 nEnd = g_TransferRowStart[j] + TRANSFER_BLOCK_SIZE;
+		do
+		{
+			j++;
+		} while ( j < nPatches && g_TransferRowStart[j + 1] <= nEnd );
+	}
+	g_TransferBlockStart.AddToTail( nPatches );
+
+	g_TransferBlocks.SetSize( g_TransferBlockStart.Count() - 1 );
+	memset( g_TransferBlocks.Base(), 0, g_TransferBlocks.Count() * sizeof( transferblock_t ) );
+
+	if ( g_bHalfTransfers )
+	{
+		g_TransferRowScale.SetSize( nPatches );
+	}
+}
+
+// a block is one row or no more than TRANSFER_BLOCK_SIZE transfers
+static int TransferBlockSize( int iBlock )
+{
+	return (int)( g_TransferRowStart[g_TransferBlockStart[iBlock + 1]] - g_TransferRowStart[g_TransferBlockStart[iBlock]] );
+}
+
+static void AllocTransferBlock( int iBlock )
+{
+	int nTransfers = TransferBlockSize( iBlock );
+	transferblock_t &block = g_TransferBlocks[iBlock];
+	block.pPatches = (int *)malloc( MAX( nTransfers, 1 ) * sizeof( int ) );
+	if ( g_bHalfTransfers )
+	{
+		block.pWeights16 = (float16 *)malloc( MAX( nTransfers, 1 ) * sizeof( float16 ) );
+	}
+	else
+	{
+		block.pWeights = (float *)malloc( MAX( nTransfers, 1 ) * sizeof( float ) );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Sets up everything besides the rows: the patch data the bounces read
+//-----------------------------------------------------------------------------
+static void FinishTransferMatrix( void )
+{
+	int nPatches = g_Patches.Count();
+	int64 nTransfers = g_TransferRowStart[nPatches];
+
+	g_PatchOrigins.SetSize( nPatches );
+	g_ShootLight.SetSize( nPatches );
+	g_BumpRow.SetSize( nPatches );
+	g_BumpNormals.RemoveAll();
+
+	int nMaxRow = 0;
+	for ( int j = 0; j < nPatches; j++ )
+	{
+		CPatch *patch = &g_Patches[j];
+		int num = (int)( g_TransferRowStart[j + 1] - g_TransferRowStart[j] );
+		nMaxRow = MAX( nMaxRow, num );
+
+		g_PatchOrigins[j] = patch->origin;
+		g_BumpRow[j] = -1;
+		if ( patch->needsBumpmap && num )
+		{
+			g_BumpRow[j] = g_BumpNormals.AddToTail();
+			ComputeBumpNormals( patch, g_BumpNormals[g_BumpRow[j]].normal );
+		}
+	}
+
+	if ( g_bHalfTransfers )
+	{
+		for ( int i = 0; i < MAX_TOOL_THREADS; i++ )
+		{
+			g_pRowWeights[i] = (float *)malloc( MAX( nMaxRow, 1 ) * sizeof( float ) );
+		}
+	}
+
+	int nWeightBytes = g_bHalfTransfers ? sizeof( float16 ) : sizeof( float );
+	qprintf( "transfer matrix: %5.1f megs, %d blocks\n",
+		(float)nTransfers * ( sizeof( int ) + nWeightBytes ) / ( 1024 * 1024 ), g_TransferBlockStart.Count() - 1 );
+}
+
+//-----------------------------------------------------------------------------
+// Moves the transfers of patch j into its row, which starts at nStart in the
+// block, and frees its transfer list
+//-----------------------------------------------------------------------------
+static void MoveTransfersToRow( int j, const transferblock_t &block, int nStart )
+{
+	CPatch *patch = &g_Patches[j];
+	int num = patch->numtransfers;
+	if ( !num )
+	{
+		if ( g_bHalfTransfers )
+			g_TransferRowScale[j] = 0;
+		return;
+	}
+
+	// reading the light in patch order walks through memory one way
+	transfer_t *trans = patch->transfers;
+	qsort( trans, num, sizeof( transfer_t ), TransferPatchCompare );
+
+	float flMaxWeight = 0;
+	for ( int k = 0; k < num; k++ )
+	{
+		float flWeight = trans[k].transfer;
+		if ( patch->needsBumpmap )
+		{
+			// remove normal already factored into transfer steradian
+			Vector delta;
+			VectorSubtract( g_Patches[trans[k].patch].origin, patch->origin, delta );
+			VectorNormalize( delta );
+			flWeight /= DotProduct( delta, patch->normal );
+		}
+		trans[k].transfer = flWeight;
+		flMaxWeight = MAX( flMaxWeight, fabs( flWeight ) );
+		block.pPatches[nStart + k] = trans[k].patch;
+	}
+
+	if ( g_bHalfTransfers )
+	{
+		float flScale = flMaxWeight > 0 ? 1.0f / flMaxWeight : 0;
+		g_TransferRowScale[j] = flMaxWeight;
+		for ( int k = 0; k < num; k++ )
+		{
+			block.pWeights16[nStart + k].SetFloat( trans[k].transfer * flScale );
+		}
+	}
+	else
+	{
+		for ( int k = 0; k < num; k++ )
+		{
+			block.pWeights[nStart + k] = trans[k].transfer;
+		}
+	}
+
+	free( patch->transfers );
+	patch->transfers = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Moves the transfer lists of all the patches into the matrix a block at a
+// time, freeing them as it goes
+//-----------------------------------------------------------------------------
+void BuildTransferMatrix( void )
+{
+	int nPatches = g_Patches.Count();
+
+	g_TransferRowStart.SetSize( nPatches + 1 );
+	g_TransferRowStart[0] = 0;
+	for ( int j = 0; j < nPatches; j++ )
+	{
+		g_TransferRowStart[j + 1] = g_TransferRowStart[j] + g_Patches[j].numtransfers;
+	}
+	SetupTransferBlocks();
+
+	for ( int iBlock = 0; iBlock < g_TransferBlocks.Count(); iBlock++ )
+	{
+		AllocTransferBlock( iBlock );
+		int64 nBlockStart = g_TransferRowStart[g_TransferBlockStart[iBlock]];
+		for ( int j = g_TransferBlockStart[iBlock]; j < g_TransferBlockStart[iBlock + 1]; j++ )
+		{
+			MoveTransfersToRow( j, g_TransferBlocks[iBlock], (int)( g_TransferRowStart[j] - nBlockStart ) );
+		}
+	}
+
+	FinishTransferMatrix();
+}
+
+static bool WriteTransfers( FileHandle_t hFile, const void *pData, int nBytes )
+{
+	return g_pFileSystem->Write( pData, nBytes, hFile ) == nBytes;
+}
+
+static bool ReadTransfers( FileHandle_t hFile, void *pData, int nBytes )
+{
+	return g_pFileSystem->Read( pData, nBytes, hFile ) == nBytes;
+}
+
+//-----------------------------------------------------------------------------
+// Writes the rows, for vrad -incremental to use again while the patches stay
+// the same. They go out a block at a time, so the file can be larger than
+// any one write. Returns false if a write failed.
+//-----------------------------------------------------------------------------
+bool SaveTransferMatrix( FileHandle_t hFile )
+{
+	int nPatches = g_Patches.Count();
+	int64 nTransfers = g_TransferRowStart[nPatches];
+	int nHalfTransfers = g_bHalfTransfers;
+
+	bool bOk = WriteTransfers( hFile, &nPatches, sizeof( nPatches ) ) &&
+		WriteTransfers( hFile, &nTransfers, sizeof( nTransfers ) ) &&
+		WriteTransfers( hFile, &nHalfTransfers, sizeof( nHalfTransfers ) ) &&
+		WriteTransfers( hFile, g_TransferRowStart.Base(), ( nPatches + 1 ) * sizeof( int64 ) );
+	if ( bOk && g_bHalfTransfers )
+	{
+		bOk = WriteTransfers( hFile, g_TransferRowScale.Base(), nPatches * sizeof( float ) );
+	}
+	for ( int iBlock = 0; iBlock < g_TransferBlocks.Count() && bOk; iBlock++ )
+	{
+		const transferblock_t &block = g_TransferBlocks[iBlock];
+		int nBlockTransfers = TransferBlockSize( iBlock );
+		bOk = WriteTransfers( hFile, block.pPatches, nBlockTransfers * sizeof( int ) );
+		if ( bOk && g_bHalfTransfers )
+		{
+			bOk = WriteTransfers( hFile, block.pWeights16, nBlockTransfers * sizeof( float16 ) );
+		}
+		else if ( bOk )
+		{
+			bOk = WriteTransfers( hFile, block.pWeights, nBlockTransfers * sizeof( float ) );
+		}
+	}
+	return bOk;
+}
+
+//-----------------------------------------------------------------------------
+// Reads the rows written by SaveTransferMatrix in place of building them.
+// Returns false if they aren't for these patches.
+//-----------------------------------------------------------------------------
+bool LoadTransferMatrix( FileHandle_t hFile )
+{
+	int nPatches = 0;
+	int64 nTransfers = 0;
+	int nHalfTransfers = 0;
+	if ( !ReadTransfers( hFile, &nPatches, sizeof( nPatches ) ) ||
+		!ReadTransfers( hFile, &nTransfers, sizeof( nTransfers ) ) ||
+		!ReadTransfers( hFile, &nHalfTransfers, sizeof( nHalfTransfers ) ) ||
+		nPatches != g_Patches.Count() || ( nHalfTransfers != 0 ) != g_bHalfTransfers ||
+		nTransfers < 0 )
+	{
+		return false;
+	}
+
+	g_TransferRowStart.SetSize( nPatches + 1 );
+	bool bValid = ReadTransfers( hFile, g_TransferRowStart.Base(), ( nPatches + 1 ) * sizeof( int64 ) ) &&
+		g_TransferRowStart[0] == 0 && g_TransferRowStart[nPatches] == nTransfers;
+	for ( int j = 0; j < nPatches && bValid; j++ )
+	{
+		// a row is one patch's transfer list, which never holds more than an int
+		bValid = g_TransferRowStart[j] <= g_TransferRowStart[j + 1] &&
+			g_TransferRowStart[j + 1] - g_TransferRowStart[j] <= INT_MAX;
+	}
+	if ( !bValid )
+	{
+		FreeTransferMatrix();
+		return false;
+	}
+
+	SetupTransferBlocks();
+	if ( g_bHalfTransfers )
+	{
+		bValid = ReadTransfers( hFile, g_TransferRowScale.Base(), nPatches * sizeof( float ) );
+	}
+	for ( int iBlock = 0; iBlock < g_TransferBlocks.Count() && bValid; iBlock++ )
+	{
+		AllocTransferBlock( iBlock );
+		const transferblock_t &block = g_TransferBlocks[iBlock];
+		int nBlockTransfers = TransferBlockSize( iBlock );
+		bValid = ReadTransfers( hFile, block.pPatches, nBlockTransfers * sizeof( int ) );
+		if ( bValid && g_bHalfTransfers )
+		{
+			bValid = ReadTransfers( hFile, block.pWeights16, nBlockTransfers * sizeof( float16 ) );
+		}
+		else if ( bValid )
+		{
+			bValid = ReadTransfers( hFile, block.pWeights, nBlockTransfers * sizeof( float ) );
+		}
+
+		for ( int k = 0; k < nBlockTransfers && bValid; k++ )
+		{
+			bValid = (unsigned)block.pPatches[k] < (unsigned)nPatches;
+		}
+	}
+	if ( !bValid )
+	{
+		FreeTransferMatrix();
+		return false;
+	}
+
+	FinishTransferMatrix();
+	return true;
+}
+
+void FreeTransferMatrix( void )
+{
+	for ( int iBlock = 0; iBlock < g_TransferBlocks.Count(); iBlock++ )
+	{
+		free( g_TransferBlocks[iBlock].pPatches );
+		free( g_TransferBlocks[iBlock].pWeights );
+		free( g_TransferBlocks[iBlock].pWeights16 );
+	}
+	g_TransferBlocks.Purge();
+	g_TransferRowStart.Purge();
+	g_TransferRowScale.Purge();
+	g_TransferBlockStart.Purge();
+	g_PatchOrigins.Purge();
+	g_ShootLight.Purge();
+	g_BumpRow.Purge();
+	g_BumpNormals.Purge();
+	for ( int i = 0; i < MAX_TOOL_THREADS; i++ )
+	{
+		free( g_pRowWeights[i] );
+		g_pRowWeights[i] = NULL;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Gets the light each patch sends out this bounce ready. Returns the number
+// of blocks to run GatherLight on.
+//-----------------------------------------------------------------------------
+int PrepareGatherLight( void )
+{
+	for ( int i = 0; i < g_Patches.Count(); i++ )
+	{
+		VectorMultiply( emitlight[i], g_Patches[i].reflectivity, g_ShootLight[i] );
+	}
+	return g_TransferBlockStart.Count() - 1;
+}
+
+static const float *GetRowWeights( int iThread, int j, const transferblock_t &block, int nStart )
+{
+	if ( !g_bHalfTransfers )
+		return block.pWeights + nStart;
+
+	int num = (int)( g_TransferRowStart[j + 1] - g_TransferRowStart[j] );
+	float flScale = g_TransferRowScale[j];
+	float *pWeights = g_pRowWeights[iThread];
+	for ( int k = 0; k < num; k++ )
+	{
+		pWeights[k] = block.pWeights16[nStart + k].GetFloat() * flScale;
+	}
+	return pWeights;
+}
+
+static void GatherRow( int j, const int *pPatches, const float *pWeights, int num )
+{
+	FourVectors sum4;
+	sum4.DuplicateVector( vec3_origin );
+
+	int k = 0;
+	for ( ; k + 4 <= num; k += 4 )
+	{
+		FourVectors v;
+		v.LoadAndSwizzle( g_ShootLight[pPatches[k]], g_ShootLight[pPatches[k + 1]],
+			g_ShootLight[pPatches[k + 2]], g_ShootLight[pPatches[k + 3]] );
+		v *= LoadUnalignedSIMD( pWeights + k );
+		sum4 += v;
+	}
+
+	Vector sum = sum4.Vec( 0 ) + sum4.Vec( 1 ) + sum4.Vec( 2 ) + sum4.Vec( 3 );
+	for ( ; k < num; k++ )
+	{
+		VectorMA( sum, pWeights[k], g_ShootLight[pPatches[k]], sum );
+	}
+	VectorCopy( sum, addlight[j].light[0] );
+}
+
+static void GatherBumpRow( int j, const int *pPatches, const float *pWeights, int num )
+{
+	const Vector *normals = g_BumpNormals[g_BumpRow[j]].normal;
+	const Vector &origin = g_PatchOrigins[j];
+
+	FourVectors origin4;
+	origin4.DuplicateVector( origin );
+	FourVectors bumpSum4[NUM_BUMP_VECTS+1];
+	for ( int i = 0; i < NUM_BUMP_VECTS+1; i++ )
+	{
+		bumpSum4[i].DuplicateVector( vec3_origin );
+	}
+
+	int k = 0;
+	for ( ; k + 4 <= num; k += 4 )
+	{
+		// get vector to other patch
+		FourVectors delta;
+		delta.LoadAndSwizzle( g_PatchOrigins[pPatches[k]], g_PatchOrigins[pPatches[k + 1]],
+			g_PatchOrigins[pPatches[k + 2]], g_PatchOrigins[pPatches[k + 3]] );
+		delta -= origin4;
+		delta.VectorNormalize();
+
+		// find light emitted from other patch
+		FourVectors v;
+		v.LoadAndSwizzle( g_ShootLight[pPatches[k]], g_ShootLight[pPatches[k + 1]],
+			g_ShootLight[pPatches[k + 2]], g_ShootLight[pPatches[k + 3]] );
+		v *= LoadUnalignedSIMD( pWeights + k );
+
+		// nothing from behind a bump normal
+		for ( int i = 0; i < NUM_BUMP_VECTS+1; i++ )
+		{
+			FourVectors bumpTransfer = v;
+			bumpTransfer *= MaxSIMD( delta * normals[i], Four_Zeros );
+			bumpSum4[i] += bumpTransfer;
+		}
+	}
+
+	Vector bumpSum[NUM_BUMP_VECTS+1];
+	for ( int i = 0; i < NUM_BUMP_VECTS+1; i++ )
+	{
+		bumpSum[i] = bumpSum4[i].Vec( 0 ) + bumpSum4[i].Vec( 1 ) + bumpSum4[i].Vec( 2 ) + bumpSum4[i].Vec( 3 );
+	}
+	for ( ; k < num; k++ )
+	{
+		Vector delta;
+		VectorSubtract( g_PatchOrigins[pPatches[k]], origin, delta );
+		VectorNormalize( delta );
+		Vector v = g_ShootLight[pPatches[k]] * pWeights[k];
+		for ( int i = 0; i < NUM_BUMP_VECTS+1; i++ )
+		{
+			float dot = DotProduct( delta, normals[i] );
+			if ( dot > 0 )
+			{
+				VectorMA( bumpSum[i], dot, v, bumpSum[i] );
+			}
+		}
+	}
+
+	for ( int i = 0; i < NUM_BUMP_VECTS+1; i++ )
+	{
+		VectorCopy( bumpSum[i], addlight[j].light[i] );
+	}
+}
+
+/*
+=============
+GatherLight
+
+Get light from other patches, one block of rows at a time
+  Run multi-threaded
+=============
+*/
+void GatherLight( int threadnum, void *pUserData )
+{
+	while ( 1 )
+	{
+		int iBlock = GetThreadWork();
+		if ( iBlock == -1 )
+			break;
+
+		const transferblock_t &block = g_TransferBlocks[iBlock];
+		int64 nBlockStart = g_TransferRowStart[g_TransferBlockStart[iBlock]];
+		for ( int j = g_TransferBlockStart[iBlock]; j < g_TransferBlockStart[iBlock + 1]; j++ )
+		{
+			int num = (int)( g_TransferRowStart[j + 1] - g_TransferRowStart[j] );
+			int nStart = (int)( g_TransferRowStart[j] - nBlockStart );
+			const int *pPatches = block.pPatches + nStart;
+			const float *pWeights = num ? GetRowWeights( threadnum, j, block, nStart ) : NULL;
+			if ( g_BumpRow[j] >= 0 )
+			{
+				GatherBumpRow( j, pPatches, pWeights, num );
+			}
+			else if ( g_Patches[j].needsBumpmap )
+			{
+				for ( int i = 0; i < NUM_BUMP_VECTS+1; i++ )
+				{
+					VectorFill( addlight[j].light[i], 0 );
+				}
+			}
+			else
+			{
+				GatherRow( j, pPatches, pWeights, num );
+			}
+		}
+	}
+}
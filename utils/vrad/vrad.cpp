@@ -13,6 +13,7 @@
 #include "lightmap.h"
 #include "tier1/strtools.h"
 #include "vmpi.h"
+#include "distwork.h"
 #include "macro_texture.h"
 #include "vmpi_tools_shared.h"
 #include "leaf_ambient_lighting.h"
@@ -59,6 +60,9 @@ bool	    bDumpNormals = false;
 bool		g_bDumpRtEnv = false;
 bool		bRed2Black = true;
 bool		g_bFastAmbient = false;
+bool		g_bHalfTransfers = false;
+bool		g_bIncremental = false;
+char		g_szLightCacheFile[_MAX_PATH] = "";
 bool        g_bNoSkyRecurse = false;
 bool		g_bDumpPropLightmaps = false;
 
@@ -1055,7 +1059,7 @@ MakeScales
   It can be run multi threaded.
 =============
 */
-int	total_transfer;
+int64	total_transfer;
 int max_transfer;
 
 
@@ -1474,23 +1478,6 @@ void CollectLight( Vector& total )
 	}
 }
 
-/*
-=============
-GatherLight
-
-Get light from other patches
-  Run multi-threaded
-=============
-*/
-
-#ifdef _WIN32
-#pragma warning (disable:4701)
-#endif
-
-extern void GetBumpNormals( const float* sVect, const float* tVect, const Vector& flatNormal, 
-					 const Vector& phongNormal, Vector bumpNormals[NUM_BUMP_VECTS] );
-
-
 void PreGetBumpNormalsForDisp( texinfo_t *pTexinfo, Vector &vecU, Vector &vecV, Vector &vecNormal )
 {
 	Vector vecTexU( pTexinfo->textureVecsTexelsPerWorldUnits[0][0], pTexinfo->textureVecsTexelsPerWorldUnits[0][1], pTexinfo->textureVecsTexelsPerWorldUnits[0][2] );
@@ -1532,119 +1519,6 @@ void PreGetBumpNormalsForDisp( texinfo_t *pTexinfo, Vector &vecU, Vector &vecV,
 	vecV = vecTexV;
 }
 
-void GatherLight (int threadnum, void *pUserData)
-{
-	int			i, j, k;
-	transfer_t	*trans;
-	int			num;
-	CPatch		*patch;
-	Vector		sum, v;
-
-	while (1)
-	{
-		j = GetThreadWork ();
-		if (j == -1)
-			break;
-
-		patch = &g_Patches[j];
-
-		trans = patch->transfers;
-		num = patch->numtransfers;
-		if ( patch->needsBumpmap )
-		{
-			Vector delta;
-			Vector bumpSum[NUM_BUMP_VECTS+1];
-			Vector normals[NUM_BUMP_VECTS+1];
-
-			// Disps
-			bool bDisp = ( g_pFaces[patch->faceNumber].dispinfo != -1 ); 
-			if ( bDisp )
-			{
-				normals[0] = patch->normal;
-				texinfo_t *pTexinfo = &texinfo[g_pFaces[patch->faceNumber].texinfo];
-				Vector vecTexU, vecTexV;
-				PreGetBumpNormalsForDisp( pTexinfo, vecTexU, vecTexV, normals[0] );
-
-				// use facenormal along with the smooth normal to build the three bump map vectors
-				GetBumpNormals( vecTexU, vecTexV, normals[0], normals[0], &normals[1] ); 
-			}
-			else
-			{
-				GetPhongNormal( patch->faceNumber, patch->origin, normals[0] );
-
-				texinfo_t *pTexinfo = &texinfo[g_pFaces[patch->faceNumber].texinfo];
-				// use facenormal along with the smooth normal to build the three bump map vectors
-				GetBumpNormals( pTexinfo->textureVecsTexelsPerWorldUnits[0], 
-					pTexinfo->textureVecsTexelsPerWorldUnits[1], patch->normal, 
-					normals[0], &normals[1] );
-			}
-
-			// force the base lightmap to use the flat normal instead of the phong normal
-			// FIXME: why does the patch not use the phong normal?
-			normals[0] = patch->normal;
-
-			for ( i = 0; i < NUM_BUMP_VECTS+1; i++ )
-			{
-				VectorFill( bumpSum[i], 0 );
-			}
-
-			float dot;
-			for (k=0 ; k<num ; k++, trans++)
-			{
-				CPatch *patch2 = &g_Patches[trans->patch];
-
-				// get vector to other patch
-				VectorSubtract (patch2->origin, patch->origin, delta);
-				VectorNormalize (delta);
-				// find light emitted from other patch
-				for(i=0; i<3; i++)
-				{
-					v[i] = emitlight[trans->patch][i] * patch2->reflectivity[i];
-				}
-				// remove normal already factored into transfer steradian
-				float scale = 1.0f / DotProduct (delta, patch->normal);
-				VectorScale( v, trans->transfer * scale, v );
-				
-				Vector bumpTransfer;
-				for ( i = 0; i < NUM_BUMP_VECTS+1; i++ )
-				{
-					dot = DotProduct( delta, normals[i] );
-					if ( dot <= 0 )
-					{
-//						Assert( i > 0 ); // if this hits, then the transfer shouldn't be here.  It doesn't face the flat normal of this face!
-						continue;
-					}
-					bumpTransfer = v * dot;
-					VectorAdd( bumpSum[i], bumpTransfer, bumpSum[i] );
-				}
-			}
-			for ( i = 0; i < NUM_BUMP_VECTS+1; i++ )
-			{
-				VectorCopy( bumpSum[i], addlight[j].light[i] );
-			}
-		}
-		else
-		{
-			VectorFill( sum, 0 );
-			for (k=0 ; k<num ; k++, trans++)
-			{
-				for(i=0; i<3; i++)
-				{
-					v[i] = emitlight[trans->patch][i] * g_Patches[trans->patch].reflectivity[i];
-				}
-				VectorScale( v, trans->transfer, v );
-				VectorAdd( sum, v, sum );
-			}
-			VectorCopy( sum, addlight[j].light[0] );
-		}
-	}
-}
-
-#ifdef _WIN32
-#pragma warning (default:4701)
-#endif
-
-
 /*
 =============
 BounceLight
@@ -1705,8 +1579,8 @@ void BounceLight (void)
 	{
 		// transfer light from to the leaf patches from other patches via transfers
 		// this moves shooter->emitlight to receiver->addlight
-		unsigned int uiPatchCount = g_Patches.Size();
-		RunThreadsOn (uiPatchCount, true, GatherLight);
+		int nBlocks = PrepareGatherLight();
+		RunThreadsOn (nBlocks, true, GatherLight);
 		// move newly received light (addlight) to light to be sent out (emitlight)
 		// start at children and pull light up to parents
 		// light is always received to leaf patches
@@ -1930,10 +1804,10 @@ void MakeAllScales (void)
 	// release visibility matrix
 	FreeVisMatrix ();
 
-	Msg("transfers %d, max %d\n", total_transfer, max_transfer );
+	Msg("transfers %lld, max %d\n", (long long)total_transfer, max_transfer );
 
-	qprintf ("transfer lists: %5.1f megs\n"
-		, (float)total_transfer * sizeof(transfer_t) / (1024*1024));
+	// pack the transfer lists for the bounces
+	BuildTransferMatrix ();
 }
 
 
@@ -2025,6 +1899,14 @@ bool RadWorld_Go()
 		// RunThreadsOnIndividual (numfaces, true, BuildFacelights);
 		RunMPIBuildFacelights();
 	}
+	else if ( g_bDistWork )
+	{
+		RunDistBuildFacelights();
+	}
+	else if ( g_bIncremental )
+	{
+		RunIncrementalBuildFacelights();
+	}
 	else 
 	{
 		RunThreadsOnIndividual (numfaces, true, BuildFacelights);
@@ -2065,10 +1947,19 @@ bool RadWorld_Go()
 			addlight.SetSize( g_Patches.Size() );
 			memset( addlight.Base(), 0, g_Patches.Size() * sizeof( bumplights_t ) );
 
-			MakeAllScales ();
+			if ( !g_bIncremental || !LoadIncrementalTransfers() )
+				MakeAllScales ();
+		}
 
+		if ( g_bIncremental )
+			SaveLightCache ();
+
+		if (numbounce > 0)
+		{
 			// spread light around
 			BounceLight ();
+
+			FreeTransferMatrix ();
 		}
 
 		//
@@ -2143,7 +2034,7 @@ void VRAD_LoadBSP( char const *pFilename )
 	// so we prepend qdir here.
 	strcpy( source, ExpandPath( source ) );
 
-	if ( !g_bUseMPI )
+	if ( !g_bUseMPI && !g_bDistWorker )
 	{
 		// Setup the logfile.
 		char logFile[512];
@@ -2178,6 +2069,7 @@ void VRAD_LoadBSP( char const *pFilename )
 
 	strcpy(incrementfile, source);
 	Q_DefaultExtension(incrementfile, ".r0", sizeof(incrementfile));
+	V_snprintf( g_szLightCacheFile, sizeof( g_szLightCacheFile ), "%s%s.vrc", source, g_bHDR ? "_hdr" : "" );
 	Q_DefaultExtension(source, ".bsp", sizeof( source ));
 
 	Msg( "Loading %s\n", source );
@@ -2491,6 +2383,18 @@ int ParseCommandLine( int argc, char **argv, bool *onlydetail )
 		{
 			do_fast = true;
 		}
+		else if (!Q_stricmp(argv[i],"-bvh"))
+		{
+			g_RtEnv.Flags |= RTE_FLAGS_BVH;
+		}
+		else if (!Q_stricmp(argv[i],"-halftransfers"))
+		{
+			g_bHalfTransfers = true;
+		}
+		else if (!Q_stricmp(argv[i],"-incremental"))
+		{
+			g_bIncremental = true;
+		}
 		else if (!Q_stricmp(argv[i],"-noskyboxrecurse"))
 		{
 			g_bNoSkyRecurse = true;
@@ -2806,6 +2710,7 @@ void PrintUsage( int argc, char **argv )
 		"  -extrasky n     : trace N times as many rays for indirect light and sky ambient.\n"
 		"  -low            : Run as an idle-priority process.\n"
 		"  -mpi            : Use VMPI to distribute computations.\n"
+		"  -distribute <n> : Light the faces on n worker processes on this machine.\n"
 		"  -rederror       : Show errors in red.\n"
 		"\n"
 		"  -vproject <directory> : Override the VPROJECT environment variable.\n"
@@ -2816,6 +2721,11 @@ void PrintUsage( int argc, char **argv )
 		"  -dump           : Write debugging .txt files.\n"
 		"  -dumpnormals    : Write normals to debug files.\n"
 		"  -dumptrace      : Write ray-tracing environment to debug files.\n"
+		"  -bvh            : Trace rays through a BVH instead of the kd-tree.\n"
+		"  -halftransfers  : Store the bounce transfers as 16 bit floats to save memory.\n"
+		"  -incremental    : Keep the direct light of each face in <mapname>.vrc and the\n"
+		"                    transfers in <mapname>.vrt, and only relight the faces\n"
+		"                    changed lights reach.\n"
 		"  -threads        : Control the number of threads vbsp uses (defaults to the #\n"
 		"                    or processors on your machine).\n"
 		"  -lights <file>  : Load a lights file in addition to lights.rad and the\n"
@@ -2829,6 +2739,9 @@ void PrintUsage( int argc, char **argv )
 		"                    radiosity.\n"
 		"  -stoponexit	   : Wait for a keypress on exit.\n"
 		"  -mpi_pw <pw>    : Use a password to choose a specific set of VMPI workers.\n"
+		"  -distlisten     : Also take -distribute workers from other machines.\n"
+		"  -distport <port>: Port to take them on (default: 27800).\n"
+		"  -distworker <host:port> : Work for the vrad -distlisten at host:port.\n"
 		"  -nodetaillight  : Don't light detail props.\n"
 		"  -centersamples  : Move sample centers.\n"
 		"  -luxeldensity # : Rescale all luxels by the specified amount (default: 1.0).\n"
@@ -2906,6 +2819,12 @@ int RunVRAD( int argc, char **argv )
 		CmdLib_Exit( 1 );
 	}
 
+	if ( g_bIncremental && ( g_bUseMPI || g_bDistWork ) )
+	{
+		Warning( "-incremental only works without -mpi and -distribute, ignoring it.\n" );
+		g_bIncremental = false;
+	}
+
 	// Initialize the filesystem, so additional commandline options can be loaded
 	Q_StripExtension( argv[ i ], source, sizeof( source ) );
 	CmdLib_InitFileSystem( argv[ i ] );
@@ -2938,6 +2857,7 @@ int VRAD_Main(int argc, char **argv)
 
 	// This must come first.
 	VRAD_SetupMPI( argc, argv );
+	DistWork_Init( argc, argv );
 
 #if !defined( _DEBUG )
 	if ( g_bUseMPI && !g_bMPIMaster )
@@ -275,6 +275,9 @@ extern bool			bRed2Black;
 extern bool         g_bNoSkyRecurse;
 extern bool			bDumpNormals;
 extern bool			g_bFastAmbient;
+extern bool			g_bHalfTransfers;
+extern bool			g_bIncremental;		// -incremental, not the WorldCraft incremental lighting
+extern char			g_szLightCacheFile[_MAX_PATH];
 extern float		maxchop;
 extern FileHandle_t	pFileSamples[4][4];
 extern qboolean		g_bLowPriority;
@@ -361,6 +364,8 @@ qboolean IsIncremental(char *filename);
 int SaveIncremental(char *filename);
 int PartialHead (void);
 void BuildFacelights (int facenum, int threadnum);
+void RunDistBuildFacelights();
+void RunIncrementalBuildFacelights( void );
 void PrecompLightmapOffsets();
 void FinalLightFace (int threadnum, int facenum);
 void PvsForOrigin (Vector& org, byte *pvs);
@@ -401,6 +406,19 @@ int LightForString( char *pLight, Vector& intensity );
 void MakeTransfer( int ndxPatch1, int ndxPatch2, transfer_t *all_transfers );
 void MakeScales( int ndxPatch, transfer_t *all_transfers );
 
+// transfermatrix.cpp
+void BuildTransferMatrix( void );
+void FreeTransferMatrix( void );
+bool SaveTransferMatrix( FileHandle_t hFile );
+bool LoadTransferMatrix( FileHandle_t hFile );
+int PrepareGatherLight( void );
+void GatherLight( int threadnum, void *pUserData );
+
+// lightcache.cpp
+void AddLightCacheClusters( int facenum, const int *pClusters );
+bool LoadIncrementalTransfers( void );
+void SaveLightCache( void );
+
 // Run startup code like initialize mathlib.
 void VRAD_Init();
 
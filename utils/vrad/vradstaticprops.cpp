@@ -311,6 +311,7 @@ private:
 		CUtlVector<MeshData_t>	m_MeshData;
 		int                     m_Flags;
 		bool					m_bLightingOriginValid;
+		int						m_iNextInstance;	// next identical prop that gets this one's lighting, or -1
 
 		// Note that all lightmaps for a given prop share the same resolution (and format)--and there can be multiple lightmaps
 		// per prop (if there are multiple pieces--the watercooler is an example).
@@ -333,10 +334,18 @@ private:
 	CUtlVector <StaticPropDict_t>	m_StaticPropDict;
 	CUtlVector <CStaticProp>		m_StaticProps;
 
+	// The props that actually get lit, one per set of identical instances
+	CUtlVector <int>				m_LitProps;
+
 	bool m_bIgnoreStaticPropTrace;
 
 	void ComputeLighting( CStaticProp &prop, int iThread, int prop_index, CComputeStaticPropLightingResults *pResults );
 	void ApplyLightingToStaticProp( int iStaticProp, CStaticProp &prop, const CComputeStaticPropLightingResults *pResults );
+	void ApplyLightingToInstances( int iStaticProp, const CComputeStaticPropLightingResults *pResults );
+
+	static int CompareInstances( const CStaticProp &prop1, const CStaticProp &prop2 );
+	static int __cdecl SortInstances( const int *pProp1, const int *pProp2 );
+	void FindIdenticalInstances();
 
 	void SerializeLighting();
 	void AddPolysForRayTrace();
@@ -1145,17 +1154,34 @@ bool PositionInSolid( Vector &position )
 }
 
 //-----------------------------------------------------------------------------
-// Trace from a vertex to each direct light source, accumulating its contribution.
+// Trace from up to four points to each direct light source, accumulating its
+// contribution. The points go through the light in one SSE batch.
 //-----------------------------------------------------------------------------
-void ComputeDirectLightingAtPoint( Vector &position, Vector &normal, Vector &outColor, int iThread,
-								   int static_prop_id_to_skip=-1, int nLFlags = 0)
+void ComputeDirectLightingAtPoints( const Vector *pPositions, const Vector *pNormals, int nPoints, Vector *pOutColors, int iThread,
+									int static_prop_id_to_skip=-1, int nLFlags = 0)
 {
+	Assert( nPoints >= 1 && nPoints <= 4 );
+
 	SSE_sampleLightOutput_t	sampleOutput;
 
-	outColor.Init();
+	int clusters[4];
+	for ( int i = 0; i < nPoints; i++ )
+	{
+		pOutColors[i].Init();
+		clusters[i] = ClusterFromPoint( pPositions[i] );
+	}
+
+	// Pad out the batch with the first point, its results get dropped
+	Vector positions[4], normals[4];
+	for ( int i = 0; i < 4; i++ )
+	{
+		normals[i] = pNormals[ i < nPoints ? i : 0 ];
+	}
+
+	FourVectors normal4;
+	normal4.LoadAndSwizzle( normals[0], normals[1], normals[2], normals[3] );
 
 	// Iterate over all direct lights and accumulate their contribution
-	int cluster = ClusterFromPoint( position );
 	for ( directlight_t *dl = activelights; dl != NULL; dl = dl->next )
 	{
 		if ( dl->light.style )
@@ -1165,46 +1191,71 @@ void ComputeDirectLightingAtPoint( Vector &position, Vector &normal, Vector &out
 		}
 
 		// is this lights cluster visible?
-		if ( !PVSCheck( dl->pvs, cluster ) )
+		bool bVisible[4];
+		bool bAnyVisible = false;
+		for ( int i = 0; i < nPoints; i++ )
+		{
+			bVisible[i] = PVSCheck( dl->pvs, clusters[i] ) != 0;
+			bAnyVisible |= bVisible[i];
+		}
+		if ( !bAnyVisible )
 			continue;
 
-		// push the vertex towards the light to avoid surface acne
-		Vector adjusted_pos = position;
 		float flEpsilon = 0.0;
 
-		if  (dl->light.type != emit_skyambient)
+		for ( int i = 0; i < 4; i++ )
 		{
-			// push towards the light
-			Vector fudge;
-			if ( dl->light.type == emit_skylight )
-				fudge = -( dl->light.normal);
-			else
+			// push the vertex towards the light to avoid surface acne
+			const Vector &position = pPositions[ i < nPoints ? i : 0 ];
+			positions[i] = position;
+
+			if  (dl->light.type != emit_skyambient)
 			{
-				fudge = dl->light.origin-position;
-				VectorNormalize( fudge );
+				// push towards the light
+				Vector fudge;
+				if ( dl->light.type == emit_skylight )
+					fudge = -( dl->light.normal);
+				else
+				{
+					fudge = dl->light.origin-position;
+					VectorNormalize( fudge );
+				}
+				fudge *= 4.0;
+				positions[i] += fudge;
+			}
+			else 
+			{
+				// push out along normal
+				positions[i] += 4.0 * normals[i];
+//				flEpsilon = 1.0;
 			}
-			fudge *= 4.0;
-			adjusted_pos += fudge;
-		}
-		else 
-		{
-			// push out along normal
-			adjusted_pos += 4.0 * normal;
-//			flEpsilon = 1.0;
 		}
 
 		FourVectors adjusted_pos4;
-		FourVectors normal4;
-		adjusted_pos4.DuplicateVector( adjusted_pos );
-		normal4.DuplicateVector( normal );
+		adjusted_pos4.LoadAndSwizzle( positions[0], positions[1], positions[2], positions[3] );
 
 		GatherSampleLightSSE( sampleOutput, dl, -1, adjusted_pos4, &normal4, 1, iThread, nLFlags | GATHERLFLAGS_FORCE_FAST,
 		                      static_prop_id_to_skip, flEpsilon );
 		
-		VectorMA( outColor, sampleOutput.m_flFalloff.m128_f32[0] * sampleOutput.m_flDot[0].m128_f32[0], dl->light.intensity, outColor );
+		for ( int i = 0; i < nPoints; i++ )
+		{
+			if ( bVisible[i] )
+			{
+				VectorMA( pOutColors[i], SubFloat( sampleOutput.m_flFalloff, i ) * SubFloat( sampleOutput.m_flDot[0], i ), dl->light.intensity, pOutColors[i] );
+			}
+		}
 	}
 }
 
+//-----------------------------------------------------------------------------
+// Trace from a vertex to each direct light source, accumulating its contribution.
+//-----------------------------------------------------------------------------
+void ComputeDirectLightingAtPoint( Vector &position, Vector &normal, Vector &outColor, int iThread,
+								   int static_prop_id_to_skip=-1, int nLFlags = 0)
+{
+	ComputeDirectLightingAtPoints( &position, &normal, 1, &outColor, iThread, static_prop_id_to_skip, nLFlags );
+}
+
 //-----------------------------------------------------------------------------
 // Takes the results from a ComputeLighting call and applies it to the static prop in question.
 //-----------------------------------------------------------------------------
@@ -1309,6 +1360,8 @@ void CVradStaticPropMgr::ApplyLightingToStaticProp( int iStaticProp, CStaticProp
 void CVradStaticPropMgr::ComputeLighting( CStaticProp &prop, int iThread, int prop_index, CComputeStaticPropLightingResults *pResults )
 {
 	CUtlVector<badVertex_t>		badVerts;
+	CUtlVector<int>				sampleVerts;
+	CUtlVector<Vector>			sampleNormals;
 
 	StaticPropDict_t &dict = m_StaticPropDict[prop.m_ModelIdx];
 	studiohdr_t	*pStudioHdr = dict.m_pStudioHdr;
@@ -1393,39 +1446,57 @@ void CVradStaticPropMgr::ComputeLighting( CStaticProp &prop, int iThread, int pr
 					}
 					else
 					{
-						Vector direct_pos=samplePosition;
-							
-						
-
-						Vector directColor(0,0,0);
-						ComputeDirectLightingAtPoint( direct_pos,
-														sampleNormal, directColor, iThread,
-														skip_prop, nFlags );
-						Vector indirectColor(0,0,0);
-
-						if (g_bShowStaticPropNormals)
-						{
-							directColor= sampleNormal;
-							directColor += Vector(1.0,1.0,1.0);
-							directColor *= 50.0;
-						}
-						else
-						{
-							if (numbounce >= 1)
-								ComputeIndirectLightingAtPoint( 
-									samplePosition, sampleNormal, 
-									indirectColor, iThread, true,
-									( prop.m_Flags & STATIC_PROP_IGNORE_NORMALS) != 0 );
-						}
-						
+						// lit below, four at a time
 						colorVerts[numVertexes].m_bValid = true;
 						colorVerts[numVertexes].m_Position = samplePosition;
-						VectorAdd( directColor, indirectColor, colorVerts[numVertexes].m_Color );
+						sampleVerts.AddToTail( numVertexes );
+						sampleNormals.AddToTail( sampleNormal );
 					}
 					
 					numVertexes++;
 				}
 			}
+
+			for ( int nSample = 0; nSample < sampleVerts.Count(); nSample += 4 )
+			{
+				int nBatch = MIN( 4, sampleVerts.Count() - nSample );
+
+				Vector samplePositions[4];
+				for ( int i = 0; i < nBatch; i++ )
+				{
+					samplePositions[i] = colorVerts[sampleVerts[nSample + i]].m_Position;
+				}
+
+				Vector directColors[4];
+				ComputeDirectLightingAtPoints( samplePositions, &sampleNormals[nSample], nBatch,
+											   directColors, iThread, skip_prop, nFlags );
+
+				for ( int i = 0; i < nBatch; i++ )
+				{
+					Vector &sampleNormal = sampleNormals[nSample + i];
+					Vector &directColor = directColors[i];
+					Vector indirectColor(0,0,0);
+
+					if (g_bShowStaticPropNormals)
+					{
+						directColor= sampleNormal;
+						directColor += Vector(1.0,1.0,1.0);
+						directColor *= 50.0;
+					}
+					else
+					{
+						if (numbounce >= 1)
+							ComputeIndirectLightingAtPoint( 
+								samplePositions[i], sampleNormal, 
+								indirectColor, iThread, true,
+								( prop.m_Flags & STATIC_PROP_IGNORE_NORMALS) != 0 );
+					}
+
+					VectorAdd( directColor, indirectColor, colorVerts[sampleVerts[nSample + i]].m_Color );
+				}
+			}
+			sampleVerts.RemoveAll();
+			sampleNormals.RemoveAll();
 			
 			// color in the bad vertexes
 			// when entire model has no lighting origin and no valid neighbors
@@ -1669,8 +1740,10 @@ void CVradStaticPropMgr::VMPI_ReceiveStaticPropResults_Static( uint64 iStaticPro
 // Called on workers to do the computation for a static prop and send
 // it to the master.
 //-----------------------------------------------------------------------------
-void CVradStaticPropMgr::VMPI_ProcessStaticProp( int iThread, int iStaticProp, MessageBuffer *pBuf )
+void CVradStaticPropMgr::VMPI_ProcessStaticProp( int iThread, int iLitProp, MessageBuffer *pBuf )
 {
+	int iStaticProp = m_LitProps[iLitProp];
+
 	// Compute the lighting.
 	CComputeStaticPropLightingResults results;
 	ComputeLighting( m_StaticProps[iStaticProp], iThread, iStaticProp, &results );
@@ -1704,7 +1777,7 @@ void CVradStaticPropMgr::VMPI_ProcessStaticProp( int iThread, int iStaticProp, M
 //-----------------------------------------------------------------------------
 // Called on the master when a worker finishes processing a static prop.
 //-----------------------------------------------------------------------------
-void CVradStaticPropMgr::VMPI_ReceiveStaticPropResults( int iStaticProp, MessageBuffer *pBuf, int iWorker )
+void CVradStaticPropMgr::VMPI_ReceiveStaticPropResults( int iLitProp, MessageBuffer *pBuf, int iWorker )
 {
 	// Read in the results.
 	CComputeStaticPropLightingResults results;
@@ -1737,16 +1810,107 @@ void CVradStaticPropMgr::VMPI_ReceiveStaticPropResults( int iStaticProp, Message
 	}
 	
 	// Apply the results.
-	ApplyLightingToStaticProp( iStaticProp, m_StaticProps[iStaticProp], &results );
+	ApplyLightingToInstances( m_LitProps[iLitProp], &results );
 }
 
 
-void CVradStaticPropMgr::ComputeLightingForProp( int iThread, int iStaticProp )
+void CVradStaticPropMgr::ComputeLightingForProp( int iThread, int iLitProp )
 {
+	int iStaticProp = m_LitProps[iLitProp];
+
 	// Compute the lighting.
 	CComputeStaticPropLightingResults results;
 	ComputeLighting( m_StaticProps[iStaticProp], iThread, iStaticProp, &results );
-	ApplyLightingToStaticProp( iStaticProp, m_StaticProps[iStaticProp], &results );
+	ApplyLightingToInstances( iStaticProp, &results );
+}
+
+//-----------------------------------------------------------------------------
+// Applies the lighting computed for a prop to it and its identical instances.
+//-----------------------------------------------------------------------------
+void CVradStaticPropMgr::ApplyLightingToInstances( int iStaticProp, const CComputeStaticPropLightingResults *pResults )
+{
+	for ( int i = iStaticProp; i != -1; i = m_StaticProps[i].m_iNextInstance )
+	{
+		ApplyLightingToStaticProp( i, m_StaticProps[i], pResults );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Returns zero if two props are identical instances that get the same lighting.
+//-----------------------------------------------------------------------------
+int CVradStaticPropMgr::CompareInstances( const CStaticProp &prop1, const CStaticProp &prop2 )
+{
+	int nCmp = prop1.m_ModelIdx - prop2.m_ModelIdx;
+	if ( !nCmp )
+		nCmp = prop1.m_Flags - prop2.m_Flags;
+	if ( !nCmp )
+		nCmp = memcmp( &prop1.m_Origin, &prop2.m_Origin, sizeof( Vector ) );
+	if ( !nCmp )
+		nCmp = memcmp( &prop1.m_Angles, &prop2.m_Angles, sizeof( QAngle ) );
+	if ( !nCmp )
+		nCmp = (int)prop1.m_bLightingOriginValid - (int)prop2.m_bLightingOriginValid;
+	if ( !nCmp && prop1.m_bLightingOriginValid )
+		nCmp = memcmp( &prop1.m_LightingOrigin, &prop2.m_LightingOrigin, sizeof( Vector ) );
+	if ( !nCmp )
+		nCmp = (int)prop1.m_LightmapImageFormat - (int)prop2.m_LightmapImageFormat;
+	if ( !nCmp )
+		nCmp = (int)prop1.m_LightmapImageWidth - (int)prop2.m_LightmapImageWidth;
+	if ( !nCmp )
+		nCmp = (int)prop1.m_LightmapImageHeight - (int)prop2.m_LightmapImageHeight;
+	return nCmp;
+}
+
+int __cdecl CVradStaticPropMgr::SortInstances( const int *pProp1, const int *pProp2 )
+{
+	int nCmp = CompareInstances( g_StaticPropMgr.m_StaticProps[*pProp1], g_StaticPropMgr.m_StaticProps[*pProp2] );
+
+	// Keep identical instances in index order
+	return nCmp ? nCmp : *pProp1 - *pProp2;
+}
+
+//-----------------------------------------------------------------------------
+// Props with the same model, transform, flags and lighting origin get the
+// same lighting, so only the first of them is lit and the rest share its
+// results. Each one skips its own triangles when self shadowing is off, but
+// the others are in the same place, so the shadows are the same too.
+//-----------------------------------------------------------------------------
+void CVradStaticPropMgr::FindIdenticalInstances()
+{
+	int count = m_StaticProps.Count();
+
+	CUtlVector<int> sorted;
+	sorted.SetSize( count );
+	for ( int i = 0; i < count; i++ )
+	{
+		sorted[i] = i;
+		m_StaticProps[i].m_iNextInstance = -1;
+	}
+	sorted.Sort( SortInstances );
+
+	CUtlVector<bool> bInstance;
+	bInstance.SetSize( count );
+	for ( int i = 0; i < count; i++ )
+	{
+		int iPrev = sorted[i];
+		bInstance[iPrev] = false;
+
+		while ( i + 1 < count && !CompareInstances( m_StaticProps[iPrev], m_StaticProps[sorted[i + 1]] ) )
+		{
+			int iNext = sorted[++i];
+			m_StaticProps[iPrev].m_iNextInstance = iNext;
+			bInstance[iNext] = true;
+			iPrev = iNext;
+		}
+	}
+
+	m_LitProps.RemoveAll();
+	for ( int i = 0; i < count; i++ )
+	{
+		if ( !bInstance[i] )
+		{
+			m_LitProps.AddToTail( i );
+		}
+	}
 }
 
 void CVradStaticPropMgr::ThreadComputeStaticPropLighting( int iThread, void *pUserData )
@@ -1775,6 +1939,14 @@ void CVradStaticPropMgr::ComputeLighting( int iThread )
 		return;
 	}
 
+	// light each set of identical instances once
+	FindIdenticalInstances();
+	if ( m_LitProps.Count() != count )
+	{
+		Msg( "%d static props share lighting with identical instances\n", count - m_LitProps.Count() );
+		count = m_LitProps.Count();
+	}
+
 	StartPacifier( "Computing static prop lighting : " );
 
 	// ensure any traces against us are ignored because we have no inherit lighting contribution
@@ -2398,6 +2570,7 @@ static void GenerateLightmapSamplesForMesh( const matrix3x4_t& _matPos, const ma
 	// on the other side.
 	// First attempt: Just pretend the triangle was larger and cast a ray from this new world pos 
 	// as above.
+	CUtlVector<int> sampleTexels;
 	int linearPos = 0;
 	for ( int j = 0; j < _lightmapResY; ++j )
 	{
@@ -2423,20 +2596,37 @@ static void GenerateLightmapSamplesForMesh( const matrix3x4_t& _matPos, const ma
 
 			if (shouldProcess)
 			{
-				Vector directColor(0, 0, 0),
-					   indirectColor(0, 0, 0);
+				sampleTexels.AddToTail( linearPos );
+			}
+
+			++linearPos;
+		}
+	}
 
+	// Light the texels four at a time.
+	for ( int nSample = 0; nSample < sampleTexels.Count(); nSample += 4 )
+	{
+		int nBatch = MIN( 4, sampleTexels.Count() - nSample );
 
-				ComputeDirectLightingAtPoint( colorTexels[linearPos].m_WorldPosition, colorTexels[linearPos].m_WorldNormal, directColor, _iThread, _skipProp, _flags);
+		Vector samplePositions[4], sampleNormals[4];
+		for ( int i = 0; i < nBatch; i++ )
+		{
+			samplePositions[i] = colorTexels[sampleTexels[nSample + i]].m_WorldPosition;
+			sampleNormals[i] = colorTexels[sampleTexels[nSample + i]].m_WorldNormal;
+		}
 
-				if (numbounce >= 1) {
-					ComputeIndirectLightingAtPoint( colorTexels[linearPos].m_WorldPosition, colorTexels[linearPos].m_WorldNormal, indirectColor, _iThread, true, (_flags & GATHERLFLAGS_IGNORE_NORMALS) != 0 );
-				}
+		Vector directColors[4];
+		ComputeDirectLightingAtPoints( samplePositions, sampleNormals, nBatch, directColors, _iThread, _skipProp, _flags );
 
-				VectorAdd(directColor, indirectColor, colorTexels[linearPos].m_Color);
+		for ( int i = 0; i < nBatch; i++ )
+		{
+			Vector indirectColor(0, 0, 0);
+
+			if (numbounce >= 1) {
+				ComputeIndirectLightingAtPoint( samplePositions[i], sampleNormals[i], indirectColor, _iThread, true, (_flags & GATHERLFLAGS_IGNORE_NORMALS) != 0 );
 			}
 
-			++linearPos;
+			VectorAdd(directColors[i], indirectColor, colorTexels[sampleTexels[nSample + i]].m_Color);
 		}
 	}
 }
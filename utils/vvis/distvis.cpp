@@ -0,0 +1,69 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: PortalFlow on worker processes, for -distribute and -distworker
+//
+//=============================================================================//
+
+#include "vis.h"
+#include "threads.h"
+#include "pacifier.h"
+#include "distwork.h"
+
+
+static void ProcessDistPortalFlow( int iThread, uint64 iPortal, CUtlBuffer &buf )
+{
+	PortalFlow( iThread, (int)iPortal );
+	buf.Put( sorted_portals[iPortal]->portalvis, portalbytes );
+}
+
+static void ReceiveDistPortalFlow( uint64 iPortal, CUtlBuffer &buf )
+{
+	portal_t *p = sorted_portals[iPortal];
+	buf.Get( p->portalvis, portalbytes );
+	if ( !buf.IsValid() )
+		Error( "Got a short portal from a -distribute worker.\n" );
+	p->status = stat_done;
+}
+
+// The portals the other workers finished prune the flows still to come, the
+// same as the ones finished here
+static void ShareDistPortalFlow( uint64 iPortal, CUtlBuffer &buf )
+{
+	portal_t *p = sorted_portals[iPortal];
+	if ( p->status != stat_none )
+		return;
+	buf.Get( p->portalvis, portalbytes );
+	if ( !buf.IsValid() )
+		Error( "Got a short portal from another -distribute worker.\n" );
+	p->status = stat_done;
+}
+
+//-----------------------------------------------------------------------------
+// Runs PortalFlow on all the portals in sorted_portals that aren't done
+// already, on the workers. The workers exit when it's done.
+//-----------------------------------------------------------------------------
+void RunDistPortalFlow()
+{
+	CUtlVector<uint64> workUnits;
+	for ( int i = 0; i < g_numportals * 2; i++ )
+	{
+		if ( sorted_portals[i]->status != stat_done )
+			workUnits.AddToTail( i );
+	}
+
+	Msg( "%-20s ", "PortalFlow:" );
+	if ( !g_bDistWorker )
+		StartPacifier( "" );
+
+	double elapsed = DistributeWorkUnits( workUnits.Count(), workUnits.Base(),
+		ProcessDistPortalFlow, ReceiveDistPortalFlow, ShareDistPortalFlow );
+
+	if ( g_bDistWorker )
+	{
+		Msg( "VVIS worker finished.\n" );
+		CmdLib_Exit( 0 );
+	}
+
+	EndPacifier( false );
+	Msg( " (%d)\n", (int)elapsed );
+}
@@ -7,6 +7,7 @@
 //=============================================================================//
 #include "vis.h"
 #include "vmpi.h"
+#include "mathlib/ssemath.h"
 
 int g_TraceClusterStart = -1;
 int g_TraceClusterStop = -1;
@@ -29,19 +30,97 @@ int g_TraceClusterStop = -1;
   void CalcMightSee (leaf_t *leaf, 
 */
 
+static inline int PopCount32( uint32 v )
+{
+	v = v - ( ( v >> 1 ) & 0x55555555 );
+	v = ( v & 0x33333333 ) + ( ( v >> 2 ) & 0x33333333 );
+	return ( ( ( v + ( v >> 4 ) ) & 0x0F0F0F0F ) * 0x01010101 ) >> 24;
+}
+
 int CountBits (byte *bits, int numbits)
 {
 	int		i;
 	int		c;
 
+	// a word at a time, the bit order within it doesn't matter for a count
 	c = 0;
-	for (i=0 ; i<numbits ; i++)
+	for (i=0 ; i+32<=numbits ; i+=32)
+	{
+		uint32 word;
+		memcpy( &word, bits + (i>>3), sizeof( word ) );
+		c += PopCount32( word );
+	}
+	for ( ; i<numbits ; i++)
 		if ( CheckBit( bits, i ) )
 			c++;
 
 	return c;
 }
 
+//-----------------------------------------------------------------------------
+// Bit vector kernels, 128 bits at a time. portalbytes is a multiple of 16.
+// The vectors aren't necessarily aligned: pstack_t::mightsee is a byte array.
+//-----------------------------------------------------------------------------
+
+// dest = a & b, returns true if dest has any bits that aren't in vis
+static inline bool AndBitsAnyNew( byte *dest, const byte *a, const byte *b, const byte *vis )
+{
+	fltx4 more = Four_Zeros;
+	for ( int j = 0; j < portalbytes; j += 16 )
+	{
+		fltx4 might = AndSIMD( LoadUnalignedSIMD( a + j ), LoadUnalignedSIMD( b + j ) );
+		StoreUnalignedSIMD( (float *)( dest + j ), might );
+		more = OrSIMD( more, AndNotSIMD( LoadUnalignedSIMD( vis + j ), might ) );
+	}
+
+	// test the bits, comparing as floats would take -0 for nothing
+	ALIGN16 uint32 words[4] ALIGN16_POST;
+	StoreAlignedSIMD( (float *)words, more );
+	return ( words[0] | words[1] | words[2] | words[3] ) != 0;
+}
+
+//-----------------------------------------------------------------------------
+// Winding points transposed four at a time, so a plane is tested against four
+// of them at once. The distances come out exactly as the scalar
+// DotProduct( p, normal ) - dist: same operations in the same order, and
+// MaddSIMD is a separate multiply and add. Lanes past numpoints repeat the
+// last point and are masked off.
+//-----------------------------------------------------------------------------
+struct windingsimd_t
+{
+	int			numpoints;
+	int			numgroups;
+	uint64		validmask;		// one bit per point
+	FourVectors	points[MAX_POINTS_ON_WINDING/4];
+};
+
+static void TransposeWinding( const winding_t *w, windingsimd_t *out )
+{
+	out->numpoints = w->numpoints;
+	out->numgroups = ( w->numpoints + 3 ) >> 2;
+	out->validmask = ( w->numpoints >= 64 ) ? ~(uint64)0 : ( ( (uint64)1 << w->numpoints ) - 1 );
+	for ( int i = 0; i < out->numgroups * 4; i++ )
+	{
+		const Vector &p = w->points[ MIN( i, w->numpoints - 1 ) ];
+		FourVectors &group = out->points[i >> 2];
+		group.X( i & 3 ) = p.x;
+		group.Y( i & 3 ) = p.y;
+		group.Z( i & 3 ) = p.z;
+	}
+}
+
+// The distances of one group of points from a plane
+static FORCEINLINE fltx4 PlaneDistSIMD( const FourVectors &points, const FourVectors &normal, const fltx4 &dist )
+{
+	return SubSIMD( points * normal, dist );
+}
+
+// Four bits of a per point mask
+static FORCEINLINE int GroupMask( uint64 mask, int group )
+{
+	return (int)( mask >> ( group * 4 ) ) & 15;
+}
+
 int		c_fullskip;
 int		c_portalskip, c_leafskip;
 int		c_vistest, c_mighttest;
@@ -115,42 +194,53 @@ ChopWinding
 
 winding_t	*ChopWinding (winding_t *in, pstack_t *stack, plane_t *split)
 {
-	vec_t	dists[128];
+	ALIGN16 vec_t	dists[128] ALIGN16_POST;
 	int		sides[128];
-	int		counts[3];
 	vec_t	dot;
 	int		i, j;
 	Vector	mid;
 	winding_t	*neww;
 
-	counts[0] = counts[1] = counts[2] = 0;
+// determine sides for each point, four at a time
+	windingsimd_t	points;
+	TransposeWinding (in, &points);
 
-// determine sides for each point
-	for (i=0 ; i<in->numpoints ; i++)
+	FourVectors	normal;
+	normal.DuplicateVector (split->normal);
+	fltx4	dist = ReplicateX4 (split->dist);
+	fltx4	epsilon = ReplicateX4 (ON_VIS_EPSILON);
+	fltx4	negEpsilon = ReplicateX4 (-ON_VIS_EPSILON);
+
+	uint64	front = 0, back = 0;
+	for (i=0 ; i<points.numgroups ; i++)
 	{
-		dot = DotProduct (in->points[i], split->normal);
-		dot -= split->dist;
-		dists[i] = dot;
-		if (dot > ON_VIS_EPSILON)
-			sides[i] = SIDE_FRONT;
-		else if (dot < -ON_VIS_EPSILON)
-			sides[i] = SIDE_BACK;
-		else
-		{
-			sides[i] = SIDE_ON;
-		}
-		counts[sides[i]]++;
+		fltx4 d = PlaneDistSIMD (points.points[i], normal, dist);
+		StoreAlignedSIMD (&dists[i*4], d);
+		front |= (uint64)TestSignSIMD (CmpGtSIMD (d, epsilon)) << (i*4);
+		back |= (uint64)TestSignSIMD (CmpLtSIMD (d, negEpsilon)) << (i*4);
 	}
+	front &= points.validmask;
+	back &= points.validmask;
 
-	if (!counts[1])
+	if (!back)
 		return in;		// completely on front side
 	
-	if (!counts[0])
+	if (!front)
 	{
 		FreeStackWinding (in, stack);
 		return NULL;
 	}
 
+	for (i=0 ; i<in->numpoints ; i++)
+	{
+		if (front & ((uint64)1 << i))
+			sides[i] = SIDE_FRONT;
+		else if (back & ((uint64)1 << i))
+			sides[i] = SIDE_BACK;
+		else
+			sides[i] = SIDE_ON;
+	}
+
 	sides[i] = sides[0];
 	dists[i] = dists[0];
 	
@@ -236,14 +326,24 @@ flipclip should be set.
 */
 winding_t	*ClipToSeperators (winding_t *source, winding_t *pass, winding_t *target, bool flipclip, pstack_t *stack)
 {
-	int			i, j, k, l;
+	int			i, j, l;
 	plane_t		plane;
 	Vector		v1, v2;
-	float		d;
 	vec_t		length;
-	int			counts[3];
 	bool		fliptest;
 
+	// every candidate plane is tested against all of source and pass
+	windingsimd_t	sourcepoints, passpoints;
+	TransposeWinding (source, &sourcepoints);
+	TransposeWinding (pass, &passpoints);
+
+	FourVectors	normal;
+	fltx4		dist;
+	fltx4		epsilon = ReplicateX4 (ON_VIS_EPSILON);
+	fltx4		negEpsilon = ReplicateX4 (-ON_VIS_EPSILON);
+	uint64		mask;
+	int			g, front, back;
+
 // check all combinations	
 	for (i=0 ; i<source->numpoints ; i++)
 	{
@@ -283,26 +383,26 @@ winding_t	*ClipToSeperators (winding_t *source, winding_t *pass, winding_t *targ
 		// source portal
 		//
 #if 1
+			normal.DuplicateVector (plane.normal);
+			dist = ReplicateX4 (plane.dist);
+
+			// the first point of source off the plane decides
 			fliptest = false;
-			for (k=0 ; k<source->numpoints ; k++)
+			mask = sourcepoints.validmask & ~((uint64)1 << i) & ~((uint64)1 << l);
+			for (g=0 ; g<sourcepoints.numgroups ; g++)
 			{
-				if (k == i || k == l)
-					continue;
-				d = DotProduct (source->points[k], plane.normal) - plane.dist;
-				if (d < -ON_VIS_EPSILON)
-				{	// source is on the negative side, so we want all
-					// pass and target on the positive side
-					fliptest = false;
-					break;
-				}
-				else if (d > ON_VIS_EPSILON)
-				{	// source is on the positive side, so we want all
-					// pass and target on the negative side
-					fliptest = true;
+				fltx4 dists = PlaneDistSIMD (sourcepoints.points[g], normal, dist);
+				back = TestSignSIMD (CmpLtSIMD (dists, negEpsilon)) & GroupMask (mask, g);
+				front = TestSignSIMD (CmpGtSIMD (dists, epsilon)) & GroupMask (mask, g);
+				if (back | front)
+				{
+					// source on the negative side wants all of pass and target
+					// on the positive side, and the other way around
+					fliptest = (front & (back | front) & -(back | front)) != 0;
 					break;
 				}
 			}
-			if (k == source->numpoints)
+			if (g == sourcepoints.numgroups)
 				continue;		// planar with source portal
 #else
 			fliptest = flipclip;
@@ -320,27 +420,28 @@ winding_t	*ClipToSeperators (winding_t *source, winding_t *pass, winding_t *targ
 		// if all of the pass portal points are now on the positive side,
 		// this is the seperating plane
 		//
-			counts[0] = counts[1] = counts[2] = 0;
-			for (k=0 ; k<pass->numpoints ; k++)
+			if (fliptest)
+			{
+				normal.DuplicateVector (plane.normal);
+				dist = ReplicateX4 (plane.dist);
+			}
+			mask = passpoints.validmask & ~((uint64)1 << j);
+			front = 0;
+			for (g=0 ; g<passpoints.numgroups ; g++)
 			{
-				if (k==j)
-					continue;
-				d = DotProduct (pass->points[k], plane.normal) - plane.dist;
-				if (d < -ON_VIS_EPSILON)
+				fltx4 dists = PlaneDistSIMD (passpoints.points[g], normal, dist);
+				if (TestSignSIMD (CmpLtSIMD (dists, negEpsilon)) & GroupMask (mask, g))
 					break;
-				else if (d > ON_VIS_EPSILON)
-					counts[0]++;
-				else
-					counts[2]++;
+				front |= TestSignSIMD (CmpGtSIMD (dists, epsilon)) & GroupMask (mask, g);
 			}
-			if (k != pass->numpoints)
+			if (g != passpoints.numgroups)
 				continue;	// points on negative side, not a seperating plane
 				
-			if (!counts[0])
+			if (!front)
 				continue;	// planar with seperating plane
 #else
-			k = (j+1)%pass->numpoints;
-			d = DotProduct (pass->points[k], plane.normal) - plane.dist;
+			int k = (j+1)%pass->numpoints;
+			float d = DotProduct (pass->points[k], plane.normal) - plane.dist;
 			if (d < -ON_VIS_EPSILON)
 				continue;
 			k = (j+pass->numpoints-1)%pass->numpoints;
@@ -481,8 +582,9 @@ void RecursiveLeafFlow (int leafnum, threaddata_t *thread, pstack_t *prevstack)
 	portal_t	*p;
 	plane_t		backplane;
 	leaf_t 		*leaf;
-	int			i, j;
-	long		*test, *might, *vis, more;
+	int			i;
+	byte		*test;
+	bool		more;
 	int			pnum;
 
 	// Early-out if we're a VMPI worker that's told to exit. If we don't do this here, then the
@@ -506,9 +608,6 @@ void RecursiveLeafFlow (int leafnum, threaddata_t *thread, pstack_t *prevstack)
 	stack.leaf = leaf;
 	stack.portal = NULL;
 
-	might = (long *)stack.mightsee;
-	vis = (long *)thread->base->portalvis;
-	
 	// check all portals for flowing into other leafs	
 	for (i=0 ; i<leaf->portals.Count() ; i++)
 	{
@@ -524,19 +623,14 @@ void RecursiveLeafFlow (int leafnum, threaddata_t *thread, pstack_t *prevstack)
 		// if the portal can't see anything we haven't allready seen, skip it
 		if (p->status == stat_done)
 		{
-			test = (long *)p->portalvis;
+			test = p->portalvis;
 		}
 		else
 		{
-			test = (long *)p->portalflood;
+			test = p->portalflood;
 		}
 
-		more = 0;
-		for (j=0 ; j<portallongs ; j++)
-		{
-			might[j] = ((long *)prevstack->mightsee)[j] & test[j];
-			more |= (might[j] & ~vis[j]);
-		}
+		more = AndBitsAnyNew (stack.mightsee, prevstack->mightsee, test, thread->base->portalvis);
 		
 		if ( !more && CheckBit( thread->base->portalvis, pnum ) )
 		{	// can't see anything new
@@ -825,8 +919,7 @@ void RecursiveLeafBitFlow (int leafnum, byte *mightsee, byte *cansee)
 {
 	portal_t	*p;
 	leaf_t 		*leaf;
-	int			i, j;
-	long		more;
+	int			i;
 	int			pnum;
 	byte		newmight[MAX_PORTALS/8];
 
@@ -843,15 +936,7 @@ void RecursiveLeafBitFlow (int leafnum, byte *mightsee, byte *cansee)
 			continue;
 
 		// if this portal can see some portals we mightsee, recurse
-		more = 0;
-		for (j=0 ; j<portallongs ; j++)
-		{
-			((long *)newmight)[j] = ((long *)mightsee)[j] 
-				& ((long *)p->portalflood)[j];
-			more |= ((long *)newmight)[j] & ~((long *)cansee)[j];
-		}
-
-		if (!more)
+		if (!AndBitsAnyNew (newmight, mightsee, p->portalflood, cansee))
 			continue;	// can't see anything new
 
 		SetBit( cansee, pnum );
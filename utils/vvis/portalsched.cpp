@@ -0,0 +1,258 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Hands the PortalFlow work out to the threads
+//
+//=============================================================================//
+
+#include "vis.h"
+#include "threads.h"
+#include "pacifier.h"
+#include "tier0/threadtools.h"
+
+// Every thread gets its own queue of portals, dealt round robin from
+// sorted_portals so each queue is cheapest first like the sorted list: the
+// portals that finish early leave a portalvis that prunes the later flows.
+// A thread whose queue runs dry steals from the far (expensive) end of the
+// queue with the most estimated work left.
+//
+// Running cheapest first leaves the few huge portals until the very end,
+// where they run alone. So a thread takes the far end of its own queue
+// instead as soon as that portal's cost is as large as the remaining work
+// spread over all the threads - the latest it can start without becoming
+// the tail by itself, when most of the cheap portals are done anyway.
+
+struct portalqueue_t
+{
+	CThreadFastMutex	m_mutex;
+	int					m_nHead;	// next portal to run from the near end
+	int					m_nTail;	// one past the far end
+	int64				m_nCost;	// estimated cost left in the queue
+};
+
+static portalqueue_t	g_PortalQueues[MAX_TOOL_THREADS];
+static int				g_nPortalQueues;
+
+// g_QueuedPortals[i * g_nPortalQueues + q] is the i'th portal of queue q
+static int				*g_QueuedPortals;
+static int64			*g_PortalCost;			// by sorted index
+
+static int64 volatile	g_nRemainingCost;		// not yet started
+static int64			g_nTotalCost;
+static int64			g_nDoneCost;			// finished, under ThreadLock
+static double			g_flFlowStart;
+static int				g_nLastEta;
+
+// Per portal, by sorted index, for -portaltimes
+static float			*g_PortalSeconds;
+static int				*g_PortalThread;
+static int				*g_PortalStartOrder;
+static int32 volatile	g_nStarted;
+
+//-----------------------------------------------------------------------------
+// How long PortalFlow is guessed to take: every portal that might be seen
+// through it is tried against every other one along the chains.
+//-----------------------------------------------------------------------------
+static int64 EstimatePortalCost( portal_t *p )
+{
+	return (int64)p->nummightsee * p->nummightsee + 1;
+}
+
+static inline int QueuedPortal( int iQueue, int iSlot )
+{
+	return g_QueuedPortals[iSlot * g_nPortalQueues + iQueue];
+}
+
+static int PopPortal( int iQueue, bool bFarEnd )
+{
+	portalqueue_t &queue = g_PortalQueues[iQueue];
+	AUTO_LOCK( queue.m_mutex );
+	if ( queue.m_nHead >= queue.m_nTail )
+		return -1;
+
+	int nPortal;
+	if ( !bFarEnd && !nosort )
+	{
+		// Start a portal that would otherwise finish last on its own now
+		int nFar = QueuedPortal( iQueue, queue.m_nTail - 1 );
+		bFarEnd = g_PortalCost[nFar] * g_nPortalQueues >= g_nRemainingCost;
+	}
+
+	if ( bFarEnd )
+		nPortal = QueuedPortal( iQueue, --queue.m_nTail );
+	else
+		nPortal = QueuedPortal( iQueue, queue.m_nHead++ );
+
+	queue.m_nCost -= g_PortalCost[nPortal];
+	ThreadInterlockedExchangeAdd64( &g_nRemainingCost, -g_PortalCost[nPortal] );
+	return nPortal;
+}
+
+static int GetPortalWork( int iThread )
+{
+	int nPortal = PopPortal( iThread, false );
+	while ( nPortal < 0 )
+	{
+		// Steal from whoever has the most left. The costs are only read
+		// to pick one, PopPortal checks again under the lock.
+		int iVictim = -1;
+		int64 nMostCost = 0;
+		for ( int i = 0; i < g_nPortalQueues; i++ )
+		{
+			if ( g_PortalQueues[i].m_nCost > nMostCost )
+			{
+				nMostCost = g_PortalQueues[i].m_nCost;
+				iVictim = i;
+			}
+		}
+		if ( iVictim < 0 )
+			return -1;
+
+		nPortal = PopPortal( iVictim, true );
+	}
+	return nPortal;
+}
+
+//-----------------------------------------------------------------------------
+// Progress by estimated cost rather than by portal count, which races
+// through the cheap portals and then stalls. The time left is the cost left
+// at the rate the finished portals went.
+//-----------------------------------------------------------------------------
+static void UpdatePortalFlowProgress( int nPortal )
+{
+	ThreadLock();
+	g_nDoneCost += g_PortalCost[nPortal];
+	float flFraction = (double)g_nDoneCost / g_nTotalCost;
+	UpdatePacifier( flFraction );
+
+	int nTenth = (int)( flFraction * 10.0f );
+	if ( nTenth > g_nLastEta && nTenth < 10 )
+	{
+		g_nLastEta = nTenth;
+		double flElapsed = Plat_FloatTime() - g_flFlowStart;
+		int nLeft = (int)( flElapsed * ( g_nTotalCost - g_nDoneCost ) / g_nDoneCost );
+		Msg( "[%d:%02d]", nLeft / 60, nLeft % 60 );
+	}
+	ThreadUnlock();
+}
+
+static void PortalFlowThread( int iThread, void *pUserData )
+{
+	int nPortal;
+	while ( ( nPortal = GetPortalWork( iThread ) ) >= 0 )
+	{
+		g_PortalStartOrder[nPortal] = ThreadInterlockedIncrement( &g_nStarted );
+		g_PortalThread[nPortal] = iThread;
+
+		double flStart = Plat_FloatTime();
+		PortalFlow( iThread, nPortal );
+		g_PortalSeconds[nPortal] = Plat_FloatTime() - flStart;
+
+		UpdatePortalFlowProgress( nPortal );
+	}
+}
+
+static int PortalSecondsCompare( const void *a, const void *b )
+{
+	float flA = g_PortalSeconds[*(const int *)a];
+	float flB = g_PortalSeconds[*(const int *)b];
+	return ( flA < flB ) - ( flA > flB );
+}
+
+//-----------------------------------------------------------------------------
+// Writes how long each portal took, slowest first, to check the cost
+// estimate and the schedule against
+//-----------------------------------------------------------------------------
+static void WritePortalTimes( const char *pFilename, int nPortals )
+{
+	FILE *fp = fopen( pFilename, "w" );
+	if ( !fp )
+	{
+		Warning( "Couldn't open %s\n", pFilename );
+		return;
+	}
+
+	int *pOrder = (int *)malloc( nPortals * sizeof( int ) );
+	for ( int i = 0; i < nPortals; i++ )
+	{
+		pOrder[i] = i;
+	}
+	qsort( pOrder, nPortals, sizeof( int ), PortalSecondsCompare );
+
+	fprintf( fp, "// portal mightsee cansee estcost seconds thread started\n" );
+	for ( int i = 0; i < nPortals; i++ )
+	{
+		int n = pOrder[i];
+		portal_t *p = sorted_portals[n];
+		fprintf( fp, "%6d %6d %6d %12lld %10.4f %3d %6d\n", (int)( p - portals ), p->nummightsee,
+			CountBits( p->portalvis, g_numportals * 2 ), (long long)g_PortalCost[n], g_PortalSeconds[n],
+			g_PortalThread[n], g_PortalStartOrder[n] );
+	}
+
+	free( pOrder );
+	fclose( fp );
+	Msg( "wrote portal times to %s\n", pFilename );
+}
+
+//-----------------------------------------------------------------------------
+// Runs PortalFlow on all the portals in sorted_portals that aren't done
+// already
+//-----------------------------------------------------------------------------
+void RunPortalFlow( const char *pTimesFilename )
+{
+	if ( numthreads == -1 )
+		ThreadSetDefault();
+	if ( numthreads > MAX_TOOL_THREADS )
+		numthreads = MAX_TOOL_THREADS;
+
+	int nPortals = g_numportals * 2;
+	g_nPortalQueues = numthreads;
+	int nSlots = ( nPortals + g_nPortalQueues - 1 ) / g_nPortalQueues;
+
+	g_QueuedPortals = (int *)malloc( nSlots * g_nPortalQueues * sizeof( int ) );
+	g_PortalCost = (int64 *)malloc( nPortals * sizeof( int64 ) );
+	g_PortalSeconds = (float *)calloc( nPortals, sizeof( float ) );
+	g_PortalThread = (int *)calloc( nPortals, sizeof( int ) );
+	g_PortalStartOrder = (int *)calloc( nPortals, sizeof( int ) );
+
+	g_nTotalCost = 0;
+	for ( int i = 0; i < g_nPortalQueues; i++ )
+	{
+		g_PortalQueues[i].m_nHead = 0;
+		g_PortalQueues[i].m_nTail = 0;
+		g_PortalQueues[i].m_nCost = 0;
+	}
+	int nQueued = 0;
+	for ( int i = 0; i < nPortals; i++ )
+	{
+		g_PortalCost[i] = EstimatePortalCost( sorted_portals[i] );
+		if ( sorted_portals[i]->status == stat_done )
+			continue;
+
+		portalqueue_t &queue = g_PortalQueues[nQueued % g_nPortalQueues];
+		g_QueuedPortals[nQueued++] = i;
+		queue.m_nTail++;
+		queue.m_nCost += g_PortalCost[i];
+		g_nTotalCost += g_PortalCost[i];
+	}
+	g_nRemainingCost = g_nTotalCost;
+	g_nDoneCost = 0;
+	g_nStarted = 0;
+	g_nLastEta = 0;
+
+	printf( "%-20s ", "PortalFlow:" );
+	g_flFlowStart = Plat_FloatTime();
+	RunThreadsOn( nQueued, false, PortalFlowThread );
+	EndPacifier( false );
+	printf( " (%i)\n", (int)( Plat_FloatTime() - g_flFlowStart ) );
+
+	if ( pTimesFilename )
+	{
+		WritePortalTimes( pTimesFilename, nPortals );
+	}
+
+	free( g_QueuedPortals );
+	free( g_PortalCost );
+	free( g_PortalSeconds );
+	free( g_PortalThread );
+	free( g_PortalStartOrder );
+}
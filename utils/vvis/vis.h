@@ -101,6 +101,8 @@ extern	byte	*vismap, *vismap_p, *vismap_end;	// past visfile
 
 extern	int			testlevel;
 
+extern	bool		nosort;
+
 extern	byte		*uncompressed;
 
 extern	int		leafbytes, leaflongs;
@@ -113,6 +115,10 @@ void LeafFlow (int leafnum);
 void BasePortalVis (int iThread, int portalnum);
 void BetterPortalVis (int portalnum);
 void PortalFlow (int iThread, int portalnum);
+void RunPortalFlow( const char *pTimesFilename );
+void RunDistPortalFlow();
+int LoadPortalVisCache( const char *pFilename );
+void SavePortalVisCache( const char *pFilename );
 void WritePortalTrace( const char *source );
 
 extern	portal_t	*sorted_portals[MAX_MAP_PORTALS*2];
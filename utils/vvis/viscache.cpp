@@ -0,0 +1,296 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Keeps each portal's vis between runs on the same map, so only
+//			the portals whose surroundings changed are flowed again
+//
+//=============================================================================//
+
+#include "vis.h"
+#include "tier1/generichash.h"
+#include "tier1/utlbuffer.h"
+#include "tier1/utlhashtable.h"
+#include "filesystem.h"
+
+#define VISCACHE_ID			MAKEID('V','V','C','1')
+
+// A portal is named by its winding and plane and the windings of the portals
+// out of the leaf it leads into. vbsp can number the portals differently
+// after any change, the name stays the same.
+//
+// PortalFlow on a portal only looks at the portals in its portalflood: their
+// windings, planes and leaves, and their own portalflood to narrow mightsee.
+// The key of a portal covers all of that, so a portal whose key is in the
+// cache would flow to the same portalvis again.
+static uint64		*g_PortalIds;
+static uint64		*g_PortalKeys;
+
+static inline uint64 MixBits( uint64 n )
+{
+	n ^= n >> 33;
+	n *= 0xff51afd7ed558ccdull;
+	n ^= n >> 33;
+	n *= 0xc4ceb9fe1a85ec53ull;
+	n ^= n >> 33;
+	return n;
+}
+
+// Order doesn't matter when summing up a portal bit vector
+static uint64 SumPortalBits( const byte *bits, const uint64 *pValues )
+{
+	uint64 nSum = 0;
+	for ( int i = 0; i < portalbytes; i++ )
+	{
+		if ( !bits[i] )
+			continue;
+
+		for ( int j = 0; j < 8; j++ )
+		{
+			if ( bits[i] & ( 1 << j ) )
+			{
+				nSum += pValues[i * 8 + j];
+			}
+		}
+	}
+	return nSum;
+}
+
+static void ComputePortalKeys()
+{
+	int nPortals = g_numportals * 2;
+	uint64 *pGeometry = (uint64 *)malloc( nPortals * sizeof( uint64 ) );
+	uint64 *pLeafSigs = (uint64 *)malloc( portalclusters * sizeof( uint64 ) );
+	uint64 *pMixed = (uint64 *)malloc( portalbytes * 8 * sizeof( uint64 ) );
+	uint64 *pFloodSums = (uint64 *)malloc( nPortals * sizeof( uint64 ) );
+	memset( pMixed, 0, portalbytes * 8 * sizeof( uint64 ) );
+
+	for ( int i = 0; i < nPortals; i++ )
+	{
+		portal_t *p = &portals[i];
+		pGeometry[i] = MurmurHash64( p->winding->points, p->winding->numpoints * sizeof( Vector ), 0 ) ^
+			MixBits( MurmurHash64( &p->plane, sizeof( p->plane ), 1 ) );
+	}
+
+	CUtlVector<uint64> leafGeometry;
+	for ( int i = 0; i < portalclusters; i++ )
+	{
+		leafGeometry.RemoveAll();
+		for ( int j = 0; j < leafs[i].portals.Count(); j++ )
+		{
+			leafGeometry.AddToTail( pGeometry[leafs[i].portals[j] - portals] );
+		}
+		pLeafSigs[i] = MurmurHash64( leafGeometry.Base(), leafGeometry.Count() * sizeof( uint64 ), 2 );
+	}
+
+	for ( int i = 0; i < nPortals; i++ )
+	{
+		g_PortalIds[i] = MixBits( pGeometry[i] ^ MixBits( pLeafSigs[portals[i].leaf] ) );
+		pMixed[i] = MixBits( g_PortalIds[i] );
+	}
+	for ( int i = 0; i < nPortals; i++ )
+	{
+		pFloodSums[i] = SumPortalBits( portals[i].portalflood, pMixed );
+	}
+
+	// The neighborhood: what's in each flood, and what's in their floods
+	for ( int i = 0; i < nPortals; i++ )
+	{
+		pMixed[i] = MixBits( g_PortalIds[i] + pFloodSums[i] * 0x9e3779b97f4a7c15ull );
+	}
+	for ( int i = 0; i < nPortals; i++ )
+	{
+		g_PortalKeys[i] = MixBits( g_PortalIds[i] ^ MixBits( pFloodSums[i] + SumPortalBits( portals[i].portalflood, pMixed ) ) );
+	}
+
+	free( pGeometry );
+	free( pLeafSigs );
+	free( pMixed );
+	free( pFloodSums );
+}
+
+// Runs of zero bytes are a zero and the run length, like CompressVis
+static void CompressPortalBits( const byte *bits, int nBytes, CUtlBuffer &buf )
+{
+	for ( int i = 0; i < nBytes; i++ )
+	{
+		buf.PutUnsignedChar( bits[i] );
+		if ( bits[i] )
+			continue;
+
+		int nRun = 1;
+		while ( i + 1 < nBytes && !bits[i + 1] && nRun < 255 )
+		{
+			i++;
+			nRun++;
+		}
+		buf.PutUnsignedChar( nRun );
+	}
+}
+
+static bool DecompressPortalBits( CUtlBuffer &buf, int nCompressed, byte *bits, int nBytes )
+{
+	int nEnd = buf.TellGet() + nCompressed;
+	int nOut = 0;
+	while ( buf.TellGet() < nEnd && buf.IsValid() )
+	{
+		byte b = buf.GetUnsignedChar();
+		int nCount = 1;
+		if ( !b )
+		{
+			nCount = buf.GetUnsignedChar();
+		}
+		if ( !nCount || nOut + nCount > nBytes )
+			return false;
+
+		memset( bits + nOut, b, nCount );
+		nOut += nCount;
+	}
+	return buf.IsValid() && nOut == nBytes;
+}
+
+//-----------------------------------------------------------------------------
+// Marks every portal found in the cache as done, with the portalvis it had.
+// Returns how many there were.
+//-----------------------------------------------------------------------------
+int LoadPortalVisCache( const char *pFilename )
+{
+	int nPortals = g_numportals * 2;
+	g_PortalIds = (uint64 *)malloc( nPortals * sizeof( uint64 ) );
+	g_PortalKeys = (uint64 *)malloc( nPortals * sizeof( uint64 ) );
+	ComputePortalKeys();
+
+	CUtlBuffer buf;
+	if ( !g_pFileSystem->ReadFile( pFilename, NULL, buf ) )
+		return 0;
+
+	int nOldPortals = 0, nOldBytes = 0;
+	if ( buf.GetInt() == VISCACHE_ID )
+	{
+		nOldPortals = buf.GetInt();
+		nOldBytes = buf.GetInt();
+	}
+	if ( !buf.IsValid() || nOldPortals <= 0 || nOldBytes != ( ( nOldPortals + 127 ) & ~127 ) >> 3 ||
+		buf.GetBytesRemaining() < nOldPortals * (int)sizeof( uint64 ) )
+	{
+		Warning( "%s isn't a vis cache, ignoring it\n", pFilename );
+		return 0;
+	}
+
+	// Portals with the same name anywhere can't be told apart, leave them out
+	CUtlHashtable<uint64, int> newPortals;
+	for ( int i = 0; i < nPortals; i++ )
+	{
+		bool bInserted;
+		UtlHashHandle_t h = newPortals.Insert( g_PortalIds[i], i, &bInserted );
+		if ( !bInserted )
+		{
+			newPortals[h] = -1;
+		}
+	}
+
+	int *pOldToNew = (int *)malloc( nOldPortals * sizeof( int ) );
+	for ( int i = 0; i < nOldPortals; i++ )
+	{
+		UtlHashHandle_t h = newPortals.Find( (uint64)buf.GetInt64() );
+		pOldToNew[i] = ( h != newPortals.InvalidHandle() ) ? newPortals[h] : -1;
+	}
+
+	// Where each key's bits are in the file
+	CUtlHashtable<uint64, int> oldKeys;
+	while ( buf.GetBytesRemaining() >= (int)( sizeof( uint64 ) + sizeof( int ) ) )
+	{
+		uint64 nKey = buf.GetInt64();
+		int nCompressed = buf.GetInt();
+		if ( nCompressed <= 0 || nCompressed > buf.GetBytesRemaining() )
+			break;
+
+		bool bInserted;
+		UtlHashHandle_t h = oldKeys.Insert( nKey, buf.TellGet(), &bInserted );
+		if ( !bInserted )
+		{
+			oldKeys[h] = -1;
+		}
+		buf.SeekGet( CUtlBuffer::SEEK_CURRENT, nCompressed );
+	}
+
+	byte *pOldBits = (byte *)malloc( nOldBytes );
+	int nReused = 0;
+	for ( int i = 0; i < nPortals; i++ )
+	{
+		portal_t *p = &portals[i];
+		UtlHashHandle_t hNew = newPortals.Find( g_PortalIds[i] );
+		UtlHashHandle_t hOld = oldKeys.Find( g_PortalKeys[i] );
+		if ( newPortals[hNew] != i || hOld == oldKeys.InvalidHandle() || oldKeys[hOld] < 0 )
+			continue;
+
+		buf.SeekGet( CUtlBuffer::SEEK_HEAD, oldKeys[hOld] - sizeof( int ) );
+		int nCompressed = buf.GetInt();
+		if ( !DecompressPortalBits( buf, nCompressed, pOldBits, nOldBytes ) )
+			continue;
+
+		bool bMapped = true;
+		for ( int j = 0; j < nOldPortals && bMapped; j++ )
+		{
+			if ( !CheckBit( pOldBits, j ) )
+				continue;
+
+			// Everything it saw is in its flood, so it's all still there
+			bMapped = pOldToNew[j] >= 0;
+			if ( bMapped )
+			{
+				SetBit( p->portalvis, pOldToNew[j] );
+			}
+		}
+
+		if ( !bMapped )
+		{
+			memset( p->portalvis, 0, portalbytes );
+			continue;
+		}
+
+		p->status = stat_done;
+		nReused++;
+	}
+
+	free( pOldBits );
+	free( pOldToNew );
+
+	Msg( "reusing the vis of %d of %d portals from %s\n", nReused, nPortals, pFilename );
+	return nReused;
+}
+
+//-----------------------------------------------------------------------------
+// Writes all the portals for the next run, once PortalFlow is done
+//-----------------------------------------------------------------------------
+void SavePortalVisCache( const char *pFilename )
+{
+	int nPortals = g_numportals * 2;
+
+	CUtlBuffer buf;
+	buf.PutInt( VISCACHE_ID );
+	buf.PutInt( nPortals );
+	buf.PutInt( portalbytes );
+	for ( int i = 0; i < nPortals; i++ )
+	{
+		buf.PutInt64( g_PortalIds[i] );
+	}
+
+	CUtlBuffer bits;
+	for ( int i = 0; i < nPortals; i++ )
+	{
+		bits.Clear();
+		CompressPortalBits( portals[i].portalvis, portalbytes, bits );
+		buf.PutInt64( g_PortalKeys[i] );
+		buf.PutInt( bits.TellPut() );
+		buf.Put( bits.Base(), bits.TellPut() );
+	}
+
+	if ( !g_pFileSystem->WriteFile( pFilename, NULL, buf ) )
+	{
+		Warning( "Couldn't write %s\n", pFilename );
+	}
+
+	free( g_PortalIds );
+	free( g_PortalKeys );
+	g_PortalIds = NULL;
+	g_PortalKeys = NULL;
+}
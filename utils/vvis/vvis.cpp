@@ -14,7 +14,9 @@
 #include "pacifier.h"
 #include "vmpi.h"
 #include "mpivis.h"
+#include "distwork.h"
 #include "tier1/strtools.h"
+#include "tier1/checksum_crc.h"
 #include "collisionutils.h"
 #include "tier0/icommandline.h"
 #include "vmpi_tools_shared.h"
@@ -46,6 +48,10 @@ int			portalbytes, portallongs;
 
 bool		fastvis;
 bool		nosort;
+bool		g_bPortalTimes;
+char		g_szPortalTimesFile[1024];
+bool		g_bIncremental;
+char		g_szVisCacheFile[1024];
 
 int			totalvis;
 
@@ -308,7 +314,24 @@ void CalcPortalVis (void)
 	}
 	else 
 	{
-		RunThreadsOnIndividual (g_numportals*2, true, PortalFlow);
+		if ( g_bIncremental && !g_bDistWorker )
+		{
+			LoadPortalVisCache( g_szVisCacheFile );
+		}
+
+		if ( g_bDistWork )
+		{
+			RunDistPortalFlow();
+		}
+		else
+		{
+			RunPortalFlow( g_bPortalTimes ? g_szPortalTimesFile : NULL );
+		}
+
+		if ( g_bIncremental )
+		{
+			SavePortalVisCache( g_szVisCacheFile );
+		}
 	}
 }
 
@@ -472,7 +495,8 @@ void LoadPortals (char *name)
 	leafbytes = ((portalclusters+63)&~63)>>3;
 	leaflongs = leafbytes/sizeof(long);
 	
-	portalbytes = ((g_numportals*2+63)&~63)>>3;
+	// rounded to 128 bits for the SIMD bit vector kernels in flow.cpp
+	portalbytes = ((g_numportals*2+127)&~127)>>3;
 	portallongs = portalbytes/sizeof(long);
 
 // each file portal is split into two memory portals
@@ -947,6 +971,14 @@ int ParseCommandLine( int argc, char **argv )
 			Msg ("nosort = true\n");
 			nosort = true;
 		}
+		else if (!Q_stricmp (argv[i],"-portaltimes"))
+		{
+			g_bPortalTimes = true;
+		}
+		else if (!Q_stricmp (argv[i],"-incremental"))
+		{
+			g_bIncremental = true;
+		}
 		else if (!Q_stricmp (argv[i],"-tmpin"))
 			strcpy (inbase, "/tmp");
 		else if( !Q_stricmp( argv[i], "-low" ) )
@@ -1017,6 +1049,7 @@ void PrintUsage( int argc, char **argv )
 		"  -v (or -verbose): Turn on verbose output (also shows more command\n"
 		"  -fast           : Only do first quick pass on vis calculations.\n"
 		"  -mpi            : Use VMPI to distribute computations.\n"
+		"  -distribute <n> : Run the portal flow on n worker processes on this machine.\n"
 		"  -low            : Run as an idle-priority process.\n"
 		"                    env_fog_controller specifies one.\n"
 		"\n"
@@ -1027,9 +1060,15 @@ void PrintUsage( int argc, char **argv )
 		"  -novconfig      : Don't bring up graphical UI on vproject errors.\n"
 		"  -radius_override: Force a vis radius, regardless of whether an\n"
 		"  -mpi_pw <pw>    : Use a password to choose a specific set of VMPI workers.\n"
+		"  -distlisten     : Also take -distribute workers from other machines.\n"
+		"  -distport <port>: Port to take them on (default: 27800).\n"
+		"  -distworker <host:port> : Work for the vvis -distlisten at host:port.\n"
 		"  -threads        : Control the number of threads vbsp uses (defaults to the #\n"
 		"                    or processors on your machine).\n"
 		"  -nosort         : Don't sort portals (sorting is an optimization).\n"
+		"  -portaltimes    : Write how long each portal took to <mapname>_portaltimes.txt.\n"
+		"  -incremental    : Keep the vis of each portal in <mapname>.vvc and only redo\n"
+		"                    the portals near what changed since the last run.\n"
 		"  -tmpin          : Make portals come from \\tmp\\<mapname>.\n"
 		"  -tmpout         : Make portals come from \\tmp\\<mapname>.\n"
 		"  -trace <start cluster> <end cluster> : Writes a linefile that traces the vis from one cluster to another for debugging map vis.\n"
@@ -1099,6 +1138,8 @@ int RunVVis( int argc, char **argv )
 	// Source is just the mapfile without an extension at this point...
 	V_strncpy( source, mapFile, sizeof( mapFile ) );
 	V_StripExtension( source, source, sizeof( source ) );
+	V_snprintf( g_szPortalTimesFile, sizeof( g_szPortalTimesFile ), "%s_portaltimes.txt", source );
+	V_snprintf( g_szVisCacheFile, sizeof( g_szVisCacheFile ), "%s.vvc", source );
 
 	if (i != argc - 1)
 	{
@@ -1110,7 +1151,7 @@ int RunVVis( int argc, char **argv )
 	start = Plat_FloatTime();
 
 
-	if (!g_bUseMPI)
+	if ( !g_bUseMPI && !g_bDistWorker )
 	{
 		// Setup the logfile.
 		char logFile[512];
@@ -1177,6 +1218,8 @@ int RunVVis( int argc, char **argv )
 
 		visdatasize = vismap_p - dvisdata;
 		Msg ("visdatasize:%i  compressed from %i\n", visdatasize, originalvismapsize*2);
+		// for comparing the output of different vvis builds over a set of maps
+		Msg ("visdata crc:%08x\n", CRC32_ProcessSingleBuffer( dvisdata, visdatasize ));
 
 		Msg ("writing %s\n", mapFile);
 		WriteBSPFile (mapFile);
@@ -1222,6 +1265,7 @@ int main (int argc, char **argv)
 	InstallSpewFunction();
 
 	VVIS_SetupMPI( argc, argv );
+	DistWork_Init( argc, argv );
 
 	// Install an exception handler.
 	if ( g_bUseMPI && !g_bMPIMaster )
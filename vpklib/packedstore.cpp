@@ -13,6 +13,7 @@
 #include "tier1/utldict.h"
 #include "tier2/fileutils.h"
 #include "tier1/utlbuffer.h"
+#include "vstdlib/jobthread.h"
 
 #ifdef VPK_ENABLE_SIGNING
 	#include "crypto.h"
@@ -23,6 +24,13 @@
 #include <windows.h>
 #endif
 
+#ifdef POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 // memdbgon must be the last include file in a .cpp file!!!
 #include "tier0/memdbgon.h"
 
@@ -160,6 +168,9 @@ CFileHeaderFixedData *CPackedStore::FindFileEntry( char const *pDirname, char co
 	if ( pNameBaseOut )
 		*pNameBaseOut = NULL;
 
+	if ( m_pDirectoryIndex )
+		return FindFileEntryInIndex( pDirname, pBaseName, pExtension, pNameBaseOut );
+
 	int nExtensionHash = HashString( pExtension ) % PACKEDFILE_EXT_HASH_SIZE;
 	CFileExtensionData const *pExt = m_pExtensionData[nExtensionHash].FindNamedNodeCaseSensitive( pExtension );
 	if ( pExt )
@@ -193,6 +204,325 @@ CFileHeaderFixedData *CPackedStore::FindFileEntry( char const *pDirname, char co
 }
 
 
+//-----------------------------------------------------------------------------
+// Perfect hash directory index
+//-----------------------------------------------------------------------------
+static uint64 HashDirectoryIndexKey( char const *pExtension, char const *pDirname, char const *pBaseName, uint32 nSeed )
+{
+	char szKey[3 * MAX_PATH];
+	int nLen = 0;
+	char const *pParts[3] = { pExtension, pDirname, pBaseName };
+	for ( int i = 0; i < 3; i++ )
+	{
+		int nPartLen = V_strlen( pParts[i] ) + 1;
+		if ( nLen + nPartLen > (int)sizeof( szKey ) )
+			return 0;
+		memcpy( szKey + nLen, pParts[i], nPartLen );
+		nLen += nPartLen;
+	}
+	// Two 32 bit hashes, MurmurHash64 has full collisions between names this similar
+	return ( (uint64)MurmurHash2( szKey, nLen, nSeed ) << 32 ) | MurmurHash2( szKey, nLen, ~nSeed );
+}
+
+static FORCEINLINE uint32 DirectoryIndexBucket( uint64 nHash, uint32 nBuckets )
+{
+	return (uint32)( nHash >> 32 ) % nBuckets;
+}
+
+static FORCEINLINE uint32 DirectoryIndexSlot( uint64 nHash, int32 nDisplacement, uint32 nEntries )
+{
+	if ( nDisplacement < 0 )
+		return (uint32)( -nDisplacement - 1 );
+
+	// murmur3 finalizer
+	uint64 h = nHash + (uint64)nDisplacement * 0x9e3779b97f4a7c15ull;
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdull;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ull;
+	h ^= h >> 33;
+	return (uint32)( h % nEntries );
+}
+
+CFileHeaderFixedData *CPackedStore::FindFileEntryInIndex( char const *pDirname, char const *pBaseName, char const *pExtension, uint8 **pNameBaseOut )
+{
+	VPKDirIndexHeader_t const *pIndex = reinterpret_cast<VPKDirIndexHeader_t const *>( m_pDirectoryIndex );
+	int32 const *pDisplacements = reinterpret_cast<int32 const *>( pIndex + 1 );
+	VPKDirIndexEntry_t const *pEntries = reinterpret_cast<VPKDirIndexEntry_t const *>( pDisplacements + pIndex->m_nBuckets );
+
+	uint64 nHash = HashDirectoryIndexKey( pExtension, pDirname, pBaseName, pIndex->m_nSeed );
+	uint32 nSlot = DirectoryIndexSlot( nHash, pDisplacements[DirectoryIndexBucket( nHash, pIndex->m_nBuckets )], pIndex->m_nEntries );
+	if ( nSlot >= pIndex->m_nEntries )
+		return NULL;
+
+	// Every key lands on some slot, make sure it's this file
+	VPKDirIndexEntry_t const &entry = pEntries[nSlot];
+	char const *pData = reinterpret_cast<char const *>( DirectoryData() );
+	if ( V_strcmp( pData + entry.m_nNameOffset, pBaseName ) || V_strcmp( pData + entry.m_nDirectoryOffset, pDirname ) ||
+		 V_strcmp( pData + entry.m_nExtensionOffset, pExtension ) )
+		return NULL;
+
+	if ( pNameBaseOut )
+		*pNameBaseOut = (uint8 *)( pData + entry.m_nNameOffset );
+	return ( CFileHeaderFixedData * )( pData + entry.m_nNameOffset + 1 + V_strlen( pBaseName ) );
+}
+
+//-----------------------------------------------------------------------------
+// Looks for an index after the rest of the directory file, and uses it if it
+// was built for this directory. Mapped where possible so it costs no heap.
+//-----------------------------------------------------------------------------
+bool CPackedStore::LoadDirectoryIndex( char const *pszDirFileName, CInputFile &dirFile, int nSectionsEnd )
+{
+	int nFileSize = dirFile.Size();
+	if ( nFileSize - nSectionsEnd < (int)( sizeof( VPKDirIndexHeader_t ) + sizeof( VPKDirIndexFooter_t ) ) )
+		return false;
+
+	VPKDirIndexFooter_t footer;
+	dirFile.Seek( nFileSize - sizeof( footer ) );
+	if ( dirFile.Read( &footer, sizeof( footer ) ) != sizeof( footer ) || footer.m_nMarker != VPK_DIR_INDEX_MARKER )
+		return false;
+
+	int nIndexOffset = nFileSize - (int)sizeof( footer ) - (int)footer.m_nIndexSize;
+	if ( footer.m_nIndexSize < sizeof( VPKDirIndexHeader_t ) || nIndexOffset < nSectionsEnd )
+		return false;
+
+#ifdef POSIX
+	int hFile = open( pszDirFileName, O_RDONLY | O_CLOEXEC );
+	if ( hFile >= 0 )
+	{
+		int nPageOffset = nIndexOffset & ~( (int)sysconf( _SC_PAGESIZE ) - 1 );
+		size_t nMapSize = nIndexOffset - nPageOffset + footer.m_nIndexSize;
+		void *pMapping = mmap( NULL, nMapSize, PROT_READ, MAP_SHARED, hFile, nPageOffset );
+		if ( pMapping != MAP_FAILED )
+		{
+			m_pDirectoryIndexMapping = pMapping;
+			m_nDirectoryIndexMappingSize = nMapSize;
+			m_pDirectoryIndex = (uint8 const *)pMapping + ( nIndexOffset - nPageOffset );
+		}
+		close( hFile );
+	}
+#endif
+	if ( !m_pDirectoryIndex )
+	{
+		m_DirectoryIndexData.SetCount( footer.m_nIndexSize );
+		dirFile.Seek( nIndexOffset );
+		if ( dirFile.Read( m_DirectoryIndexData.Base(), footer.m_nIndexSize ) != (int)footer.m_nIndexSize )
+		{
+			m_DirectoryIndexData.Purge();
+			return false;
+		}
+		m_pDirectoryIndex = m_DirectoryIndexData.Base();
+	}
+
+	VPKDirIndexHeader_t const *pIndex = reinterpret_cast<VPKDirIndexHeader_t const *>( m_pDirectoryIndex );
+	bool bValid = pIndex->m_nMarker == VPK_DIR_INDEX_MARKER && pIndex->m_nVersion == VPK_DIR_INDEX_VERSION &&
+		pIndex->m_nEntries && pIndex->m_nBuckets &&
+		(uint64)sizeof( VPKDirIndexHeader_t ) + pIndex->m_nBuckets * (uint64)sizeof( int32 ) + pIndex->m_nEntries * (uint64)sizeof( VPKDirIndexEntry_t ) == footer.m_nIndexSize &&
+		pIndex->m_nDirectorySize == (uint32)m_DirectoryData.Count() &&
+		pIndex->m_nDirectoryHash == MurmurHash2( DirectoryData(), m_DirectoryData.Count(), 0 );
+
+	if ( bValid )
+	{
+		// Offsets are compared against names in the directory, keep them inside it
+		int32 const *pDisplacements = reinterpret_cast<int32 const *>( pIndex + 1 );
+		VPKDirIndexEntry_t const *pEntries = reinterpret_cast<VPKDirIndexEntry_t const *>( pDisplacements + pIndex->m_nBuckets );
+		for ( uint32 i = 0; bValid && i < pIndex->m_nEntries; i++ )
+		{
+			bValid = pEntries[i].m_nExtensionOffset < pIndex->m_nDirectorySize && pEntries[i].m_nDirectoryOffset < pIndex->m_nDirectorySize &&
+				pEntries[i].m_nNameOffset < pIndex->m_nDirectorySize;
+		}
+	}
+
+	if ( !bValid )
+	{
+		DiscardDirectoryIndex();
+		return false;
+	}
+
+	m_nHighestChunkFileIndex = pIndex->m_nHighestChunkFileIndex;
+	return true;
+}
+
+void CPackedStore::DiscardDirectoryIndex( void )
+{
+#ifdef POSIX
+	if ( m_pDirectoryIndexMapping )
+	{
+		munmap( m_pDirectoryIndexMapping, m_nDirectoryIndexMappingSize );
+	}
+#endif
+	m_pDirectoryIndexMapping = NULL;
+	m_nDirectoryIndexMappingSize = 0;
+	m_DirectoryIndexData.Purge();
+	m_pDirectoryIndex = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Builds the index with hash and displace: buckets are placed largest first,
+// each trying displacements until all its files land in free slots, and the
+// single file buckets left over take the remaining slots directly.
+//-----------------------------------------------------------------------------
+void CPackedStore::WriteDirectoryIndex( CUtlBuffer &buf )
+{
+	CUtlVector<VPKDirIndexEntry_t> entries;
+	int nHighestChunkFileIndex = -1;
+	char const *pDirData = reinterpret_cast<char const *>( DirectoryData() );
+	char const *pData = pDirData;
+	while ( *pData )
+	{
+		uint32 nExtensionOffset = pData - pDirData;
+		pData += 1 + V_strlen( pData );
+		while ( *pData )
+		{
+			uint32 nDirectoryOffset = pData - pDirData;
+			pData += 1 + V_strlen( pData );
+			while ( *pData )
+			{
+				VPKDirIndexEntry_t &entry = entries[entries.AddToTail()];
+				entry.m_nExtensionOffset = nExtensionOffset;
+				entry.m_nDirectoryOffset = nDirectoryOffset;
+				entry.m_nNameOffset = pData - pDirData;
+				int nSkipIndex = SkipFile( pData );
+				nHighestChunkFileIndex = MAX( nHighestChunkFileIndex, nSkipIndex );
+			}
+			pData++;
+		}
+		pData++;
+	}
+
+	uint32 nEntries = entries.Count();
+	if ( !nEntries )
+		return;
+
+	uint32 nBuckets = nEntries;
+	CUtlVector<uint64> hashes;
+	CUtlVector<int32> displacements;
+	CUtlVector<uint32> bucketStart;		// files sorted by bucket, bucket b is [bucketStart[b], bucketStart[b+1])
+	CUtlVector<uint32> sortedFiles;
+	CUtlVector<uint32> bucketOrder;
+	CUtlVector<uint32> slotFiles;		// file in each slot, ~0 if free
+	hashes.SetCount( nEntries );
+	displacements.SetCount( nBuckets );
+	bucketStart.SetCount( nBuckets + 1 );
+	sortedFiles.SetCount( nEntries );
+	slotFiles.SetCount( nEntries );
+
+	uint32 nSeed;
+	for ( nSeed = 0; nSeed < 16; nSeed++ )
+	{
+		for ( uint32 i = 0; i < nEntries; i++ )
+		{
+			hashes[i] = HashDirectoryIndexKey( pDirData + entries[i].m_nExtensionOffset, pDirData + entries[i].m_nDirectoryOffset, pDirData + entries[i].m_nNameOffset, nSeed );
+		}
+
+		// Counting sort of the files by bucket
+		memset( bucketStart.Base(), 0, bucketStart.Count() * sizeof( uint32 ) );
+		uint32 nLargestBucket = 0;
+		for ( uint32 i = 0; i < nEntries; i++ )
+		{
+			uint32 nBucketSize = ++bucketStart[DirectoryIndexBucket( hashes[i], nBuckets ) + 1];
+			nLargestBucket = MAX( nLargestBucket, nBucketSize );
+		}
+		for ( uint32 b = 0; b < nBuckets; b++ )
+		{
+			bucketStart[b + 1] += bucketStart[b];
+		}
+		CUtlVector<uint32> fill;
+		fill.CopyArray( bucketStart.Base(), nBuckets );
+		for ( uint32 i = 0; i < nEntries; i++ )
+		{
+			sortedFiles[fill[DirectoryIndexBucket( hashes[i], nBuckets )]++] = i;
+		}
+
+		// Largest buckets first
+		CUtlVector< CUtlVector<uint32> > bucketsBySize;
+		bucketsBySize.SetCount( nLargestBucket + 1 );
+		for ( uint32 b = 0; b < nBuckets; b++ )
+		{
+			bucketsBySize[bucketStart[b + 1] - bucketStart[b]].AddToTail( b );
+		}
+
+		memset( slotFiles.Base(), 0xff, slotFiles.Count() * sizeof( uint32 ) );
+		memset( displacements.Base(), 0, displacements.Count() * sizeof( int32 ) );
+		bool bPlaced = true;
+		uint32 nNextFreeSlot = 0;
+		for ( uint32 nSize = nLargestBucket; bPlaced && nSize > 0; nSize-- )
+		{
+			for ( int k = 0; bPlaced && k < bucketsBySize[nSize].Count(); k++ )
+			{
+				uint32 b = bucketsBySize[nSize][k];
+				uint32 const *pFiles = &sortedFiles[bucketStart[b]];
+				if ( nSize == 1 )
+				{
+					while ( slotFiles[nNextFreeSlot] != ~0u )
+					{
+						nNextFreeSlot++;
+					}
+					slotFiles[nNextFreeSlot] = pFiles[0];
+					displacements[b] = -(int32)nNextFreeSlot - 1;
+					continue;
+				}
+
+				int32 nDisplacement;
+				for ( nDisplacement = 0; nDisplacement < ( 1 << 20 ); nDisplacement++ )
+				{
+					uint32 i;
+					for ( i = 0; i < nSize; i++ )
+					{
+						uint32 nSlot = DirectoryIndexSlot( hashes[pFiles[i]], nDisplacement, nEntries );
+						if ( slotFiles[nSlot] != ~0u )
+							break;
+						slotFiles[nSlot] = pFiles[i];
+					}
+					if ( i == nSize )
+						break;
+
+					// Collided, release what this attempt took
+					while ( i-- > 0 )
+					{
+						slotFiles[DirectoryIndexSlot( hashes[pFiles[i]], nDisplacement, nEntries )] = ~0u;
+					}
+				}
+				displacements[b] = nDisplacement;
+				bPlaced = nDisplacement < ( 1 << 20 );
+			}
+		}
+
+		// Two names with the same hash never separate, try another seed
+		if ( bPlaced )
+			break;
+	}
+
+	// Only if the directory has the same file twice, which the tables cope with
+	if ( nSeed == 16 )
+	{
+		Warning( "Couldn't build a directory index for %s\n", m_pszFileBaseName );
+		return;
+	}
+
+	VPKDirIndexHeader_t header;
+	header.m_nMarker = VPK_DIR_INDEX_MARKER;
+	header.m_nVersion = VPK_DIR_INDEX_VERSION;
+	header.m_nDirectorySize = m_DirectoryData.Count();
+	header.m_nDirectoryHash = MurmurHash2( DirectoryData(), m_DirectoryData.Count(), 0 );
+	header.m_nSeed = nSeed;
+	header.m_nBuckets = nBuckets;
+	header.m_nEntries = nEntries;
+	header.m_nHighestChunkFileIndex = nHighestChunkFileIndex;
+
+	VPKDirIndexFooter_t footer;
+	footer.m_nIndexSize = sizeof( header ) + nBuckets * sizeof( int32 ) + nEntries * sizeof( VPKDirIndexEntry_t );
+	footer.m_nMarker = VPK_DIR_INDEX_MARKER;
+
+	buf.Put( &header, sizeof( header ) );
+	buf.Put( displacements.Base(), nBuckets * sizeof( int32 ) );
+	for ( uint32 nSlot = 0; nSlot < nEntries; nSlot++ )
+	{
+		buf.Put( &entries[slotFiles[nSlot]], sizeof( VPKDirIndexEntry_t ) );
+	}
+	buf.Put( &footer, sizeof( footer ) );
+}
+
 const void *CFileHeaderFixedData::MetaData( void ) const
 {
 	if ( ! m_nMetaDataSize )
@@ -217,6 +547,11 @@ void CPackedStore::Init( void )
 	memset( m_pExtensionData, 0, sizeof( m_pExtensionData ) );
 	m_nDirectoryDataSize = 0;
 	m_nWriteChunkSize = k_nVPKDefaultChunkSize;
+	m_bMapDataFiles = false;
+	m_bWriteDirectoryIndex = true;
+	m_pDirectoryIndex = NULL;
+	m_pDirectoryIndexMapping = NULL;
+	m_nDirectoryIndexMappingSize = 0;
 
 	m_nSizeOfSignedData = 0;
 	m_Signature.Purge();
@@ -226,6 +561,9 @@ void CPackedStore::Init( void )
    
 void CPackedStore::BuildHashTables( void )
 {
+	// The directory changed, or there was no usable index
+	DiscardDirectoryIndex();
+
 	m_nHighestChunkFileIndex = -1;
 	for( int i = 0; i < ARRAYSIZE( m_pExtensionData ) ; i++ )
 	{
@@ -422,13 +760,22 @@ CPackedStore::CPackedStore( char const *pFileBasename, char *pszFName, IBaseFile
 				m_Signature.SetCount( cubSignature );
 				dirFile.MustRead( m_Signature.Base(), cubSignature );
 			}
+
+			// Writers rebuild the directory and the index with it
+			if ( bNewFileFormat && !bOpenForWrite )
+			{
+				LoadDirectoryIndex( pszFName, dirFile, nSizeOfHeader + dirHeader.ComputeSizeofSignedDataAfterHeader() + dirHeader.m_nSignatureSize );
+			}
 		}
 		Q_MakeAbsolutePath( m_pszFullPathName, sizeof( m_pszFullPathName ), m_pszFileBaseName );
 		V_strcat_safe( m_pszFullPathName, ".vpk" );
 		//Q_strlower( m_pszFullPathName ); // NO!  this screws up linux.
 		Q_FixSlashes( m_pszFullPathName );
 	}
-	BuildHashTables();
+	if ( !m_pDirectoryIndex )
+	{
+		BuildHashTables();
+	}
 }
 
 
@@ -470,8 +817,16 @@ CPackedStore::~CPackedStore( void )
 #endif
 
 		}
+#ifdef POSIX
+		if ( m_FileHandles[i].m_pMappedData )
+		{
+			munmap( (void *)m_FileHandles[i].m_pMappedData, m_FileHandles[i].m_nMappedSize );
+		}
+#endif
 	}
 
+	DiscardDirectoryIndex();
+
 	// Free the FindFirst cache data
 	m_directoryList.PurgeAndDeleteElementsArray();
 
@@ -736,6 +1091,12 @@ void CPackedStore::Write( void )
 		}
 	#endif
 
+	// The index goes last, outside the signed data, for readers that look for it
+	if ( m_bWriteDirectoryIndex )
+	{
+		WriteDirectoryIndex( bufDirFile );
+	}
+
 	char szOutFileName[MAX_PATH];
 
 	// Delete any existing header file, either the standalone kind,
@@ -1173,18 +1534,20 @@ int CPackedStore::ReadData( CPackedStoreFileHandle &handle, void *pOutData, int
 			handle.m_nCurrentFileOffset += nNumMetaDataBytes;
 			nNumBytes -= nNumMetaDataBytes;
 		}
-		// satisfy remaining bytes from file
-		if ( nNumBytes > 0 )
+		// satisfy remaining bytes from file, straight from memory if it's mapped
+		const void *pMapped = ( nNumBytes > 0 && m_bMapDataFiles ) ? GetDataPointer( handle, handle.m_nCurrentFileOffset, nNumBytes ) : NULL;
+		if ( pMapped )
+		{
+			memcpy( pOutData, pMapped, nNumBytes );
+			nRet += nNumBytes;
+			handle.m_nCurrentFileOffset += nNumBytes;
+		}
+		else if ( nNumBytes > 0 )
 		{
 			FileHandleTracker_t &fHandle = GetFileHandle( handle.m_nFileNumber );
-			int nDesiredPos = handle.m_nFileOffset + handle.m_nCurrentFileOffset - handle.m_nMetaDataSize;
+			int nDesiredPos = (int)GetDataFileOffset( handle, handle.m_nCurrentFileOffset );
 			int nRead;
 			fHandle.m_Mutex.Lock();
-			if ( handle.m_nFileNumber == VPKFILENUMBER_EMBEDDED_IN_DIR_FILE )
-			{
-				// for file data in the directory header, all offsets are relative to the size of the dir header.
-				nDesiredPos += m_nDirectoryDataSize + sizeof( VPKDirHeader_t );
-			}
 
 			if ( m_PackedStoreReadCache.BCanSatisfyFromReadCache( (uint8 *)pOutData, handle, fHandle, nDesiredPos, nNumBytes, nRead ) )
 			{
@@ -1212,6 +1575,94 @@ int CPackedStore::ReadData( CPackedStoreFileHandle &handle, void *pOutData, int
 	return nRet;
 }
 
+bool CPackedStore::GetDataFileRange( CPackedStoreFileHandle &handle, int nOffset, PackDataFileHandle_t &hDataFile, int64 &nDataFileOffset )
+{
+	if ( nOffset < handle.m_nMetaDataSize )
+		return false;
+
+	FileHandleTracker_t &fHandle = GetFileHandle( handle.m_nFileNumber );
+	if ( fHandle.m_nFileNumber != handle.m_nFileNumber )
+		return false;
+
+	nDataFileOffset = GetDataFileOffset( handle, nOffset );
+	hDataFile = fHandle.m_hFileHandle;
+	return true;
+}
+
+int64 CPackedStore::GetDataFileOffset( CPackedStoreFileHandle &handle, int nOffset ) const
+{
+	int64 nDataFileOffset = handle.m_nFileOffset + nOffset - handle.m_nMetaDataSize;
+	if ( handle.m_nFileNumber == VPKFILENUMBER_EMBEDDED_IN_DIR_FILE )
+	{
+		// for file data in the directory header, all offsets are relative to the size of the dir header.
+		nDataFileOffset += m_nDirectoryDataSize + sizeof( VPKDirHeader_t );
+	}
+	return nDataFileOffset;
+}
+
+const void *CPackedStore::GetDataPointer( CPackedStoreFileHandle &handle, int nOffset, int nNumBytes )
+{
+	if ( nOffset < 0 || nNumBytes < 0 || nOffset + nNumBytes > handle.m_nFileSize )
+		return NULL;
+
+	// All in the preload bytes
+	if ( nOffset + nNumBytes <= handle.m_nMetaDataSize )
+		return reinterpret_cast<uint8 const *>( handle.m_pMetaData ) + nOffset;
+
+	if ( nOffset < handle.m_nMetaDataSize || !m_bMapDataFiles )
+		return NULL;
+
+	FileHandleTracker_t &fHandle = GetFileHandle( handle.m_nFileNumber );
+	if ( fHandle.m_nFileNumber != handle.m_nFileNumber )
+		return NULL;
+
+	const uint8 *pMapped = GetMappedDataFile( fHandle );
+	int64 nDataFileOffset = GetDataFileOffset( handle, nOffset );
+	if ( !pMapped || nDataFileOffset + nNumBytes > fHandle.m_nMappedSize )
+		return NULL;
+
+	return pMapped + nDataFileOffset;
+}
+
+//-----------------------------------------------------------------------------
+// Maps the whole data file the first time it's asked for. The mapping is
+// shared and read only, and stays until the store is destroyed; bytes
+// appended to the file afterwards are read the normal way.
+//-----------------------------------------------------------------------------
+const uint8 *CPackedStore::GetMappedDataFile( FileHandleTracker_t &fHandle )
+{
+	const uint8 *pMapped = fHandle.m_pMappedData;
+	if ( pMapped || fHandle.m_bMapAttempted )
+		return pMapped;
+
+	AUTO_LOCK( fHandle.m_Mutex );
+	if ( fHandle.m_bMapAttempted )
+		return fHandle.m_pMappedData;
+
+#ifdef POSIX
+	char szDataFileName[MAX_PATH];
+	GetDataFileName( szDataFileName, sizeof( szDataFileName ), fHandle.m_nFileNumber );
+	int hFile = open( szDataFileName, O_RDONLY | O_CLOEXEC );
+	if ( hFile >= 0 )
+	{
+		struct stat st;
+		if ( fstat( hFile, &st ) == 0 && st.st_size > 0 )
+		{
+			void *pData = mmap( NULL, st.st_size, PROT_READ, MAP_SHARED, hFile, 0 );
+			if ( pData != MAP_FAILED )
+			{
+				fHandle.m_nMappedSize = st.st_size;
+				ThreadMemoryBarrier();
+				fHandle.m_pMappedData = (const uint8 *)pData;
+			}
+		}
+		close( hFile );
+	}
+#endif
+	fHandle.m_bMapAttempted = true;
+	return fHandle.m_pMappedData;
+}
+
 bool CPackedStore::HashEntirePackFile( CPackedStoreFileHandle &handle, int64 &nFileSize, int nFileFraction, int nFractionSize, FileHash_t &fileHash )
 {
 #define	CRC_CHUNK_SIZE	(32*1024)
@@ -1302,44 +1753,104 @@ void CPackedStore::DiscardChunkHashes( int iChunkFileIndex )
 	}
 }
 
+static const int k_nFileFractionSize = 0x00100000; // 1 MB
+
+// Adds the fractions a chunk file of this size is hashed in, there's always at least one
+static int AddChunkFractions( int nPackFileNumber, int64 nFileSize, CUtlVector<ChunkHashFraction_t> &fractions )
+{
+	int nAdded = 0;
+	for ( int64 nFileFraction = 0; nFileFraction <= nFileSize; nFileFraction += k_nFileFractionSize )
+	{
+		ChunkHashFraction_t &fraction = fractions[fractions.AddToTail()];
+		fraction.m_nPackFileNumber = nPackFileNumber;
+		fraction.m_nFileFraction = (int)nFileFraction;
+		fraction.m_cbChunkLen = (int)MIN( nFileSize - nFileFraction, (int64)k_nFileFractionSize );
+		nAdded++;
+	}
+	return nAdded;
+}
+
+//-----------------------------------------------------------------------------
+// Hashes one fraction through its own file handle, so fractions can be
+// hashed on any thread without the store's locks
+//-----------------------------------------------------------------------------
+void CPackedStore::HashChunkFraction( ChunkHashFraction_t &fraction )
+{
+	unsigned char tempBuf[CRC_CHUNK_SIZE];
+
+	MD5Context_t ctx;
+	memset( &ctx, 0, sizeof( MD5Context_t ) );
+	MD5Init( &ctx );
+
+	char szDataFileName[MAX_PATH];
+	GetDataFileName( szDataFileName, sizeof( szDataFileName ), fraction.m_nPackFileNumber );
+	FileHandle_t hFile = m_pFileSystem->Open( szDataFileName, "rb" );
+	if ( hFile != FILESYSTEM_INVALID_HANDLE )
+	{
+		m_pFileSystem->Seek( hFile, fraction.m_nFileFraction, FILESYSTEM_SEEK_HEAD );
+		int nRemaining = fraction.m_cbChunkLen;
+		while ( nRemaining > 0 )
+		{
+			int nRead = m_pFileSystem->Read( tempBuf, MIN( nRemaining, CRC_CHUNK_SIZE ), hFile );
+			if ( nRead <= 0 )
+				break;
+			MD5Update( &ctx, tempBuf, nRead );
+			nRemaining -= nRead;
+		}
+		m_pFileSystem->Close( hFile );
+	}
+	MD5Final( fraction.m_md5contents.bits, &ctx );
+}
+
+void CPackedStore::HashChunkFractions( CUtlVector<ChunkHashFraction_t> &fractions )
+{
+	// Reads of different fractions overlap fine on anything but a single
+	// spinning disk, and MD5 is what takes the time once they're cached
+	int nThreads = MIN( MIN( (int)GetCPUInformation()->m_nLogicalProcessors, 8 ), fractions.Count() ) - 1;
+	IThreadPool *pPool = NULL;
+	if ( nThreads > 0 )
+	{
+		pPool = CreateThreadPool();
+		ThreadPoolStartParams_t params;
+		params.nThreads = nThreads;
+		pPool->Start( params, "VPKHash" );
+	}
+
+	CParallelProcessor<ChunkHashFraction_t, CMemberFuncJobItemProcessor<ChunkHashFraction_t, CPackedStore, CPackedStore> > processor( "HashChunkFractions" );
+	processor.m_ItemProcessor.Init( this, &CPackedStore::HashChunkFraction );
+	processor.Run( fractions.Base(), fractions.Count(), INT_MAX, pPool );
+
+	if ( pPool )
+	{
+		pPool->Stop();
+		DestroyThreadPool( pPool );
+	}
+}
+
 void CPackedStore::HashChunkFile( int iChunkFileIndex )
 {
 	AUTO_LOCK( m_Mutex );
-	static const int k_nFileFractionSize = 0x00100000; // 1 MB
 
 	// Purge any hashes we already have for this chunk.
 	DiscardChunkHashes( iChunkFileIndex );
 
-	CPackedStoreFileHandle VPKHandle = GetHandleForHashingFiles();
-	VPKHandle.m_nFileNumber = iChunkFileIndex;
-
-	int nFileFraction = 0;
-	while ( 1 )
-	{
-		FileHash_t filehash;
-
-		// VPKHandle.m_nFileNumber;
-		// nFileFraction;
-		int64 fileSize = 0;
-		// if we have never hashed this before - do it now
-		HashEntirePackFile( VPKHandle, fileSize, nFileFraction, k_nFileFractionSize, filehash );
-		ChunkHashFraction_t fileHashFraction;
-		fileHashFraction.m_cbChunkLen = filehash.m_cbFileLen;
-		fileHashFraction.m_nPackFileNumber = VPKHandle.m_nFileNumber;
-		fileHashFraction.m_nFileFraction = nFileFraction;
-		Q_memcpy( fileHashFraction.m_md5contents.bits, filehash.m_md5contents.bits, sizeof(fileHashFraction.m_md5contents) );
-		m_vecChunkHashFraction.Insert( fileHashFraction );
-		// move to next section
-		nFileFraction += k_nFileFractionSize;
-		// if we are at EOF we are done
-		if ( nFileFraction > fileSize )
-			break;
+	char szDataFileName[MAX_PATH];
+	GetDataFileName( szDataFileName, sizeof( szDataFileName ), iChunkFileIndex );
+
+	CUtlVector<ChunkHashFraction_t> fractions;
+	AddChunkFractions( iChunkFileIndex, m_pFileSystem->Size( szDataFileName ), fractions );
+	HashChunkFractions( fractions );
+	FOR_EACH_VEC( fractions, i )
+	{
+		m_vecChunkHashFraction.Insert( fractions[i] );
 	}
 }
 
 
-void CPackedStore::HashAllChunkFiles()
+int CPackedStore::HashAllChunkFiles( const char *pszHashCacheFile, const char *pszHashCachePathID )
 {
+	AUTO_LOCK( m_Mutex );
+
 	// Rebuild the directory hash tables.  The main reason to do this is
 	// so that the highest chunk number is correct, in case chunks have
 	// been removed.
@@ -1347,8 +1858,96 @@ void CPackedStore::HashAllChunkFiles()
 
 	// make brand new hashes
 	m_vecChunkHashFraction.Purge();
+
+	// Hashes kept from last time, with where each chunk's start in cachedFractions
+	CUtlVector<VPKHashCacheChunk_t> cachedChunks;
+	CUtlVector<int> cachedFirstFraction;
+	CUtlVector<ChunkHashFraction_t> cachedFractions;
+	CUtlBuffer cacheIn;
+	if ( pszHashCacheFile && m_pFileSystem->ReadFile( pszHashCacheFile, pszHashCachePathID, cacheIn ) && cacheIn.GetBytesRemaining() >= (int)sizeof( VPKHashCacheHeader_t ) )
+	{
+		VPKHashCacheHeader_t header;
+		cacheIn.Get( &header, sizeof( header ) );
+		for ( int i = 0; header.m_nMarker == VPK_HASH_CACHE_MARKER && header.m_nVersion == VPK_HASH_CACHE_VERSION && i < header.m_nChunks; i++ )
+		{
+			VPKHashCacheChunk_t chunk;
+			if ( cacheIn.GetBytesRemaining() < (int)sizeof( chunk ) )
+				break;
+			cacheIn.Get( &chunk, sizeof( chunk ) );
+			if ( chunk.m_nFractions < 0 || cacheIn.GetBytesRemaining() < chunk.m_nFractions * (int)sizeof( ChunkHashFraction_t ) )
+				break;
+
+			cachedChunks.AddToTail( chunk );
+			cachedFirstFraction.AddToTail( cachedFractions.AddMultipleToTail( chunk.m_nFractions ) );
+			cacheIn.Get( cachedFractions.Base() + cachedFirstFraction.Tail(), chunk.m_nFractions * sizeof( ChunkHashFraction_t ) );
+		}
+	}
+
+	CUtlVector<VPKHashCacheChunk_t> chunks;
+	CUtlVector<ChunkHashFraction_t> fractions;
+	CUtlVector<ChunkHashFraction_t> reused;
+	int nHashedChunks = 0;
 	for ( int iChunkFileIndex = 0 ; iChunkFileIndex <= GetHighestChunkFileIndex() ; ++iChunkFileIndex )
-		HashChunkFile( iChunkFileIndex );
+	{
+		char szDataFileName[MAX_PATH];
+		GetDataFileName( szDataFileName, sizeof( szDataFileName ), iChunkFileIndex );
+
+		VPKHashCacheChunk_t &chunk = chunks[chunks.AddToTail()];
+		chunk.m_nPackFileNumber = iChunkFileIndex;
+		chunk.m_nFileSize = m_pFileSystem->Size( szDataFileName );
+		chunk.m_nFileTime = m_pFileSystem->GetFileTime( szDataFileName );
+		chunk.m_nFractions = 0;
+
+		// Without a time there's nothing to tell a rewritten file by
+		FOR_EACH_VEC( cachedChunks, i )
+		{
+			const VPKHashCacheChunk_t &cached = cachedChunks[i];
+			if ( chunk.m_nFileTime && cached.m_nPackFileNumber == iChunkFileIndex && cached.m_nFileSize == chunk.m_nFileSize && cached.m_nFileTime == chunk.m_nFileTime )
+			{
+				reused.AddMultipleToTail( cached.m_nFractions, cachedFractions.Base() + cachedFirstFraction[i] );
+				chunk.m_nFractions = cached.m_nFractions;
+				break;
+			}
+		}
+
+		if ( !chunk.m_nFractions )
+		{
+			chunk.m_nFractions = AddChunkFractions( iChunkFileIndex, chunk.m_nFileSize, fractions );
+			nHashedChunks++;
+		}
+	}
+
+	HashChunkFractions( fractions );
+	FOR_EACH_VEC( reused, i )
+	{
+		m_vecChunkHashFraction.Insert( reused[i] );
+	}
+	FOR_EACH_VEC( fractions, i )
+	{
+		m_vecChunkHashFraction.Insert( fractions[i] );
+	}
+
+	if ( pszHashCacheFile && nHashedChunks )
+	{
+		CUtlBuffer cacheOut;
+		VPKHashCacheHeader_t header;
+		header.m_nMarker = VPK_HASH_CACHE_MARKER;
+		header.m_nVersion = VPK_HASH_CACHE_VERSION;
+		header.m_nChunks = chunks.Count();
+		cacheOut.Put( &header, sizeof( header ) );
+
+		// m_vecChunkHashFraction is sorted by chunk, then fraction
+		int iFraction = 0;
+		FOR_EACH_VEC( chunks, i )
+		{
+			cacheOut.Put( &chunks[i], sizeof( chunks[i] ) );
+			cacheOut.Put( &m_vecChunkHashFraction[iFraction], chunks[i].m_nFractions * sizeof( ChunkHashFraction_t ) );
+			iFraction += chunks[i].m_nFractions;
+		}
+		m_pFileSystem->WriteFile( pszHashCacheFile, pszHashCachePathID, cacheOut );
+	}
+
+	return nHashedChunks;
 }
 
 void CPackedStore::ComputeDirectoryHash( MD5Value_t &md5Directory )
@@ -1506,6 +2105,12 @@ void CPackedStore::AddFileToDirectory( const VPKContentFileInfo_t &info )
 	// the file part at the right place. If everything is present, we just need to return the
 	// current record
 
+	// The inserts below walk the hash tables, which aren't built while an index is in use
+	if ( m_pDirectoryIndex )
+	{
+		BuildHashTables();
+	}
+
 	// First, remove it if it's already there,
 	// without rebuilding the hash tables
 	InternalRemoveFileFromDirectory( info.m_sName );
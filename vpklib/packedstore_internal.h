@@ -55,6 +55,64 @@ struct VPKDirHeaderOld_t
 };
 
 
+// Optional minimal perfect hash index of the directory, written after
+// everything else in the directory file so readers that don't know about it
+// never look at it. A VPKDirIndexFooter_t at the very end of the file gives
+// its size. Entries are found with one hash of "ext\0dir\0name\0": the high
+// half picks a bucket, whose displacement either is the slot (-slot - 1) or
+// is mixed back into the hash to get it. A slot names the file's strings in
+// the directory data, which are compared before the entry is trusted.
+#define VPK_DIR_INDEX_MARKER 0x55aa5678
+#define VPK_DIR_INDEX_VERSION 1
+
+struct VPKDirIndexHeader_t
+{
+	uint32 m_nMarker;
+	uint32 m_nVersion;
+	uint32 m_nDirectorySize;								// the directory it was built for
+	uint32 m_nDirectoryHash;								// MurmurHash2 of it
+	uint32 m_nSeed;
+	uint32 m_nBuckets;
+	uint32 m_nEntries;
+	int32 m_nHighestChunkFileIndex;
+	// int32 m_nDisplacements[m_nBuckets];
+	// VPKDirIndexEntry_t m_Entries[m_nEntries];
+};
+
+struct VPKDirIndexEntry_t
+{
+	uint32 m_nExtensionOffset;								// offsets into the directory data
+	uint32 m_nDirectoryOffset;
+	uint32 m_nNameOffset;
+};
+
+struct VPKDirIndexFooter_t
+{
+	uint32 m_nIndexSize;									// header, displacements and entries
+	uint32 m_nMarker;
+};
+
+// Chunk file hashes kept between runs by CPackedStore::HashAllChunkFiles().
+// The header is followed by a VPKHashCacheChunk_t for each chunk file, each
+// followed by its m_nFractions ChunkHashFraction_t's.
+#define VPK_HASH_CACHE_MARKER 0x55aa9abc
+#define VPK_HASH_CACHE_VERSION 1
+
+struct VPKHashCacheHeader_t
+{
+	uint32 m_nMarker;
+	uint32 m_nVersion;
+	int32 m_nChunks;
+};
+
+struct VPKHashCacheChunk_t
+{
+	int32 m_nPackFileNumber;
+	int32 m_nFractions;
+	int64 m_nFileSize;										// the hashes are reused while these match
+	int64 m_nFileTime;
+};
+
 #include "vpklib/packedstore.h"
 
 
@@ -14,6 +14,7 @@
 #include "tier1/utlmap.h"
 #include "tier1/utlstring.h"
 #include "tier1/fmtstr.h"
+#include "tier1/utlstringindexmt.h"
 
 // memdbgon must be the last include file in a .cpp file!!!
 #include <tier0/memdbgon.h>
@@ -22,10 +23,15 @@
 #define KEYVALUES_USE_POOL 1
 #endif
 
+// symbols are offsets into the string stack, so they need enough bits to address all of it
+#define KEYVALUES_STRING_SPACE		( 4*1024*1024 )
+#define KEYVALUES_SYMBOL_BITS		24
+COMPILE_TIME_ASSERT( KEYVALUES_STRING_SPACE < ( 1 << KEYVALUES_SYMBOL_BITS ) );
+
 //-----------------------------------------------------------------------------
 // Purpose: Central storage point for KeyValues memory and symbols
 //-----------------------------------------------------------------------------
-class CKeyValuesSystem : public IKeyValuesSystem
+class CKeyValuesSystem : public IKeyValuesSystem, private IUtlStringIndexStorage
 {
 public:
 	CKeyValuesSystem();
@@ -64,16 +70,16 @@ private:
 #endif
 	int m_iMaxKeyValuesSize;
 
-	// string hash table
+	// string storage; symbols are offsets into this
 	CMemoryStack m_Strings;
-	struct hash_item_t
-	{
-		intp stringIndex;
-		hash_item_t *next;
-	};
-	CUtlMemoryPool m_HashItemMemPool;
-	CUtlVector<hash_item_t> m_HashTable;
-	int CaseInsensitiveHash(const char *string, int iBounds);
+	CThreadFastMutex m_StringsMutex;
+
+	// IUtlStringIndexStorage
+	virtual const char *GetIndexedString( uint32 nValue ) const;
+	virtual uint32 AddIndexedString( const char *pString );
+
+	// case-insensitive string -> symbol lookup, lock-free for existing strings
+	CUtlStringIndexMT m_SymbolIndex;
 
 	void DoInvalidateCache();
 
@@ -88,8 +94,6 @@ private:
 	}
 	CUtlRBTree<MemoryLeakTracker_t, int> m_KeyValuesTrackingList;
 
-	CThreadFastMutex m_mutex;
-
 	CUtlMap<CUtlString, KeyValues*> m_KeyValueCache;
 };
 
@@ -109,21 +113,14 @@ IKeyValuesSystem *KeyValuesSystem()
 // Purpose: Constructor
 //-----------------------------------------------------------------------------
 CKeyValuesSystem::CKeyValuesSystem()
-: m_HashItemMemPool(sizeof(hash_item_t), 64, CUtlMemoryPool::GROW_FAST, "CKeyValuesSystem::m_HashItemMemPool")
+: m_SymbolIndex( this, KEYVALUES_SYMBOL_BITS, true, 2048 )
 , m_KeyValuesTrackingList(0, 0, MemoryLeakTrackerLessFunc)
 , m_KeyValueCache( UtlStringLessFunc )
 {
-	// initialize hash table
-	m_HashTable.AddMultipleToTail(2047);
-	for (int i = 0; i < m_HashTable.Count(); i++)
-	{
-		m_HashTable[i].stringIndex = 0;
-		m_HashTable[i].next = NULL;
-	}
+	m_Strings.Init( KEYVALUES_STRING_SPACE, 64*1024, 0, 4 );
 
-	m_Strings.Init( 4*1024*1024, 64*1024, 0, 4 );
-	char *pszEmpty = ((char *)m_Strings.Alloc(1));
-	*pszEmpty = 0;
+	// the empty string is always symbol 0
+	m_SymbolIndex.FindOrAdd( "" );
 
 #ifdef KEYVALUES_USE_POOL
 	m_pMemPool = NULL;
@@ -228,55 +225,37 @@ HKeySymbol CKeyValuesSystem::GetSymbolForString( const char *name, bool bCreate
 		return (-1);
 	}
 
-	AUTO_LOCK( m_mutex );
-
-	int hash = CaseInsensitiveHash(name, m_HashTable.Count());
-	int i = 0;
-	hash_item_t *item = &m_HashTable[hash];
-	while (1)
+	uint32 nHash = m_SymbolIndex.HashString( name );
+	uint32 nSymbol = bCreate ? m_SymbolIndex.FindOrAdd( name, nHash ) : m_SymbolIndex.Find( name, nHash );
+	if ( nSymbol == UTL_STRINGINDEX_INVALID )
 	{
-		if (!stricmp(name, (char *)m_Strings.GetBase() + item->stringIndex ))
-		{
-			return (HKeySymbol)item->stringIndex;
-		}
+		return (-1);
+	}
 
-		i++;
+	return (HKeySymbol)nSymbol;
+}
 
-		if (item->next == NULL)
-		{
-			if ( !bCreate )
-			{
-				// not found
-				return -1;
-			}
-
-			// we're not in the table
-			if (item->stringIndex != 0)
-			{
-				// first item is used, an new item
-				item->next = (hash_item_t *)m_HashItemMemPool.Alloc(sizeof(hash_item_t));
-				item = item->next;
-			}
-
-			// build up the new item
-			item->next = NULL;
-			char *pString = (char *)m_Strings.Alloc( V_strlen(name) + 1 );
-			if ( !pString )
-			{
-				Error( "Out of keyvalue string space" );
-				return -1;
-			}
-			item->stringIndex = pString - (char *)m_Strings.GetBase();
-			strcpy(pString, name);
-			return (HKeySymbol)item->stringIndex;
-		}
+//-----------------------------------------------------------------------------
+// Purpose: copies a new key name into the string stack, called by the
+//			symbol index with the name's shard locked
+//-----------------------------------------------------------------------------
+uint32 CKeyValuesSystem::AddIndexedString( const char *pString )
+{
+	AUTO_LOCK( m_StringsMutex );
 
-		item = item->next;
+	char *pNewString = (char *)m_Strings.Alloc( V_strlen( pString ) + 1 );
+	if ( !pNewString )
+	{
+		Error( "Out of keyvalue string space" );
+		return UTL_STRINGINDEX_INVALID;
 	}
+	strcpy( pNewString, pString );
+	return (uint32)( pNewString - (char *)m_Strings.GetBase() );
+}
 
-	// shouldn't be able to get here
-	Assert(0);
-	return (-1);
+const char *CKeyValuesSystem::GetIndexedString( uint32 nValue ) const
+{
+	return (const char *)m_Strings.GetBase() + nValue;
 }
 
 //-----------------------------------------------------------------------------
@@ -375,28 +354,6 @@ void CKeyValuesSystem::InvalidateCache()
 	DoInvalidateCache();
 }
 
-//-----------------------------------------------------------------------------
-// Purpose: generates a simple hash value for a string
-//-----------------------------------------------------------------------------
-int CKeyValuesSystem::CaseInsensitiveHash(const char *string, int iBounds)
-{
-	unsigned int hash = 0;
-
-	for ( ; *string != 0; string++ )
-	{
-		if (*string >= 'A' && *string <= 'Z')
-		{
-			hash = (hash << 1) + (*string - 'A' + 'a');
-		}
-		else
-		{
-			hash = (hash << 1) + *string;
-		}
-	}
-	  
-	return hash % iBounds;
-}
-
 //-----------------------------------------------------------------------------
 // Purpose: Evicts everything from the cache, cleans up the memory used.
 //-----------------------------------------------------------------------------
@@ -10,6 +10,7 @@
 #include <ctype.h>
 #include "tier0/icommandline.h"
 #include "tier1/utlrbtree.h"
+#include "tier1/utlflathashtable.h"
 #include "tier1/strtools.h"
 #include "tier1/KeyValues.h"
 #include "tier1/convar.h"
@@ -114,11 +115,20 @@ private:
 
 	void DisplayQueuedMessages( );
 
+	// Makes the index point at the first command in the list with each name
+	void RebuildCommandIndex();
+	void ReindexCommandName( const char *pName );
+
 	CUtlVector< FnChangeCallback_t >	m_GlobalChangeCallbacks;
 	CUtlVector< IConsoleDisplayFunc* >	m_DisplayFuncs;
 	int									m_nNextDLLIdentifier;
 	ConCommandBase						*m_pConCommandList;
 
+	// Name -> command lookup. When several registered commands share a name,
+	// this holds the one FindCommandBase would hit first walking the list.
+	typedef CUtlFlatHashtable< const char *, ConCommandBase *, CaselessStringHashFunctor, CaselessStringEqualFunctor > CommandIndex_t;
+	CommandIndex_t						m_CommandIndex;
+
 	// temporary console area so we can store prints before console display funs are installed
 	mutable CUtlBuffer					m_TempConsoleBuffer;
 protected:
@@ -405,6 +415,10 @@ void CCvar::RegisterConCommand( ConCommandBase *variable )
 	// link the variable in
 	variable->m_pNext = m_pConCommandList;
 	m_pConCommandList = variable;
+
+	// It's now at the head of the list, so it shadows any other command with its name
+	m_CommandIndex.Remove( pName );
+	m_CommandIndex.Insert( pName, variable );
 }
 
 void CCvar::UnregisterConCommand( ConCommandBase *pCommandToRemove )
@@ -434,6 +448,12 @@ void CCvar::UnregisterConCommand( ConCommandBase *pCommandToRemove )
 			pPrev->m_pNext = pCommand->m_pNext;
 		}
 		pCommand->m_pNext = NULL;
+
+		const char *pName = pCommand->GetName();
+		if ( pName && pName[0] && m_CommandIndex.Get( pName, NULL ) == pCommand )
+		{
+			ReindexCommandName( pName );
+		}
 		break;
 	}
 }
@@ -471,6 +491,7 @@ void CCvar::UnregisterConCommands( CVarDLLIdentifier_t id )
 	}
 
 	m_pConCommandList = pNewList;
+	RebuildCommandIndex();
 }
 #ifdef WIN32
 #pragma optimize( "", on )
@@ -478,28 +499,49 @@ void CCvar::UnregisterConCommands( CVarDLLIdentifier_t id )
 
 
 //-----------------------------------------------------------------------------
-// Finds base commands 
+// Keeps the name index in sync with the command list
 //-----------------------------------------------------------------------------
-const ConCommandBase *CCvar::FindCommandBase( const char *name ) const
+void CCvar::ReindexCommandName( const char *pName )
 {
-	const ConCommandBase *cmd = GetCommands();
-	for ( ; cmd; cmd = cmd->GetNext() )
+	m_CommandIndex.Remove( pName );
+	for ( ConCommandBase *pCommand = m_pConCommandList; pCommand; pCommand = pCommand->m_pNext )
 	{
-		if ( !Q_stricmp( name, cmd->GetName() ) )
-			return cmd;
+		if ( !Q_stricmp( pName, pCommand->GetName() ) )
+		{
+			m_CommandIndex.Insert( pCommand->GetName(), pCommand );
+			break;
+		}
 	}
-	return NULL;
 }
 
-ConCommandBase *CCvar::FindCommandBase( const char *name )
+void CCvar::RebuildCommandIndex()
 {
-	ConCommandBase *cmd = GetCommands();
-	for ( ; cmd; cmd = cmd->GetNext() )
+	m_CommandIndex.RemoveAll();
+	for ( ConCommandBase *pCommand = m_pConCommandList; pCommand; pCommand = pCommand->m_pNext )
 	{
-		if ( !Q_stricmp( name, cmd->GetName() ) )
-			return cmd;
+		// Insert doesn't replace, so the first command with each name wins
+		m_CommandIndex.Insert( pCommand->GetName(), pCommand );
 	}
-	return NULL;
+}
+
+
+//-----------------------------------------------------------------------------
+// Finds base commands 
+//-----------------------------------------------------------------------------
+const ConCommandBase *CCvar::FindCommandBase( const char *name ) const
+{
+	if ( !name )
+		return NULL;
+
+	return m_CommandIndex.Get( name, NULL );
+}
+
+ConCommandBase *CCvar::FindCommandBase( const char *name )
+{
+	if ( !name )
+		return NULL;
+
+	return m_CommandIndex.Get( name, NULL );
 }
 
 
@@ -0,0 +1,732 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Jobs that run on their own stack and can suspend mid-execution
+//
+//=============================================================================
+
+#if defined( _WIN32 ) && !defined( _X360 )
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+#include "tier0/dbg.h"
+#include "tier0/threadtools.h"
+#include "vstdlib/jobfiber.h"
+#include "tier1/utlvector.h"
+
+// How the fiber's context is switched on this platform
+#if defined( _WIN32 ) && !defined( _X360 )
+#define FIBER_CONTEXT_WIN32
+#elif defined( __x86_64__ ) && defined( __linux__ )
+#define FIBER_CONTEXT_X64_ASM
+#elif defined( POSIX ) && !defined( ANDROID ) && !defined( __ANDROID__ )
+#define FIBER_CONTEXT_UCONTEXT
+#endif
+
+#if defined( FIBER_CONTEXT_X64_ASM ) || defined( FIBER_CONTEXT_UCONTEXT )
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef FIBER_CONTEXT_UCONTEXT
+#include <ucontext.h>
+#endif
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+// Stacks kept around for reuse, so short lived fiber jobs don't map memory
+#define FIBER_MAX_CACHED_STACKS		32
+
+// How often fibers suspended on an event are checked. Events can't be
+// hooked the way finishing jobs can, and CThreadEvent::WaitForMultiple()
+// spins on POSIX
+#define FIBER_WAIT_POLL_MS			1
+
+typedef void (*FiberEntry_t)( CFiberJobStack *pStack );
+
+//-----------------------------------------------------------------------------
+// Context switching
+//-----------------------------------------------------------------------------
+#if defined( FIBER_CONTEXT_X64_ASM )
+
+// The saved stack pointer, everything else is pushed on the stack
+typedef void *FiberContext_t;
+
+extern "C" void FiberJob_SwitchContext( void **ppSaveSP, void *pNewSP );
+extern "C" void FiberJob_StartTrampoline();
+
+// Saves the callee saved registers, mxcsr and x87 control word on the current
+// stack and switches to another one that was saved the same way. New stacks
+// start in the trampoline, which calls r13( r12 ).
+__asm__(
+	".text\n"
+	".globl FiberJob_SwitchContext\n"
+	".hidden FiberJob_SwitchContext\n"
+	".type FiberJob_SwitchContext,@function\n"
+	"FiberJob_SwitchContext:\n"
+	"	pushq %rbp\n"
+	"	pushq %rbx\n"
+	"	pushq %r12\n"
+	"	pushq %r13\n"
+	"	pushq %r14\n"
+	"	pushq %r15\n"
+	"	subq $8, %rsp\n"
+	"	stmxcsr (%rsp)\n"
+	"	fnstcw 4(%rsp)\n"
+	"	movq %rsp, (%rdi)\n"
+	"	movq %rsi, %rsp\n"
+	"	ldmxcsr (%rsp)\n"
+	"	fldcw 4(%rsp)\n"
+	"	addq $8, %rsp\n"
+	"	popq %r15\n"
+	"	popq %r14\n"
+	"	popq %r13\n"
+	"	popq %r12\n"
+	"	popq %rbx\n"
+	"	popq %rbp\n"
+	"	ret\n"
+	".size FiberJob_SwitchContext,.-FiberJob_SwitchContext\n"
+	".globl FiberJob_StartTrampoline\n"
+	".hidden FiberJob_StartTrampoline\n"
+	".type FiberJob_StartTrampoline,@function\n"
+	"FiberJob_StartTrampoline:\n"
+	"	movq %r12, %rdi\n"
+	"	call *%r13\n"
+	"	ud2\n"
+	".size FiberJob_StartTrampoline,.-FiberJob_StartTrampoline\n"
+);
+
+#elif defined( FIBER_CONTEXT_UCONTEXT )
+
+typedef ucontext_t FiberContext_t;
+
+#elif defined( FIBER_CONTEXT_WIN32 )
+
+// The fiber handle
+typedef LPVOID FiberContext_t;
+
+#endif
+
+//-----------------------------------------------------------------------------
+// A stack and the context of whatever is running on it. Stacks are reused
+// between jobs: FiberMain() loops, picking up the next job each time it's
+// switched to.
+//-----------------------------------------------------------------------------
+class CFiberJobStack
+{
+public:
+	CFiberJob *m_pJob;
+	unsigned m_nSize;
+	FiberEntry_t m_pfnEntry;
+#ifdef FIBER_CONTEXT_WIN32
+	FiberContext_t m_Context;
+#elif defined( FIBER_CONTEXT_X64_ASM ) || defined( FIBER_CONTEXT_UCONTEXT )
+	FiberContext_t m_Context;
+	void *m_pMemory;
+	size_t m_nMapped;
+#endif
+};
+
+#if defined( FIBER_CONTEXT_X64_ASM ) || defined( FIBER_CONTEXT_UCONTEXT ) || defined( FIBER_CONTEXT_WIN32 )
+#define FIBER_SUPPORTED
+
+static inline void SwitchContext( FiberContext_t *pFrom, FiberContext_t *pTo )
+{
+#if defined( FIBER_CONTEXT_X64_ASM )
+	FiberJob_SwitchContext( pFrom, *pTo );
+#elif defined( FIBER_CONTEXT_UCONTEXT )
+	swapcontext( pFrom, pTo );
+#elif defined( FIBER_CONTEXT_WIN32 )
+	// The current fiber's handle was stored by the caller
+	SwitchToFiber( *pTo );
+#endif
+}
+
+#ifdef FIBER_CONTEXT_UCONTEXT
+// makecontext() only passes ints
+static void FiberUContextEntry( unsigned int nLow, unsigned int nHigh )
+{
+	CFiberJobStack *pStack = (CFiberJobStack *)( ( (uint64)nHigh << 32 ) | nLow );
+	pStack->m_pfnEntry( pStack );
+}
+#endif
+
+#ifdef FIBER_CONTEXT_WIN32
+static VOID CALLBACK FiberWin32Entry( PVOID pParam )
+{
+	CFiberJobStack *pStack = (CFiberJobStack *)pParam;
+	pStack->m_pfnEntry( pStack );
+}
+#endif
+
+static CFiberJobStack *CreateStack( unsigned nSize, FiberEntry_t pfnEntry )
+{
+	CFiberJobStack *pStack = new CFiberJobStack;
+	pStack->m_pJob = NULL;
+	pStack->m_nSize = nSize;
+	pStack->m_pfnEntry = pfnEntry;
+
+#if defined( FIBER_CONTEXT_WIN32 )
+	pStack->m_Context = CreateFiber( nSize, FiberWin32Entry, pStack );
+	if ( !pStack->m_Context )
+	{
+		delete pStack;
+		return NULL;
+	}
+#else
+	// Lowest page is left unmapped to catch overflows
+	size_t nPage = sysconf( _SC_PAGESIZE );
+	size_t nMapped = ( ( nSize + nPage - 1 ) & ~( nPage - 1 ) ) + nPage;
+	void *pMemory = mmap( NULL, nMapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+	if ( pMemory == MAP_FAILED )
+	{
+		delete pStack;
+		return NULL;
+	}
+	mprotect( pMemory, nPage, PROT_NONE );
+	pStack->m_pMemory = pMemory;
+	pStack->m_nMapped = nMapped;
+
+#if defined( FIBER_CONTEXT_X64_ASM )
+	// Build the frame FiberJob_SwitchContext() pops: control words, r15..r12,
+	// rbx, rbp and a return into the trampoline. The return slot is placed so
+	// the stack is 16 byte aligned at the trampoline's call.
+	uint64 *pTop = (uint64 *)( (uint8 *)pMemory + nMapped );
+	uint64 *pFrame = pTop - 3 - 7;
+	pFrame[0] = 0x1F80 | ( (uint64)0x037F << 32 );		// mxcsr, fpu control word
+	pFrame[1] = 0;										// r15
+	pFrame[2] = 0;										// r14
+	pFrame[3] = (uint64)pfnEntry;						// r13
+	pFrame[4] = (uint64)pStack;							// r12
+	pFrame[5] = 0;										// rbx
+	pFrame[6] = 0;										// rbp
+	pFrame[7] = (uint64)FiberJob_StartTrampoline;		// return address
+	pStack->m_Context = pFrame;
+#else
+	getcontext( &pStack->m_Context );
+	pStack->m_Context.uc_stack.ss_sp = (uint8 *)pMemory + nPage;
+	pStack->m_Context.uc_stack.ss_size = nMapped - nPage;
+	pStack->m_Context.uc_link = NULL;
+	uint64 nStack = (uint64)(uintp)pStack;
+	makecontext( &pStack->m_Context, (void (*)())FiberUContextEntry, 2, (unsigned int)nStack, (unsigned int)( nStack >> 32 ) );
+#endif
+#endif
+
+	return pStack;
+}
+
+static void DestroyStack( CFiberJobStack *pStack )
+{
+#if defined( FIBER_CONTEXT_WIN32 )
+	DeleteFiber( pStack->m_Context );
+#else
+	munmap( pStack->m_pMemory, pStack->m_nMapped );
+#endif
+	delete pStack;
+}
+
+#endif // FIBER_CONTEXT_*
+
+//-----------------------------------------------------------------------------
+// Stack cache
+//-----------------------------------------------------------------------------
+static CThreadFastMutex g_StackCacheMutex;
+static CUtlVector< CFiberJobStack * > g_FreeStacks;
+
+static CFiberJobStack *AllocStack( unsigned nSize, FiberEntry_t pfnEntry )
+{
+#ifdef FIBER_SUPPORTED
+	{
+		AUTO_LOCK( g_StackCacheMutex );
+		for ( int i = g_FreeStacks.Count() - 1; i >= 0; --i )
+		{
+			if ( g_FreeStacks[i]->m_nSize == nSize )
+			{
+				CFiberJobStack *pStack = g_FreeStacks[i];
+				g_FreeStacks.FastRemove( i );
+				return pStack;
+			}
+		}
+	}
+	return CreateStack( nSize, pfnEntry );
+#else
+	return NULL;
+#endif
+}
+
+// Only stacks whose fiber ran to completion are back at the top of
+// FiberMain() and can be reused
+static void FreeStack( CFiberJobStack *pStack, bool bReusable )
+{
+#ifdef FIBER_SUPPORTED
+	pStack->m_pJob = NULL;
+	if ( bReusable )
+	{
+		AUTO_LOCK( g_StackCacheMutex );
+		if ( g_FreeStacks.Count() < FIBER_MAX_CACHED_STACKS )
+		{
+			g_FreeStacks.AddToTail( pStack );
+			return;
+		}
+	}
+	DestroyStack( pStack );
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Puts suspended fibers back in their pool once what they wait on is done.
+// A fiber waiting on a job is queued again by the thread that finishes the
+// job, so a worker that runs the job usually picks the fiber up next without
+// any other thread waking. Fibers waiting on an event, or yielding while
+// other jobs are queued, are queued again by the scheduler's thread.
+//-----------------------------------------------------------------------------
+class CFiberJobScheduler
+{
+public:
+	CFiberJobScheduler()
+	  : m_hThread( NULL ),
+		m_bExit( false )
+	{
+	}
+
+	// Both take over a reference to the job. ParkOnJob() returns false,
+	// keeping nothing, if the job the fiber waits on has already finished.
+	bool ParkOnJob( CFiberJob *pJob );
+	void Park( CFiberJob *pJob );
+
+	void OnJobFinished( CJob *pFinishedJob );
+	void Shutdown();
+
+private:
+	static uintp ThreadFunc( void *pParam );
+	void Run();
+	static void Resume( CFiberJob *pJob );
+	static bool IsWaitSatisfied( CFiberJob *pJob );
+
+	CThreadMutex m_mutex;
+	CUtlVector< CFiberJob * > m_Waiting;
+	CThreadEvent m_WakeEvent;
+	ThreadHandle_t m_hThread;
+	volatile bool m_bExit;
+
+	CThreadMutex m_JobWaitMutex;
+	CUtlVector< CFiberJob * > m_WaitingOnJob;
+};
+
+// Never destroyed, its thread may still be waiting during static destruction
+static CFiberJobScheduler &FiberJobScheduler()
+{
+	static CFiberJobScheduler *s_pScheduler = new CFiberJobScheduler;
+	return *s_pScheduler;
+}
+
+bool CFiberJobScheduler::ParkOnJob( CFiberJob *pJob )
+{
+	// Registered before the job is asked to notify, so OnJobFinished() can't
+	// miss the fiber
+	AUTO_LOCK( m_JobWaitMutex );
+	if ( !pJob->m_pWaitJob->RequestFinishNotify() )
+	{
+		return false;
+	}
+	m_WaitingOnJob.AddToTail( pJob );
+	return true;
+}
+
+void CFiberJobScheduler::OnJobFinished( CJob *pFinishedJob )
+{
+	CUtlVectorFixedGrowable< CFiberJob *, 8 > ready;
+	{
+		AUTO_LOCK( m_JobWaitMutex );
+		for ( int i = 0; i < m_WaitingOnJob.Count(); )
+		{
+			if ( m_WaitingOnJob[i]->m_pWaitJob == pFinishedJob )
+			{
+				ready.AddToTail( m_WaitingOnJob[i] );
+				m_WaitingOnJob.FastRemove( i );
+			}
+			else
+			{
+				i++;
+			}
+		}
+	}
+
+	for ( int i = 0; i < ready.Count(); i++ )
+	{
+		Resume( ready[i] );
+	}
+}
+
+void CFiberJobScheduler::Park( CFiberJob *pJob )
+{
+	{
+		AUTO_LOCK( m_mutex );
+		m_Waiting.AddToTail( pJob );
+		if ( !m_hThread )
+		{
+			m_bExit = false;
+			m_hThread = CreateSimpleThread( ThreadFunc, this );
+			ThreadSetDebugName( m_hThread, "FiberJobScheduler" );
+		}
+	}
+	m_WakeEvent.Set();
+}
+
+void CFiberJobScheduler::Shutdown()
+{
+	ThreadHandle_t hThread;
+	{
+		AUTO_LOCK( m_mutex );
+		AssertMsg( m_Waiting.Count() == 0 && m_WaitingOnJob.Count() == 0, "Fiber jobs still suspended at shutdown" );
+		hThread = m_hThread;
+		m_hThread = NULL;
+		m_bExit = true;
+		m_WakeEvent.Set();
+	}
+
+	if ( hThread )
+	{
+		ThreadJoin( hThread );
+		ReleaseThreadHandle( hThread );
+	}
+}
+
+uintp CFiberJobScheduler::ThreadFunc( void *pParam )
+{
+	( (CFiberJobScheduler *)pParam )->Run();
+	return 0;
+}
+
+bool CFiberJobScheduler::IsWaitSatisfied( CFiberJob *pJob )
+{
+	if ( pJob->m_pWaitEvent )
+	{
+		// Consumes an auto reset event, the fiber is resumed right after
+		return pJob->m_pWaitEvent->Wait( 0 );
+	}
+	return true;
+}
+
+void CFiberJobScheduler::Run()
+{
+	CUtlVector< CFiberJob * > ready;
+	while ( !m_bExit )
+	{
+		bool bPolling = false;
+		{
+			AUTO_LOCK( m_mutex );
+			for ( int i = 0; i < m_Waiting.Count(); )
+			{
+				if ( IsWaitSatisfied( m_Waiting[i] ) )
+				{
+					ready.AddToTail( m_Waiting[i] );
+					m_Waiting.Remove( i );
+				}
+				else
+				{
+					bPolling = bPolling || ( m_Waiting[i]->m_pWaitEvent != NULL );
+					i++;
+				}
+			}
+		}
+
+		for ( int i = 0; i < ready.Count(); i++ )
+		{
+			Resume( ready[i] );
+		}
+		ready.RemoveAll();
+
+		m_WakeEvent.Wait( bPolling ? FIBER_WAIT_POLL_MS : TT_INFINITE );
+	}
+}
+
+void CFiberJobScheduler::Resume( CFiberJob *pJob )
+{
+	// The worker that parked the job may still be on its way out of
+	// CJob::Execute(), it has to let go before the job can be queued again
+	pJob->Lock();
+	bool bAborted = pJob->IsFinished();
+	pJob->Unlock();
+
+	if ( !bAborted )
+	{
+		pJob->ClearServiceThread();
+		IThreadPool *pPool = pJob->GetThreadPool() ? pJob->GetThreadPool() : g_pThreadPool;
+		pPool->AddJob( pJob );
+	}
+
+	pJob->Release();
+}
+
+//-----------------------------------------------------------------------------
+// CFiberJob
+//-----------------------------------------------------------------------------
+static CTHREADLOCALPTR( CFiberJob ) g_pCurrentFiberJob;
+
+CFiberJob::CFiberJob( JobPriority_t priority, unsigned nStackSize )
+  : CJob( priority ),
+	m_pStack( NULL ),
+	m_pReturnContext( NULL ),
+	m_nStackSize( nStackSize ),
+	m_FiberState( FIBER_NOT_STARTED ),
+	m_FiberResult( JOB_OK ),
+	m_nYields( 0 ),
+	m_pWaitJob( NULL ),
+	m_pWaitEvent( NULL )
+{
+	SetFlags( JF_QUEUE );
+}
+
+CFiberJob::~CFiberJob()
+{
+	Assert( m_FiberState != FIBER_RUNNING );
+
+	// Aborted while suspended
+	if ( m_pWaitJob )
+	{
+		m_pWaitJob->Release();
+	}
+	if ( m_pStack )
+	{
+		FreeStack( m_pStack, false );
+	}
+}
+
+CFiberJob *CFiberJob::GetCurrent()
+{
+	return g_pCurrentFiberJob;
+}
+
+bool CFiberJob::IsSupported()
+{
+#ifdef FIBER_SUPPORTED
+	return true;
+#else
+	return false;
+#endif
+}
+
+void CFiberJob::FiberMain( CFiberJobStack *pStack )
+{
+	for ( ;; )
+	{
+		CFiberJob *pJob = pStack->m_pJob;
+		pJob->m_FiberResult = pJob->DoFiberExecute();
+		pJob->m_FiberState = FIBER_FINISHED;
+
+#ifdef FIBER_SUPPORTED
+		// Back to DoExecute(), which hands the stack to the next job
+		SwitchContext( &pStack->m_Context, (FiberContext_t *)pJob->m_pReturnContext );
+#endif
+	}
+}
+
+JobStatus_t CFiberJob::DoExecute()
+{
+	CFiberJob *pPrevFiber = g_pCurrentFiberJob;
+	g_pCurrentFiberJob = this;
+
+	if ( m_FiberState == FIBER_NOT_STARTED )
+	{
+		m_pStack = AllocStack( m_nStackSize, FiberMain );
+		if ( m_pStack )
+		{
+			m_pStack->m_pJob = this;
+		}
+	}
+
+	if ( !m_pStack )
+	{
+		// No context switch here, run on the worker's stack and let the
+		// yields block
+		m_FiberState = FIBER_RUNNING;
+		m_FiberResult = DoFiberExecute();
+		m_FiberState = FIBER_FINISHED;
+		g_pCurrentFiberJob = pPrevFiber;
+		return m_FiberResult;
+	}
+
+#ifdef FIBER_SUPPORTED
+	FiberContext_t returnContext;
+#ifdef FIBER_CONTEXT_WIN32
+	if ( !IsThreadAFiber() )
+	{
+		ConvertThreadToFiber( NULL );
+	}
+	returnContext = GetCurrentFiber();
+#endif
+	m_pReturnContext = &returnContext;
+
+	// A yield whose wait is already satisfied switches straight back in,
+	// without leaving this worker
+	do
+	{
+		m_FiberState = FIBER_RUNNING;
+		SwitchContext( &returnContext, &m_pStack->m_Context );
+	} while ( m_FiberState == FIBER_SUSPENDED && !Park() );
+
+	m_pReturnContext = NULL;
+#endif
+	g_pCurrentFiberJob = pPrevFiber;
+
+	if ( m_FiberState == FIBER_FINISHED )
+	{
+		FreeStack( m_pStack, true );
+		m_pStack = NULL;
+		return m_FiberResult;
+	}
+
+	// Parked, it's added to the pool again once the wait is satisfied
+	return JOB_STATUS_PENDING;
+}
+
+// Hands the suspended fiber to the scheduler, which holds a reference until
+// the job is queued again. Returns false if it should just carry on.
+bool CFiberJob::Park()
+{
+	if ( m_pWaitJob )
+	{
+		AddRef();
+		if ( FiberJobScheduler().ParkOnJob( this ) )
+		{
+			return true;
+		}
+		Release();
+		return false;
+	}
+
+	if ( m_pWaitEvent )
+	{
+		if ( m_pWaitEvent->Wait( 0 ) )
+		{
+			return false;
+		}
+	}
+	else
+	{
+		// YieldToPool(): only step aside for jobs no worker has taken yet,
+		// the pool counts the ones being serviced as well
+		IThreadPool *pPool = GetThreadPool() ? GetThreadPool() : g_pThreadPool;
+		if ( (int)pPool->GetJobCount() <= pPool->NumThreads() - pPool->NumIdleThreads() )
+		{
+			return false;
+		}
+	}
+
+	AddRef();
+	FiberJobScheduler().Park( this );
+	return true;
+}
+
+void CFiberJob::Suspend()
+{
+	Assert( (CFiberJob *)g_pCurrentFiberJob == this && m_pStack );
+
+	m_FiberState = FIBER_SUSPENDED;
+	++m_nYields;
+
+#ifdef FIBER_SUPPORTED
+	SwitchContext( &m_pStack->m_Context, (FiberContext_t *)m_pReturnContext );
+#endif
+
+	// Resumed, possibly on another thread
+	Assert( m_FiberState == FIBER_RUNNING );
+}
+
+void CFiberJob::YieldUntilFinished( CJob *pJob )
+{
+	if ( !pJob || pJob->IsFinished() )
+	{
+		return;
+	}
+
+	if ( (CFiberJob *)g_pCurrentFiberJob != this || !m_pStack )
+	{
+		g_pThreadPool->YieldWait( pJob );
+		return;
+	}
+
+	pJob->AddRef();
+	m_pWaitJob = pJob;
+	Suspend();
+	m_pWaitJob = NULL;
+	pJob->Release();
+}
+
+void CFiberJob::YieldUntilSet( CThreadEvent *pEvent )
+{
+	if ( (CFiberJob *)g_pCurrentFiberJob != this || !m_pStack )
+	{
+		pEvent->Wait();
+		return;
+	}
+
+	if ( pEvent->Wait( 0 ) )
+	{
+		return;
+	}
+
+	m_pWaitEvent = pEvent;
+	Suspend();
+	m_pWaitEvent = NULL;
+}
+
+void CFiberJob::YieldToPool()
+{
+	if ( (CFiberJob *)g_pCurrentFiberJob != this || !m_pStack )
+	{
+		ThreadSleep( 0 );
+		return;
+	}
+
+	Suspend();
+}
+
+//-----------------------------------------------------------------------------
+
+void FiberJob_YieldUntilFinished( CJob *pJob )
+{
+	CFiberJob *pFiber = CFiberJob::GetCurrent();
+	if ( pFiber )
+	{
+		pFiber->YieldUntilFinished( pJob );
+	}
+	else if ( pJob && !pJob->IsFinished() )
+	{
+		g_pThreadPool->YieldWait( pJob );
+	}
+}
+
+void FiberJob_YieldUntilSet( CThreadEvent *pEvent )
+{
+	CFiberJob *pFiber = CFiberJob::GetCurrent();
+	if ( pFiber )
+	{
+		pFiber->YieldUntilSet( pEvent );
+	}
+	else
+	{
+		pEvent->Wait();
+	}
+}
+
+void FiberJob_NotifyJobFinished( CJob *pJob )
+{
+	FiberJobScheduler().OnJobFinished( pJob );
+}
+
+void FiberJob_Shutdown()
+{
+	FiberJobScheduler().Shutdown();
+
+	AUTO_LOCK( g_StackCacheMutex );
+	for ( int i = 0; i < g_FreeStacks.Count(); i++ )
+	{
+#ifdef FIBER_SUPPORTED
+		DestroyStack( g_FreeStacks[i] );
+#endif
+	}
+	g_FreeStacks.RemoveAll();
+}